@@ -0,0 +1,56 @@
+#pragma once
+
+#include <webkit/webkit.h>
+
+class PasswordManager;
+
+/**
+ * AutofillScript fills login forms through one WebKitUserScript and one
+ * script message handler, both registered once on a WebKitUserContentManager
+ * that every tab's WebView shares (Tab::create_webview()).
+ *
+ * The script runs at document end in the top frame, in its own script
+ * world, so page JavaScript can neither see it nor post to its handler, and
+ * location.origin there is the frame's real origin. On a page without a
+ * password field it costs one querySelector() and a capturing focusin
+ * listener that checks again when an input is focused (for forms rendered
+ * later). Only when it finds a password field does it post the origin; the
+ * handler replies with the most recently used credential saved for exactly
+ * that host from PasswordManager::autofill(), or null, and the script fills
+ * the fields unless the user has typed a different username. After a null,
+ * a trusted click or key press in the form asks again, and the answer may
+ * then be a login saved for another host of the same site.
+ *
+ * Ownership: shared() lives for the process and keeps its content manager.
+ * The password manager is not owned; clear it before destroying it.
+ */
+class AutofillScript {
+public:
+    static constexpr const char* WORLD_NAME = "ryxsurf-autofill";
+    static constexpr const char* HANDLER_NAME = "ryxsurfAutofill";
+
+    // Non-copyable, non-movable (signal handlers point at this)
+    AutofillScript(const AutofillScript&) = delete;
+    AutofillScript& operator=(const AutofillScript&) = delete;
+    AutofillScript(AutofillScript&&) = delete;
+    AutofillScript& operator=(AutofillScript&&) = delete;
+
+    // Created with the script and handler on first call
+    WebKitUserContentManager* get_content_manager();
+
+    // Credentials come from `manager`; nullptr answers every form with null
+    void set_password_manager(PasswordManager* manager) { password_manager_ = manager; }
+
+    static const char* source();
+
+    static AutofillScript& shared();
+
+private:
+    AutofillScript();
+
+    WebKitUserContentManager* content_manager_;
+    PasswordManager* password_manager_;
+
+    static gboolean on_message(WebKitUserContentManager* manager, JSCValue* value,
+                               WebKitScriptMessageReply* reply, gpointer user_data);
+};
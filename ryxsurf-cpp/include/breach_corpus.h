@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * BreachCorpus answers "has this password appeared in a breach?" offline,
+ * from a local copy of a breached-password hash list such as Have I Been
+ * Pwned's "ordered by hash" SHA-1 download. No password or hash prefix ever
+ * leaves the machine.
+ *
+ * Layout: the corpus file is the list's SHA-1 hashes as raw 20-byte records
+ * in ascending order (convert_hibp_text() turns the text download into it,
+ * about 17 GB for the full list). It is mmap'd read-only with random-access
+ * advice and never read as a whole. Hashes are uniformly distributed, so a
+ * lookup interpolates on the first 8 bytes and usually lands within a page
+ * or two of the answer; after MAX_INTERPOLATION_STEPS it falls back to
+ * binary search on whatever range is left.
+ *
+ * Bloom filter: build_bloom_filter() writes "<corpus>.bloom", a blocked
+ * Bloom filter in which each hash sets bits within one 64-byte block (about
+ * 1.25 bytes per entry at the default 10 bits). open() maps it too when it
+ * matches the corpus. A password not in the filter is rejected after one
+ * cache line, without faulting in corpus pages, which keeps the resident
+ * set small when auditing many passwords that are mostly not breached.
+ * Bloom file layout (host byte order, checked via BloomHeader::byte_order):
+ *   BloomHeader | uint64_t[8] per block
+ *
+ * Ownership: BreachCorpus owns both mappings; close() releases them.
+ * Thread-safety: after open(), lookups may run concurrently.
+ */
+class BreachCorpus {
+public:
+    static constexpr size_t HASH_SIZE = 20;
+    static constexpr unsigned DEFAULT_BLOOM_BITS = 10;
+    static constexpr int MAX_INTERPOLATION_STEPS = 8;
+    static constexpr uint32_t BLOOM_VERSION = 1;
+
+    struct BloomHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t record_count;  // Of the corpus it was built from
+        uint64_t block_count;
+        uint32_t probes;  // Bits set per hash, each 9 bits of the hash
+        uint32_t reserved[7];
+    };
+
+    BreachCorpus();
+    ~BreachCorpus();
+
+    // Non-copyable, non-movable (owns mappings)
+    BreachCorpus(const BreachCorpus&) = delete;
+    BreachCorpus& operator=(const BreachCorpus&) = delete;
+    BreachCorpus(BreachCorpus&&) = delete;
+    BreachCorpus& operator=(BreachCorpus&&) = delete;
+
+    // Map a corpus, and "<path>.bloom" if it exists and was built from it
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return open_; }
+    size_t size() const { return record_count_; }
+    bool has_bloom_filter() const { return bloom_blocks_ != nullptr; }
+
+    bool contains(std::string_view password) const;
+    bool contains_hash(const unsigned char* sha1) const;
+    static void sha1(std::string_view data, unsigned char out[HASH_SIZE]);
+
+    // One sequential pass over the corpus; the filter is built in memory
+    // (about bits_per_entry / 8 bytes per hash) and renamed into place
+    static bool build_bloom_filter(const std::string& corpus_path, unsigned bits_per_entry = DEFAULT_BLOOM_BITS);
+
+    // Convert "HASH:COUNT" lines (upper- or lowercase hex, ascending) to the
+    // corpus layout; false on a malformed or out-of-order line
+    static bool convert_hibp_text(std::istream& in, std::ostream& out, size_t* count = nullptr);
+
+    // Default corpus: $RYXSURF_BREACH_CORPUS, else
+    // $XDG_DATA_HOME/ryxsurf/breached-passwords.sha1
+    static std::string default_path();
+
+private:
+    bool open_;
+    const unsigned char* records_;
+    size_t record_count_;
+    void* mapping_;
+    size_t mapping_size_;
+    void* bloom_mapping_;
+    size_t bloom_mapping_size_;
+    const uint64_t* bloom_blocks_;
+    uint64_t bloom_block_count_;
+    uint32_t bloom_probes_;
+
+    bool open_bloom_filter(const std::string& path);
+    bool bloom_may_contain(const unsigned char* sha1) const;
+    bool search(const unsigned char* sha1) const;
+};
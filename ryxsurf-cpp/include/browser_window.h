@@ -66,20 +66,33 @@ private:
     std::unique_ptr<KeyboardHandler> keyboard_handler_;
     std::unique_ptr<class TabUnloadManager> unload_manager_;
     std::unique_ptr<class PersistenceManager> persistence_manager_;
+    std::unique_ptr<class BreachCorpus> breach_corpus_;  // Outlives password_manager_
     std::unique_ptr<class PasswordManager> password_manager_;
     std::unique_ptr<class ThemeManager> theme_manager_;
     guint unload_timer_id_;
+    guint restore_idle_id_;
+    guint refresh_idle_id_;
+    SessionObserverList::ObserverId model_observer_id_;
     
     // UI creation methods
     void create_window_controls();
     
+    // Startup: restore from SQLite (deferred to idle after a snapshot preview)
+    void restore_sessions();
+    void show_snapshot_preview(const class SessionSnapshot& snapshot);
+    
     // UI update methods
     void update_tab_bar();
+    void clear_tab_strip();
+    void append_tab_button(size_t index, const std::string& title, bool active, bool unloaded);
+    void append_new_tab_button();
     void update_address_bar();
     void update_notebook();
     void update_session_indicator();
     void update_sidebar();
     void refresh_ui();
+    // Coalesce refreshes triggered by model events into one idle redraw
+    void schedule_refresh();
     
     // Signal handlers
     static void on_address_bar_activated(GtkEntry* entry, gpointer user_data);
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "password_manager.h"
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Password export layouts CredentialReader understands.
+ */
+enum class CredentialFormat {
+    ChromiumCsv,    // name,url,username,password[,note]
+    FirefoxCsv,     // "url","username","password",...,"timeCreated",...,"timeLastUsed" (ms)
+    BitwardenJson,  // {"items": [{"type": 1, "login": {"uris": [{"uri": ...}], ...}}]}
+};
+
+/**
+ * CredentialReader pulls credentials out of a password export one at a time.
+ * Input is read in fixed-size blocks and parsed incrementally, so memory use
+ * does not grow with the size of the export: CSV rows and Bitwarden items are
+ * decoded as they arrive and never collected.
+ *
+ * CSV columns are matched by header name, ASCII case-insensitively. Each
+ * login's domain is the host of its URL. Logins whose URL is not http(s)
+ * (Android apps) or that have no password (federated sign-ins), and
+ * Bitwarden items that are not logins, are counted in skipped() instead.
+ *
+ * The second constructor reads an EncryptedCredentialWriter export.
+ */
+class CredentialReader {
+public:
+    CredentialReader(std::istream& in, CredentialFormat format);
+    CredentialReader(std::istream& in, const std::string& passphrase);
+    ~CredentialReader();
+
+    // Non-copyable, non-movable (holds a reference to the stream)
+    CredentialReader(const CredentialReader&) = delete;
+    CredentialReader& operator=(const CredentialReader&) = delete;
+    CredentialReader(CredentialReader&&) = delete;
+    CredentialReader& operator=(CredentialReader&&) = delete;
+
+    // Next login; false at the end of the input or on an error
+    bool next(Credential& credential);
+
+    bool failed() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+    size_t skipped() const { return skipped_; }
+
+private:
+    class Source;
+    class DecryptingSource;
+
+    std::unique_ptr<Source> source_;
+    CredentialFormat format_;
+    std::string error_;
+    size_t skipped_;
+    bool started_;
+
+    // CSV: column of each field in the header, -1 when absent
+    int url_column_;
+    int username_column_;
+    int password_column_;
+    int created_column_;
+    int last_used_column_;
+
+    // JSON: position within the top-level object
+    bool in_items_;
+    bool first_item_;
+    bool after_member_;
+
+    bool fail(const std::string& message);
+    bool accept(Credential& credential, std::string_view url, std::string username, std::string password);
+
+    bool read_csv_row(std::vector<std::string>& fields);
+    bool read_csv_header();
+    bool next_csv(Credential& credential);
+
+    void skip_whitespace();
+    bool expect(char c);
+    bool read_json_string(std::string& out);
+    bool read_json_scalar(std::string& out);
+    bool read_json_string_or_null(std::string& out);
+    bool read_json_object(const std::function<bool(const std::string& key)>& on_member);
+    bool read_json_array(const std::function<bool()>& on_element);
+    bool skip_json_value(int depth = 0);
+    bool read_json_item(bool& is_login, std::string& url, std::string& username, std::string& password);
+    bool next_json(Credential& credential);
+};
+
+/**
+ * EncryptedCredentialWriter produces a passphrase-protected export that
+ * CredentialReader reads back, timestamps included.
+ *
+ * Layout: an 8-byte magic ("RYXCRED" + format version), a KDF header with
+ * the Argon2id parameters and salt (version 1 exports have a bare salt and
+ * default parameters; both read back), then frames of up to FRAME_SIZE
+ * plaintext bytes, each a little-endian uint32 length followed by
+ * Crypto::encrypt() of (frame index, final flag, data). The plaintext is
+ * Firefox-style CSV. Frame indices and the final flag are authenticated, so
+ * reordered, dropped or truncated frames fail to read.
+ */
+class EncryptedCredentialWriter {
+public:
+    static constexpr size_t FRAME_SIZE = 64 * 1024;
+
+    explicit EncryptedCredentialWriter(std::ostream& out);
+
+    // Derive the key and write the header; false on a stream or KDF error
+    bool begin(const std::string& passphrase);
+    bool write(const Credential& credential);
+    // Flush the final frame; the export is unreadable without it
+    bool finish();
+
+    size_t written() const { return written_; }
+
+private:
+    std::ostream& out_;
+    SecureBuffer key_;
+    std::string pending_;
+    std::vector<unsigned char> frame_;  // Reused for every frame
+    uint64_t frame_index_;
+    size_t written_;
+
+    bool flush_frame(bool final);
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "secure_memory.h"
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <sodium.h>
@@ -9,15 +12,45 @@
  * Crypto utilities for password-based encryption.
  * 
  * Uses Argon2id for key derivation and ChaCha20-Poly1305 for encryption.
+ * 
+ * Keys are SecureBuffers (SecurePool memory: locked, zeroed when freed).
+ * 
+ * KDF parameters: files keyed from a password store the parameters they
+ * were derived with in a KDF header next to the salt (see
+ * encode_kdf_header()), so the cost can change per host without breaking
+ * existing files. calibrate_kdf() picks parameters for a latency budget.
  */
 class Crypto {
 public:
-    // Argon2id parameters
+    // Default Argon2id parameters (and the ones behind every bare 16-byte salt)
     static constexpr unsigned long long OPS_LIMIT = 3;
     static constexpr size_t MEM_LIMIT = 64 * 1024 * 1024;  // 64 MB
+    // Calibration bounds
+    static constexpr unsigned long long MAX_OPS_LIMIT = 16;
+    static constexpr size_t MIN_MEM_LIMIT = 8 * 1024 * 1024;          // 8 MB
+    static constexpr size_t MAX_MEM_LIMIT = 1024ULL * 1024 * 1024;    // 1 GB
     static constexpr unsigned int SALT_SIZE = 16;
     static constexpr unsigned int KEY_SIZE = 32;    // crypto_aead_xchacha20poly1305_ietf_KEYBYTES
     static constexpr unsigned int NONCE_SIZE = 24;  // crypto_aead_xchacha20poly1305_ietf_NPUBBYTES
+    static constexpr unsigned int TAG_SIZE = 16;    // crypto_aead_xchacha20poly1305_ietf_ABYTES
+    // What encrypt() adds to a plaintext: nonce in front, tag behind
+    static constexpr unsigned int SEALED_OVERHEAD = NONCE_SIZE + TAG_SIZE;
+    // Magic, version, algorithm, reserved, ops (u32 LE), memory in KiB (u32 LE), salt
+    static constexpr unsigned int KDF_HEADER_SIZE = 32;
+    
+    /**
+     * Password hashing parameters.
+     */
+    struct KdfParams {
+        int algorithm = crypto_pwhash_argon2id_ALG_ARGON2ID13;
+        unsigned long long ops_limit = OPS_LIMIT;
+        size_t mem_limit = MEM_LIMIT;
+        
+        bool operator==(const KdfParams& other) const {
+            return algorithm == other.algorithm && ops_limit == other.ops_limit && mem_limit == other.mem_limit;
+        }
+        bool operator!=(const KdfParams& other) const { return !(*this == other); }
+    };
     
     /**
      * Derive encryption key from password using Argon2id.
@@ -26,8 +59,36 @@ public:
      * @param salt Salt (16 bytes, will be generated if empty)
      * @return Pair of (derived_key, salt)
      */
-    static std::pair<std::vector<unsigned char>, std::vector<unsigned char>>
-    derive_key(const std::string& password, const std::vector<unsigned char>& salt = {});
+    static std::pair<SecureBuffer, std::vector<unsigned char>>
+    derive_key(std::string_view password, const std::vector<unsigned char>& salt = {});
+    
+    /**
+     * Derive encryption key with explicit Argon2id parameters.
+     */
+    static std::pair<SecureBuffer, std::vector<unsigned char>>
+    derive_key(std::string_view password, const std::vector<unsigned char>& salt, const KdfParams& params);
+    
+    /**
+     * Measure Argon2id on this host and pick parameters whose derivation
+     * takes about `budget`: memory first (up to `max_mem_limit`, or a quarter
+     * of physical memory when zero), then passes. Runs two or three
+     * derivations, so it takes a few times the budget.
+     */
+    static KdfParams calibrate_kdf(std::chrono::milliseconds budget, size_t max_mem_limit = 0);
+    
+    /**
+     * Serialize `params` and `salt` as a KDF_HEADER_SIZE-byte header.
+     */
+    static std::vector<unsigned char> encode_kdf_header(const KdfParams& params, const std::vector<unsigned char>& salt);
+    
+    /**
+     * Parse a KDF header, or a bare SALT_SIZE-byte salt (default parameters).
+     * 
+     * @return false if `size` matches neither, or the header is from a newer
+     *         version or names parameters this build cannot use
+     */
+    static bool decode_kdf_header(const unsigned char* data, size_t size, KdfParams& params,
+                                  std::vector<unsigned char>& salt);
     
     /**
      * Encrypt data using ChaCha20-Poly1305.
@@ -37,7 +98,7 @@ public:
      * @return Encrypted data (nonce + ciphertext + tag)
      */
     static std::vector<unsigned char>
-    encrypt(const std::vector<unsigned char>& plaintext, const std::vector<unsigned char>& key);
+    encrypt(const std::vector<unsigned char>& plaintext, const SecureBuffer& key);
     
     /**
      * Decrypt data using ChaCha20-Poly1305.
@@ -47,13 +108,46 @@ public:
      * @return Decrypted data
      */
     static std::vector<unsigned char>
-    decrypt(const std::vector<unsigned char>& ciphertext, const std::vector<unsigned char>& key);
+    decrypt(const std::vector<unsigned char>& ciphertext, const SecureBuffer& key);
+    
+    /**
+     * Size of encrypt()'s output for a plaintext of `plaintext_size` bytes.
+     */
+    static constexpr size_t sealed_size(size_t plaintext_size) { return plaintext_size + SEALED_OVERHEAD; }
+    
+    /**
+     * Encrypt into a caller-provided buffer; allocates nothing.
+     * 
+     * @param out At least sealed_size(size) bytes, receives nonce +
+     *            ciphertext + tag. `plaintext` may be out + NONCE_SIZE to
+     *            encrypt in place; any other overlap is not allowed.
+     * @return Bytes written (sealed_size(size))
+     */
+    static size_t encrypt(const unsigned char* plaintext, size_t size, const SecureBuffer& key,
+                          unsigned char* out);
+    
+    /**
+     * Decrypt into a caller-provided buffer; allocates nothing.
+     * 
+     * @param sealed nonce + ciphertext + tag, as encrypt() writes it
+     * @param out At least size - SEALED_OVERHEAD bytes. May be
+     *            sealed + NONCE_SIZE to decrypt in place; any other overlap
+     *            is not allowed.
+     * @return Plaintext size
+     */
+    static size_t decrypt(const unsigned char* sealed, size_t size, const SecureBuffer& key,
+                          unsigned char* out);
     
     /**
      * Generate random bytes.
      */
     static std::vector<unsigned char> random_bytes(size_t size);
     
+    /**
+     * Generate a random KEY_SIZE-byte key.
+     */
+    static SecureBuffer random_key();
+    
     /**
      * Initialize libsodium (call once at startup).
      */
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "secure_memory.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <gio/gio.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * CryptoStream encrypts and decrypts byte streams of any length (session
+ * snapshots, exports, profile backups) with libsodium's secretstream
+ * (XChaCha20-Poly1305), in constant memory: the input is read and sealed
+ * one chunk at a time, so neither the whole plaintext nor the whole
+ * ciphertext is ever held. Crypto::encrypt() stays the API for small blobs.
+ *
+ * Layout:
+ *   "RXSS" | version | 3 reserved | chunk size (u32 LE) | secretstream header
+ *   then one sealed chunk per chunk_size bytes of plaintext, each
+ *   CHUNK_OVERHEAD bytes longer, the last one shorter (possibly empty) and
+ *   tagged final.
+ * The 12-byte prefix is authenticated with every chunk. Reordered, dropped,
+ * truncated or trailing chunks fail decryption.
+ *
+ * Decryption writes each chunk as soon as it is authenticated, so on a
+ * false return the sink has received a prefix of the plaintext: discard it.
+ *
+ * Errors: functions return false and set `error` (when given); they never
+ * throw for bad input or I/O errors. Call Crypto::init() first.
+ */
+class CryptoStream {
+public:
+    static constexpr unsigned int PREFIX_SIZE = 12;
+    static constexpr unsigned int HEADER_SIZE = PREFIX_SIZE + 24;  // + crypto_secretstream_xchacha20poly1305_HEADERBYTES
+    static constexpr unsigned int CHUNK_OVERHEAD = 17;             // crypto_secretstream_xchacha20poly1305_ABYTES
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+    static constexpr unsigned char VERSION = 1;
+
+    // Reads up to `size` bytes: the count read, 0 at the end, -1 on error
+    using Reader = std::function<ssize_t(unsigned char* buffer, size_t size)>;
+    // Writes all `size` bytes; false on error
+    using Writer = std::function<bool(const unsigned char* data, size_t size)>;
+
+    /**
+     * Encrypt everything `in` yields to `out`.
+     *
+     * @param key Crypto::KEY_SIZE bytes
+     * @param chunk_size Plaintext bytes per chunk (1 to MAX_CHUNK_SIZE);
+     *                   memory use is about twice this
+     */
+    static bool encrypt(const Reader& in, const Writer& out, const SecureBuffer& key,
+                        std::string* error = nullptr, size_t chunk_size = CHUNK_SIZE);
+
+    /**
+     * Decrypt an encrypt() stream from `in` to `out`.
+     */
+    static bool decrypt(const Reader& in, const Writer& out, const SecureBuffer& key,
+                        std::string* error = nullptr);
+
+    // File descriptors (pipes, sockets or files), read and written from their current offsets
+    static bool encrypt_fd(int in_fd, int out_fd, const SecureBuffer& key,
+                           std::string* error = nullptr);
+    static bool decrypt_fd(int in_fd, int out_fd, const SecureBuffer& key,
+                           std::string* error = nullptr);
+
+    // GIO streams; blocking, so run off the main thread for large inputs.
+    // Neither stream is closed.
+    static bool encrypt_gio(GInputStream* in, GOutputStream* out, const SecureBuffer& key,
+                            GCancellable* cancellable = nullptr, std::string* error = nullptr);
+    static bool decrypt_gio(GInputStream* in, GOutputStream* out, const SecureBuffer& key,
+                            GCancellable* cancellable = nullptr, std::string* error = nullptr);
+
+    /**
+     * Size of encrypt()'s output for `plaintext_size` bytes.
+     */
+    static uint64_t sealed_size(uint64_t plaintext_size, size_t chunk_size = CHUNK_SIZE);
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "crypto.h"
+#include <glib.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * KeyAgent turns the master password into encryption keys once per unlock.
+ *
+ * unlock() runs Argon2id a single time over the profile's salt and keeps the
+ * resulting master key in guarded memory (sodium_malloc: guard pages, mlock,
+ * PROT_NONE except while a subkey is being derived). Each consumer asks for
+ * its own subkey with get_key(); subkeys come from crypto_kdf (BLAKE2b) in
+ * microseconds, so opening the session store and the password store costs
+ * one derivation instead of one each.
+ *
+ * The master key is random. The key file ("master.kdf") holds it sealed
+ * with a key derived from the password, behind a KDF header recording the
+ * salt and Argon2id parameters, so a wrong password fails in unlock()
+ * instead of as decryption errors later. When the wanted parameters differ
+ * from the file's (set_kdf_params(), or a key file from before headers),
+ * unlock() re-seals the master key under the new ones: nothing encrypted
+ * with subkeys changes. A new key file is calibrated to
+ * DEFAULT_UNLOCK_BUDGET on this host unless parameters were set.
+ *
+ * lock() wipes the master key and tells every lock listener, which wipe
+ * their copies of subkeys. With an idle timeout, the agent locks itself once
+ * no consumer has touched it for that long; consumers call touch() (or
+ * get_key()) whenever they use their key.
+ *
+ * Thread-safety: every method may be called from any thread. Lock listeners
+ * run on the thread that locked, outside the agent's mutex; the idle timer
+ * runs on the default main context.
+ */
+class KeyAgent {
+public:
+    // Subkey ids; never renumber, stored data is encrypted under them
+    enum class Purpose : uint64_t {
+        Sessions = 1,
+        Passwords = 2,
+    };
+
+    using LockListener = std::function<void()>;
+    
+    static constexpr std::chrono::milliseconds DEFAULT_UNLOCK_BUDGET{500};
+
+    explicit KeyAgent(std::string key_file_path);
+    ~KeyAgent();
+
+    // Non-copyable, non-movable (the idle timer points back here)
+    KeyAgent(const KeyAgent&) = delete;
+    KeyAgent& operator=(const KeyAgent&) = delete;
+    KeyAgent(KeyAgent&&) = delete;
+    KeyAgent& operator=(KeyAgent&&) = delete;
+
+    // Unseal the master key; creates the key file on first use, and re-seals
+    // it when the KDF parameters changed. False on a wrong password or I/O
+    // error. A no-op when already unlocked.
+    bool unlock(std::string_view master_password);
+    void lock();
+    bool is_unlocked() const;
+
+    // Re-seal the master key under `new_password` (fresh salt, same KDF
+    // parameters unless set_kdf_params() changed them). Subkeys do not
+    // change, so nothing encrypted with them needs rewriting. False on a
+    // wrong old password or I/O error; locked or not, the agent stays so.
+    bool change_password(std::string_view old_password, std::string_view new_password);
+
+    // Copy the subkey for `purpose` into `key`; false while locked
+    bool get_key(Purpose purpose, SecureBuffer& key);
+    // Record a use of an already fetched subkey (resets the idle timer)
+    void touch();
+
+    // Listeners are called after every lock(); the id removes them again
+    size_t add_lock_listener(LockListener listener);
+    void remove_lock_listener(size_t id);
+
+    // Lock after `timeout` without a touch; zero disables. The check runs on
+    // a GLib timer, or directly through lock_if_idle().
+    void set_idle_timeout(std::chrono::seconds timeout);
+    bool lock_if_idle(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Argon2id parameters for the key file, applied at the next unlock()
+    void set_kdf_params(const Crypto::KdfParams& params);
+    // Parameters the key file was sealed with (as of the last unlock())
+    Crypto::KdfParams get_kdf_params() const;
+
+    const std::string& get_key_file_path() const { return key_file_path_; }
+
+    // Process-wide agent over $XDG_DATA_HOME/ryxsurf/master.kdf (or
+    // ~/.local/share/ryxsurf/master.kdf)
+    static KeyAgent& shared();
+
+private:
+    static constexpr char KDF_CONTEXT[crypto_kdf_CONTEXTBYTES + 1] = "RyxSurfK";
+    static constexpr uint64_t CHECK_SUBKEY_ID = 0;  // Key files from before KDF headers
+
+    std::string key_file_path_;
+    mutable std::mutex mutex_;
+    unsigned char* master_key_;  // sodium_malloc'd, Crypto::KEY_SIZE bytes; null while locked
+    std::optional<Crypto::KdfParams> wanted_params_;
+    Crypto::KdfParams file_params_;
+    std::chrono::steady_clock::time_point last_used_;
+    std::chrono::seconds idle_timeout_;
+    guint idle_timer_id_;
+    std::map<size_t, LockListener> listeners_;
+    size_t next_listener_id_;
+
+    // Caller holds mutex_ (and, to derive, master_key_ is set)
+    void derive_locked(uint64_t subkey_id, unsigned char* out, size_t size) const;
+    void wipe_locked();
+    // Caller does not hold mutex_
+    void notify_lock_listeners();
+    // Open a current-format key file with `master_password`; false if it is not one or the password is wrong
+    static bool unseal_key_file(std::string_view master_password, const std::vector<unsigned char>& contents,
+                                Crypto::KdfParams& params, SecureBuffer& master_key);
+    // Seal `master_key` under a fresh salt and `params`; replaces the file atomically
+    bool write_key_file(std::string_view master_password, const Crypto::KdfParams& params,
+                        const SecureBuffer& master_key);
+
+    static gboolean idle_timer_callback(gpointer user_data);
+};
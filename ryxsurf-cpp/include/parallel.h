@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/**
+ * Run work(i) for every i < count, split into contiguous ranges across the
+ * hardware threads (at least kMinPerThread items each; the calling thread
+ * takes the first range). False if any call threw; the remaining items of
+ * every range are then skipped.
+ */
+template <typename Work>
+inline bool parallel_for(size_t count, const Work& work) {
+    constexpr size_t kMinPerThread = 64;
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                      (count + kMinPerThread - 1) / kMinPerThread);
+    std::atomic<bool> ok{true};
+    auto run = [&](size_t begin, size_t end) {
+        try {
+            for (size_t i = begin; i < end && ok.load(std::memory_order_relaxed); ++i) {
+                work(i);
+            }
+        } catch (const std::exception&) {
+            ok = false;
+        }
+    };
+
+    if (threads <= 1) {
+        run(0, count);
+        return ok;
+    }
+    size_t per_thread = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(run, t * per_thread, std::min(count, (t + 1) * per_thread));
+    }
+    run(0, per_thread);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return ok;
+}
@@ -1,22 +1,33 @@
 #pragma once
 
 #include "crypto.h"
+#include "rekey.h"
 #include <libsecret/secret.h>
 #include <sqlite3.h>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
+#include <map>
 #include <memory>
 #include <optional>
 #include <chrono>
-#include <webkit/webkit.h>
+#include <functional>
+#include <utility>
+
+class BreachCorpus;
+class CredentialReader;
+class EncryptedCredentialWriter;
+class KeyAgent;
 
 /**
- * Credential structure for password storage.
+ * Credential structure for password storage. The password lives in
+ * SecurePool memory and is zeroed when the credential goes away.
  */
 struct Credential {
     std::string domain;
     std::string username;
-    std::string password;
+    SecureString password;
     std::chrono::system_clock::time_point created;
     std::chrono::system_clock::time_point last_used;
 };
@@ -26,78 +37,297 @@ struct Credential {
  * 1. Primary: libsecret (Secret Service API - GNOME Keyring/KWallet)
  * 2. Fallback: Encrypted SQLite (if libsecret unavailable)
  * 
- * Ownership: PasswordManager owns its database connection.
+ * Ownership: PasswordManager owns its database connection and the
+ * statements compiled on it.
+ * 
+ * Storage: ciphertext (nonce + ciphertext + tag) is stored as a raw BLOB.
+ * Databases from before PRAGMA user_version was set hold it hex-encoded in
+ * TEXT; the database open converts those rows in place, once. The database
+ * runs in WAL mode with synchronous=NORMAL, like the sessions database, so
+ * a last-used bump is an append rather than an fsync. The per-credential
+ * statements are prepared once when it opens and finalized by close().
+ * 
+ * Lookups: the credentials table (which also holds libsecret metadata) is
+ * mirrored in an in-memory index of site -> usernames and timestamps,
+ * loaded when the database opens and updated by every write. Origin checks
+ * never touch SQLite; passwords are only fetched and decrypted for the one
+ * credential get_one() returns.
+ * 
+ * Origin matching: a site is the registrable domain (eTLD+1, per the Public
+ * Suffix List) of the stored domain, so a login saved for example.co.uk is
+ * offered on accounts.example.co.uk but never on other.co.uk. get_one() and
+ * has_credentials() match by site; get() and the write paths use the exact
+ * stored domain. Autofill without a user gesture is stricter (see
+ * autofill()).
+ * 
+ * Keyring access: every Secret Service call is a D-Bus round trip and may
+ * wait on an unlock prompt. The *_async() methods use the libsecret async
+ * API and complete on the caller's GLib main context, so the GTK thread
+ * never blocks. The service is probed on first use (probe_keyring_async()
+ * starts it early); async operations issued meanwhile are queued until it
+ * answers. The synchronous methods remain for tools and tests and probe
+ * synchronously if needed.
  */
 class PasswordManager {
 public:
+    // PRAGMA user_version of the credentials database (0 = hex TEXT ciphertext)
+    static constexpr int SCHEMA_VERSION = 1;
+    
     PasswordManager();
     ~PasswordManager();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (pending keyring operations point back here)
     PasswordManager(const PasswordManager&) = delete;
     PasswordManager& operator=(const PasswordManager&) = delete;
-    PasswordManager(PasswordManager&&) = default;
-    PasswordManager& operator=(PasswordManager&&) = default;
+    PasswordManager(PasswordManager&&) = delete;
+    PasswordManager& operator=(PasswordManager&&) = delete;
 
     // Initialization
     bool initialize(const std::string& master_password = "");
     void close();
     
-    // Credential operations
-    bool save(const std::string& domain, const std::string& username, const std::string& password);
+    // Credential operations (get() decrypts every credential for the domain;
+    // get_one() decrypts only the most recently used one)
+    bool save(const std::string& domain, const std::string& username, const SecureString& password);
     std::vector<Credential> get(const std::string& domain);
     std::optional<Credential> get_one(const std::string& domain);
-    bool has_credentials(const std::string& domain);
+    bool has_credentials(std::string_view domain) const;
     bool delete_credential(const std::string& domain, const std::string& username);
     void update_last_used(const std::string& domain, const std::string& username);
     
+    // Asynchronous credential operations. Callbacks run on the main loop once
+    // the keyring answers; when SQLite is the backend they run before the call
+    // returns. Callbacks of operations still pending at close() are dropped.
+    using DoneCallback = std::function<void(bool ok)>;
+    using CredentialsCallback = std::function<void(std::vector<Credential>)>;
+    using CredentialCallback = std::function<void(std::optional<Credential>)>;
+    
+    void probe_keyring_async(DoneCallback done = nullptr);  // ok = keyring in use
+    void save_async(const std::string& domain, const std::string& username, const SecureString& password,
+                    DoneCallback done = nullptr);
+    void get_async(const std::string& domain, CredentialsCallback done);
+    void get_one_async(const std::string& domain, CredentialCallback done);
+    void delete_credential_async(const std::string& domain, const std::string& username,
+                                 DoneCallback done = nullptr);
+    
     // Domain operations
     std::vector<std::string> list_domains();
     
-    // Autofill
-    void autofill(WebKitWebView* webview, const std::string& origin);
-    bool should_autofill(const std::string& origin) const;
+    // Bulk transfer (see credential_transfer.h). An import is one transaction:
+    // batches of IMPORT_BATCH_SIZE are encrypted in parallel (or stored in
+    // the keyring with all calls in flight at once) and inserted with a
+    // single prepared statement, and a read error rolls everything back,
+    // removing the keyring items the import added. Existing credentials
+    // with the same domain and username are replaced. An export skips rows
+    // whose password does not decrypt and fails on a read error.
+    struct ImportStats {
+        size_t imported = 0;
+        size_t skipped = 0;  // Not a web login, or no password
+    };
+    struct ExportStats {
+        size_t exported = 0;
+        size_t skipped = 0;  // Password did not decrypt
+    };
+    static constexpr size_t IMPORT_BATCH_SIZE = 2048;
+    bool import_credentials(CredentialReader& reader, ImportStats* stats = nullptr);
+    bool export_credentials(EncryptedCredentialWriter& writer, ExportStats* stats = nullptr);
+    
+    // Autofill (see autofill_script.h): `done` gets the most recently used
+    // credential for the origin, or nullopt when autofill is off or there
+    // is none; a credential handed out counts as used. Only https origins
+    // are answered (stored domains carry no scheme and are treated as
+    // https logins). A fill nobody asked for, at page load, needs the exact
+    // stored host; a user gesture on the form widens that to the site.
+    enum class AutofillTrigger {
+        PageLoad,
+        UserGesture,
+    };
+    void autofill(const std::string& origin, AutofillTrigger trigger, CredentialCallback done);
+    bool should_autofill(const std::string& origin, AutofillTrigger trigger = AutofillTrigger::UserGesture) const;
     void set_autofill_enabled(bool enabled) { autofill_enabled_ = enabled; }
     bool is_autofill_enabled() const { return autofill_enabled_; }
     
-    // Password generator
+    // Password generator (never returns a password in the breach corpus)
     std::string generate_password(size_t length = 16, bool include_symbols = true);
     
-    // Configuration
+    // Breach checks against an offline corpus (see breach_corpus.h), which
+    // must stay open while set; nullptr disables them. is_breached() is false
+    // without a corpus. find_breached() decrypts every saved password (in
+    // parallel for SQLite) and returns the credentials whose password is in
+    // the corpus, with the password left empty.
+    void set_breach_corpus(const BreachCorpus* corpus) { breach_corpus_ = corpus; }
+    bool is_breached(std::string_view password) const;
+    std::vector<Credential> find_breached();
+    
+    // Configuration: set_master_password() supplies the password that opens
+    // the store; it does not change it
     void set_master_password(const std::string& password);
-    bool has_master_password() const { return !master_password_.empty(); }
+    bool has_master_password() const { return !master_password_.empty() || encrypted_; }
+    // Change the password of an encrypted store. With a key agent this only
+    // re-seals the agent's key file (KeyAgent::change_password(); call it
+    // through one store). Otherwise every SQLite password is re-encrypted
+    // under the new password's key (same salt) by Rekey, in one transaction,
+    // reporting per-batch progress. False, with nothing changed, on a wrong
+    // old password or any failure.
+    bool change_master_password(const std::string& old_password, const std::string& new_password,
+                                const Rekey::Progress& progress = nullptr);
+    
+    // Take the SQLite encryption key from `agent` (KeyAgent::Purpose::Passwords)
+    // instead of running Argon2id over a salt of our own. Call before
+    // initialize(); a master password passed there unlocks the agent if it is
+    // locked and is not kept. While the agent is locked, reading or writing
+    // encrypted credentials fails. A store keyed by its own "<db>.salt" is
+    // re-encrypted under the agent's key once, on the next unlock.
+    void set_key_agent(KeyAgent* agent);
+    
+    // Benchmark helpers: disable the statement cache (compile SQL on every
+    // use) or WAL journaling (call before initialize()), and count how many
+    // statements have been compiled so far
+    void set_statement_cache_enabled_for_tests(bool enabled) { statement_cache_enabled_ = enabled; }
+    void set_wal_enabled_for_tests(bool enabled) { wal_enabled_ = enabled; }
+    size_t get_statements_prepared() const { return statements_prepared_; }
 
 private:
+    // Index entry: a credential without its password
+    struct CredentialMeta {
+        std::string domain;  // As stored; the index key is its site
+        std::string username;
+        std::chrono::system_clock::time_point created;
+        std::chrono::system_clock::time_point last_used;
+    };
+
+    enum class KeyringState {
+        Unknown,      // Not probed yet
+        Probing,      // Async probe in flight
+        Available,
+        Unavailable,  // No service, disabled, or failed and fell back to SQLite
+    };
+    
+    // An in-flight async keyring call (defined in the .cpp)
+    struct KeyringOp;
+    // Ciphertexts of a bulk operation packed into one reused buffer
+    struct SealedBatch;
+    // Keyring calls of a bulk operation, all in flight at once
+    struct KeyringBatch;
+    
+    // Per-credential statements compiled once by init_database()
+    enum class Statement {
+        SelectDomain,
+        SelectPassword,
+        Upsert,
+        UpsertMetadata,
+        Delete,
+        UpdateLastUsed,
+        Count
+    };
+    
     // Storage backends
-    bool use_libsecret_;
+    KeyringState keyring_state_;
     sqlite3* db_;
     std::string db_path_;
-    std::string master_password_;
-    std::vector<unsigned char> encryption_key_;
-    std::vector<unsigned char> salt_;
+    std::array<sqlite3_stmt*, static_cast<size_t>(Statement::Count)> statements_;
+    bool statement_cache_enabled_;
+    bool wal_enabled_;
+    size_t statements_prepared_;
+    SecureString master_password_;
+    SecureBuffer encryption_key_;
+    std::vector<unsigned char> salt_;  // Not secret: stored beside the database
+    Crypto::KdfParams kdf_params_;     // Of salt_
+    bool encrypted_;  // Passwords in SQLite are encrypted, even while the key is wiped
+    KeyAgent* key_agent_;
+    size_t key_listener_id_;
+    // Key of a store encrypted before it had an agent; wiped after migration
+    SecureBuffer legacy_key_;
+    // Such a store opened through an agent another store unlocked: no
+    // password to derive legacy_key_ from yet, so it acts as locked
+    bool legacy_pending_;
     bool autofill_enabled_;
+    const BreachCorpus* breach_corpus_;
+    // Per site, most recently used first; std::less<> allows string_view lookups
+    std::map<std::string, std::vector<CredentialMeta>, std::less<>> index_;
     
     // libsecret schema
     SecretSchema* schema_;
     
+    // Cancelled and replaced by close(); async callbacks check it before
+    // touching the manager
+    GCancellable* cancellable_;
+    // Async operations waiting for the keyring probe
+    std::vector<std::function<void()>> keyring_waiters_;
+    
     // Database operations
     bool init_database();
     bool create_schema();
-    bool save_to_sqlite(const std::string& domain, const std::string& username, const std::string& password);
+    int get_schema_version();
+    bool migrate_hex_ciphertext();
+    bool save_to_sqlite(const std::string& domain, const std::string& username, std::string_view password);
     std::vector<Credential> get_from_sqlite(const std::string& domain);
     bool delete_from_sqlite(const std::string& domain, const std::string& username);
+    std::optional<SecureString> get_password_from_sqlite(const std::string& domain, const std::string& username);
+    bool import_batch(const std::vector<Credential>& batch, sqlite3_stmt* insert, SealedBatch& sealed,
+                      std::vector<std::pair<std::string, std::string>>& keyring_added);
+    
+    // Statement cache: acquire() hands out a ready statement, release() resets it
+    bool prepare_statements();
+    void finalize_statements();
+    sqlite3_stmt* acquire(Statement id);
+    void release(sqlite3_stmt* stmt);
+    bool save_locally(const std::string& domain, const std::string& username, std::string_view password);
+    bool delete_locally(const std::string& domain, const std::string& username);
+    
+    // Credential index
+    bool load_index();
+    // Most recently used credential of the domain's site (with same_host,
+    // of the domain itself); nullptr if none
+    const CredentialMeta* find_credential(std::string_view domain, bool same_host) const;
+    std::optional<Credential> fetch_credential(const CredentialMeta& meta);
+    void get_one_async(const std::string& domain, bool same_host, CredentialCallback done);
+    void index_touch(const std::string& domain, const std::string& username, bool inserted);
+    void index_remove(const std::string& domain, const std::string& username);
     
     // libsecret operations
-    bool save_to_libsecret(const std::string& domain, const std::string& username, const std::string& password);
+    bool use_libsecret() const { return keyring_state_ == KeyringState::Available; }
+    void ensure_keyring();
+    void when_keyring_ready(std::function<void()> operation);
+    void finish_keyring_probe(bool available);
+    bool fall_back_to_sqlite();
+    void store_keyring_metadata(const std::string& domain, const std::string& username);
+    std::vector<Credential> credentials_from_items(const std::string& domain, GList* items) const;
+    bool save_to_libsecret(const std::string& domain, const std::string& username, const SecureString& password);
     std::vector<Credential> get_from_libsecret(const std::string& domain);
+    std::optional<SecureString> get_password_from_libsecret(const std::string& domain, const std::string& username);
     bool delete_from_libsecret(const std::string& domain, const std::string& username);
+    // Per credential, whether the keyring took it; waits for every call
+    std::vector<char> store_in_keyring(const std::vector<Credential>& batch);
+    void clear_from_keyring(const std::vector<std::pair<std::string, std::string>>& items);
+    
+    // libsecret async completions (user_data is a KeyringOp)
+    static void on_keyring_probed(GObject* source, GAsyncResult* result, gpointer user_data);
+    static void on_password_stored(GObject* source, GAsyncResult* result, gpointer user_data);
+    static void on_items_found(GObject* source, GAsyncResult* result, gpointer user_data);
+    static void on_password_looked_up(GObject* source, GAsyncResult* result, gpointer user_data);
+    static void on_password_cleared(GObject* source, GAsyncResult* result, gpointer user_data);
+    // user_data is a KeyringBatch slot
+    static void on_batch_stored(GObject* source, GAsyncResult* result, gpointer user_data);
+    static void on_batch_cleared(GObject* source, GAsyncResult* result, gpointer user_data);
     
     // Encryption helpers
     bool setup_encryption();
-    std::string encrypt_password(const std::string& password);
-    std::string decrypt_password(const std::string& encrypted);
+    bool setup_agent_encryption();
+    bool migrate_legacy_key();
+    bool ensure_key();  // False while the agent is locked
+    std::vector<unsigned char> encrypt_password(std::string_view password);
+    // Into `out`, sealed_password_size() bytes; no allocation
+    size_t sealed_password_size(size_t password_size) const;
+    void encrypt_password(std::string_view password, unsigned char* out);
+    SecureString decrypt_password(const unsigned char* data, size_t size);
     
     // Helper methods
     std::string get_db_path() const;
     std::string extract_domain(const std::string& url) const;
+    // The URL's host, lowercased
+    static std::string domain_of(std::string_view url);
+    // Index key for a domain: its lowercased registrable domain, or the
+    // domain itself when it is a public suffix or an IP literal
+    static std::string site_of(std::string_view domain);
 };
@@ -2,78 +2,222 @@
 
 #include "session_manager.h"
 #include "crypto.h"
+#include "rekey.h"
+#include "session_changes.h"
 #include <sqlite3.h>
 #include <string>
 #include <memory>
 #include <optional>
+#include <array>
+#include <vector>
+#include <functional>
+
+class SessionWriter;
+class SessionJournal;
+class KeyAgent;
 
 /**
  * PersistenceManager handles encrypted SQLite storage for sessions.
  * 
- * Ownership: PersistenceManager does not own SessionManager.
+ * Ownership: PersistenceManager does not own SessionManager. It owns a
+ * SessionWriter whose worker thread and connection perform every write;
+ * the main connection is only used for schema setup and loading.
  * Uses WAL mode for better concurrency.
+ * 
+ * Encryption: with a master password, each workspace's sessions and tabs
+ * are stored as one blob sealed by a single encrypt_data() call and only
+ * decrypted when the workspace is loaded (see load_workspace()). Workspace
+ * names and timestamps stay in the clear so the workspace list loads
+ * without decrypting anything. The profile records that it is encrypted,
+ * and initialize() refuses to open it without a key. Between checkpoints
+ * only the changed rows are sealed, as journal records; the writer thread
+ * folds them into the blobs of the workspaces they touch (seal_deltas()).
+ * 
+ * Durability: between checkpoints, dirty rows are appended to a
+ * SessionJournal ("<db>.journal") every JOURNAL_INTERVAL_MS; the main thread
+ * only collects them, the writer thread does the file I/O. The journal is
+ * compacted into the database when the session goes idle (or grows past
+ * JOURNAL_COMPACT_BYTES) and replayed by load_all() after a crash.
+ * 
+ * Schema: PRAGMA user_version records the schema version. initialize()
+ * applies each missing migration step in order, one transaction per step,
+ * and refuses a database written by a newer build.
  */
 class PersistenceManager {
 public:
+    static constexpr guint JOURNAL_INTERVAL_MS = 500;
+    static constexpr uint64_t JOURNAL_COMPACT_BYTES = 1024 * 1024;
+    static constexpr int SCHEMA_VERSION = 4;
+
     PersistenceManager(SessionManager* session_manager);
     ~PersistenceManager();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (autosave timer and writer hold this)
     PersistenceManager(const PersistenceManager&) = delete;
     PersistenceManager& operator=(const PersistenceManager&) = delete;
-    PersistenceManager(PersistenceManager&&) = default;
-    PersistenceManager& operator=(PersistenceManager&&) = default;
+    PersistenceManager(PersistenceManager&&) = delete;
+    PersistenceManager& operator=(PersistenceManager&&) = delete;
 
     // Database operations
     bool initialize(const std::string& master_password = "");
     void close();
     
-    // Save/load operations
+    // Save/load operations (save_all blocks until the writer has committed;
+    // load_all replays any journal a crash left behind before reading)
     bool save_all();
     bool load_all();
     
-    // Individual workspace/session/tab operations
+    // Individual workspace/session/tab operations. load_all() only restores the
+    // workspace list and the current workspace; load_workspace() fills in the
+    // sessions and tabs of one stored workspace (SessionManager calls it on switch).
     bool save_workspace(Workspace* workspace);
     bool load_workspace(const std::string& name, Workspace* workspace);
+    
+    // Startup snapshot (see SessionSnapshot): written on clean shutdown for
+    // plaintext profiles and deleted by load_all(), so it never outlives a crash
+    bool write_snapshot();
+    std::string get_snapshot_path() const { return db_path_ + ".snapshot"; }
+    
+    // Rows written by the most recent save_all() (0 when nothing was dirty)
+    int get_last_save_changes() const { return last_save_changes_; }
+    // Main-thread time spent by the most recent autosave tick
+    int64_t get_last_autosave_stall_us() const { return last_autosave_stall_us_; }
 
     // Testing helper: override database path for isolated runs
     void set_db_path_for_tests(const std::string& path) { db_path_ = path; }
+    // Testing helpers: PRAGMA user_version, and the EXPLAIN QUERY PLAN
+    // details of every cached read statement (one string per statement)
+    int get_schema_version();
+    std::vector<std::string> get_query_plans_for_tests();
+    
+    // Benchmark helpers: disable the statement cache (compile SQL on every use)
+    // and count how many statements have been compiled so far
+    void set_statement_cache_enabled_for_tests(bool enabled);
+    size_t get_statements_prepared() const;
     
     // Autosave
     void enable_autosave(int interval_seconds = 30);
     void disable_autosave();
+    // Snapshot dirty rows and queue them for the writer without waiting
+    // (what each autosave tick runs on the main thread)
+    void queue_autosave();
+    
+    // Journal: collect dirty rows and queue them for the writer thread, which
+    // appends and fsyncs them as one batch; false if nothing was dirty (what
+    // each journal tick runs)
+    bool journal_changes();
+    // Hand journaled rows to the writer; the journal shrinks once they commit
+    void compact_journal();
+    // Block until every queued batch is in the journal file
+    void flush_journal();
+    // Bytes appended to the journal since initialize()
+    uint64_t get_journal_bytes_written() const;
     
-    // Configuration
+    // Configuration: set_master_password() supplies the password that opens
+    // the store; it does not change it
     void set_master_password(const std::string& password);
-    bool has_master_password() const { return !master_password_.empty(); }
+    bool has_master_password() const { return !master_password_.empty() || encrypted_; }
+    // Change the password of an encrypted store (see
+    // PasswordManager::change_master_password()). Without an agent, dirty
+    // rows are saved first, then every workspace blob is re-sealed.
+    bool change_master_password(const std::string& old_password, const std::string& new_password,
+                                const Rekey::Progress& progress = nullptr);
+    // Take the session key from `agent` (KeyAgent::Purpose::Sessions); call
+    // before initialize(). See PasswordManager::set_key_agent().
+    void set_key_agent(KeyAgent* agent);
 
 private:
+    // Read statements compiled once after create_schema() (writes live in SessionWriter)
+    enum class Statement {
+        SelectWorkspaces,
+        SelectWorkspaceByName,
+        SelectWorkspaceSessions,
+        SelectWorkspaceTabs,
+        SelectWorkspaceBlob,
+        Count
+    };
+
     SessionManager* session_manager_;
     sqlite3* db_;
     std::string db_path_;
-    std::string master_password_;
-    std::vector<unsigned char> encryption_key_;
-    std::vector<unsigned char> salt_;
+    SecureString master_password_;
+    SecureBuffer encryption_key_;
+    std::vector<unsigned char> salt_;  // Not secret: stored beside the database
+    Crypto::KdfParams kdf_params_;     // Of salt_
+    bool encrypted_;  // Blob mode, even while the agent is locked
+    KeyAgent* key_agent_;
+    size_t key_listener_id_;
+    SecureBuffer legacy_key_;  // Pre-agent key, until migrated
+    bool legacy_pending_;      // A .salt is left and no password has come to derive its key
     bool autosave_enabled_;
     int autosave_interval_;
     guint autosave_timer_id_;
+    guint journal_timer_id_;
+    int last_save_changes_;
+    int64_t last_autosave_stall_us_;
+    std::array<sqlite3_stmt*, static_cast<size_t>(Statement::Count)> statements_;
+    bool statement_cache_enabled_;
+    size_t statements_prepared_;
+    
+    // Row ids are handed out here so change sets never wait on the database
+    int64_t next_workspace_id_;
+    int64_t next_session_id_;
+    int64_t next_tab_id_;
+    std::unique_ptr<SessionWriter> writer_;
+    std::unique_ptr<SessionJournal> journal_;
+    // Change sets in the live journal file that the writer has not seen yet
+    std::vector<ChangeSet> journaled_;
+    uint64_t journaled_bytes_;  // Their encoded size: compaction starts past JOURNAL_COMPACT_BYTES
     
     // Make db_path_ accessible for tests
     friend class PersistenceManagerTest;
     
-    // Database schema
+    // Database schema: run every migration step above the stored user_version
     bool create_schema();
-    bool create_tables();
+    bool apply_migration(int version, const char* sql);
+    
+    // Incremental save helpers: copy dirty rows out and clear their flags
+    void collect_changes(ChangeSet& changes);
+    void collect_workspace(Workspace* workspace, ChangeSet& changes);
+    bool sync_row_ids();
+    void scan_blob_row_ids();
+    
+    // Lazy workspace restore: read stored rows (or decrypt the blob), then rebuild
+    bool read_workspace_rows(int64_t workspace_id, ChangeSet& contents);
+    bool read_workspace_blob(int64_t workspace_id, ChangeSet& contents, bool& found);
+    void restore_workspace(Workspace* workspace, const ChangeSet& contents);
+    // Write journaled rows plus `changes` and wait; truncates the journal on success
+    bool checkpoint(ChangeSet changes);
+    bool replay_journal();
+    // Queue change sets for the writer, oldest first; on_commit follows the last
+    void submit_changes(std::vector<ChangeSet> sets, std::function<void()> on_commit = nullptr);
+    // Encrypted mode, on the writer thread: apply row deltas to the stored
+    // contents of each workspace they touch and re-seal those into `sealed`
+    static bool seal_deltas(sqlite3* db, const SecureBuffer& key, const std::vector<ChangeSet>& deltas,
+                            ChangeSet& sealed);
+    static bool read_stored_workspace(sqlite3* db, const SecureBuffer& key, int64_t workspace_id,
+                                      ChangeSet& contents);
+    
+    // Statement cache: acquire() hands out a ready statement, release() resets it
+    bool prepare_statements();
+    void finalize_statements();
+    sqlite3_stmt* acquire(Statement id);
+    void release(sqlite3_stmt* stmt);
     
     // Encryption helpers
     bool setup_encryption();
+    bool setup_agent_encryption();
+    bool check_encryption_mode();
+    bool migrate_legacy_key();
+    bool ensure_key();
     std::vector<unsigned char> encrypt_data(const std::string& data);
-    std::string decrypt_data(const std::vector<unsigned char>& encrypted);
+    std::string decrypt_data(const unsigned char* data, size_t size);
     
     // SQL helpers
     bool execute_sql(const std::string& sql);
     std::string get_db_path() const;
     
-    // Autosave callback
+    // Autosave/journal callbacks
     static gboolean autosave_callback(gpointer user_data);
+    static gboolean journal_callback(gpointer user_data);
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Host of a URL: the scheme, userinfo ("user:pass@"), port, path, query and
+ * fragment are dropped, IPv6 literals lose their brackets, and a trailing
+ * root dot is removed. Scheme-less input ("example.com/login") is accepted.
+ * Returns a view into `url`; empty when there is no host (about:blank,
+ * file:///...).
+ */
+std::string_view url_host(std::string_view url);
+
+/**
+ * PublicSuffixList answers "which part of this host can anyone register
+ * under?" using the rules of the Mozilla Public Suffix List (publicsuffix.org),
+ * so that accounts.example.co.uk and example.co.uk share a registrable domain
+ * (eTLD+1) while example.co.uk and other.co.uk do not.
+ *
+ * Rules are compiled into a trie keyed on labels from right to left, stored
+ * flat: one array of nodes whose children are contiguous and sorted, and one
+ * string holding every label. A lookup walks at most one node per host label
+ * with a binary search at each, and never allocates.
+ *
+ * Hosts are matched as given, ASCII case-insensitively; internationalised
+ * domains must already be in punycode (as WebKit reports them), and list
+ * rules in Unicode form therefore never match.
+ */
+class PublicSuffixList {
+public:
+    // Built-in subset: generic TLDs and the common ccTLD second levels
+    PublicSuffixList();
+
+    // Replace the rules with a list in public_suffix_list.dat format
+    bool load(std::string_view list);
+    bool load_file(const std::string& path);
+
+    // Public suffix of `host` (the TLD itself when no rule matches)
+    std::string_view public_suffix(std::string_view host) const;
+    // eTLD+1 of `host`; the host itself for IP literals; empty when the host
+    // is itself a public suffix
+    std::string_view registrable_domain(std::string_view host) const;
+
+    size_t rule_count() const { return rule_count_; }
+
+    // Process-wide list: $RYXSURF_PUBLIC_SUFFIX_LIST, else the system copy
+    // (/usr/share/publicsuffix), else the built-in subset. Built on first use.
+    static const PublicSuffixList& shared();
+
+private:
+    enum : uint8_t {
+        RULE = 1,       // A rule ends at this node
+        EXCEPTION = 2,  // "!" rule: the suffix is this node's parent
+    };
+
+    struct Node {
+        uint32_t label_offset;
+        uint32_t first_child;
+        uint32_t child_count;
+        uint16_t label_length;
+        uint8_t flags;
+        bool has_wildcard;  // A "*" rule below this node
+    };
+
+    const Node* find_child(const Node& node, std::string_view label) const;
+    size_t suffix_start(std::string_view host) const;
+    void build(const std::vector<std::string_view>& rules);
+
+    std::vector<Node> nodes_;  // nodes_[0] is the root
+    std::string labels_;
+    size_t rule_count_ = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "secure_memory.h"
+#include <cstddef>
+#include <functional>
+#include <sqlite3.h>
+
+/**
+ * Rekey moves one encrypted column from one key to another: every non-empty
+ * value is decrypted with the old key and sealed again with the new one
+ * (Crypto's sealed format on both sides).
+ *
+ * Rows are streamed in batches of up to BATCH_ROWS rows (or BATCH_BYTES of
+ * ciphertext) by ascending id. Each batch is re-sealed in place across the
+ * hardware threads (see parallel_for()), then written back on the calling
+ * thread. Plaintext only ever exists inside the row's own buffer, between
+ * the two AEAD calls on one worker.
+ *
+ * The whole run is one BEGIN IMMEDIATE transaction: either every row is
+ * re-encrypted or, on any decryption failure (wrong old key, corrupt row)
+ * or SQLite error, nothing is. The caller must not hold an open transaction
+ * on `db`, and other connections wait on (or fail with) SQLITE_BUSY.
+ */
+class Rekey {
+public:
+    static constexpr size_t BATCH_ROWS = 4096;
+    static constexpr size_t BATCH_BYTES = 16 * 1024 * 1024;
+
+    // Called on the calling thread after each batch: rows re-encrypted so
+    // far, of `total` (nothing is committed until run() returns)
+    using Progress = std::function<void(size_t done, size_t total)>;
+
+    /**
+     * Re-encrypt `data_column` of `table` from `old_key` to `new_key`.
+     *
+     * @param id_column An INTEGER PRIMARY KEY of `table`
+     * @return false, with the table untouched, if any row failed
+     */
+    static bool run(sqlite3* db, const char* table, const char* id_column, const char* data_column,
+                    const SecureBuffer& old_key, const SecureBuffer& new_key,
+                    const Progress& progress = nullptr);
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * SecurePool hands out small blocks of guarded memory for key material and
+ * decrypted secrets.
+ *
+ * A sodium_malloc() call per secret costs a few syscalls and at least three
+ * pages (guard pages around a locked one), which is too much for every
+ * password a lookup decrypts. The pool instead takes ARENA_SIZE regions from
+ * sodium_malloc() (mlock'd, so never swapped; guard pages around each
+ * region; excluded from core dumps where supported) and carves them into
+ * power-of-two blocks from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE, one size per
+ * arena, kept on per-size free lists. A block is zeroed as it is freed, so
+ * no secret outlives its owner in the pool. Larger requests get their own
+ * sodium_malloc() region.
+ *
+ * Arenas are kept for reuse and only released with the pool; shared() is
+ * never destroyed, so secrets in other static objects may outlive main().
+ *
+ * Thread-safety: allocate() and deallocate() may be called from any thread.
+ */
+class SecurePool {
+public:
+    static constexpr size_t MIN_BLOCK_SIZE = 16;
+    static constexpr size_t MAX_BLOCK_SIZE = 4096;
+    static constexpr size_t ARENA_SIZE = 16 * 1024;
+
+    struct Stats {
+        size_t arenas = 0;         // Carved into blocks
+        size_t blocks_in_use = 0;
+        size_t large_in_use = 0;   // Own sodium_malloc() regions
+    };
+
+    SecurePool();
+    ~SecurePool();
+
+    // Non-copyable, non-movable (owns the arenas)
+    SecurePool(const SecurePool&) = delete;
+    SecurePool& operator=(const SecurePool&) = delete;
+    SecurePool(SecurePool&&) = delete;
+    SecurePool& operator=(SecurePool&&) = delete;
+
+    // Throws std::bad_alloc when sodium_malloc() fails
+    void* allocate(size_t size);
+    // `size` as passed to allocate(); zeroes the block
+    void deallocate(void* ptr, size_t size) noexcept;
+
+    Stats get_stats() const;
+
+    static SecurePool& shared();
+
+private:
+    static constexpr size_t CLASS_COUNT = 9;  // 16 .. 4096
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        FreeBlock* free_list = nullptr;
+        unsigned char* next = nullptr;  // Not yet handed out in the newest arena
+        unsigned char* end = nullptr;
+    };
+
+    mutable std::mutex mutex_;
+    SizeClass classes_[CLASS_COUNT];
+    std::vector<void*> arenas_;
+    Stats stats_;
+
+    static size_t class_index(size_t size);
+};
+
+/**
+ * Standard allocator over SecurePool::shared().
+ */
+template <typename T>
+struct SecureAllocator {
+    using value_type = T;
+
+    SecureAllocator() noexcept = default;
+    template <typename U>
+    SecureAllocator(const SecureAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(SecurePool::shared().allocate(n * sizeof(T))); }
+    void deallocate(T* ptr, size_t n) noexcept { SecurePool::shared().deallocate(ptr, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const SecureAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const SecureAllocator<U>&) const noexcept { return false; }
+};
+
+/**
+ * Key material. Freed (or outgrown) storage is zeroed by the pool; clear()
+ * alone leaves the bytes in place, so zero them first (sodium_memzero()).
+ */
+using SecureBuffer = std::vector<unsigned char, SecureAllocator<unsigned char>>;
+
+/**
+ * A NUL-terminated string kept in SecurePool memory, for passwords.
+ *
+ * Unlike std::basic_string it has no small-string buffer, so even a short
+ * password never sits inline in (and is never copied with) its owner.
+ * clear(), assignment and destruction zero the old contents. Converts to
+ * std::string_view; converting to std::string copies the secret out of
+ * guarded memory, so only do that where an API needs one.
+ */
+class SecureString {
+public:
+    SecureString() = default;
+    SecureString(const char* text) : SecureString(std::string_view(text)) {}
+    SecureString(const std::string& text) : SecureString(std::string_view(text)) {}
+    SecureString(std::string_view text) { assign(text.data(), text.size()); }
+    SecureString(const SecureString&) = default;
+    SecureString(SecureString&&) noexcept = default;
+
+    // Copies wipe the old contents rather than reuse their block
+    SecureString& operator=(const SecureString& other) {
+        if (this != &other) {
+            assign(other.data(), other.size());
+        }
+        return *this;
+    }
+    SecureString& operator=(SecureString&&) noexcept = default;
+    SecureString& operator=(const char* text) { return *this = std::string_view(text); }
+    SecureString& operator=(const std::string& text) { return *this = std::string_view(text); }
+    SecureString& operator=(std::string_view text) {
+        assign(text.data(), text.size());
+        return *this;
+    }
+
+    void assign(const char* data, size_t size);
+    // Keeps the first min(size, size()) characters; new ones are '\0'
+    void resize(size_t size);
+    void clear();
+
+    const char* c_str() const { return bytes_.empty() ? "" : data(); }
+    const char* data() const { return reinterpret_cast<const char*>(bytes_.data()); }
+    char* data() { return reinterpret_cast<char*>(bytes_.data()); }
+    size_t size() const { return bytes_.empty() ? 0 : bytes_.size() - 1; }
+    bool empty() const { return size() == 0; }
+    const char* begin() const { return c_str(); }
+    const char* end() const { return c_str() + size(); }
+
+    char& operator[](size_t i) { return data()[i]; }
+    const char& operator[](size_t i) const { return data()[i]; }
+
+    std::string_view view() const { return std::string_view(c_str(), size()); }
+    operator std::string_view() const { return view(); }
+
+    // One overload per string type, or literals would be ambiguous
+    bool operator==(const SecureString& other) const { return view() == other.view(); }
+    bool operator==(std::string_view other) const { return view() == other; }
+    bool operator==(const std::string& other) const { return view() == other; }
+    bool operator==(const char* other) const { return view() == other; }
+    template <typename T>
+    bool operator!=(const T& other) const { return !(*this == other); }
+
+private:
+    SecureBuffer bytes_;  // Characters and '\0', or empty
+};
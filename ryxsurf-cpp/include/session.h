@@ -1,33 +1,42 @@
 #pragma once
 
 #include "tab.h"
+#include "session_events.h"
 #include <vector>
 #include <string>
 #include <memory>
 #include <chrono>
+#include <cstdint>
+
+class Workspace;  // Forward declaration
 
 /**
  * Session represents a workspace subcontext containing multiple tabs.
  * 
  * Ownership: Session owns its Tab objects. Sessions may be empty
  * (showing Overview placeholder) or contain real tabs.
+ * 
+ * Changes to the session and its tabs are delivered as SessionEvents to
+ * this session's observers and then passed up to the owning Workspace.
  */
 class Session {
 public:
     Session(const std::string& name);
     ~Session();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (tabs point back at their session)
     Session(const Session&) = delete;
     Session& operator=(const Session&) = delete;
-    Session(Session&&) = default;
-    Session& operator=(Session&&) = default;
+    Session(Session&&) = delete;
+    Session& operator=(Session&&) = delete;
 
     // Tab management
     Tab* add_tab(const std::string& url = "about:blank");
     void remove_tab(size_t index);
     Tab* get_tab(size_t index);
     size_t get_tab_count() const { return tabs_.size(); }
+    // Reorder so the tab at `from` ends up at `to`
+    void move_tab(size_t from, size_t to);
     
     // Active tab
     size_t get_active_tab_index() const { return active_tab_index_; }
@@ -38,7 +47,7 @@ public:
     std::string get_name() const { return name_; }
     bool is_empty() const { return tabs_.empty(); }
     bool is_overview() const { return is_overview_; }
-    void set_overview(bool overview) { is_overview_ = overview; }
+    void set_overview(bool overview);
     
     std::chrono::system_clock::time_point get_created_at() const { return created_at_; }
     std::chrono::system_clock::time_point get_updated_at() const { return updated_at_; }
@@ -46,6 +55,26 @@ public:
     void set_created_at(std::chrono::system_clock::time_point tp) { created_at_ = tp; }
     void set_updated_at(std::chrono::system_clock::time_point tp) { updated_at_ = tp; }
 
+    // Persistence bookkeeping (row id is 0 until the session has been stored)
+    int64_t get_row_id() const { return row_id_; }
+    void set_row_id(int64_t id) { row_id_ = id; }
+    bool is_dirty() const { return dirty_; }
+    void clear_dirty() { dirty_ = false; }
+    const std::vector<int64_t>& get_removed_tab_ids() const { return removed_tab_ids_; }
+    void clear_removed_tab_ids() { removed_tab_ids_.clear(); }
+
+    // Change notifications (see SessionEvent)
+    SessionObserverList::ObserverId add_observer(SessionObserverList::Observer observer) {
+        return observers_.add(std::move(observer));
+    }
+    void remove_observer(SessionObserverList::ObserverId id) { observers_.remove(id); }
+    // Fill in this session, deliver to observers, then pass up to the workspace
+    void notify(SessionEvent event);
+    
+    // Owning workspace (set by Workspace::add_session), null for a detached session
+    Workspace* get_workspace() const { return workspace_; }
+    void set_workspace(Workspace* workspace) { workspace_ = workspace; }
+
 private:
     std::string name_;
     std::vector<std::unique_ptr<Tab>> tabs_;
@@ -53,4 +82,11 @@ private:
     bool is_overview_;
     std::chrono::system_clock::time_point created_at_;
     std::chrono::system_clock::time_point updated_at_;
+    int64_t row_id_;
+    bool dirty_;
+    std::vector<int64_t> removed_tab_ids_;  // Stored tabs removed since last save
+    Workspace* workspace_;
+    SessionObserverList observers_;
+    
+    void notify_tab(SessionEventType type, Tab* tab, size_t index, size_t old_index = SessionEvent::npos);
 };
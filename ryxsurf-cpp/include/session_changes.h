@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Plain copies of one stored row of each session table (written as upserts by id)
+struct WorkspaceRow {
+    int64_t id;
+    std::string name;
+    int64_t created_at;
+    int64_t updated_at;
+};
+
+struct SessionRow {
+    int64_t id;
+    int64_t workspace_id;
+    std::string name;
+    bool is_overview;
+    int64_t created_at;
+    int64_t updated_at;
+};
+
+struct TabRow {
+    int64_t id;
+    int64_t session_id;
+    std::string url;
+    std::string title;
+    std::string snapshot_path;
+    int64_t last_active;
+    int64_t position;
+};
+
+// Encrypted storage mode: a workspace's sessions and tabs as one sealed blob
+struct WorkspaceBlobRow {
+    int64_t workspace_id;
+    std::vector<unsigned char> data;
+};
+
+/**
+ * ChangeSet is an immutable list of row-level changes to the session tables,
+ * collected from the dirty Workspace/Session/Tab objects on the main thread
+ * and handed to the persistence writer.
+ * 
+ * Ownership: ChangeSet holds copies of every field it writes and never
+ * references the live session tree. Row ids are assigned by
+ * PersistenceManager when an object is first collected.
+ */
+struct ChangeSet {
+    // Applied in this order: deletes (children first), then upserts (parents first)
+    std::vector<int64_t> deleted_tabs;
+    std::vector<int64_t> deleted_sessions;
+    std::vector<int64_t> deleted_workspaces;
+    std::vector<WorkspaceRow> workspaces;
+    std::vector<SessionRow> sessions;
+    std::vector<TabRow> tabs;
+    // Written after workspaces; each replaces the workspace's session/tab rows
+    std::vector<WorkspaceBlobRow> blobs;
+    // Highest session/tab ids handed out so far (0: unchanged). Recorded in
+    // the meta table, since ids inside sealed blobs are invisible to MAX(id).
+    int64_t last_session_id = 0;
+    int64_t last_tab_id = 0;
+
+    bool empty() const {
+        return deleted_tabs.empty() && deleted_sessions.empty() && deleted_workspaces.empty() &&
+               workspaces.empty() && sessions.empty() && tabs.empty() && blobs.empty();
+    }
+};
+
+// Compact varint encoding shared by the journal and encrypted workspace blobs
+std::string encode_change_set(const ChangeSet& changes);
+bool decode_change_set(const char* data, size_t size, ChangeSet& changes);
+
+// CRC32 (IEEE) framing journal records and snapshot files; pass the previous
+// result as `crc` to continue a checksum across several ranges
+uint32_t checksum_crc32(const char* data, size_t size, uint32_t crc = 0);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+class Workspace;
+class Session;
+class Tab;
+
+enum class SessionEventType {
+    TabAdded,
+    TabRemoved,
+    TabMoved,
+    TabNavigated,
+    TabRetitled,
+    TabActivated,
+    SessionAdded,
+    SessionRemoved,
+    SessionActivated,
+    WorkspaceAdded,
+    WorkspaceRemoved,
+    WorkspaceActivated,
+    WorkspaceLoaded,
+};
+
+/**
+ * SessionEvent describes one change to the session model. Events bubble up
+ * from Tab to Session to Workspace to SessionManager, and each level fills
+ * in its own pointer, so an observer on SessionManager sees `workspace`
+ * and `session` set on every tab event.
+ *
+ * Removed objects are already detached from their parent but still alive
+ * while observers run; do not keep the pointer.
+ */
+struct SessionEvent {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    SessionEventType type;
+    Workspace* workspace = nullptr;
+    Session* session = nullptr;
+    Tab* tab = nullptr;
+    // Position of the tab/session/workspace the event is about (the new one
+    // for TabMoved); npos for TabNavigated and TabRetitled
+    size_t index = npos;
+    // Previous position (TabMoved only)
+    size_t old_index = npos;
+};
+
+/**
+ * SessionObserverList holds the observers of one model object. Observers may
+ * add or remove observers (including themselves) from inside a callback.
+ */
+class SessionObserverList {
+public:
+    using Observer = std::function<void(const SessionEvent&)>;
+    using ObserverId = uint64_t;
+
+    ObserverId add(Observer observer);
+    void remove(ObserverId id);
+    void notify(const SessionEvent& event);
+    bool empty() const { return observers_.empty(); }
+
+private:
+    struct Entry {
+        ObserverId id;
+        Observer observer;
+        bool removed;
+    };
+
+    // A deque so an observer added mid-notify never moves the one running;
+    // removals during notify() are only flagged and erased afterwards
+    std::deque<Entry> observers_;
+    ObserverId next_id_ = 1;
+    int notifying_ = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * SessionJournal is an append-only log of records kept next to the session
+ * database. Each record is an opaque payload (PersistenceManager writes an
+ * encoded ChangeSet, sealed on encrypted profiles) behind a length and a
+ * CRC32, so a record torn by a crash is detected and dropped on open.
+ *
+ * Records are buffered by append() and made durable together by sync() (one
+ * write and one fdatasync per batch). Compaction seals the live file as
+ * "<path>.1" with rotate(); once the writer has committed the sealed records
+ * discard_sealed() removes it. read_all() returns sealed records before live
+ * ones, which is the order they were appended in.
+ *
+ * Ownership: SessionJournal owns its file descriptor. Calls must not overlap:
+ * PersistenceManager makes them from the writer thread (see
+ * SessionWriter::post()), or from the main thread while that has nothing
+ * posted. has_sealed(), discard_sealed() and the counters are safe anywhere.
+ */
+class SessionJournal {
+public:
+    SessionJournal();
+    ~SessionJournal();
+
+    // Non-copyable, non-movable (owns a file descriptor)
+    SessionJournal(const SessionJournal&) = delete;
+    SessionJournal& operator=(const SessionJournal&) = delete;
+    SessionJournal(SessionJournal&&) = delete;
+    SessionJournal& operator=(SessionJournal&&) = delete;
+
+    // Open or create the journal; a torn or corrupt tail is truncated away
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Buffer a record; nothing reaches the disk until sync()
+    void append(const std::string& payload);
+    // Write every buffered record and fdatasync once
+    bool sync();
+
+    // Seal the live file for compaction; false while a sealed file still exists
+    bool rotate();
+    bool has_sealed() const { return sealed_; }
+    // Drop the sealed file once its records are in the database (any thread)
+    void discard_sealed();
+    // Drop every record (after a checkpoint committed all of them)
+    bool reset();
+
+    // Every intact record on disk, sealed file first
+    bool read_all(std::vector<std::string>& records) const;
+
+    // Bytes and fdatasync calls issued since open()
+    uint64_t get_bytes_written() const { return bytes_written_.load(); }
+    uint64_t get_sync_count() const { return sync_count_.load(); }
+
+private:
+    std::string path_;
+    int fd_;
+    uint64_t size_;
+    std::string pending_;
+    std::atomic<bool> sealed_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> sync_count_;
+
+    std::string sealed_path() const { return path_ + ".1"; }
+    bool open_live();
+    bool write_all(const std::string& data);
+    void sync_directory() const;
+};
@@ -6,23 +6,29 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
+#include <functional>
 
 /**
  * SessionManager manages workspaces and provides high-level session operations.
  * 
  * Ownership: SessionManager owns all Workspace objects. This is the root
  * of the session hierarchy: Workspace -> Session -> Tab.
+ * 
+ * Observers added here see every SessionEvent in the tree (tab, session and
+ * workspace changes), so consumers can react to what changed instead of
+ * rescanning the model.
  */
 class SessionManager {
 public:
     SessionManager();
     ~SessionManager();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (workspaces point back at their manager)
     SessionManager(const SessionManager&) = delete;
     SessionManager& operator=(const SessionManager&) = delete;
-    SessionManager(SessionManager&&) = default;
-    SessionManager& operator=(SessionManager&&) = default;
+    SessionManager(SessionManager&&) = delete;
+    SessionManager& operator=(SessionManager&&) = delete;
 
     // Workspace management
     Workspace* add_workspace(const std::string& name);
@@ -54,9 +60,30 @@ public:
     // State management
     void reset(bool create_default = true);
 
+    // Lazy loading: switch_workspace() calls the loader for a workspace that
+    // is not loaded yet and stays put if it fails
+    using WorkspaceLoader = std::function<bool(Workspace*)>;
+    void set_workspace_loader(WorkspaceLoader loader) { workspace_loader_ = std::move(loader); }
+
+    // Change notifications (see SessionEvent)
+    SessionObserverList::ObserverId add_observer(SessionObserverList::Observer observer) {
+        return observers_.add(std::move(observer));
+    }
+    void remove_observer(SessionObserverList::ObserverId id) { observers_.remove(id); }
+    // Deliver an event that bubbled up from a workspace
+    void notify(const SessionEvent& event) { observers_.notify(event); }
+
+    // Persistence bookkeeping: stored workspaces dropped since last save
+    const std::vector<int64_t>& get_removed_workspace_ids() const { return removed_workspace_ids_; }
+    void clear_removed_workspace_ids() { removed_workspace_ids_.clear(); }
+
 private:
     std::vector<std::unique_ptr<Workspace>> workspaces_;
     size_t current_workspace_index_;
+    std::vector<int64_t> removed_workspace_ids_;
+    WorkspaceLoader workspace_loader_;
+    SessionObserverList observers_;
     
     void ensure_default_workspace();
+    void notify_workspace(SessionEventType type, Workspace* workspace, size_t index);
 };
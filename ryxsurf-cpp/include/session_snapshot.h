@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+class SessionManager;
+
+/**
+ * SessionSnapshot is a flat, memory-mappable copy of the session tree that a
+ * clean shutdown leaves next to the database, so the next startup can draw
+ * the tab strip before SQLite is even opened.
+ *
+ * Layout (host byte order, checked via Header::byte_order):
+ *   Header | WorkspaceRecord[] | SessionRecord[] | TabRecord[] | string bytes
+ * Records are fixed-size and index into the following array (workspace ->
+ * first_session, session -> first_tab), and strings are offset/length pairs
+ * into the trailing string table, so readers use the mapping in place.
+ * Workspace and session names come first in the string table, followed by
+ * each session's tab strings in session order.
+ *
+ * open() only checksums the workspace and session records and the names, so
+ * its cost does not grow with the tab count. Each session carries its own
+ * checksum over its tab records and strings; verify_session() checks it, and
+ * must succeed before that session's tabs are read.
+ * The file is written to a temporary name and renamed over the old one.
+ *
+ * Ownership: SessionSnapshot owns its mapping; every record and string_view
+ * it hands out points into it and is invalid after close(). SQLite stays the
+ * source of truth: the snapshot is only a startup preview.
+ */
+class SessionSnapshot {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t WORKSPACE_DORMANT = 1;  // Sessions were not loaded when written
+    static constexpr uint32_t SESSION_OVERVIEW = 1;
+
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t file_size;
+        uint32_t checksum;  // CRC32 of the workspace and session records, then the names
+        uint32_t workspace_count;
+        uint32_t session_count;
+        uint32_t tab_count;
+        uint64_t workspaces_offset;
+        uint64_t sessions_offset;
+        uint64_t tabs_offset;
+        uint64_t strings_offset;
+        uint64_t names_size;  // Leading bytes of the string table holding names
+    };
+
+    struct WorkspaceRecord {
+        int64_t id;
+        int64_t created_at;
+        int64_t updated_at;
+        StringRef name;
+        uint32_t first_session;
+        uint32_t session_count;
+        uint32_t active_session;
+        uint32_t flags;
+    };
+
+    struct SessionRecord {
+        int64_t id;
+        int64_t created_at;
+        int64_t updated_at;
+        StringRef name;
+        uint32_t first_tab;
+        uint32_t tab_count;
+        uint32_t active_tab;
+        uint32_t flags;
+        StringRef tab_strings;  // Range of the string table used by this session's tabs
+        uint32_t tab_checksum;  // CRC32 of the tab records, then tab_strings
+        uint32_t reserved;
+    };
+
+    struct TabRecord {
+        int64_t id;
+        int64_t last_active;
+        StringRef url;
+        StringRef title;
+        StringRef snapshot_path;
+    };
+
+    SessionSnapshot();
+    ~SessionSnapshot();
+
+    // Non-copyable, non-movable (owns a mapping)
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+    SessionSnapshot(SessionSnapshot&&) = delete;
+    SessionSnapshot& operator=(SessionSnapshot&&) = delete;
+
+    // Serialize the in-memory tree and atomically replace `path` with it
+    static bool write(const std::string& path, SessionManager* session_manager);
+
+    // Map and validate a snapshot; false if missing, truncated or corrupt
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return header_ != nullptr; }
+
+    size_t get_workspace_count() const { return header_ ? header_->workspace_count : 0; }
+    size_t get_session_count() const { return header_ ? header_->session_count : 0; }
+    size_t get_tab_count() const { return header_ ? header_->tab_count : 0; }
+
+    // Records by global index (a workspace's sessions start at first_session)
+    const WorkspaceRecord& get_workspace(size_t index) const { return workspaces_[index]; }
+    const SessionRecord& get_session(size_t index) const { return sessions_[index]; }
+    const TabRecord& get_tab(size_t index) const { return tabs_[index]; }
+    // Check a session's tab records and strings against its checksum
+    bool verify_session(size_t index) const;
+    // Empty if the reference falls outside the string table
+    std::string_view get_string(StringRef ref) const;
+
+    // Size of the mapped file
+    size_t get_mapped_size() const { return size_; }
+
+private:
+    void* mapping_;
+    size_t size_;
+    const Header* header_;
+    const WorkspaceRecord* workspaces_;
+    const SessionRecord* sessions_;
+    const TabRecord* tabs_;
+    const char* strings_;
+    size_t strings_size_;
+
+    bool validate();
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "session_changes.h"
+#include <sqlite3.h>
+#include <string>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/**
+ * SessionWriter applies ChangeSets to the session database on a dedicated
+ * worker thread, so autosave never blocks the GTK main loop on SQLite.
+ * 
+ * Ownership: SessionWriter owns its worker thread and its own sqlite3
+ * connection (separate from PersistenceManager's read connection; WAL lets
+ * both coexist). A change set that fails to commit stays queued and is
+ * retried on the next submit() or flush(). Rows are written as upserts by id,
+ * so applying the same change set twice (journal replay) is harmless.
+ * 
+ * Tasks queued with post() (journal I/O) run on the same thread, in posting
+ * order, ahead of queued change sets; a stalled change set does not hold
+ * them back.
+ */
+class SessionWriter {
+public:
+    // Runs on the worker thread inside a change set's transaction, before its
+    // rows are written, and may fill in the rows (encrypted mode seals blobs
+    // here). It gets a fresh copy of the set on every attempt; false fails it.
+    using Prepare = std::function<bool(sqlite3* db, ChangeSet& changes)>;
+
+    SessionWriter();
+    ~SessionWriter();
+
+    // Non-copyable, non-movable (the worker thread holds this)
+    SessionWriter(const SessionWriter&) = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+    SessionWriter(SessionWriter&&) = delete;
+    SessionWriter& operator=(SessionWriter&&) = delete;
+
+    // Open the writer connection and start the worker thread
+    bool open(const std::string& db_path);
+    // Flush pending change sets, stop the worker and close the connection
+    void close();
+    bool is_open() const { return db_ != nullptr; }
+
+    // Queue a change set for the worker (never blocks on I/O). on_commit, if
+    // set, runs on the worker thread once the set has been committed.
+    void submit(ChangeSet changes, std::function<void()> on_commit = nullptr, Prepare prepare = nullptr);
+    // Block until every queued change set is committed; false if one failed
+    bool flush();
+    // Run `task` on the worker thread outside any transaction (never blocks)
+    void post(std::function<void()> task);
+    // Block until every posted task has run
+    void flush_posted();
+
+    // Rows changed by every committed change set so far
+    int64_t get_total_changes() const { return total_changes_; }
+
+    // Benchmark helpers (see PersistenceManager)
+    void set_statement_cache_enabled(bool enabled) { statement_cache_enabled_ = enabled; }
+    size_t get_statements_prepared() const { return statements_prepared_; }
+
+private:
+    enum class Statement {
+        UpsertWorkspace,
+        DeleteWorkspace,
+        UpsertSession,
+        DeleteSession,
+        UpsertTab,
+        DeleteTab,
+        UpsertWorkspaceBlob,
+        DeleteWorkspaceSessions,
+        UpsertMeta,
+        Count
+    };
+
+    sqlite3* db_;
+    std::array<sqlite3_stmt*, static_cast<size_t>(Statement::Count)> statements_;
+    std::atomic<bool> statement_cache_enabled_;
+    std::atomic<size_t> statements_prepared_;
+    std::atomic<int64_t> total_changes_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    struct Pending {
+        ChangeSet changes;
+        std::function<void()> on_commit;
+        Prepare prepare;
+    };
+    std::deque<Pending> queue_;
+    std::deque<std::function<void()>> tasks_;
+    bool busy_;
+    bool stalled_;  // Front change set failed; wait for the next submit/flush
+    bool stop_;
+
+    void run();
+    bool write(const Pending& pending);
+    bool delete_rows(Statement id, const std::vector<int64_t>& row_ids);
+    bool execute_sql(const char* sql);
+
+    bool prepare_statements();
+    void finalize_statements();
+    sqlite3_stmt* acquire(Statement id);
+    void release(sqlite3_stmt* stmt);
+};
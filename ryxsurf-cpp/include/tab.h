@@ -1,28 +1,34 @@
 #pragma once
 
+#include "session_events.h"
 #include <webkit/webkit.h>
 #include <gtk/gtk.h>
 #include <string>
 #include <memory>
 #include <chrono>
+#include <cstdint>
+
+class Session;  // Forward declaration
 
 /**
  * Tab represents a single browser tab with lazy WebView loading.
  * 
  * Ownership: Tab owns its WebKitWebView when loaded, but the view
  * is managed by GTK container hierarchy. Tab metadata persists even
- * when webview is unloaded.
+ * when webview is unloaded. URL and title changes are reported to the
+ * owning Session as TabNavigated/TabRetitled events.
  */
 class Tab {
 public:
     Tab(const std::string& url = "about:blank");
     ~Tab();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (WebKit signal handlers and the owning
+    // Session's events point at this)
     Tab(const Tab&) = delete;
     Tab& operator=(const Tab&) = delete;
-    Tab(Tab&&) = default;
-    Tab& operator=(Tab&&) = default;
+    Tab(Tab&&) = delete;
+    Tab& operator=(Tab&&) = delete;
 
     // WebView management
     WebKitWebView* get_webview();
@@ -35,8 +41,8 @@ public:
     // Metadata
     std::string get_url() const { return url_; }
     std::string get_title() const { return title_; }
-    void set_url(const std::string& url) { url_ = url; }
-    void set_title(const std::string& title) { title_ = title; }
+    void set_url(const std::string& url);
+    void set_title(const std::string& title);
     
     // Activity tracking
     void mark_active();
@@ -47,9 +53,20 @@ public:
     // Unload/restore
     void unload();
     void restore();
-    void set_snapshot_path(const std::string& path) { snapshot_path_ = path; }
+    void set_snapshot_path(const std::string& path);
     std::string get_snapshot_path() const { return snapshot_path_; }
 
+    // Persistence bookkeeping (row id is 0 until the tab has been stored)
+    int64_t get_row_id() const { return row_id_; }
+    void set_row_id(int64_t id) { row_id_ = id; }
+    bool is_dirty() const { return dirty_; }
+    void mark_dirty() { dirty_ = true; }
+    void clear_dirty() { dirty_ = false; }
+
+    // Owning session (set by Session::add_tab), null for a detached tab
+    Session* get_session() const { return session_; }
+    void set_session(Session* session) { session_ = session; }
+
 private:
     std::string url_;
     std::string title_;
@@ -59,4 +76,9 @@ private:
     std::chrono::system_clock::time_point last_active_system_;  // For persistence (absolute time)
     bool is_unloaded_;
     std::string snapshot_path_;
+    int64_t row_id_;
+    bool dirty_;
+    Session* session_;
+    
+    void notify(SessionEventType type);
 };
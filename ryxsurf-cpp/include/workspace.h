@@ -1,28 +1,34 @@
 #pragma once
 
+#include "session_events.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <cstdint>
 
 class Session;  // Forward declaration
+class SessionManager;
 
 /**
  * Workspace represents a named persistent container for sessions.
  * 
  * Ownership: Workspace owns its Session objects.
  * Workspaces persist across application restarts.
+ * 
+ * Session lifecycle events, and every event from its sessions, are delivered
+ * to this workspace's observers and then passed up to the SessionManager.
  */
 class Workspace {
 public:
     Workspace(const std::string& name);
     ~Workspace();
 
-    // Non-copyable, movable
+    // Non-copyable, non-movable (sessions point back at their workspace)
     Workspace(const Workspace&) = delete;
     Workspace& operator=(const Workspace&) = delete;
-    Workspace(Workspace&&) = default;
-    Workspace& operator=(Workspace&&) = default;
+    Workspace(Workspace&&) = delete;
+    Workspace& operator=(Workspace&&) = delete;
 
     // Session management
     Session* add_session(const std::string& name);
@@ -43,10 +49,40 @@ public:
     void set_created_at(std::chrono::system_clock::time_point tp) { created_at_ = tp; }
     void set_updated_at(std::chrono::system_clock::time_point tp) { updated_at_ = tp; }
 
+    // Persistence bookkeeping (row id is 0 until the workspace has been stored)
+    int64_t get_row_id() const { return row_id_; }
+    void set_row_id(int64_t id) { row_id_ = id; }
+    bool is_dirty() const { return dirty_; }
+    void clear_dirty() { dirty_ = false; }
+    const std::vector<int64_t>& get_removed_session_ids() const { return removed_session_ids_; }
+    void clear_removed_session_ids() { removed_session_ids_.clear(); }
+    // False while the workspace's sessions are still only in the database
+    bool is_loaded() const { return loaded_; }
+    void set_loaded(bool loaded);
+
+    // Change notifications (see SessionEvent)
+    SessionObserverList::ObserverId add_observer(SessionObserverList::Observer observer) {
+        return observers_.add(std::move(observer));
+    }
+    void remove_observer(SessionObserverList::ObserverId id) { observers_.remove(id); }
+    // Fill in this workspace, deliver to observers, then pass up to the manager
+    void notify(SessionEvent event);
+    
+    // Owning manager (set by SessionManager), null for a detached workspace
+    void set_session_manager(SessionManager* session_manager) { session_manager_ = session_manager; }
+
 private:
     std::string name_;
     std::vector<std::unique_ptr<Session>> sessions_;
     size_t active_session_index_;
     std::chrono::system_clock::time_point created_at_;
     std::chrono::system_clock::time_point updated_at_;
+    int64_t row_id_;
+    bool dirty_;
+    bool loaded_;
+    std::vector<int64_t> removed_session_ids_;  // Stored sessions removed since last save
+    SessionManager* session_manager_;
+    SessionObserverList observers_;
+    
+    void notify_session(SessionEventType type, Session* session, size_t index);
 };
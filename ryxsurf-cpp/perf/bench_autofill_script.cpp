@@ -0,0 +1,123 @@
+// Autofill script benchmark: what the shared autofill user script costs on
+// pages without a login form. Loads a form-less page (a few thousand nodes,
+// text inputs but no password field) repeatedly in a WebView with the
+// shared content manager and in one without it, and compares the median
+// time to WEBKIT_LOAD_FINISHED. Then runs the script body itself on that
+// page in a scratch script world and reports its in-page cost per run.
+// Needs a display (or a headless compositor) for GTK.
+//
+// Usage: bench_autofill_script [loads]
+
+#include "autofill_script.h"
+#include "bench_util.h"
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kScriptRuns = 1000;
+
+std::string build_page() {
+    std::string html = "<!doctype html><html><head><title>No login</title></head><body>";
+    for (int i = 0; i < 500; ++i) {
+        html += "<div class=\"item\"><h3>Item " + std::to_string(i) + "</h3><p>Some text <a href=\"#" +
+                std::to_string(i) + "\">link</a></p>";
+        if (i % 10 == 0) {
+            html += "<input type=\"text\" name=\"q" + std::to_string(i) + "\">";
+        }
+        html += "</div>";
+    }
+    return html + "</body></html>";
+}
+
+void iterate_until(const bool& done) {
+    while (!done) {
+        g_main_context_iteration(nullptr, TRUE);
+    }
+}
+
+double load(WebKitWebView* view, const std::string& html) {
+    bool finished = false;
+    gulong id = g_signal_connect(view, "load-changed",
+        G_CALLBACK(+[](WebKitWebView*, WebKitLoadEvent event, gpointer data) {
+            if (event == WEBKIT_LOAD_FINISHED) {
+                *static_cast<bool*>(data) = true;
+            }
+        }), &finished);
+    auto start = std::chrono::steady_clock::now();
+    webkit_web_view_load_html(view, html.c_str(), "https://bench.example/");
+    iterate_until(finished);
+    double ms = elapsed_ms(start);
+    g_signal_handler_disconnect(view, id);
+    return ms;
+}
+
+// The script body, kScriptRuns times, in a world without the handler (it
+// never posts on a page without a password field); microseconds per run
+double script_cost_us(WebKitWebView* view) {
+    std::string js = "const start = performance.now();\nfor (let i = 0; i < " +
+                     std::to_string(kScriptRuns) + "; ++i) {\n" + AutofillScript::source() +
+                     "}\nreturn (performance.now() - start) * 1000 / " + std::to_string(kScriptRuns) + ";";
+    struct Result {
+        bool done = false;
+        double us = -1;
+    } result;
+    webkit_web_view_call_async_javascript_function(
+        view, js.c_str(), -1, nullptr, "ryxsurf-bench", nullptr, nullptr,
+        +[](GObject* object, GAsyncResult* res, gpointer data) {
+            auto* out = static_cast<Result*>(data);
+            GError* error = nullptr;
+            JSCValue* value = webkit_web_view_call_async_javascript_function_finish(
+                WEBKIT_WEB_VIEW(object), res, &error);
+            if (value) {
+                out->us = jsc_value_to_double(value);
+                g_object_unref(value);
+            } else {
+                std::fprintf(stderr, "script failed: %s\n", error->message);
+                g_error_free(error);
+            }
+            out->done = true;
+        }, &result);
+    iterate_until(result.done);
+    return result.us;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int loads = argc > 1 ? std::atoi(argv[1]) : 50;
+    gtk_init();
+
+    std::string html = build_page();
+    WebKitWebView* plain = WEBKIT_WEB_VIEW(g_object_ref_sink(webkit_web_view_new()));
+    WebKitWebView* shared = WEBKIT_WEB_VIEW(g_object_ref_sink(g_object_new(WEBKIT_TYPE_WEB_VIEW,
+        "user-content-manager", AutofillScript::shared().get_content_manager(), nullptr)));
+
+    // Warm up both web processes, then alternate so drift hits both alike
+    load(plain, html);
+    load(shared, html);
+    std::vector<double> plain_ms;
+    std::vector<double> shared_ms;
+    for (int i = 0; i < loads; ++i) {
+        plain_ms.push_back(load(plain, html));
+        shared_ms.push_back(load(shared, html));
+    }
+    double script_us = script_cost_us(shared);
+
+    g_object_unref(shared);
+    g_object_unref(plain);
+
+    std::printf("=== Autofill script benchmark (%d loads, %zu byte page, no login form) ===\n",
+                loads, html.size());
+    std::printf("load without script:     %10.2f ms median\n", median(plain_ms));
+    std::printf("load with shared script: %10.2f ms median\n", median(shared_ms));
+    std::printf("difference:              %10.2f ms\n", median(shared_ms) - median(plain_ms));
+    std::printf("script body in page:     %10.2f us per run (%d runs)\n", script_us, kScriptRuns);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Offline breach check benchmark: writes a synthetic sorted SHA-1 corpus of
+// N hashes (20 bytes each; the default is about 3 GB), builds its Bloom
+// filter, then times 10k lookups (1 in 10 breached) with and without the
+// filter, with the process RSS each run adds. Finally audits 10k saved
+// credentials through PasswordManager::find_breached().
+//
+// Usage: bench_breach_corpus [hash_count] [corpus_path]
+
+#include "bench_util.h"
+#include "breach_corpus.h"
+#include "credential_transfer.h"
+#include "password_manager.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Hash = std::array<unsigned char, BreachCorpus::HASH_SIZE>;
+
+size_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0;
+    size_t resident = 0;
+    statm >> total >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Uniform hashes in ascending order without sorting: one per slot of the
+// prefix space, merged with the real hashes of `breached`
+bool write_corpus(const std::string& path, uint64_t count, std::vector<Hash> breached) {
+    std::sort(breached.begin(), breached.end());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::mt19937_64 rng(7);
+    const uint64_t slot = UINT64_MAX / count;
+    std::vector<char> buffer;
+    buffer.reserve(1 << 20);
+    size_t next_breached = 0;
+
+    auto emit = [&](const Hash& hash) {
+        buffer.insert(buffer.end(), hash.begin(), hash.end());
+        if (buffer.size() >= (1 << 20) - BreachCorpus::HASH_SIZE) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    };
+    for (uint64_t i = 0; i < count; ++i) {
+        Hash hash;
+        uint64_t prefix = i * slot + rng() % slot;
+        for (int b = 0; b < 8; ++b) {
+            hash[b] = static_cast<unsigned char>(prefix >> (56 - 8 * b));
+        }
+        uint64_t rest = rng();
+        for (int b = 8; b < 20; ++b) {
+            hash[b] = static_cast<unsigned char>(b < 16 ? rest >> (8 * (b - 8)) : rng());
+        }
+        while (next_breached < breached.size() && breached[next_breached] < hash) {
+            emit(breached[next_breached++]);
+        }
+        emit(hash);
+    }
+    while (next_breached < breached.size()) {
+        emit(breached[next_breached++]);
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return out.good();
+}
+
+struct Run {
+    double ms;
+    size_t hits;
+    size_t rss_added;
+};
+
+Run audit(const std::string& path, const std::vector<std::string>& passwords) {
+    BreachCorpus corpus;
+    if (!corpus.open(path)) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        std::exit(1);
+    }
+    size_t rss_before = resident_bytes();
+    auto start = std::chrono::steady_clock::now();
+    size_t hits = 0;
+    for (const std::string& password : passwords) {
+        hits += corpus.contains(password);
+    }
+    return Run{elapsed_ms(start), hits, resident_bytes() - rss_before};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint64_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 150000000;
+    std::string path = argc > 2 ? argv[2] : (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-breach-" + std::to_string(getpid()) + ".sha1")).string();
+    constexpr size_t kPasswords = 10000;
+
+    std::vector<std::string> passwords;
+    std::vector<Hash> breached;
+    for (size_t i = 0; i < kPasswords; ++i) {
+        passwords.push_back("saved-password-" + std::to_string(i));
+        if (i % 10 == 0) {
+            Hash hash;
+            BreachCorpus::sha1(passwords.back(), hash.data());
+            breached.push_back(hash);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!write_corpus(path, count, breached)) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return 1;
+    }
+    double write_ms = elapsed_ms(start);
+    double corpus_gb = static_cast<double>(std::filesystem::file_size(path)) / 1e9;
+
+    Run plain = audit(path, passwords);
+
+    start = std::chrono::steady_clock::now();
+    BreachCorpus::build_bloom_filter(path);
+    double bloom_ms = elapsed_ms(start);
+    double bloom_mb = static_cast<double>(std::filesystem::file_size(path + ".bloom")) / 1e6;
+    Run filtered = audit(path, passwords);
+
+    // The same audit over saved credentials: decrypt, hash, look up
+    std::string db_path = path + ".passwords.db";
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    setenv("RYXSURF_FORCE_SQLITE", "1", 1);
+    double find_ms;
+    size_t found;
+    {
+        std::string csv = "name,url,username,password\n";
+        for (size_t i = 0; i < kPasswords; ++i) {
+            csv += "s,https://site" + std::to_string(i) + ".example/,user," + passwords[i] + "\n";
+        }
+        std::istringstream in(csv);
+        CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+        PasswordManager pm;
+        pm.initialize("bench master password");
+        pm.import_credentials(reader);
+
+        BreachCorpus corpus;
+        corpus.open(path);
+        pm.set_breach_corpus(&corpus);
+        start = std::chrono::steady_clock::now();
+        found = pm.find_breached().size();
+        find_ms = elapsed_ms(start);
+        pm.close();
+    }
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + ".salt");
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".bloom");
+
+    std::printf("=== Breach corpus benchmark (%llu hashes, %.2f GB) ===\n",
+                static_cast<unsigned long long>(count), corpus_gb);
+    std::printf("write synthetic corpus:  %10.0f ms\n", write_ms);
+    std::printf("build Bloom filter:      %10.0f ms  (%.1f MB)\n", bloom_ms, bloom_mb);
+    std::printf("10k lookups, corpus:     %10.2f ms  (%zu hits, +%.1f MB RSS)\n",
+                plain.ms, plain.hits, static_cast<double>(plain.rss_added) / 1e6);
+    std::printf("10k lookups, Bloom:      %10.2f ms  (%zu hits, +%.1f MB RSS)\n",
+                filtered.ms, filtered.hits, static_cast<double>(filtered.rss_added) / 1e6);
+    std::printf("find_breached(), 10k:    %10.2f ms  (%zu breached)\n", find_ms, found);
+    return 0;
+}
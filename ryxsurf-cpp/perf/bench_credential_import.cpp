@@ -0,0 +1,120 @@
+// Bulk credential transfer benchmark: parses an N-row Chromium CSV export,
+// imports it into an encrypted SQLite store with import_credentials(), and
+// compares that with calling save() once per credential (each its own
+// transaction and encryption). Then times an encrypted export of the store.
+//
+// Usage: bench_credential_import [credential_count] [save_loop_count]
+
+#include "bench_util.h"
+#include "credential_transfer.h"
+#include "password_manager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string make_csv(size_t count) {
+    std::string csv = "name,url,username,password,note\n";
+    for (size_t i = 0; i < count; ++i) {
+        std::string n = std::to_string(i);
+        csv += "Site " + n + ",https://login.site" + n + ".example.com/signin,\"user" + n +
+               "@example.com\",\"Xy9!pass," + n + "\",\n";
+    }
+    return csv;
+}
+
+void remove_db(const std::string& path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".salt");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    size_t save_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    Crypto::init();
+
+    std::string csv = make_csv(count);
+    std::string db_path = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-import-" + std::to_string(getpid()) + ".db")).string();
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    setenv("RYXSURF_FORCE_SQLITE", "1", 1);
+
+    // Parse only
+    auto start = std::chrono::steady_clock::now();
+    size_t parsed = 0;
+    {
+        std::istringstream in(csv);
+        CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+        Credential cred;
+        while (reader.next(cred)) {
+            ++parsed;
+        }
+    }
+    double parse_ms = elapsed_ms(start);
+
+    // One save() per credential, on a smaller sample
+    remove_db(db_path);
+    double save_ms;
+    {
+        PasswordManager pm;
+        pm.initialize("bench master password");
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < save_count; ++i) {
+            std::string n = std::to_string(i);
+            pm.save("login.site" + n + ".example.com", "user" + n + "@example.com", "Xy9!pass," + n);
+        }
+        save_ms = elapsed_ms(start);
+        pm.close();
+    }
+
+    // Bulk import of the full file
+    remove_db(db_path);
+    double import_ms;
+    double export_ms;
+    PasswordManager::ImportStats stats;
+    size_t exported_bytes;
+    {
+        PasswordManager pm;
+        pm.initialize("bench master password");
+        std::istringstream in(csv);
+        CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+        start = std::chrono::steady_clock::now();
+        if (!pm.import_credentials(reader, &stats)) {
+            std::fprintf(stderr, "import failed: %s\n", reader.error().c_str());
+            return 1;
+        }
+        import_ms = elapsed_ms(start);
+
+        // Includes one Argon2id derivation for the export passphrase
+        std::ostringstream out;
+        EncryptedCredentialWriter writer(out);
+        start = std::chrono::steady_clock::now();
+        writer.begin("export passphrase");
+        pm.export_credentials(writer);
+        export_ms = elapsed_ms(start);
+        exported_bytes = out.str().size();
+        pm.close();
+    }
+    remove_db(db_path);
+
+    double save_us = save_ms * 1000.0 / save_count;
+    double import_us = import_ms * 1000.0 / count;
+    std::printf("=== Credential import benchmark (%zu credentials, %u threads) ===\n",
+                count, std::thread::hardware_concurrency());
+    std::printf("parse CSV:            %10.2f ms  (%zu parsed)\n", parse_ms, parsed);
+    std::printf("save() loop:          %10.2f us/credential  (%zu sampled, ~%.0f ms for all)\n",
+                save_us, save_count, save_us * count / 1000.0);
+    std::printf("import_credentials(): %10.2f us/credential  (%.2f ms, %zu imported, %zu skipped)\n",
+                import_us, import_ms, stats.imported, stats.skipped);
+    std::printf("speedup:              %10.1fx\n", save_us / import_us);
+    std::printf("encrypted export:     %10.2f ms  (%zu bytes)\n", export_ms, exported_bytes);
+    return 0;
+}
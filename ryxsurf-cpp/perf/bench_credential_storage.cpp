@@ -0,0 +1,190 @@
+// Credential storage benchmark: reads N encrypted credentials stored the old
+// way (hex TEXT, decoded with substr + sscanf per byte) and the current way
+// (raw BLOB read in place with sqlite3_column_blob), with and without the
+// decrypt step, and times PasswordManager's one-time hex -> BLOB migration.
+//
+// Usage: bench_credential_storage [credential_count]
+
+#include "bench_util.h"
+#include "crypto.h"
+#include "password_manager.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int kRounds = 5;
+
+struct Result {
+    double read_ms;     // SELECT + decode to ciphertext bytes
+    double decrypt_ms;  // the same, plus Crypto::decrypt
+    size_t stored_bytes;
+};
+
+std::string to_hex(const std::vector<unsigned char>& bytes) {
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char byte : bytes) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", byte);
+        hex += buf;
+    }
+    return hex;
+}
+
+// The decoder PasswordManager used before BLOB storage
+std::vector<unsigned char> legacy_from_hex(const std::string& encrypted) {
+    std::vector<unsigned char> bytes;
+    for (size_t i = 0; i < encrypted.length(); i += 2) {
+        unsigned int byte;
+        std::sscanf(encrypted.substr(i, 2).c_str(), "%02x", &byte);
+        bytes.push_back(static_cast<unsigned char>(byte));
+    }
+    return bytes;
+}
+
+void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::fprintf(stderr, "sqlite: %s\n", err ? err : "error");
+        std::exit(1);
+    }
+}
+
+void create_table(sqlite3* db) {
+    exec(db, "CREATE TABLE credentials (id INTEGER PRIMARY KEY AUTOINCREMENT, domain TEXT NOT NULL, "
+             "username TEXT NOT NULL, password_encrypted BLOB NOT NULL, created INTEGER NOT NULL, "
+             "last_used INTEGER NOT NULL, UNIQUE(domain, username));");
+}
+
+void fill(sqlite3* db, const std::vector<std::vector<unsigned char>>& ciphertexts, bool hex) {
+    exec(db, "BEGIN;");
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO credentials (domain, username, password_encrypted, created, last_used) "
+                           "VALUES (?, 'user', ?, 1, 1);", -1, &stmt, nullptr);
+    for (size_t i = 0; i < ciphertexts.size(); ++i) {
+        std::string domain = "site" + std::to_string(i) + ".example";
+        sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_TRANSIENT);
+        if (hex) {
+            sqlite3_bind_text(stmt, 2, to_hex(ciphertexts[i]).c_str(), -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_blob(stmt, 2, ciphertexts[i].data(), static_cast<int>(ciphertexts[i].size()),
+                              SQLITE_STATIC);
+        }
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    exec(db, "COMMIT;");
+}
+
+Result run(sqlite3* db, bool hex, const SecureBuffer& key) {
+    Result result{1e300, 1e300, 0};
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "SELECT password_encrypted FROM credentials;", -1, &stmt, nullptr);
+
+    for (int round = 0; round < kRounds * 2; ++round) {
+        bool decrypt = round % 2 == 1;
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            std::vector<unsigned char> ciphertext;
+            if (hex) {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                ciphertext = legacy_from_hex(text ? text : "");
+            } else {
+                const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+                ciphertext.assign(blob, blob + sqlite3_column_bytes(stmt, 0));
+            }
+            bytes += static_cast<size_t>(sqlite3_column_bytes(stmt, 0));
+            if (decrypt) {
+                Crypto::decrypt(ciphertext, key);
+            }
+        }
+        double ms = elapsed_ms(start);
+        sqlite3_reset(stmt);
+
+        double& slot = decrypt ? result.decrypt_ms : result.read_ms;
+        slot = std::min(slot, ms);
+        result.stored_bytes = bytes;
+    }
+
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    Crypto::init();
+
+    SecureBuffer key = Crypto::random_key();
+    std::vector<std::vector<unsigned char>> ciphertexts;
+    ciphertexts.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string password = "password-" + std::to_string(i) + "-Xy9!";
+        ciphertexts.push_back(Crypto::encrypt(std::vector<unsigned char>(password.begin(), password.end()), key));
+    }
+
+    sqlite3* hex_db = nullptr;
+    sqlite3* blob_db = nullptr;
+    sqlite3_open(":memory:", &hex_db);
+    sqlite3_open(":memory:", &blob_db);
+    create_table(hex_db);
+    create_table(blob_db);
+    fill(hex_db, ciphertexts, true);
+    fill(blob_db, ciphertexts, false);
+
+    Result hex = run(hex_db, true, key);
+    Result blob = run(blob_db, false, key);
+    sqlite3_close(hex_db);
+    sqlite3_close(blob_db);
+
+    // One-time migration through PasswordManager on an on-disk legacy database
+    std::string db_path = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-creds-" + std::to_string(getpid()) + ".db")).string();
+    sqlite3* legacy = nullptr;
+    sqlite3_open(db_path.c_str(), &legacy);
+    create_table(legacy);
+    fill(legacy, ciphertexts, true);
+    sqlite3_close(legacy);
+
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    setenv("RYXSURF_FORCE_SQLITE", "1", 1);
+    double open_legacy_ms;
+    double open_migrated_ms;
+    {
+        PasswordManager pm;
+        auto start = std::chrono::steady_clock::now();
+        pm.initialize();  // Converts every row, then loads the index
+        open_legacy_ms = elapsed_ms(start);
+        pm.close();
+    }
+    {
+        PasswordManager pm;
+        auto start = std::chrono::steady_clock::now();
+        pm.initialize();
+        open_migrated_ms = elapsed_ms(start);
+        pm.close();
+    }
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + ".salt");
+
+    std::printf("=== Credential storage benchmark (%zu credentials, best of %d) ===\n", count, kRounds);
+    std::printf("%-6s %12s %14s %14s\n", "format", "read_ms", "read+dec_ms", "stored_bytes");
+    std::printf("%-6s %12.2f %14.2f %14zu\n", "hex", hex.read_ms, hex.decrypt_ms, hex.stored_bytes);
+    std::printf("%-6s %12.2f %14.2f %14zu\n", "blob", blob.read_ms, blob.decrypt_ms, blob.stored_bytes);
+    std::printf("decode speedup: %.1fx, storage: %.0f%% of hex\n",
+                hex.read_ms / blob.read_ms, 100.0 * blob.stored_bytes / hex.stored_bytes);
+    std::printf("open: %.2f ms with hex -> blob migration, %.2f ms once migrated\n",
+                open_legacy_ms, open_migrated_ms);
+    return 0;
+}
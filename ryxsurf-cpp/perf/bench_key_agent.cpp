@@ -0,0 +1,105 @@
+// Key agent benchmark: time to open the session store and the password store
+// with a master password, each deriving its own key with Argon2id (the old
+// way) versus both taking a subkey from one KeyAgent unlock. Also times a
+// bare get_key() and the cost of re-opening a store while the agent is
+// already unlocked.
+//
+// Usage: bench_key_agent [rounds]
+
+#include "bench_util.h"
+#include "key_agent.h"
+#include "password_manager.h"
+#include "persistence_manager.h"
+#include "session_manager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+struct Paths {
+    std::string sessions;
+    std::string passwords;
+    std::string key_file;
+
+    void remove() const {
+        for (const std::string& path : {sessions, passwords}) {
+            for (const char* suffix : {"", ".salt", ".journal", "-wal", "-shm"}) {
+                std::filesystem::remove(path + suffix);
+            }
+        }
+        std::filesystem::remove(key_file);
+    }
+};
+
+// Opens both stores; with an agent, both take their keys from it
+double open_stores(const Paths& paths, KeyAgent* agent, const char* master) {
+    paths.remove();
+    SessionManager sm;
+    PersistenceManager sessions(&sm);
+    sessions.set_db_path_for_tests(paths.sessions);
+    PasswordManager passwords;
+    if (agent) {
+        sessions.set_key_agent(agent);
+        passwords.set_key_agent(agent);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = sessions.initialize(master) && passwords.initialize(master);
+    double ms = elapsed_ms(start);
+    if (!ok) {
+        std::fprintf(stderr, "initialize failed\n");
+        std::exit(1);
+    }
+    passwords.close();
+    sessions.close();
+    return ms;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 5;
+    Crypto::init();
+
+    std::string base = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-agent-" + std::to_string(getpid()))).string();
+    Paths paths{base + "-sessions.db", base + "-passwords.db", base + ".kdf"};
+    setenv("RYXSURF_PASSWORD_DB_PATH", paths.passwords.c_str(), 1);
+    setenv("RYXSURF_FORCE_SQLITE", "1", 1);
+
+    double separate_ms = 0;
+    double agent_ms = 0;
+    double reopen_ms = 0;
+    for (int i = 0; i < rounds; ++i) {
+        separate_ms += open_stores(paths, nullptr, "bench master password");
+
+        KeyAgent agent(paths.key_file);
+        agent_ms += open_stores(paths, &agent, "bench master password");
+        // The agent is still unlocked: no derivation at all
+        reopen_ms += open_stores(paths, &agent, "");
+    }
+
+    KeyAgent agent(paths.key_file);
+    agent.unlock("bench master password");
+    constexpr int kSubkeys = 100000;
+    SecureBuffer key;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kSubkeys; ++i) {
+        agent.get_key(KeyAgent::Purpose::Passwords, key);
+    }
+    double subkey_us = elapsed_ms(start) * 1000.0 / kSubkeys;
+    agent.lock();
+    paths.remove();
+
+    std::printf("=== Key agent benchmark (%d rounds) ===\n", rounds);
+    std::printf("two Argon2id derivations: %10.2f ms to open both stores\n", separate_ms / rounds);
+    std::printf("one KeyAgent unlock:      %10.2f ms to open both stores\n", agent_ms / rounds);
+    std::printf("agent already unlocked:   %10.2f ms to open both stores\n", reopen_ms / rounds);
+    std::printf("speedup:                  %10.1fx\n", separate_ms / agent_ms);
+    std::printf("get_key():                %10.3f us per subkey\n", subkey_us);
+    return 0;
+}
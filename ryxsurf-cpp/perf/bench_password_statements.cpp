@@ -0,0 +1,145 @@
+// Password database benchmark: lookup and update throughput of the SQLite
+// backend as it was (SQL compiled on every call, rollback journal with
+// synchronous=FULL), with the statement cache alone, and with the statement
+// cache plus WAL and synchronous=NORMAL. Lookups are get_one() (one row,
+// decrypted) and get() (all rows of a domain); updates are
+// update_last_used(), one transaction each. The three modes run
+// interleaved, kRounds times each, and the median of each figure is shown.
+//
+// Usage: bench_password_statements [credential_count] [operations]
+
+#include "credential_transfer.h"
+#include "password_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int kRounds = 3;
+
+struct Result {
+    double get_one_per_s;
+    double get_per_s;
+    double update_per_s;
+    size_t prepares;
+};
+
+double elapsed_s(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void remove_files(const std::string& db_path) {
+    for (const char* suffix : {"", ".salt", "-wal", "-shm", "-journal"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
+
+std::string domain(size_t i) {
+    return "site" + std::to_string(i) + ".example";
+}
+
+Result run(bool cached, bool wal, size_t count, size_t operations, const std::string& db_path) {
+    remove_files(db_path);
+    PasswordManager pm;
+    // Without WAL, SQLite's defaults: rollback journal, synchronous=FULL
+    pm.set_wal_enabled_for_tests(wal);
+    if (!pm.initialize("bench master password")) {
+        std::fprintf(stderr, "failed to open %s\n", db_path.c_str());
+        std::exit(1);
+    }
+
+    std::string csv = "name,url,username,password\n";
+    for (size_t i = 0; i < count; ++i) {
+        csv += "s,https://" + domain(i) + "/,user,password-" + std::to_string(i) + "\n";
+    }
+    std::istringstream in(csv);
+    CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+    pm.import_credentials(reader);
+    pm.set_statement_cache_enabled_for_tests(cached);
+
+    Result result{};
+    size_t prepared_before = pm.get_statements_prepared();
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; ++i) {
+        found += pm.get_one(domain(i * 7919 % count)).has_value();
+    }
+    result.get_one_per_s = operations / elapsed_s(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; ++i) {
+        found += pm.get(domain(i * 7919 % count)).size();
+    }
+    result.get_per_s = operations / elapsed_s(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; ++i) {
+        pm.update_last_used(domain(i * 7919 % count), "user");
+    }
+    result.update_per_s = operations / elapsed_s(start);
+    result.prepares = pm.get_statements_prepared() - prepared_before;
+
+    if (found != 2 * operations) {
+        std::fprintf(stderr, "lookups missed: %zu of %zu\n", 2 * operations - found, 2 * operations);
+        std::exit(1);
+    }
+    pm.close();
+    return result;
+}
+
+Result median(std::vector<Result> runs) {
+    auto pick = [&runs](double Result::*field) {
+        std::sort(runs.begin(), runs.end(),
+                  [field](const Result& a, const Result& b) { return a.*field < b.*field; });
+        return runs[runs.size() / 2].*field;
+    };
+    Result result{};
+    result.get_one_per_s = pick(&Result::get_one_per_s);
+    result.get_per_s = pick(&Result::get_per_s);
+    result.update_per_s = pick(&Result::update_per_s);
+    result.prepares = runs.front().prepares;
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    size_t operations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5000;
+    std::string db_path = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-pwstmt-" + std::to_string(getpid()) + ".db")).string();
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    setenv("RYXSURF_FORCE_SQLITE", "1", 1);
+
+    // Interleaved, so disk cache and write-back state affect every mode alike
+    std::vector<Result> before_runs;
+    std::vector<Result> cache_runs;
+    std::vector<Result> after_runs;
+    for (int round = 0; round < kRounds; ++round) {
+        before_runs.push_back(run(false, false, count, operations, db_path));
+        cache_runs.push_back(run(true, false, count, operations, db_path));
+        after_runs.push_back(run(true, true, count, operations, db_path));
+    }
+    remove_files(db_path);
+    Result before = median(before_runs);
+    Result cache = median(cache_runs);
+    Result after = median(after_runs);
+
+    std::printf("=== Password statement benchmark (%zu credentials, %zu operations) ===\n",
+                count, operations);
+    std::printf("%-16s %14s %14s %14s %10s\n", "mode", "get_one/s", "get/s", "update/s", "prepares");
+    std::printf("%-16s %14.0f %14.0f %14.0f %10zu\n", "before", before.get_one_per_s,
+                before.get_per_s, before.update_per_s, before.prepares);
+    std::printf("%-16s %14.0f %14.0f %14.0f %10zu\n", "cache", cache.get_one_per_s,
+                cache.get_per_s, cache.update_per_s, cache.prepares);
+    std::printf("%-16s %14.0f %14.0f %14.0f %10zu\n", "cache + WAL", after.get_one_per_s,
+                after.get_per_s, after.update_per_s, after.prepares);
+    return 0;
+}
@@ -0,0 +1,321 @@
+// Persistence benchmark suite: builds synthetic Workspace/Session/Tab trees
+// from 10 to 100k tabs and times, in plaintext and encrypted mode,
+//   - open: initialize() (includes key derivation when encrypted)
+//   - save_all: first full save, then an incremental save after touching 1%
+//   - load_all: startup restore (current workspace only), then every workspace
+//   - churn: journal and autosave ticks while tabs are edited, opened and closed
+// Results are written as JSON so runs can be compared across commits.
+//
+// Usage: bench_persistence [--max-tabs N] [--rounds N] [--out results.json]
+
+#include "bench_util.h"
+#include "persistence_manager.h"
+#include "session_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kTabsPerSession = 100;
+constexpr size_t kSessionsPerWorkspace = 20;
+constexpr size_t kSizes[] = {10, 100, 1000, 10000, 100000};
+constexpr const char* kPassword = "bench-master-password";
+
+struct Options {
+    size_t max_tabs = 100000;
+    size_t rounds = 50;
+    std::string out;
+};
+
+struct Churn {
+    size_t rounds = 0;
+    size_t edits_per_round = 0;
+    double journal_tick_p50_us = 0;
+    double journal_tick_p99_us = 0;
+    double autosave_tick_p50_us = 0;
+    double autosave_tick_p99_us = 0;
+    uint64_t journal_bytes = 0;
+    double final_save_ms = 0;
+};
+
+struct Result {
+    size_t tabs = 0;
+    bool encrypted = false;
+    double open_ms = 0;
+    double save_all_ms = 0;
+    int save_all_rows = 0;
+    double incremental_save_ms = 0;
+    int incremental_save_rows = 0;
+    double load_all_ms = 0;
+    double load_every_workspace_ms = 0;
+    size_t tabs_loaded = 0;
+    uint64_t db_bytes = 0;
+    Churn churn;
+};
+
+void build_profile(SessionManager& sm, size_t tab_count) {
+    sm.reset(false);
+    size_t created = 0;
+    for (size_t w = 0; created < tab_count; ++w) {
+        Workspace* ws = sm.add_workspace("Workspace " + std::to_string(w));
+        for (size_t s = 0; s < kSessionsPerWorkspace && created < tab_count; ++s) {
+            Session* session = ws->add_session("Session " + std::to_string(s));
+            for (size_t t = 0; t < kTabsPerSession && created < tab_count; ++t, ++created) {
+                Tab* tab = session->add_tab("https://example.com/" + std::to_string(created));
+                tab->set_title("Synthetic tab " + std::to_string(created));
+            }
+        }
+    }
+}
+
+// Every tab in the tree, for picking random edit targets
+std::vector<Tab*> all_tabs(SessionManager& sm) {
+    std::vector<Tab*> tabs;
+    for (size_t w = 0; w < sm.get_workspace_count(); ++w) {
+        Workspace* ws = sm.get_workspace(w);
+        for (size_t s = 0; s < ws->get_session_count(); ++s) {
+            Session* session = ws->get_session(s);
+            for (size_t t = 0; t < session->get_tab_count(); ++t) {
+                tabs.push_back(session->get_tab(t));
+            }
+        }
+    }
+    return tabs;
+}
+
+size_t count_tabs(SessionManager& sm) {
+    return all_tabs(sm).size();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+}
+
+void remove_files(const std::string& db_path) {
+    for (const char* suffix : {"", "-wal", "-shm", ".salt", ".journal", ".journal.1", ".snapshot"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
+
+uint64_t db_bytes(const std::string& db_path) {
+    uint64_t total = 0;
+    for (const char* suffix : {"", "-wal"}) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(db_path + suffix, ec);
+        total += ec ? 0 : size;
+    }
+    return total;
+}
+
+bool open_profile(PersistenceManager& pm, const std::string& db_path, bool encrypted) {
+    pm.set_db_path_for_tests(db_path);
+    return pm.initialize(encrypted ? kPassword : "");
+}
+
+// Edit, open and close tabs between ticks the way a browsing session would:
+// a journal tick every round and an autosave tick every tenth round
+Churn run_churn(SessionManager& sm, PersistenceManager& pm, size_t rounds) {
+    Churn churn;
+    churn.rounds = rounds;
+    std::vector<Tab*> tabs = all_tabs(sm);
+    churn.edits_per_round = std::max<size_t>(1, tabs.size() / 100);
+
+    std::mt19937 rng(42);
+    std::vector<double> journal_us, autosave_us;
+    uint64_t journal_before = pm.get_journal_bytes_written();
+    Session* session = sm.get_current_session();
+    for (size_t round = 0; round < rounds; ++round) {
+        std::uniform_int_distribution<size_t> pick(0, tabs.size() - 1);
+        for (size_t i = 0; i < churn.edits_per_round; ++i) {
+            Tab* tab = tabs[pick(rng)];
+            tab->set_title("Edited " + std::to_string(round) + "/" + std::to_string(i));
+        }
+        if (session) {
+            session->add_tab("https://example.com/churn/" + std::to_string(round));
+            session->remove_tab(0);
+            tabs = all_tabs(sm);  // remove_tab freed a Tab the list pointed at
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pm.journal_changes();
+        journal_us.push_back(elapsed_ms(start) * 1000.0);
+
+        if (round % 10 == 9) {
+            start = std::chrono::steady_clock::now();
+            pm.queue_autosave();
+            autosave_us.push_back(elapsed_ms(start) * 1000.0);
+        }
+    }
+
+    churn.journal_tick_p50_us = percentile(journal_us, 0.50);
+    churn.journal_tick_p99_us = percentile(journal_us, 0.99);
+    churn.autosave_tick_p50_us = percentile(autosave_us, 0.50);
+    churn.autosave_tick_p99_us = percentile(autosave_us, 0.99);
+
+    auto start = std::chrono::steady_clock::now();
+    pm.save_all();
+    churn.final_save_ms = elapsed_ms(start);
+    // The writer thread has caught up with the journal too
+    churn.journal_bytes = pm.get_journal_bytes_written() - journal_before;
+    return churn;
+}
+
+Result run(size_t tab_count, bool encrypted, size_t rounds, const std::string& db_path) {
+    remove_files(db_path);
+    Result result;
+    result.tabs = tab_count;
+    result.encrypted = encrypted;
+
+    {
+        SessionManager sm;
+        build_profile(sm, tab_count);
+        PersistenceManager pm(&sm);
+        auto start = std::chrono::steady_clock::now();
+        if (!open_profile(pm, db_path, encrypted)) {
+            std::fprintf(stderr, "failed to open %s\n", db_path.c_str());
+            std::exit(1);
+        }
+        result.open_ms = elapsed_ms(start);
+
+        start = std::chrono::steady_clock::now();
+        pm.save_all();
+        result.save_all_ms = elapsed_ms(start);
+        result.save_all_rows = pm.get_last_save_changes();
+
+        std::vector<Tab*> tabs = all_tabs(sm);
+        for (size_t i = 0; i < tabs.size(); i += 100) {
+            tabs[i]->set_title("Touched " + std::to_string(i));
+        }
+        start = std::chrono::steady_clock::now();
+        pm.save_all();
+        result.incremental_save_ms = elapsed_ms(start);
+        result.incremental_save_rows = pm.get_last_save_changes();
+        pm.close();
+    }
+    result.db_bytes = db_bytes(db_path);
+
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        if (!open_profile(pm, db_path, encrypted)) {
+            std::fprintf(stderr, "failed to reopen %s\n", db_path.c_str());
+            std::exit(1);
+        }
+        auto start = std::chrono::steady_clock::now();
+        pm.load_all();
+        result.load_all_ms = elapsed_ms(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t w = 0; w < sm.get_workspace_count(); ++w) {
+            sm.switch_workspace(w);
+        }
+        sm.switch_workspace(0);
+        result.load_every_workspace_ms = result.load_all_ms + elapsed_ms(start);
+        result.tabs_loaded = count_tabs(sm);
+
+        result.churn = run_churn(sm, pm, rounds);
+        pm.close();
+    }
+
+    remove_files(db_path);
+    return result;
+}
+
+void write_json(std::FILE* out, const std::vector<Result>& results) {
+    std::fprintf(out, "{\n  \"benchmark\": \"persistence\",\n");
+    std::fprintf(out, "  \"timestamp\": %lld,\n",
+                 static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch()).count()));
+    std::fprintf(out, "  \"results\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(out, "%s\n    {\n", i ? "," : "");
+        std::fprintf(out, "      \"tabs\": %zu,\n", r.tabs);
+        std::fprintf(out, "      \"mode\": \"%s\",\n", r.encrypted ? "encrypted" : "plaintext");
+        std::fprintf(out, "      \"open_ms\": %.3f,\n", r.open_ms);
+        std::fprintf(out, "      \"save_all_ms\": %.3f,\n", r.save_all_ms);
+        std::fprintf(out, "      \"save_all_rows\": %d,\n", r.save_all_rows);
+        std::fprintf(out, "      \"incremental_save_ms\": %.3f,\n", r.incremental_save_ms);
+        std::fprintf(out, "      \"incremental_save_rows\": %d,\n", r.incremental_save_rows);
+        std::fprintf(out, "      \"load_all_ms\": %.3f,\n", r.load_all_ms);
+        std::fprintf(out, "      \"load_every_workspace_ms\": %.3f,\n", r.load_every_workspace_ms);
+        std::fprintf(out, "      \"tabs_loaded\": %zu,\n", r.tabs_loaded);
+        std::fprintf(out, "      \"db_bytes\": %llu,\n", static_cast<unsigned long long>(r.db_bytes));
+        std::fprintf(out, "      \"churn\": {\n");
+        std::fprintf(out, "        \"rounds\": %zu,\n", r.churn.rounds);
+        std::fprintf(out, "        \"edits_per_round\": %zu,\n", r.churn.edits_per_round);
+        std::fprintf(out, "        \"journal_tick_p50_us\": %.1f,\n", r.churn.journal_tick_p50_us);
+        std::fprintf(out, "        \"journal_tick_p99_us\": %.1f,\n", r.churn.journal_tick_p99_us);
+        std::fprintf(out, "        \"autosave_tick_p50_us\": %.1f,\n", r.churn.autosave_tick_p50_us);
+        std::fprintf(out, "        \"autosave_tick_p99_us\": %.1f,\n", r.churn.autosave_tick_p99_us);
+        std::fprintf(out, "        \"journal_bytes\": %llu,\n", static_cast<unsigned long long>(r.churn.journal_bytes));
+        std::fprintf(out, "        \"final_save_ms\": %.3f\n", r.churn.final_save_ms);
+        std::fprintf(out, "      }\n    }");
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--max-tabs") == 0 && has_value) {
+            options.max_tabs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--rounds") == 0 && has_value) {
+            options.rounds = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--out") == 0 && has_value) {
+            options.out = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--max-tabs N] [--rounds N] [--out results.json]\n", argv[0]);
+        return 2;
+    }
+    std::string db_path = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-persistence-" + std::to_string(getpid()) + ".db")).string();
+
+    std::vector<Result> results;
+    for (size_t tabs : kSizes) {
+        if (tabs > options.max_tabs) {
+            break;
+        }
+        for (bool encrypted : {false, true}) {
+            results.push_back(run(tabs, encrypted, options.rounds, db_path));
+            const Result& r = results.back();
+            std::fprintf(stderr, "%7zu tabs %-9s save %9.2f ms  load %8.2f ms  all %9.2f ms  churn p99 %8.1f us\n",
+                         r.tabs, r.encrypted ? "encrypted" : "plaintext", r.save_all_ms, r.load_all_ms,
+                         r.load_every_workspace_ms, r.churn.journal_tick_p99_us);
+        }
+    }
+
+    std::FILE* out = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "failed to write %s\n", options.out.c_str());
+        return 1;
+    }
+    write_json(out, results);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Re-key benchmark: fills a credentials-shaped SQLite table with N rows
+// (default 100000) sealed under one key, then moves them to another key
+// with Rekey::run() (batched, parallel AEAD, one transaction) and with the
+// row-at-a-time loop it replaced (decrypt, encrypt into a new vector,
+// update). Runs once with password-sized rows and once with 4 KB rows
+// (session blobs), and reports seconds and rows per second for each.
+//
+// Usage: bench_rekey [rows] [directory]
+
+#include "crypto.h"
+#include "rekey.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sqlite3.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+void remove_db(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+sqlite3* fill(const std::string& path, size_t rows, size_t row_size, const SecureBuffer& key) {
+    remove_db(path);
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;"
+                     "CREATE TABLE credentials (id INTEGER PRIMARY KEY AUTOINCREMENT, domain TEXT NOT NULL,"
+                     " password_encrypted BLOB NOT NULL);",
+                 nullptr, nullptr, nullptr);
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO credentials (domain, password_encrypted) VALUES (?, ?);", -1, &insert,
+                       nullptr);
+    std::vector<unsigned char> plaintext = Crypto::random_bytes(row_size);
+    std::vector<unsigned char> sealed(Crypto::sealed_size(row_size));
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    for (size_t i = 0; i < rows; ++i) {
+        std::string domain = "site" + std::to_string(i) + ".example";
+        Crypto::encrypt(plaintext.data(), plaintext.size(), key, sealed.data());
+        sqlite3_bind_text(insert, 1, domain.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_blob(insert, 2, sealed.data(), static_cast<int>(sealed.size()), SQLITE_STATIC);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_finalize(insert);
+    return db;
+}
+
+// The loop Rekey replaced: read everything, re-seal one row at a time, write
+bool sequential_rekey(sqlite3* db, const SecureBuffer& old_key, const SecureBuffer& new_key) {
+    std::vector<std::pair<sqlite3_int64, std::vector<unsigned char>>> rows;
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT id, password_encrypted FROM credentials WHERE length(password_encrypted) > 0;",
+                       -1, &stmt, nullptr);
+    bool ok = true;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 1));
+        std::vector<unsigned char> sealed(blob, blob + sqlite3_column_bytes(stmt, 1));
+        try {
+            std::vector<unsigned char> plaintext = Crypto::decrypt(sealed, old_key);
+            rows.emplace_back(sqlite3_column_int64(stmt, 0), Crypto::encrypt(plaintext, new_key));
+        } catch (const std::exception&) {
+            ok = false;
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_prepare_v2(db, "UPDATE credentials SET password_encrypted = ? WHERE id = ?;", -1, &stmt, nullptr);
+    ok = ok && sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    for (size_t i = 0; ok && i < rows.size(); ++i) {
+        sqlite3_bind_blob(stmt, 1, rows[i].second.data(), static_cast<int>(rows[i].second.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, rows[i].first);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+template <typename Body>
+double seconds(Body body) {
+    auto start = std::chrono::steady_clock::now();
+    if (!body()) {
+        std::fprintf(stderr, "re-key failed\n");
+        std::exit(1);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::filesystem::path dir = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::temp_directory_path();
+    std::string path = (dir / ("ryxsurf-bench-rekey-" + std::to_string(getpid()) + ".db")).string();
+
+    Crypto::init();
+    SecureBuffer first = Crypto::random_key();
+    SecureBuffer second = Crypto::random_key();
+
+    std::printf("=== Re-key benchmark (%zu rows) ===\n", rows);
+    std::printf("%-10s %-14s %10s %14s\n", "row size", "method", "seconds", "rows/s");
+    for (size_t row_size : {size_t(24), size_t(4096)}) {
+        sqlite3* db = fill(path, rows, row_size, first);
+        size_t reports = 0;
+        double parallel = seconds([&] {
+            return Rekey::run(db, "credentials", "id", "password_encrypted", first, second,
+                              [&](size_t, size_t) { ++reports; });
+        });
+        double sequential = seconds([&] { return sequential_rekey(db, second, first); });
+        sqlite3_close(db);
+        remove_db(path);
+
+        std::printf("%-10zu %-14s %10.3f %14.0f\n", row_size, "Rekey::run", parallel, rows / parallel);
+        std::printf("%-10zu %-14s %10.3f %14.0f\n", row_size, "row at a time", sequential, rows / sequential);
+        std::printf("%-10s (%zu progress reports)\n", "", reports);
+    }
+    return 0;
+}
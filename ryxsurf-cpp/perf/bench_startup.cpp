@@ -0,0 +1,149 @@
+// Startup benchmark: time from process start to having the titles of the
+// current session's tabs, i.e. what the tab strip needs for its first frame.
+// Compares opening the SQLite database (initialize + load_all) with mapping
+// the binary snapshot a clean shutdown leaves behind.
+//
+// Usage: bench_startup [tab_count] [iterations]
+
+#include "bench_util.h"
+#include "persistence_manager.h"
+#include "session_manager.h"
+#include "session_snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kTabsPerSession = 100;
+constexpr size_t kSessionsPerWorkspace = 20;
+
+void build_profile(SessionManager& sm, size_t tab_count) {
+    sm.reset(false);
+    size_t created = 0;
+    for (size_t w = 0; created < tab_count; ++w) {
+        Workspace* ws = sm.add_workspace("Workspace " + std::to_string(w));
+        for (size_t s = 0; s < kSessionsPerWorkspace && created < tab_count; ++s) {
+            Session* session = ws->add_session("Session " + std::to_string(s));
+            for (size_t t = 0; t < kTabsPerSession && created < tab_count; ++t, ++created) {
+                Tab* tab = session->add_tab("https://example.com/" + std::to_string(created));
+                tab->set_title("Synthetic tab " + std::to_string(created));
+            }
+        }
+    }
+}
+
+void remove_files(const std::string& db_path) {
+    for (const char* suffix : {"", "-wal", "-shm", ".journal", ".snapshot"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
+
+// Bytes of title text seen, so neither path can be optimised away
+size_t sqlite_startup(const std::string& db_path) {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    pm.set_db_path_for_tests(db_path);
+    if (!pm.initialize() || !pm.load_all()) {
+        std::fprintf(stderr, "failed to load %s\n", db_path.c_str());
+        std::exit(1);
+    }
+
+    size_t bytes = 0;
+    Session* session = sm.get_current_workspace() ? sm.get_current_workspace()->get_active_session() : nullptr;
+    for (size_t t = 0; session && t < session->get_tab_count(); ++t) {
+        bytes += session->get_tab(t)->get_title().size();
+    }
+    pm.close();
+    return bytes;
+}
+
+size_t snapshot_startup(const std::string& snapshot_path) {
+    SessionSnapshot snapshot;
+    if (!snapshot.open(snapshot_path) || snapshot.get_workspace_count() == 0) {
+        std::fprintf(stderr, "failed to map %s\n", snapshot_path.c_str());
+        std::exit(1);
+    }
+
+    size_t bytes = 0;
+    const auto& ws = snapshot.get_workspace(0);
+    if (ws.active_session < ws.session_count && snapshot.verify_session(ws.first_session + ws.active_session)) {
+        const auto& session = snapshot.get_session(ws.first_session + ws.active_session);
+        for (uint32_t t = 0; t < session.tab_count; ++t) {
+            bytes += snapshot.get_string(snapshot.get_tab(session.first_tab + t).title).size();
+        }
+    }
+    return bytes;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t tab_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    std::string db_path = (std::filesystem::temp_directory_path() /
+        ("ryxsurf-bench-startup-" + std::to_string(getpid()) + ".db")).string();
+    remove_files(db_path);
+
+    std::string snapshot_path;
+    size_t snapshot_bytes = 0;
+    {
+        SessionManager sm;
+        build_profile(sm, tab_count);
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(db_path);
+        if (!pm.initialize() || !pm.save_all()) {
+            std::fprintf(stderr, "failed to write %s\n", db_path.c_str());
+            return 1;
+        }
+        snapshot_path = pm.get_snapshot_path();
+        pm.close();
+
+        auto start = std::chrono::steady_clock::now();
+        if (!SessionSnapshot::write(snapshot_path, &sm)) {
+            std::fprintf(stderr, "failed to write %s\n", snapshot_path.c_str());
+            return 1;
+        }
+        std::printf("snapshot write: %.2f ms, %ju bytes\n", elapsed_ms(start),
+                    static_cast<uintmax_t>(std::filesystem::file_size(snapshot_path)));
+    }
+
+    // load_all deletes the snapshot, so keep a copy to restore after each SQLite run
+    std::string saved_snapshot = snapshot_path + ".bench";
+    std::filesystem::copy_file(snapshot_path, saved_snapshot, std::filesystem::copy_options::overwrite_existing);
+
+    std::vector<double> sqlite_ms, snapshot_ms;
+    size_t sqlite_bytes = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        snapshot_bytes = snapshot_startup(snapshot_path);
+        snapshot_ms.push_back(elapsed_ms(start));
+
+        start = std::chrono::steady_clock::now();
+        sqlite_bytes = sqlite_startup(db_path);
+        sqlite_ms.push_back(elapsed_ms(start));
+        std::filesystem::copy_file(saved_snapshot, snapshot_path, std::filesystem::copy_options::overwrite_existing);
+    }
+    if (sqlite_bytes != snapshot_bytes) {
+        std::fprintf(stderr, "title bytes differ: sqlite %zu, snapshot %zu\n", sqlite_bytes, snapshot_bytes);
+        return 1;
+    }
+
+    std::printf("=== Startup benchmark (%zu tabs, median of %zu) ===\n", tab_count, iterations);
+    std::printf("%-10s %12s\n", "backend", "first_frame_ms");
+    std::printf("%-10s %12.3f\n", "sqlite", median(sqlite_ms));
+    std::printf("%-10s %12.3f\n", "snapshot", median(snapshot_ms));
+    std::printf("Speedup: %.1fx\n", median(sqlite_ms) / std::max(median(snapshot_ms), 1e-6));
+
+    std::filesystem::remove(saved_snapshot);
+    remove_files(db_path);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Timing helpers shared by the benchmarks in perf/
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+inline double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// The middle sample (the upper one of an even count)
+inline double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
@@ -88,6 +88,16 @@ else
 fi
 echo "" | tee -a "$RESULT_FILE"
 
+# Test 3: Persistence benchmarks (only built with -Dbenchmarks=true)
+BENCH_PERSISTENCE="$BUILD_DIR/bench_persistence"
+if [ -x "$BENCH_PERSISTENCE" ]; then
+    echo -e "${YELLOW}Test 3: Persistence${NC}" | tee -a "$RESULT_FILE"
+    PERSISTENCE_JSON="$RESULTS_DIR/persistence_${TIMESTAMP}.json"
+    "$BENCH_PERSISTENCE" --out "$PERSISTENCE_JSON" 2>&1 | tee -a "$RESULT_FILE"
+    echo "PERSISTENCE_JSON=${PERSISTENCE_JSON}" | tee -a "$RESULT_FILE"
+    echo "" | tee -a "$RESULT_FILE"
+fi
+
 # Summary
 echo "=== Summary ===" | tee -a "$RESULT_FILE"
 echo "COLD_START_MS=${ELAPSED_MS}" | tee -a "$RESULT_FILE"
@@ -0,0 +1,202 @@
+#include "autofill_script.h"
+#include "password_manager.h"
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace {
+
+// Compiled into the binary and handed to WebKit once, for every view
+const char kSource[] = R"JS((() => {
+  'use strict';
+  let requested = false;
+
+  function usernameField(password) {
+    // The last text-like input before the password field, in its form
+    let candidate = null;
+    for (const input of (password.form || document).querySelectorAll('input')) {
+      if (input === password) {
+        break;
+      }
+      if (input.type === 'text' || input.type === 'email' || input.type === 'tel') {
+        candidate = input;
+      }
+    }
+    return candidate;
+  }
+
+  function setValue(input, value) {
+    input.value = value;
+    input.dispatchEvent(new Event('input', {bubbles: true}));
+    input.dispatchEvent(new Event('change', {bubbles: true}));
+  }
+
+  function fill(password, credential) {
+    if (!credential || password.value) {
+      return;
+    }
+    const username = usernameField(password);
+    if (username && username.value && username.value !== credential.username) {
+      return;
+    }
+    if (username && !username.value) {
+      setValue(username, credential.username);
+    }
+    setValue(password, credential.password);
+  }
+
+  function request(gesture) {
+    return window.webkit.messageHandlers.ryxsurfAutofill.postMessage({origin: location.origin, gesture});
+  }
+
+  // Nothing for this exact host: the site's logins are offered only once
+  // the user clicks or types in the form (page script cannot fake isTrusted)
+  function offerOnGesture(password) {
+    const username = usernameField(password);
+    function onGesture(event) {
+      if (!event.isTrusted || (event.target !== password && event.target !== username)) {
+        return;
+      }
+      document.removeEventListener('pointerdown', onGesture, true);
+      document.removeEventListener('keydown', onGesture, true);
+      request(true).then(credential => fill(password, credential), () => {});
+    }
+    document.addEventListener('pointerdown', onGesture, true);
+    document.addEventListener('keydown', onGesture, true);
+  }
+
+  function check() {
+    if (requested) {
+      return;
+    }
+    const password = document.querySelector('input[type="password"]');
+    if (!password) {
+      return;
+    }
+    requested = true;
+    document.removeEventListener('focusin', onFocus, true);
+    request(false).then(credential => {
+      if (credential) {
+        fill(password, credential);
+      } else {
+        offerOnGesture(password);
+      }
+    }, () => {});
+  }
+
+  function onFocus(event) {
+    if (event.target instanceof HTMLInputElement) {
+      check();
+    }
+  }
+
+  check();
+  if (!requested) {
+    document.addEventListener('focusin', onFocus, true);
+  }
+})();
+)JS";
+
+// Keeps a reply (and, through the message, its JS context) until the
+// keyring answers. Dropped unanswered, WebKit rejects the page's promise.
+struct PendingReply {
+    WebKitScriptMessageReply* reply;
+    JSCValue* message;
+
+    PendingReply(WebKitScriptMessageReply* r, JSCValue* m)
+        : reply(webkit_script_message_reply_ref(r))
+        , message(JSC_VALUE(g_object_ref(m))) {}
+    ~PendingReply() {
+        webkit_script_message_reply_unref(reply);
+        g_object_unref(message);
+    }
+    PendingReply(const PendingReply&) = delete;
+    PendingReply& operator=(const PendingReply&) = delete;
+};
+
+void reply_with(WebKitScriptMessageReply* reply, JSCValue* message, const std::optional<Credential>& cred) {
+    JSCContext* context = jsc_value_get_context(message);
+    JSCValue* result;
+    if (cred) {
+        result = jsc_value_new_object(context, nullptr, nullptr);
+        JSCValue* username = jsc_value_new_string(context, cred->username.c_str());
+        JSCValue* password = jsc_value_new_string(context, cred->password.c_str());
+        jsc_value_object_set_property(result, "username", username);
+        jsc_value_object_set_property(result, "password", password);
+        g_object_unref(username);
+        g_object_unref(password);
+    } else {
+        result = jsc_value_new_null(context);
+    }
+    webkit_script_message_reply_return_value(reply, result);
+    g_object_unref(result);
+}
+
+}  // namespace
+
+AutofillScript::AutofillScript()
+    : content_manager_(nullptr)
+    , password_manager_(nullptr)
+{
+}
+
+AutofillScript& AutofillScript::shared() {
+    static AutofillScript script;
+    return script;
+}
+
+const char* AutofillScript::source() {
+    return kSource;
+}
+
+WebKitUserContentManager* AutofillScript::get_content_manager() {
+    if (content_manager_) {
+        return content_manager_;
+    }
+
+    content_manager_ = webkit_user_content_manager_new();
+    g_signal_connect(content_manager_, "script-message-with-reply-received::ryxsurfAutofill",
+                     G_CALLBACK(&AutofillScript::on_message), this);
+    webkit_user_content_manager_register_script_message_handler_with_reply(
+        content_manager_, HANDLER_NAME, WORLD_NAME);
+
+    WebKitUserScript* script = webkit_user_script_new_for_world(
+        kSource,
+        WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+        WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END,
+        WORLD_NAME,
+        nullptr,
+        nullptr);
+    webkit_user_content_manager_add_script(content_manager_, script);
+    webkit_user_script_unref(script);
+    return content_manager_;
+}
+
+gboolean AutofillScript::on_message(WebKitUserContentManager*, JSCValue* value,
+                                    WebKitScriptMessageReply* reply, gpointer user_data) {
+    auto* self = static_cast<AutofillScript*>(user_data);
+    if (!self->password_manager_ || !jsc_value_is_object(value)) {
+        reply_with(reply, value, std::nullopt);
+        return TRUE;
+    }
+
+    // {origin, gesture}, posted from our own world (see source())
+    JSCValue* origin_value = jsc_value_object_get_property(value, "origin");
+    JSCValue* gesture_value = jsc_value_object_get_property(value, "gesture");
+    std::string origin_str;
+    if (jsc_value_is_string(origin_value)) {
+        char* origin = jsc_value_to_string(origin_value);
+        origin_str = origin;
+        g_free(origin);
+    }
+    auto trigger = jsc_value_to_boolean(gesture_value) ? PasswordManager::AutofillTrigger::UserGesture
+                                                       : PasswordManager::AutofillTrigger::PageLoad;
+    g_object_unref(origin_value);
+    g_object_unref(gesture_value);
+
+    auto pending = std::make_shared<PendingReply>(reply, value);
+    self->password_manager_->autofill(origin_str, trigger, [pending](std::optional<Credential> cred) {
+        reply_with(pending->reply, pending->message, cred);
+    });
+    return TRUE;
+}
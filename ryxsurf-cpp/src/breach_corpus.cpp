@@ -0,0 +1,363 @@
+#include "breach_corpus.h"
+#include <glib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kBloomMagic[8] = {'R', 'Y', 'X', 'B', 'L', 'O', 'O', 'M'};
+constexpr uint32_t kByteOrder = 0x01020304;
+constexpr size_t kBlockWords = 8;  // 512 bits, one cache line
+constexpr uint32_t kMaxProbes = 10;  // 9 bits each from hash bytes 8..19
+
+static_assert(sizeof(BreachCorpus::BloomHeader) == 64, "BloomHeader must keep blocks cache-line aligned");
+
+uint64_t prefix_of(const unsigned char* hash) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = value << 8 | hash[i];
+    }
+    return value;
+}
+
+// Monotonic in the prefix, so a sorted corpus fills blocks in order
+uint64_t block_of(const unsigned char* hash, uint64_t block_count) {
+    uint64_t span = UINT64_MAX / block_count + 1;
+    return prefix_of(hash) / span;
+}
+
+uint32_t probe_bit(const unsigned char* hash, uint32_t probe) {
+    uint32_t bit = probe * 9;
+    uint32_t window = static_cast<uint32_t>(hash[8 + bit / 8]) << 8 | hash[9 + bit / 8];
+    return (window >> (7 - bit % 8)) & 511;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Map a whole file read-only; size 0 maps nothing
+bool map_file(const std::string& path, void*& mapping, size_t& size) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    mapping = nullptr;
+    if (size > 0) {
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        size = 0;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+BreachCorpus::BreachCorpus()
+    : open_(false)
+    , records_(nullptr)
+    , record_count_(0)
+    , mapping_(nullptr)
+    , mapping_size_(0)
+    , bloom_mapping_(nullptr)
+    , bloom_mapping_size_(0)
+    , bloom_blocks_(nullptr)
+    , bloom_block_count_(0)
+    , bloom_probes_(0)
+{
+}
+
+BreachCorpus::~BreachCorpus() {
+    close();
+}
+
+bool BreachCorpus::open(const std::string& path) {
+    close();
+
+    if (!map_file(path, mapping_, mapping_size_)) {
+        return false;
+    }
+    if (mapping_size_ % HASH_SIZE != 0) {
+        close();
+        return false;
+    }
+    if (mapping_) {
+        // Lookups touch a few scattered pages; readahead would only grow RSS
+        madvise(mapping_, mapping_size_, MADV_RANDOM);
+    }
+    records_ = static_cast<const unsigned char*>(mapping_);
+    record_count_ = mapping_size_ / HASH_SIZE;
+    open_ = true;
+
+    open_bloom_filter(path + ".bloom");
+    return true;
+}
+
+bool BreachCorpus::open_bloom_filter(const std::string& path) {
+    void* mapping;
+    size_t size;
+    if (!map_file(path, mapping, size)) {
+        return false;
+    }
+    const BloomHeader* header = static_cast<const BloomHeader*>(mapping);
+    bool valid = size >= sizeof(BloomHeader) &&
+        std::memcmp(header->magic, kBloomMagic, sizeof(kBloomMagic)) == 0 &&
+        header->version == BLOOM_VERSION && header->byte_order == kByteOrder &&
+        header->record_count == record_count_ && header->block_count > 0 &&
+        header->probes >= 1 && header->probes <= kMaxProbes &&
+        (size - sizeof(BloomHeader)) / (kBlockWords * sizeof(uint64_t)) == header->block_count &&
+        (size - sizeof(BloomHeader)) % (kBlockWords * sizeof(uint64_t)) == 0;
+    if (!valid) {
+        // A filter from another corpus would reject hashes it never saw
+        if (mapping) {
+            munmap(mapping, size);
+        }
+        return false;
+    }
+
+    madvise(mapping, size, MADV_RANDOM);
+    bloom_mapping_ = mapping;
+    bloom_mapping_size_ = size;
+    bloom_blocks_ = reinterpret_cast<const uint64_t*>(static_cast<const char*>(mapping) + sizeof(BloomHeader));
+    bloom_block_count_ = header->block_count;
+    bloom_probes_ = header->probes;
+    return true;
+}
+
+void BreachCorpus::close() {
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+    if (bloom_mapping_) {
+        munmap(bloom_mapping_, bloom_mapping_size_);
+    }
+    open_ = false;
+    records_ = nullptr;
+    record_count_ = 0;
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    bloom_mapping_ = nullptr;
+    bloom_mapping_size_ = 0;
+    bloom_blocks_ = nullptr;
+    bloom_block_count_ = 0;
+    bloom_probes_ = 0;
+}
+
+void BreachCorpus::sha1(std::string_view data, unsigned char out[HASH_SIZE]) {
+    GChecksum* checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    g_checksum_update(checksum, reinterpret_cast<const guchar*>(data.data()), static_cast<gssize>(data.size()));
+    gsize length = HASH_SIZE;
+    g_checksum_get_digest(checksum, out, &length);
+    g_checksum_free(checksum);
+}
+
+bool BreachCorpus::contains(std::string_view password) const {
+    unsigned char hash[HASH_SIZE];
+    sha1(password, hash);
+    return contains_hash(hash);
+}
+
+bool BreachCorpus::contains_hash(const unsigned char* sha1) const {
+    if (record_count_ == 0) {
+        return false;
+    }
+    if (bloom_blocks_ && !bloom_may_contain(sha1)) {
+        return false;
+    }
+    return search(sha1);
+}
+
+bool BreachCorpus::bloom_may_contain(const unsigned char* sha1) const {
+    const uint64_t* block = bloom_blocks_ + block_of(sha1, bloom_block_count_) * kBlockWords;
+    for (uint32_t probe = 0; probe < bloom_probes_; ++probe) {
+        uint32_t bit = probe_bit(sha1, probe);
+        if (!(block[bit / 64] & (uint64_t{1} << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BreachCorpus::search(const unsigned char* sha1) const {
+    auto record = [this](size_t i) { return records_ + i * HASH_SIZE; };
+    const uint64_t key = prefix_of(sha1);
+
+    // Interpolate over [lo, hi) while the guesses keep landing
+    size_t lo = 0;
+    size_t hi = record_count_;
+    for (int step = 0; step < MAX_INTERPOLATION_STEPS && hi - lo > 1; ++step) {
+        uint64_t first = prefix_of(record(lo));
+        uint64_t last = prefix_of(record(hi - 1));
+        if (key < first || key > last) {
+            return false;
+        }
+        if (first == last) {
+            break;
+        }
+        long double fraction = static_cast<long double>(key - first) / static_cast<long double>(last - first);
+        size_t pos = lo + static_cast<size_t>(fraction * static_cast<long double>(hi - 1 - lo));
+        pos = std::min(pos, hi - 1);
+
+        int cmp = std::memcmp(sha1, record(pos), HASH_SIZE);
+        if (cmp == 0) {
+            return true;
+        }
+        if (cmp < 0) {
+            hi = pos;
+        } else {
+            lo = pos + 1;
+        }
+    }
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = std::memcmp(sha1, record(mid), HASH_SIZE);
+        if (cmp == 0) {
+            return true;
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return false;
+}
+
+bool BreachCorpus::build_bloom_filter(const std::string& corpus_path, unsigned bits_per_entry) {
+    BreachCorpus corpus;
+    if (!corpus.open(corpus_path) || bits_per_entry == 0) {
+        return false;
+    }
+
+    BloomHeader header{};
+    std::memcpy(header.magic, kBloomMagic, sizeof(kBloomMagic));
+    header.version = BLOOM_VERSION;
+    header.byte_order = kByteOrder;
+    header.record_count = corpus.record_count_;
+    header.block_count = std::max<uint64_t>(
+        1, (static_cast<uint64_t>(corpus.record_count_) * bits_per_entry + 511) / 512);
+    // k = m/n * ln 2 minimises false positives for a plain Bloom filter
+    header.probes = std::clamp<uint32_t>(
+        static_cast<uint32_t>(std::lround(bits_per_entry * 0.6931)), 1, kMaxProbes);
+
+    std::vector<uint64_t> blocks(header.block_count * kBlockWords, 0);
+    if (corpus.mapping_) {
+        madvise(corpus.mapping_, corpus.mapping_size_, MADV_SEQUENTIAL);
+    }
+    for (size_t i = 0; i < corpus.record_count_; ++i) {
+        const unsigned char* hash = corpus.records_ + i * HASH_SIZE;
+        uint64_t* block = &blocks[block_of(hash, header.block_count) * kBlockWords];
+        for (uint32_t probe = 0; probe < header.probes; ++probe) {
+            uint32_t bit = probe_bit(hash, probe);
+            block[bit / 64] |= uint64_t{1} << (bit % 64);
+        }
+    }
+
+    // Readers only ever see no filter or the complete new one
+    std::string path = corpus_path + ".bloom";
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(blocks.data()),
+                  static_cast<std::streamsize>(blocks.size() * sizeof(uint64_t)));
+        if (!out.good()) {
+            std::filesystem::remove(tmp_path);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool BreachCorpus::convert_hibp_text(std::istream& in, std::ostream& out, size_t* count) {
+    size_t written = 0;
+    unsigned char hash[HASH_SIZE];
+    unsigned char previous[HASH_SIZE];
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        // "HASH" or "HASH:COUNT"
+        if (line.size() < HASH_SIZE * 2 || (line.size() > HASH_SIZE * 2 && line[HASH_SIZE * 2] != ':')) {
+            return false;
+        }
+        for (size_t i = 0; i < HASH_SIZE; ++i) {
+            int high = hex_value(line[2 * i]);
+            int low = hex_value(line[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            hash[i] = static_cast<unsigned char>(high << 4 | low);
+        }
+        if (written > 0) {
+            int cmp = std::memcmp(hash, previous, HASH_SIZE);
+            if (cmp < 0) {
+                return false;  // Lookups rely on the order
+            }
+            if (cmp == 0) {
+                continue;
+            }
+        }
+        out.write(reinterpret_cast<const char*>(hash), HASH_SIZE);
+        std::memcpy(previous, hash, HASH_SIZE);
+        ++written;
+    }
+    if (count) {
+        *count = written;
+    }
+    return !in.bad() && out.good();
+}
+
+std::string BreachCorpus::default_path() {
+    if (const char* override_path = std::getenv("RYXSURF_BREACH_CORPUS")) {
+        return override_path;
+    }
+    std::filesystem::path base_dir;
+    if (const char* xdg_data = std::getenv("XDG_DATA_HOME")) {
+        base_dir = std::filesystem::path(xdg_data) / "ryxsurf";
+    } else if (const char* home = std::getenv("HOME")) {
+        base_dir = std::filesystem::path(home) / ".local" / "share" / "ryxsurf";
+    } else {
+        base_dir = std::filesystem::path("/tmp") / "ryxsurf";
+    }
+    return (base_dir / "breached-passwords.sha1").string();
+}
@@ -4,7 +4,11 @@
 #include "workspace.h"
 #include "tab_unload_manager.h"
 #include "persistence_manager.h"
+#include "session_snapshot.h"
 #include "password_manager.h"
+#include "autofill_script.h"
+#include "breach_corpus.h"
+#include "key_agent.h"
 #include "theme_manager.h"
 #include <gtk/gtk.h>
 #include <webkit/webkit.h>
@@ -28,9 +32,13 @@ BrowserWindow::BrowserWindow()
     , keyboard_handler_(std::make_unique<KeyboardHandler>(this))
     , unload_manager_(std::make_unique<TabUnloadManager>())
     , persistence_manager_(std::make_unique<PersistenceManager>(session_manager_.get()))
+    , breach_corpus_(std::make_unique<BreachCorpus>())
     , password_manager_(std::make_unique<PasswordManager>())
     , theme_manager_(std::make_unique<ThemeManager>())
     , unload_timer_id_(0)
+    , restore_idle_id_(0)
+    , refresh_idle_id_(0)
+    , model_observer_id_(0)
 {
     // Create main window
     window_ = GTK_WINDOW(gtk_window_new());
@@ -114,23 +122,46 @@ BrowserWindow::BrowserWindow()
     // Apply theme
     theme_manager_->apply_to_window(window_);
     
-    // Initialize persistence and load saved sessions
-    if (persistence_manager_->initialize()) {
-        persistence_manager_->load_all();
-        persistence_manager_->enable_autosave(30);
-    }
-    
-    // Initialize password manager
+    // Initialize password manager; connect to the keyring in the background
+    // so the first save or autofill does not wait on D-Bus. Both stores take
+    // their keys from the shared agent, so one unlock serves the profile.
+    password_manager_->set_key_agent(&KeyAgent::shared());
     password_manager_->initialize();
+    password_manager_->probe_keyring_async();
     
-    // Create initial tab if no sessions loaded
-    if (session_manager_->get_current_session() && 
-        session_manager_->get_current_session()->get_tab_count() == 0) {
-        session_manager_->new_tab();
+    // Breach checks stay off unless an offline corpus has been installed;
+    // opening only maps it
+    if (breach_corpus_->open(BreachCorpus::default_path())) {
+        password_manager_->set_breach_corpus(breach_corpus_.get());
     }
+    AutofillScript::shared().set_password_manager(password_manager_.get());
     
-    refresh_ui();
-    update_notebook();
+    // Page titles and URLs change as pages load, outside any UI action;
+    // redraw once per burst when it affects the visible session
+    model_observer_id_ = session_manager_->add_observer([this](const SessionEvent& event) {
+        if (event.type != SessionEventType::TabRetitled && event.type != SessionEventType::TabNavigated) {
+            return;
+        }
+        if (session_manager_->get_workspace_count() > 0 &&
+            event.session == session_manager_->get_current_session()) {
+            schedule_refresh();
+        }
+    });
+    
+    // After a clean shutdown, draw the tab strip from the mapped snapshot and
+    // restore from SQLite once the first frame is up
+    SessionSnapshot snapshot;
+    if (snapshot.open(persistence_manager_->get_snapshot_path())) {
+        show_snapshot_preview(snapshot);
+        restore_idle_id_ = g_idle_add(+[](gpointer user_data) -> gboolean {
+            BrowserWindow* bw = static_cast<BrowserWindow*>(user_data);
+            bw->restore_idle_id_ = 0;
+            bw->restore_sessions();
+            return G_SOURCE_REMOVE;
+        }, this);
+    } else {
+        restore_sessions();
+    }
     
     // Setup periodic unload check (every 60 seconds)
     unload_timer_id_ = g_timeout_add_seconds(60, 
@@ -144,12 +175,13 @@ BrowserWindow::BrowserWindow()
             return TRUE;
         }, this);
     
-    // Connect window close - save before exit
+    // Connect window close - final synchronous flush (waits for the writer thread)
     g_signal_connect(window_, "close-request",
                      G_CALLBACK(+[](GtkWindow* window, gpointer user_data) -> gboolean {
                          BrowserWindow* bw = static_cast<BrowserWindow*>(user_data);
                          if (bw->persistence_manager_) {
                              bw->persistence_manager_->save_all();
+                             bw->persistence_manager_->write_snapshot();
                          }
                          gtk_window_destroy(window);
                          return TRUE;
@@ -157,12 +189,25 @@ BrowserWindow::BrowserWindow()
 }
 
 BrowserWindow::~BrowserWindow() {
-    // Save before exit
+    AutofillScript::shared().set_password_manager(nullptr);
+    
+    // Save before exit; writes nothing if close-request already flushed
     if (persistence_manager_) {
         persistence_manager_->save_all();
         persistence_manager_->close();
     }
     
+    if (restore_idle_id_ != 0) {
+        g_source_remove(restore_idle_id_);
+        restore_idle_id_ = 0;
+    }
+    
+    session_manager_->remove_observer(model_observer_id_);
+    if (refresh_idle_id_ != 0) {
+        g_source_remove(refresh_idle_id_);
+        refresh_idle_id_ = 0;
+    }
+    
     // Remove unload timer
     if (unload_timer_id_ != 0) {
         g_source_remove(unload_timer_id_);
@@ -174,6 +219,31 @@ BrowserWindow::~BrowserWindow() {
     }
 }
 
+void BrowserWindow::restore_sessions() {
+    // Initialize persistence and load saved sessions
+    persistence_manager_->set_key_agent(&KeyAgent::shared());
+    bool load_failed = false;
+    if (persistence_manager_->initialize()) {
+        if (persistence_manager_->load_all()) {
+            persistence_manager_->enable_autosave(30);
+        } else {
+            load_failed = true;
+        }
+    }
+    
+    // Create initial tab if no sessions loaded. After a failed load the
+    // current workspace is a shell over stored rows, so leave it empty.
+    if (!load_failed && session_manager_->get_current_session() && 
+        session_manager_->get_current_session()->get_tab_count() == 0) {
+        session_manager_->new_tab();
+    }
+    
+    // Rebuilt from the model, replacing any snapshot preview
+    gtk_widget_set_sensitive(GTK_WIDGET(tab_strip_), TRUE);
+    refresh_ui();
+    update_notebook();
+}
+
 void BrowserWindow::show() {
     gtk_window_present(window_);
 }
@@ -299,94 +369,129 @@ void BrowserWindow::focus_address_bar() {
 }
 
 void BrowserWindow::update_tab_bar() {
-    // Clear existing tab buttons from tab strip
-    GtkWidget* child = gtk_widget_get_first_child(GTK_WIDGET(tab_strip_));
-    while (child) {
-        GtkWidget* next = gtk_widget_get_next_sibling(child);
-        gtk_box_remove(tab_strip_, child);
-        child = next;
-    }
+    clear_tab_strip();
     
     Session* session = session_manager_->get_current_session();
     if (!session) {
         return;
     }
     
-    // Add tab buttons with subtle dividers
     for (size_t i = 0; i < session->get_tab_count(); ++i) {
         Tab* tab = session->get_tab(i);
         if (!tab) {
             continue;
         }
-        
-        // Add divider before tab (except first)
-        if (i > 0) {
-            GtkWidget* divider = gtk_separator_new(GTK_ORIENTATION_VERTICAL);
-            gtk_widget_add_css_class(divider, "tab-divider");
-            gtk_box_append(tab_strip_, divider);
-        }
-        
-        GtkButton* button = GTK_BUTTON(gtk_button_new());
-        gtk_widget_add_css_class(GTK_WIDGET(button), "tab-button");
-        gtk_button_set_has_frame(button, FALSE);
-        
-        GtkBox* box = GTK_BOX(gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4));
-        
-        // Tab title (truncated)
-        std::string title = tab->get_title();
-        if (title.length() > 20) {
-            title = title.substr(0, 18) + "…";
-        }
-        GtkLabel* label = GTK_LABEL(gtk_label_new(title.c_str()));
-        gtk_widget_add_css_class(GTK_WIDGET(label), "tab-title");
-        gtk_label_set_ellipsize(label, PANGO_ELLIPSIZE_END);
-        gtk_label_set_max_width_chars(label, 20);
-        gtk_box_append(box, GTK_WIDGET(label));
-        
-        // Close button (hidden until hover via CSS)
-        GtkButton* close_btn = GTK_BUTTON(gtk_button_new_from_icon_name("window-close-symbolic"));
-        gtk_button_set_has_frame(close_btn, FALSE);
-        gtk_widget_add_css_class(GTK_WIDGET(close_btn), "tab-close-button");
-        g_signal_connect(close_btn, "clicked",
-                         G_CALLBACK(on_tab_close_clicked), this);
-        g_object_set_data(G_OBJECT(close_btn), "tab-index", GINT_TO_POINTER(i));
-        gtk_box_append(box, GTK_WIDGET(close_btn));
-        
-        gtk_button_set_child(button, GTK_WIDGET(box));
-        
-        // Highlight active tab
-        if (i == session->get_active_tab_index()) {
-            gtk_widget_add_css_class(GTK_WIDGET(button), "active-tab");
-        }
-        
-        // Mark unloaded tabs
-        if (tab->is_unloaded()) {
-            gtk_widget_add_css_class(GTK_WIDGET(button), "unloaded");
-        }
-        
-        // Add animation class
-        if (theme_manager_->are_animations_enabled()) {
-            gtk_widget_add_css_class(GTK_WIDGET(button), "animate-fade-in");
-        }
+        append_tab_button(i, tab->get_title(), i == session->get_active_tab_index(), tab->is_unloaded());
+    }
+    append_new_tab_button();
+}
 
-        g_object_set_data(G_OBJECT(button), "tab-index", GINT_TO_POINTER(i));
-        g_signal_connect(button, "clicked", G_CALLBACK(+[](GtkButton* btn, gpointer user_data) {
-            BrowserWindow* bw = static_cast<BrowserWindow*>(user_data);
-            gpointer idx_ptr = g_object_get_data(G_OBJECT(btn), "tab-index");
-            if (idx_ptr) {
-                size_t index = static_cast<size_t>(GPOINTER_TO_INT(idx_ptr));
-                Session* session = bw->session_manager_->get_current_session();
-                if (session) {
-                    session->set_active_tab(index);
-                    bw->show_tab(index);
-                }
-            }
-        }), this);
-        
-        gtk_box_append(tab_strip_, GTK_WIDGET(button));
+void BrowserWindow::show_snapshot_preview(const SessionSnapshot& snapshot) {
+    // Same workspace/session load_all() will restore; titles come straight
+    // from the mapping
+    if (snapshot.get_workspace_count() == 0) {
+        return;
+    }
+    const SessionSnapshot::WorkspaceRecord& ws = snapshot.get_workspace(0);
+    if (ws.session_count == 0) {
+        return;
+    }
+    
+    uint32_t active_session = ws.active_session < ws.session_count ? ws.active_session : 0;
+    if (!snapshot.verify_session(ws.first_session + active_session)) {
+        return;
+    }
+    const SessionSnapshot::SessionRecord& session = snapshot.get_session(ws.first_session + active_session);
+    
+    clear_tab_strip();
+    for (uint32_t i = 0; i < session.tab_count; ++i) {
+        std::string_view title = snapshot.get_string(snapshot.get_tab(session.first_tab + i).title);
+        append_tab_button(i, std::string(title), i == session.active_tab, false);
+    }
+    append_new_tab_button();
+    // The buttons' handlers act on the model, which restore_sessions() has
+    // not loaded yet
+    gtk_widget_set_sensitive(GTK_WIDGET(tab_strip_), FALSE);
+}
+
+void BrowserWindow::clear_tab_strip() {
+    GtkWidget* child = gtk_widget_get_first_child(GTK_WIDGET(tab_strip_));
+    while (child) {
+        GtkWidget* next = gtk_widget_get_next_sibling(child);
+        gtk_box_remove(tab_strip_, child);
+        child = next;
+    }
+}
+
+void BrowserWindow::append_tab_button(size_t i, const std::string& tab_title, bool active, bool unloaded) {
+    // Add divider before tab (except first)
+    if (i > 0) {
+        GtkWidget* divider = gtk_separator_new(GTK_ORIENTATION_VERTICAL);
+        gtk_widget_add_css_class(divider, "tab-divider");
+        gtk_box_append(tab_strip_, divider);
+    }
+    
+    GtkButton* button = GTK_BUTTON(gtk_button_new());
+    gtk_widget_add_css_class(GTK_WIDGET(button), "tab-button");
+    gtk_button_set_has_frame(button, FALSE);
+    
+    GtkBox* box = GTK_BOX(gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4));
+    
+    // Tab title (truncated)
+    std::string title = tab_title;
+    if (title.length() > 20) {
+        title = title.substr(0, 18) + "…";
+    }
+    GtkLabel* label = GTK_LABEL(gtk_label_new(title.c_str()));
+    gtk_widget_add_css_class(GTK_WIDGET(label), "tab-title");
+    gtk_label_set_ellipsize(label, PANGO_ELLIPSIZE_END);
+    gtk_label_set_max_width_chars(label, 20);
+    gtk_box_append(box, GTK_WIDGET(label));
+    
+    // Close button (hidden until hover via CSS)
+    GtkButton* close_btn = GTK_BUTTON(gtk_button_new_from_icon_name("window-close-symbolic"));
+    gtk_button_set_has_frame(close_btn, FALSE);
+    gtk_widget_add_css_class(GTK_WIDGET(close_btn), "tab-close-button");
+    g_signal_connect(close_btn, "clicked",
+                     G_CALLBACK(on_tab_close_clicked), this);
+    g_object_set_data(G_OBJECT(close_btn), "tab-index", GINT_TO_POINTER(i));
+    gtk_box_append(box, GTK_WIDGET(close_btn));
+    
+    gtk_button_set_child(button, GTK_WIDGET(box));
+    
+    // Highlight active tab
+    if (active) {
+        gtk_widget_add_css_class(GTK_WIDGET(button), "active-tab");
+    }
+    
+    // Mark unloaded tabs
+    if (unloaded) {
+        gtk_widget_add_css_class(GTK_WIDGET(button), "unloaded");
     }
     
-    // Add "new tab" button at end
+    // Add animation class
+    if (theme_manager_->are_animations_enabled()) {
+        gtk_widget_add_css_class(GTK_WIDGET(button), "animate-fade-in");
+    }
+
+    g_object_set_data(G_OBJECT(button), "tab-index", GINT_TO_POINTER(i));
+    g_signal_connect(button, "clicked", G_CALLBACK(+[](GtkButton* btn, gpointer user_data) {
+        BrowserWindow* bw = static_cast<BrowserWindow*>(user_data);
+        gpointer idx_ptr = g_object_get_data(G_OBJECT(btn), "tab-index");
+        if (idx_ptr) {
+            size_t index = static_cast<size_t>(GPOINTER_TO_INT(idx_ptr));
+            Session* session = bw->session_manager_->get_current_session();
+            if (session) {
+                session->set_active_tab(index);
+                bw->show_tab(index);
+            }
+        }
+    }), this);
+    
+    gtk_box_append(tab_strip_, GTK_WIDGET(button));
+}
+
+void BrowserWindow::append_new_tab_button() {
     GtkButton* new_tab_btn = GTK_BUTTON(gtk_button_new_from_icon_name("list-add-symbolic"));
     gtk_button_set_has_frame(new_tab_btn, FALSE);
     gtk_widget_add_css_class(GTK_WIDGET(new_tab_btn), "tab-button");
@@ -416,6 +521,18 @@ void BrowserWindow::refresh_ui() {
     update_sidebar();
 }
 
+void BrowserWindow::schedule_refresh() {
+    if (refresh_idle_id_ != 0) {
+        return;
+    }
+    refresh_idle_id_ = g_idle_add(+[](gpointer user_data) -> gboolean {
+        BrowserWindow* bw = static_cast<BrowserWindow*>(user_data);
+        bw->refresh_idle_id_ = 0;
+        bw->refresh_ui();
+        return G_SOURCE_REMOVE;
+    }, this);
+}
+
 void BrowserWindow::update_session_indicator() {
     if (!session_indicator_) {
         return;
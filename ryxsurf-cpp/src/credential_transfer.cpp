@@ -0,0 +1,826 @@
+#include "credential_transfer.h"
+#include "public_suffix.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+constexpr size_t kReadBlockSize = 64 * 1024;
+constexpr size_t kMaxJsonDepth = 64;
+
+// "RYXCRED" + format version (1: bare salt, 2: KDF header)
+const char kExportMagic[8] = {'R', 'Y', 'X', 'C', 'R', 'E', 'D', 2};
+constexpr size_t kFrameHeaderSize = 9;  // uint64 frame index + final flag
+
+char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string lowercase(std::string_view text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), ascii_lower);
+    return result;
+}
+
+// http(s) URLs and bare hosts; not android://, chrome://, file:// and the like
+bool is_web_url(std::string_view url) {
+    size_t scheme_end = url.find("://");
+    if (scheme_end == std::string_view::npos) {
+        return true;
+    }
+    std::string scheme = lowercase(url.substr(0, scheme_end));
+    return scheme == "http" || scheme == "https";
+}
+
+std::chrono::system_clock::time_point from_millis(const std::string& text,
+                                                  std::chrono::system_clock::time_point fallback) {
+    if (text.empty()) {
+        return fallback;
+    }
+    char* end = nullptr;
+    long long millis = std::strtoll(text.c_str(), &end, 10);
+    if (*end != '\0' || millis <= 0) {
+        return fallback;
+    }
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(millis)));
+}
+
+long long to_millis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+void append_csv_field(std::string& out, std::string_view field) {
+    out += '"';
+    for (char c : field) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+}  // namespace
+
+// Buffered byte source: the parsers pull one character at a time, and the
+// stream is read a block at a time behind them
+class CredentialReader::Source {
+public:
+    explicit Source(std::istream& in) : in_(in), pos_(0) {}
+    virtual ~Source() = default;
+
+    int peek() {
+        if (pos_ == buffer_.size() && !refill()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(buffer_[pos_]);
+    }
+
+    int get() {
+        int c = peek();
+        if (c >= 0) {
+            ++pos_;
+        }
+        return c;
+    }
+
+    const std::string& error() const { return error_; }
+
+protected:
+    std::istream& in_;
+    std::string error_;
+
+    // Replace `buffer` with the next block; false at the end or on an error
+    virtual bool fill(std::string& buffer) {
+        buffer.resize(kReadBlockSize);
+        in_.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+        buffer.resize(static_cast<size_t>(in_.gcount()));
+        if (in_.bad()) {
+            error_ = "read error";
+            return false;
+        }
+        return !buffer.empty();
+    }
+
+private:
+    std::string buffer_;
+    size_t pos_;
+
+    bool refill() {
+        pos_ = 0;
+        while (error_.empty()) {
+            buffer_.clear();
+            if (!fill(buffer_)) {
+                return false;
+            }
+            if (!buffer_.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Decrypts an EncryptedCredentialWriter export frame by frame
+class CredentialReader::DecryptingSource : public CredentialReader::Source {
+public:
+    DecryptingSource(std::istream& in, const std::string& passphrase)
+        : Source(in), frame_index_(0), final_seen_(false)
+    {
+        char magic[sizeof(kExportMagic)];
+        if (!in_.read(magic, sizeof(magic)) || std::memcmp(magic, kExportMagic, sizeof(magic) - 1) != 0 ||
+            magic[7] < 1 || magic[7] > kExportMagic[7]) {
+            error_ = "not a RyxSurf credential export";
+            return;
+        }
+        std::vector<unsigned char> header(magic[7] == 1 ? Crypto::SALT_SIZE : Crypto::KDF_HEADER_SIZE);
+        if (!in_.read(reinterpret_cast<char*>(header.data()), static_cast<std::streamsize>(header.size()))) {
+            error_ = "truncated export";
+            return;
+        }
+        Crypto::KdfParams params;
+        std::vector<unsigned char> salt;
+        if (!Crypto::decode_kdf_header(header.data(), header.size(), params, salt)) {
+            error_ = "unsupported key derivation parameters";
+            return;
+        }
+        try {
+            key_ = Crypto::derive_key(passphrase, salt, params).first;
+        } catch (const std::exception& e) {
+            error_ = e.what();
+        }
+    }
+
+protected:
+    bool fill(std::string& buffer) override {
+        if (!error_.empty()) {
+            return false;
+        }
+        if (final_seen_) {
+            if (in_.peek() != std::char_traits<char>::eof()) {
+                error_ = "data after the final frame";
+            }
+            return false;
+        }
+
+        unsigned char length_bytes[4];
+        if (!in_.read(reinterpret_cast<char*>(length_bytes), sizeof(length_bytes))) {
+            error_ = "truncated export";
+            return false;
+        }
+        uint32_t length = static_cast<uint32_t>(length_bytes[0]) | static_cast<uint32_t>(length_bytes[1]) << 8 |
+                          static_cast<uint32_t>(length_bytes[2]) << 16 | static_cast<uint32_t>(length_bytes[3]) << 24;
+        size_t overhead = Crypto::SEALED_OVERHEAD + kFrameHeaderSize;
+        if (length < overhead || length > EncryptedCredentialWriter::FRAME_SIZE + overhead) {
+            error_ = "corrupt export";
+            return false;
+        }
+
+        // Every frame is read into, and decrypted in place in, one buffer
+        frame_.resize(length);
+        if (!in_.read(reinterpret_cast<char*>(frame_.data()), length)) {
+            error_ = "truncated export";
+            return false;
+        }
+
+        unsigned char* plaintext = frame_.data() + Crypto::NONCE_SIZE;
+        size_t plaintext_size;
+        try {
+            plaintext_size = Crypto::decrypt(frame_.data(), frame_.size(), key_, plaintext);
+        } catch (const std::exception&) {
+            error_ = frame_index_ == 0 ? "wrong passphrase or corrupt export" : "corrupt export";
+            return false;
+        }
+
+        uint64_t index = 0;
+        for (int i = 7; i >= 0; --i) {
+            index = index << 8 | plaintext[i];
+        }
+        if (index != frame_index_) {
+            error_ = "export frames out of order";
+            sodium_memzero(plaintext, plaintext_size);
+            return false;
+        }
+        ++frame_index_;
+        final_seen_ = plaintext[8] != 0;
+        buffer.assign(reinterpret_cast<const char*>(plaintext) + kFrameHeaderSize, plaintext_size - kFrameHeaderSize);
+        sodium_memzero(plaintext, plaintext_size);
+        return true;
+    }
+
+private:
+    SecureBuffer key_;
+    std::vector<unsigned char> frame_;
+    uint64_t frame_index_;
+    bool final_seen_;
+};
+
+CredentialReader::CredentialReader(std::istream& in, CredentialFormat format)
+    : source_(std::make_unique<Source>(in))
+    , format_(format)
+    , skipped_(0)
+    , started_(false)
+    , url_column_(-1)
+    , username_column_(-1)
+    , password_column_(-1)
+    , created_column_(-1)
+    , last_used_column_(-1)
+    , in_items_(false)
+    , first_item_(false)
+    , after_member_(false)
+{
+}
+
+CredentialReader::CredentialReader(std::istream& in, const std::string& passphrase)
+    : CredentialReader(in, CredentialFormat::FirefoxCsv)
+{
+    source_ = std::make_unique<DecryptingSource>(in, passphrase);
+    if (!source_->error().empty()) {
+        error_ = source_->error();
+    }
+}
+
+CredentialReader::~CredentialReader() = default;
+
+bool CredentialReader::next(Credential& credential) {
+    if (failed()) {
+        return false;
+    }
+    bool found = format_ == CredentialFormat::BitwardenJson ? next_json(credential) : next_csv(credential);
+    if (!found && !failed() && !source_->error().empty()) {
+        error_ = source_->error();
+    }
+    return found;
+}
+
+bool CredentialReader::fail(const std::string& message) {
+    // A read or decryption error explains a parse error better than the parser
+    if (error_.empty()) {
+        error_ = source_->error().empty() ? message : source_->error();
+    }
+    return false;
+}
+
+bool CredentialReader::accept(Credential& credential, std::string_view url, std::string username,
+                              std::string password) {
+    std::string_view host = url_host(url);
+    if (!is_web_url(url) || host.empty() || password.empty()) {
+        ++skipped_;
+        return false;
+    }
+
+    credential.domain = lowercase(host);
+    credential.username = std::move(username);
+    // Into pool memory; the parser's copy is wiped
+    credential.password = password;
+    sodium_memzero(&password[0], password.size());
+    credential.created = std::chrono::system_clock::now();
+    credential.last_used = credential.created;
+    return true;
+}
+
+// CSV (RFC 4180): quoted fields may hold commas, quotes ("") and newlines
+bool CredentialReader::read_csv_row(std::vector<std::string>& fields) {
+    fields.clear();
+    if (source_->peek() < 0) {
+        return false;
+    }
+
+    std::string field;
+    bool quoted = false;
+    while (true) {
+        int c = source_->get();
+        if (quoted) {
+            if (c < 0) {
+                return fail("unterminated quoted field");
+            }
+            if (c == '"') {
+                if (source_->peek() == '"') {
+                    source_->get();
+                    field += '"';
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += static_cast<char>(c);
+            }
+            continue;
+        }
+
+        if (c == '\r' && source_->peek() == '\n') {
+            continue;
+        }
+        if (c < 0 || c == '\n') {
+            fields.push_back(std::move(field));
+            return true;
+        }
+        if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c == '"') {
+            quoted = true;
+        } else {
+            field += static_cast<char>(c);
+        }
+    }
+}
+
+bool CredentialReader::read_csv_header() {
+    std::vector<std::string> header;
+    if (!read_csv_row(header)) {
+        return failed() ? false : fail("empty file");
+    }
+    if (header[0].compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        header[0].erase(0, 3);  // UTF-8 byte order mark
+    }
+
+    for (size_t i = 0; i < header.size(); ++i) {
+        std::string name = lowercase(header[i]);
+        int column = static_cast<int>(i);
+        if (name == "url") {
+            url_column_ = column;
+        } else if (name == "username") {
+            username_column_ = column;
+        } else if (name == "password") {
+            password_column_ = column;
+        } else if (name == "timecreated" && format_ == CredentialFormat::FirefoxCsv) {
+            created_column_ = column;
+        } else if (name == "timelastused" && format_ == CredentialFormat::FirefoxCsv) {
+            last_used_column_ = column;
+        }
+    }
+
+    if (url_column_ < 0 || username_column_ < 0 || password_column_ < 0) {
+        return fail("missing url, username or password column");
+    }
+    return true;
+}
+
+bool CredentialReader::next_csv(Credential& credential) {
+    if (!started_) {
+        started_ = true;
+        if (!read_csv_header()) {
+            return false;
+        }
+    }
+
+    std::vector<std::string> fields;
+    while (read_csv_row(fields)) {
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;  // Blank line
+        }
+        auto field = [&](int column) -> std::string {
+            return column >= 0 && static_cast<size_t>(column) < fields.size()
+                ? std::move(fields[static_cast<size_t>(column)]) : std::string();
+        };
+
+        std::string created = field(created_column_);
+        std::string last_used = field(last_used_column_);
+        std::string url = field(url_column_);
+        if (accept(credential, url, field(username_column_), field(password_column_))) {
+            credential.created = from_millis(created, credential.created);
+            credential.last_used = from_millis(last_used, credential.created);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CredentialReader::skip_whitespace() {
+    int c = source_->peek();
+    while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        source_->get();
+        c = source_->peek();
+    }
+}
+
+bool CredentialReader::expect(char c) {
+    skip_whitespace();
+    if (source_->get() != static_cast<unsigned char>(c)) {
+        return fail(std::string("expected '") + c + "'");
+    }
+    return true;
+}
+
+bool CredentialReader::read_json_string(std::string& out) {
+    out.clear();
+    if (!expect('"')) {
+        return false;
+    }
+
+    auto read_hex4 = [this](uint32_t& value) {
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            int c = source_->get();
+            int digit = (c >= '0' && c <= '9') ? c - '0'
+                      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                      : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0) {
+                return fail("bad \\u escape");
+            }
+            value = value << 4 | static_cast<uint32_t>(digit);
+        }
+        return true;
+    };
+
+    while (true) {
+        int c = source_->get();
+        if (c < 0) {
+            return fail("unterminated string");
+        }
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            out += static_cast<char>(c);
+            continue;
+        }
+
+        c = source_->get();
+        switch (c) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code_point;
+                if (!read_hex4(code_point)) {
+                    return false;
+                }
+                // A high surrogate pairs with a following \uDC00-\uDFFF
+                if (code_point >= 0xD800 && code_point < 0xDC00 && source_->peek() == '\\') {
+                    source_->get();
+                    uint32_t low;
+                    if (source_->get() != 'u' || !read_hex4(low)) {
+                        return fail("bad surrogate pair");
+                    }
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        append_utf8(out, 0xFFFD);
+                        code_point = low;
+                    }
+                }
+                if (code_point >= 0xD800 && code_point < 0xE000) {
+                    code_point = 0xFFFD;  // Unpaired surrogate
+                }
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                return fail("bad escape");
+        }
+    }
+}
+
+// Numbers, true, false and null, as their text
+bool CredentialReader::read_json_scalar(std::string& out) {
+    out.clear();
+    skip_whitespace();
+    int c = source_->peek();
+    while (c >= 0 && c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        out += static_cast<char>(source_->get());
+        c = source_->peek();
+    }
+    return out.empty() ? fail("expected a value") : true;
+}
+
+bool CredentialReader::read_json_string_or_null(std::string& out) {
+    skip_whitespace();
+    if (source_->peek() == '"') {
+        return read_json_string(out);
+    }
+    if (!read_json_scalar(out)) {
+        return false;
+    }
+    if (out != "null") {
+        return fail("expected a string");
+    }
+    out.clear();
+    return true;
+}
+
+bool CredentialReader::read_json_object(const std::function<bool(const std::string& key)>& on_member) {
+    if (!expect('{')) {
+        return false;
+    }
+    skip_whitespace();
+    if (source_->peek() == '}') {
+        source_->get();
+        return true;
+    }
+
+    std::string key;
+    while (true) {
+        if (!read_json_string(key) || !expect(':') || !on_member(key)) {
+            return false;
+        }
+        skip_whitespace();
+        int c = source_->get();
+        if (c == '}') {
+            return true;
+        }
+        if (c != ',') {
+            return fail("expected ',' or '}'");
+        }
+    }
+}
+
+bool CredentialReader::read_json_array(const std::function<bool()>& on_element) {
+    if (!expect('[')) {
+        return false;
+    }
+    skip_whitespace();
+    if (source_->peek() == ']') {
+        source_->get();
+        return true;
+    }
+
+    while (true) {
+        if (!on_element()) {
+            return false;
+        }
+        skip_whitespace();
+        int c = source_->get();
+        if (c == ']') {
+            return true;
+        }
+        if (c != ',') {
+            return fail("expected ',' or ']'");
+        }
+    }
+}
+
+bool CredentialReader::skip_json_value(int depth) {
+    if (static_cast<size_t>(depth) > kMaxJsonDepth) {
+        return fail("nesting too deep");
+    }
+    skip_whitespace();
+    std::string ignored;
+    switch (source_->peek()) {
+        case '"':
+            return read_json_string(ignored);
+        case '{':
+            return read_json_object([&](const std::string&) { return skip_json_value(depth + 1); });
+        case '[':
+            return read_json_array([&] { return skip_json_value(depth + 1); });
+        default:
+            return read_json_scalar(ignored);
+    }
+}
+
+bool CredentialReader::read_json_item(bool& is_login, std::string& url, std::string& username,
+                                      std::string& password) {
+    is_login = false;
+    url.clear();
+    username.clear();
+    password.clear();
+
+    // First web URI wins; otherwise the first URI at all
+    auto read_uri = [&](const std::string& key) {
+        if (key != "uri") {
+            return skip_json_value();
+        }
+        std::string uri;
+        if (!read_json_string_or_null(uri)) {
+            return false;
+        }
+        if (!uri.empty() && (url.empty() || (!is_web_url(url) && is_web_url(uri)))) {
+            url = std::move(uri);
+        }
+        return true;
+    };
+    auto read_login_member = [&](const std::string& key) {
+        if (key == "username") {
+            return read_json_string_or_null(username);
+        }
+        if (key == "password") {
+            return read_json_string_or_null(password);
+        }
+        if (key == "uris") {
+            skip_whitespace();
+            if (source_->peek() != '[') {
+                return skip_json_value();  // null
+            }
+            return read_json_array([&] {
+                skip_whitespace();
+                return source_->peek() == '{' ? read_json_object(read_uri) : skip_json_value();
+            });
+        }
+        return skip_json_value();
+    };
+
+    return read_json_object([&](const std::string& key) {
+        if (key == "type") {
+            std::string type;
+            if (!read_json_scalar(type)) {
+                return false;
+            }
+            is_login = type == "1";
+            return true;
+        }
+        if (key == "login") {
+            skip_whitespace();
+            return source_->peek() == '{' ? read_json_object(read_login_member) : skip_json_value();
+        }
+        return skip_json_value();
+    });
+}
+
+// Bitwarden: walks the top-level object and yields logins from "items" one
+// item at a time, skipping folders, collections and everything else
+bool CredentialReader::next_json(Credential& credential) {
+    if (!started_) {
+        started_ = true;
+        if (!expect('{')) {
+            return false;
+        }
+        skip_whitespace();
+        if (source_->peek() == '}') {
+            return false;
+        }
+    }
+
+    std::string key;
+    std::string url;
+    std::string username;
+    std::string password;
+    while (true) {
+        if (in_items_) {
+            skip_whitespace();
+            if (source_->peek() == ']') {
+                source_->get();
+                in_items_ = false;
+                continue;
+            }
+            if (!first_item_ && !expect(',')) {
+                return false;
+            }
+            first_item_ = false;
+
+            bool is_login;
+            if (!read_json_item(is_login, url, username, password)) {
+                return false;
+            }
+            if (!is_login) {
+                ++skipped_;
+            } else if (accept(credential, url, std::move(username), std::move(password))) {
+                return true;
+            }
+            continue;
+        }
+
+        skip_whitespace();
+        if (after_member_) {
+            int c = source_->get();
+            if (c == '}') {
+                return false;
+            }
+            if (c != ',') {
+                return fail(c < 0 ? "unexpected end of input" : "expected ',' or '}'");
+            }
+        }
+        if (!read_json_string(key) || !expect(':')) {
+            return false;
+        }
+        after_member_ = true;
+
+        if (key == "items") {
+            if (!expect('[')) {
+                return false;
+            }
+            in_items_ = true;
+            first_item_ = true;
+        } else if (key == "encrypted") {
+            std::string encrypted;
+            if (!read_json_scalar(encrypted)) {
+                return false;
+            }
+            if (encrypted == "true") {
+                return fail("encrypted Bitwarden exports are not supported");
+            }
+        } else if (!skip_json_value()) {
+            return false;
+        }
+    }
+}
+
+EncryptedCredentialWriter::EncryptedCredentialWriter(std::ostream& out)
+    : out_(out)
+    , frame_index_(0)
+    , written_(0)
+{
+}
+
+bool EncryptedCredentialWriter::begin(const std::string& passphrase) {
+    Crypto::KdfParams params;
+    std::vector<unsigned char> header;
+    try {
+        auto [key, salt] = Crypto::derive_key(passphrase, {}, params);
+        key_ = std::move(key);
+        header = Crypto::encode_kdf_header(params, salt);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    out_.write(kExportMagic, sizeof(kExportMagic));
+    out_.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    pending_ = "\"url\",\"username\",\"password\",\"timeCreated\",\"timeLastUsed\"\n";
+    return out_.good();
+}
+
+bool EncryptedCredentialWriter::write(const Credential& credential) {
+    if (key_.empty()) {
+        return false;
+    }
+
+    // IPv6 literals need their brackets back to parse as a URL
+    bool ipv6 = credential.domain.find(':') != std::string::npos;
+    append_csv_field(pending_, (ipv6 ? "https://[" + credential.domain + "]" : "https://" + credential.domain));
+    pending_ += ',';
+    append_csv_field(pending_, credential.username);
+    pending_ += ',';
+    append_csv_field(pending_, credential.password);
+    pending_ += ',';
+    pending_ += std::to_string(to_millis(credential.created));
+    pending_ += ',';
+    pending_ += std::to_string(to_millis(credential.last_used));
+    pending_ += '\n';
+    ++written_;
+
+    while (pending_.size() >= FRAME_SIZE) {
+        if (!flush_frame(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EncryptedCredentialWriter::finish() {
+    if (key_.empty()) {
+        return false;
+    }
+    bool ok = flush_frame(true);
+    out_.flush();
+    SecureBuffer().swap(key_);  // The pool zeroes the key as it takes it back
+    return ok && out_.good();
+}
+
+bool EncryptedCredentialWriter::flush_frame(bool final) {
+    // The frame is assembled after the nonce slot of one reused buffer and
+    // encrypted in place, which also leaves no plaintext behind in it
+    size_t size = std::min(pending_.size(), FRAME_SIZE);
+    frame_.resize(Crypto::sealed_size(kFrameHeaderSize + size));
+    unsigned char* plaintext = frame_.data() + Crypto::NONCE_SIZE;
+    for (size_t i = 0; i < 8; ++i) {
+        plaintext[i] = static_cast<unsigned char>(frame_index_ >> (8 * i));
+    }
+    plaintext[8] = final ? 1 : 0;
+    std::memcpy(plaintext + kFrameHeaderSize, pending_.data(), size);
+
+    // The consumed CSV holds passwords: wipe it
+    try {
+        Crypto::encrypt(plaintext, kFrameHeaderSize + size, key_, frame_.data());
+    } catch (const std::exception&) {
+        sodium_memzero(frame_.data(), frame_.size());
+        return false;
+    }
+    sodium_memzero(&pending_[0], size);
+    pending_.erase(0, size);
+    ++frame_index_;
+
+    const std::vector<unsigned char>& ciphertext = frame_;
+    uint32_t length = static_cast<uint32_t>(ciphertext.size());
+    unsigned char length_bytes[4] = {
+        static_cast<unsigned char>(length), static_cast<unsigned char>(length >> 8),
+        static_cast<unsigned char>(length >> 16), static_cast<unsigned char>(length >> 24),
+    };
+    out_.write(reinterpret_cast<const char*>(length_bytes), sizeof(length_bytes));
+    out_.write(reinterpret_cast<const char*>(ciphertext.data()), static_cast<std::streamsize>(ciphertext.size()));
+    return out_.good();
+}
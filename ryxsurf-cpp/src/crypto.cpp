@@ -1,6 +1,26 @@
 #include "crypto.h"
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kKdfMagic[4] = {'R', 'K', 'D', 'F'};
+constexpr unsigned char kKdfVersion = 1;
+
+void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t get_u32(const unsigned char* in) {
+    return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+           static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+}  // namespace
 
 void Crypto::init() {
     if (sodium_init() < 0) {
@@ -8,8 +28,13 @@ void Crypto::init() {
     }
 }
 
-std::pair<std::vector<unsigned char>, std::vector<unsigned char>>
-Crypto::derive_key(const std::string& password, const std::vector<unsigned char>& salt) {
+std::pair<SecureBuffer, std::vector<unsigned char>>
+Crypto::derive_key(std::string_view password, const std::vector<unsigned char>& salt) {
+    return derive_key(password, salt, KdfParams());
+}
+
+std::pair<SecureBuffer, std::vector<unsigned char>>
+Crypto::derive_key(std::string_view password, const std::vector<unsigned char>& salt, const KdfParams& params) {
     std::vector<unsigned char> actual_salt = salt;
     if (actual_salt.empty()) {
         actual_salt = random_bytes(SALT_SIZE);
@@ -19,77 +44,172 @@ Crypto::derive_key(const std::string& password, const std::vector<unsigned char>
         throw std::invalid_argument("Salt must be 16 bytes");
     }
     
-    std::vector<unsigned char> key(KEY_SIZE);
+    if (params.algorithm != crypto_pwhash_argon2id_ALG_ARGON2ID13) {
+        throw std::invalid_argument("Unsupported key derivation algorithm");
+    }
+    
+    SecureBuffer key(KEY_SIZE);
     
     if (crypto_pwhash_argon2id(
             key.data(), key.size(),
-            password.c_str(), password.length(),
+            password.data(), password.size(),
             actual_salt.data(),
-            OPS_LIMIT,
-            MEM_LIMIT,
-            crypto_pwhash_argon2id_ALG_ARGON2ID13) != 0) {
+            params.ops_limit,
+            params.mem_limit,
+            params.algorithm) != 0) {
         throw std::runtime_error("Argon2id key derivation failed");
     }
     
-    return {key, actual_salt};
+    return {std::move(key), actual_salt};
+}
+
+Crypto::KdfParams Crypto::calibrate_kdf(std::chrono::milliseconds budget, size_t max_mem_limit) {
+    if (max_mem_limit == 0) {
+        long pages = sysconf(_SC_PHYS_PAGES);
+        long page_size = sysconf(_SC_PAGESIZE);
+        max_mem_limit = pages > 0 && page_size > 0
+            ? static_cast<size_t>(pages) * static_cast<size_t>(page_size) / 4
+            : MEM_LIMIT;
+    }
+    max_mem_limit = std::clamp(max_mem_limit, MIN_MEM_LIMIT, MAX_MEM_LIMIT);
+    const double target = std::max<double>(1, static_cast<double>(budget.count())) / 1000.0;
+    const std::vector<unsigned char> salt = random_bytes(SALT_SIZE);
+    
+    auto seconds_for = [&](const KdfParams& params) {
+        auto start = std::chrono::steady_clock::now();
+        SecureBuffer key = derive_key("calibration", salt, params).first;
+        sodium_memzero(key.data(), key.size());
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::max(elapsed, 1e-6);
+    };
+    
+    // Argon2 time is close to linear in passes * memory: one measured pass
+    // gives the cost per byte
+    KdfParams params;
+    params.ops_limit = 1;
+    params.mem_limit = std::min(MEM_LIMIT, max_mem_limit);
+    double per_byte = seconds_for(params) / static_cast<double>(params.mem_limit);
+    
+    // Memory is what makes GPU attacks expensive: spend the budget on it
+    // first, keeping at least OPS_LIMIT passes within reach
+    const size_t mib = 1024 * 1024;
+    double affordable = target / (per_byte * static_cast<double>(OPS_LIMIT));
+    size_t mem = std::clamp(static_cast<size_t>(std::min(affordable, static_cast<double>(MAX_MEM_LIMIT))),
+                            MIN_MEM_LIMIT, max_mem_limit);
+    params.mem_limit = mem / mib * mib;
+    params.ops_limit = std::clamp<unsigned long long>(
+        static_cast<unsigned long long>(target / (per_byte * static_cast<double>(params.mem_limit))),
+        1, MAX_OPS_LIMIT);
+    
+    // Check the extrapolation once; large allocations cost more than linear
+    double measured = seconds_for(params);
+    if (measured > target * 1.25 && params.ops_limit > 1) {
+        params.ops_limit = std::max<unsigned long long>(
+            1, static_cast<unsigned long long>(static_cast<double>(params.ops_limit) * target / measured));
+    }
+    return params;
+}
+
+std::vector<unsigned char> Crypto::encode_kdf_header(const KdfParams& params, const std::vector<unsigned char>& salt) {
+    if (salt.size() != SALT_SIZE) {
+        throw std::invalid_argument("Salt must be 16 bytes");
+    }
+    std::vector<unsigned char> header(KDF_HEADER_SIZE, 0);
+    std::memcpy(header.data(), kKdfMagic, sizeof(kKdfMagic));
+    header[4] = kKdfVersion;
+    header[5] = static_cast<unsigned char>(params.algorithm);
+    put_u32(&header[8], static_cast<uint32_t>(params.ops_limit));
+    put_u32(&header[12], static_cast<uint32_t>(params.mem_limit / 1024));
+    std::copy(salt.begin(), salt.end(), header.begin() + 16);
+    return header;
+}
+
+bool Crypto::decode_kdf_header(const unsigned char* data, size_t size, KdfParams& params,
+                               std::vector<unsigned char>& salt) {
+    if (size == SALT_SIZE) {
+        params = KdfParams();
+        salt.assign(data, data + SALT_SIZE);
+        return true;
+    }
+    if (size != KDF_HEADER_SIZE || std::memcmp(data, kKdfMagic, sizeof(kKdfMagic)) != 0 || data[4] != kKdfVersion) {
+        return false;
+    }
+    
+    KdfParams decoded;
+    decoded.algorithm = data[5];
+    decoded.ops_limit = get_u32(&data[8]);
+    decoded.mem_limit = static_cast<size_t>(get_u32(&data[12])) * 1024;
+    if (decoded.algorithm != crypto_pwhash_argon2id_ALG_ARGON2ID13 ||
+        decoded.ops_limit < crypto_pwhash_argon2id_OPSLIMIT_MIN ||
+        decoded.mem_limit < crypto_pwhash_argon2id_MEMLIMIT_MIN ||
+        decoded.mem_limit > MAX_MEM_LIMIT) {
+        return false;
+    }
+    params = decoded;
+    salt.assign(data + 16, data + KDF_HEADER_SIZE);
+    return true;
+}
+
+std::vector<unsigned char>
+Crypto::encrypt(const std::vector<unsigned char>& plaintext, const SecureBuffer& key) {
+    std::vector<unsigned char> sealed(sealed_size(plaintext.size()));
+    encrypt(plaintext.data(), plaintext.size(), key, sealed.data());
+    return sealed;
 }
 
 std::vector<unsigned char>
-Crypto::encrypt(const std::vector<unsigned char>& plaintext, const std::vector<unsigned char>& key) {
+Crypto::decrypt(const std::vector<unsigned char>& ciphertext, const SecureBuffer& key) {
+    if (ciphertext.size() < SEALED_OVERHEAD) {
+        throw std::invalid_argument("Ciphertext too short");
+    }
+    std::vector<unsigned char> plaintext(ciphertext.size() - SEALED_OVERHEAD);
+    decrypt(ciphertext.data(), ciphertext.size(), key, plaintext.data());
+    return plaintext;
+}
+
+size_t Crypto::encrypt(const unsigned char* plaintext, size_t size, const SecureBuffer& key,
+                       unsigned char* out) {
     if (key.size() != KEY_SIZE) {
         throw std::invalid_argument("Key must be 32 bytes");
     }
     
-    std::vector<unsigned char> nonce = random_bytes(NONCE_SIZE);
-    std::vector<unsigned char> ciphertext(plaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    // Nonce first; the ciphertext (which libsodium may write over the
+    // plaintext) and tag follow it
+    randombytes_buf(out, NONCE_SIZE);
     unsigned long long ciphertext_len;
-    
     crypto_aead_xchacha20poly1305_ietf_encrypt(
-        ciphertext.data(), &ciphertext_len,
-        plaintext.data(), plaintext.size(),
+        out + NONCE_SIZE, &ciphertext_len,
+        plaintext, size,
         nullptr, 0,  // No additional data
         nullptr,     // No nsec
-        nonce.data(),
+        out,
         key.data());
     
-    // Prepend nonce to ciphertext
-    std::vector<unsigned char> result;
-    result.reserve(nonce.size() + ciphertext_len);
-    result.insert(result.end(), nonce.begin(), nonce.end());
-    result.insert(result.end(), ciphertext.begin(), ciphertext.begin() + ciphertext_len);
-    
-    return result;
+    return NONCE_SIZE + static_cast<size_t>(ciphertext_len);
 }
 
-std::vector<unsigned char>
-Crypto::decrypt(const std::vector<unsigned char>& ciphertext, const std::vector<unsigned char>& key) {
+size_t Crypto::decrypt(const unsigned char* sealed, size_t size, const SecureBuffer& key,
+                       unsigned char* out) {
     if (key.size() != KEY_SIZE) {
         throw std::invalid_argument("Key must be 32 bytes");
     }
     
-    if (ciphertext.size() < NONCE_SIZE + crypto_aead_xchacha20poly1305_ietf_ABYTES) {
+    if (size < SEALED_OVERHEAD) {
         throw std::invalid_argument("Ciphertext too short");
     }
     
-    // Extract nonce
-    std::vector<unsigned char> nonce(ciphertext.begin(), ciphertext.begin() + NONCE_SIZE);
-    std::vector<unsigned char> encrypted(ciphertext.begin() + NONCE_SIZE, ciphertext.end());
-    
-    std::vector<unsigned char> plaintext(encrypted.size() - crypto_aead_xchacha20poly1305_ietf_ABYTES);
     unsigned long long plaintext_len;
-    
     if (crypto_aead_xchacha20poly1305_ietf_decrypt(
-            plaintext.data(), &plaintext_len,
+            out, &plaintext_len,
             nullptr,  // No nsec
-            encrypted.data(), encrypted.size(),
+            sealed + NONCE_SIZE, size - NONCE_SIZE,
             nullptr, 0,  // No additional data
-            nonce.data(),
+            sealed,
             key.data()) != 0) {
         throw std::runtime_error("Decryption failed");
     }
     
-    plaintext.resize(plaintext_len);
-    return plaintext;
+    return static_cast<size_t>(plaintext_len);
 }
 
 std::vector<unsigned char> Crypto::random_bytes(size_t size) {
@@ -97,3 +217,9 @@ std::vector<unsigned char> Crypto::random_bytes(size_t size) {
     randombytes_buf(bytes.data(), size);
     return bytes;
 }
+
+SecureBuffer Crypto::random_key() {
+    SecureBuffer key(KEY_SIZE);
+    randombytes_buf(key.data(), key.size());
+    return key;
+}
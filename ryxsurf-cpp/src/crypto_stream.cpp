@@ -0,0 +1,273 @@
+#include "crypto_stream.h"
+#include "crypto.h"
+#include <cerrno>
+#include <cstring>
+#include <sodium.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'X', 'S', 'S'};
+
+static_assert(CryptoStream::HEADER_SIZE ==
+              CryptoStream::PREFIX_SIZE + crypto_secretstream_xchacha20poly1305_HEADERBYTES, "header size");
+static_assert(CryptoStream::CHUNK_OVERHEAD == crypto_secretstream_xchacha20poly1305_ABYTES, "chunk overhead");
+
+bool fail(std::string* error, const char* message) {
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+// Reads until `size` bytes or the end: the count, or -1 on error
+ssize_t read_full(const CryptoStream::Reader& in, unsigned char* buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = in(buffer + total, size - total);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(total);
+}
+
+void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t get_u32(const unsigned char* in) {
+    return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+           static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+bool encrypt_chunks(const CryptoStream::Reader& in, const CryptoStream::Writer& out,
+                    crypto_secretstream_xchacha20poly1305_state& state, const unsigned char* prefix,
+                    SecureBuffer& plain, std::vector<unsigned char>& sealed, std::string* error) {
+    for (;;) {
+        ssize_t n = read_full(in, plain.data(), plain.size());
+        if (n < 0) {
+            return fail(error, "read failed");
+        }
+        // A short read is the end; a full last chunk is followed by an empty final one
+        bool final = static_cast<size_t>(n) < plain.size();
+        unsigned long long sealed_size = 0;
+        crypto_secretstream_xchacha20poly1305_push(
+            &state, sealed.data(), &sealed_size, plain.data(), static_cast<unsigned long long>(n),
+            prefix, CryptoStream::PREFIX_SIZE,
+            final ? crypto_secretstream_xchacha20poly1305_TAG_FINAL : crypto_secretstream_xchacha20poly1305_TAG_MESSAGE);
+        if (!out(sealed.data(), static_cast<size_t>(sealed_size))) {
+            return fail(error, "write failed");
+        }
+        if (final) {
+            return true;
+        }
+    }
+}
+
+bool decrypt_chunks(const CryptoStream::Reader& in, const CryptoStream::Writer& out,
+                    crypto_secretstream_xchacha20poly1305_state& state, const unsigned char* prefix,
+                    std::vector<unsigned char>& sealed, SecureBuffer& plain, std::string* error) {
+    for (bool first = true;; first = false) {
+        ssize_t n = read_full(in, sealed.data(), sealed.size());
+        if (n < 0) {
+            return fail(error, "read failed");
+        }
+        if (static_cast<size_t>(n) < CryptoStream::CHUNK_OVERHEAD) {
+            return fail(error, "truncated stream");
+        }
+        unsigned long long plain_size = 0;
+        unsigned char tag = 0;
+        if (crypto_secretstream_xchacha20poly1305_pull(&state, plain.data(), &plain_size, &tag, sealed.data(),
+                                                       static_cast<unsigned long long>(n), prefix,
+                                                       CryptoStream::PREFIX_SIZE) != 0) {
+            return fail(error, first ? "wrong key or corrupt stream" : "corrupt stream");
+        }
+        if (!out(plain.data(), static_cast<size_t>(plain_size))) {
+            return fail(error, "write failed");
+        }
+        if (tag == crypto_secretstream_xchacha20poly1305_TAG_FINAL) {
+            unsigned char extra;
+            ssize_t more = read_full(in, &extra, 1);
+            if (more != 0) {
+                return fail(error, more < 0 ? "read failed" : "data after the end of the stream");
+            }
+            return true;
+        }
+        if (static_cast<size_t>(n) < sealed.size()) {
+            return fail(error, "truncated stream");
+        }
+    }
+}
+
+// Runs `operation` with an adapter's error: its I/O message replaces the generic one
+template <typename Operation>
+bool with_io_error(std::string* error, const std::string& io_error, Operation operation) {
+    if (operation()) {
+        return true;
+    }
+    if (error && !io_error.empty()) {
+        *error = io_error;
+    }
+    return false;
+}
+
+CryptoStream::Reader fd_reader(int fd, std::string& io_error) {
+    return [fd, &io_error](unsigned char* buffer, size_t size) -> ssize_t {
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer, size);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            io_error = std::string("read failed: ") + std::strerror(errno);
+        }
+        return n;
+    };
+}
+
+CryptoStream::Writer fd_writer(int fd, std::string& io_error) {
+    return [fd, &io_error](const unsigned char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                io_error = std::string("write failed: ") + std::strerror(errno);
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+}
+
+CryptoStream::Reader gio_reader(GInputStream* in, GCancellable* cancellable, std::string& io_error) {
+    return [in, cancellable, &io_error](unsigned char* buffer, size_t size) -> ssize_t {
+        GError* gerror = nullptr;
+        gssize n = g_input_stream_read(in, buffer, size, cancellable, &gerror);
+        if (n < 0) {
+            io_error = std::string("read failed: ") + (gerror ? gerror->message : "unknown error");
+            g_clear_error(&gerror);
+        }
+        return n;
+    };
+}
+
+CryptoStream::Writer gio_writer(GOutputStream* out, GCancellable* cancellable, std::string& io_error) {
+    return [out, cancellable, &io_error](const unsigned char* data, size_t size) {
+        GError* gerror = nullptr;
+        if (!g_output_stream_write_all(out, data, size, nullptr, cancellable, &gerror)) {
+            io_error = std::string("write failed: ") + (gerror ? gerror->message : "unknown error");
+            g_clear_error(&gerror);
+            return false;
+        }
+        return true;
+    };
+}
+
+}  // namespace
+
+bool CryptoStream::encrypt(const Reader& in, const Writer& out, const SecureBuffer& key,
+                           std::string* error, size_t chunk_size) {
+    if (key.size() != Crypto::KEY_SIZE) {
+        return fail(error, "invalid key size");
+    }
+    if (chunk_size == 0 || chunk_size > MAX_CHUNK_SIZE) {
+        return fail(error, "invalid chunk size");
+    }
+
+    unsigned char header[HEADER_SIZE] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    header[4] = VERSION;
+    put_u32(header + 8, static_cast<uint32_t>(chunk_size));
+    crypto_secretstream_xchacha20poly1305_state state;
+    crypto_secretstream_xchacha20poly1305_init_push(&state, header + PREFIX_SIZE, key.data());
+    if (!out(header, HEADER_SIZE)) {
+        sodium_memzero(&state, sizeof(state));
+        return fail(error, "write failed");
+    }
+
+    // The only buffers, reused for every chunk
+    SecureBuffer plain(chunk_size);
+    std::vector<unsigned char> sealed(chunk_size + CHUNK_OVERHEAD);
+    bool ok = encrypt_chunks(in, out, state, header, plain, sealed, error);
+    sodium_memzero(&state, sizeof(state));
+    return ok;
+}
+
+bool CryptoStream::decrypt(const Reader& in, const Writer& out, const SecureBuffer& key,
+                           std::string* error) {
+    if (key.size() != Crypto::KEY_SIZE) {
+        return fail(error, "invalid key size");
+    }
+
+    unsigned char header[HEADER_SIZE];
+    ssize_t n = read_full(in, header, HEADER_SIZE);
+    if (n < 0) {
+        return fail(error, "read failed");
+    }
+    if (static_cast<size_t>(n) < HEADER_SIZE || std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+        return fail(error, "not an encrypted stream");
+    }
+    if (header[4] > VERSION) {
+        return fail(error, "encrypted stream is from a newer version");
+    }
+    size_t chunk_size = get_u32(header + 8);
+    if (chunk_size == 0 || chunk_size > MAX_CHUNK_SIZE) {
+        return fail(error, "corrupt stream header");
+    }
+    crypto_secretstream_xchacha20poly1305_state state;
+    if (crypto_secretstream_xchacha20poly1305_init_pull(&state, header + PREFIX_SIZE, key.data()) != 0) {
+        return fail(error, "corrupt stream header");
+    }
+
+    std::vector<unsigned char> sealed(chunk_size + CHUNK_OVERHEAD);
+    SecureBuffer plain(chunk_size);
+    bool ok = decrypt_chunks(in, out, state, header, sealed, plain, error);
+    sodium_memzero(&state, sizeof(state));
+    return ok;
+}
+
+bool CryptoStream::encrypt_fd(int in_fd, int out_fd, const SecureBuffer& key, std::string* error) {
+    std::string io_error;
+    return with_io_error(error, io_error, [&] {
+        return encrypt(fd_reader(in_fd, io_error), fd_writer(out_fd, io_error), key, error);
+    });
+}
+
+bool CryptoStream::decrypt_fd(int in_fd, int out_fd, const SecureBuffer& key, std::string* error) {
+    std::string io_error;
+    return with_io_error(error, io_error, [&] {
+        return decrypt(fd_reader(in_fd, io_error), fd_writer(out_fd, io_error), key, error);
+    });
+}
+
+bool CryptoStream::encrypt_gio(GInputStream* in, GOutputStream* out, const SecureBuffer& key,
+                               GCancellable* cancellable, std::string* error) {
+    std::string io_error;
+    return with_io_error(error, io_error, [&] {
+        return encrypt(gio_reader(in, cancellable, io_error), gio_writer(out, cancellable, io_error), key, error);
+    });
+}
+
+bool CryptoStream::decrypt_gio(GInputStream* in, GOutputStream* out, const SecureBuffer& key,
+                               GCancellable* cancellable, std::string* error) {
+    std::string io_error;
+    return with_io_error(error, io_error, [&] {
+        return decrypt(gio_reader(in, cancellable, io_error), gio_writer(out, cancellable, io_error), key, error);
+    });
+}
+
+uint64_t CryptoStream::sealed_size(uint64_t plaintext_size, size_t chunk_size) {
+    // Every full chunk, then the final (short or empty) one
+    uint64_t chunks = plaintext_size / chunk_size + 1;
+    return HEADER_SIZE + plaintext_size + chunks * CHUNK_OVERHEAD;
+}
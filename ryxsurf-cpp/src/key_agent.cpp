@@ -0,0 +1,360 @@
+#include "key_agent.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Key file: KDF header, then the master key sealed with the password's key
+constexpr size_t kSealedKeySize = Crypto::NONCE_SIZE + Crypto::KEY_SIZE + crypto_aead_xchacha20poly1305_ietf_ABYTES;
+constexpr size_t kKeyFileSize = Crypto::KDF_HEADER_SIZE + kSealedKeySize;
+// Before KDF headers: salt, then a check subkey of the Argon2id output,
+// which was the master key itself
+constexpr size_t kCheckSize = 32;
+constexpr size_t kLegacyKeyFileSize = Crypto::SALT_SIZE + kCheckSize;
+
+void wipe(SecureBuffer& bytes) {
+    if (!bytes.empty()) {
+        sodium_memzero(bytes.data(), bytes.size());
+    }
+    bytes.clear();
+}
+
+}  // namespace
+
+KeyAgent::KeyAgent(std::string key_file_path)
+    : key_file_path_(std::move(key_file_path))
+    , master_key_(nullptr)
+    , last_used_(std::chrono::steady_clock::now())
+    , idle_timeout_(0)
+    , idle_timer_id_(0)
+    , next_listener_id_(1)
+{
+}
+
+KeyAgent::~KeyAgent() {
+    if (idle_timer_id_ != 0) {
+        g_source_remove(idle_timer_id_);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    wipe_locked();
+}
+
+bool KeyAgent::unlock(std::string_view master_password) {
+    if (master_password.empty()) {
+        return false;
+    }
+    std::optional<Crypto::KdfParams> wanted;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (master_key_) {
+            last_used_ = std::chrono::steady_clock::now();
+            return true;
+        }
+        wanted = wanted_params_;
+    }
+
+    std::vector<unsigned char> contents;
+    bool existing = false;
+    {
+        std::ifstream in(key_file_path_, std::ios::binary);
+        if (in.is_open()) {
+            contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            existing = true;
+        }
+    }
+
+    SecureBuffer key;
+    Crypto::KdfParams params;
+    bool reseal = true;
+    try {
+        Crypto::init();
+        std::vector<unsigned char> salt;
+        if (!existing) {
+            params = wanted ? *wanted : Crypto::calibrate_kdf(DEFAULT_UNLOCK_BUDGET);
+            key = Crypto::random_key();
+        } else if (contents.size() == kKeyFileSize) {
+            if (!unseal_key_file(master_password, contents, params, key)) {
+                return false;  // Wrong password or corrupt header
+            }
+            reseal = wanted && *wanted != params;
+            if (reseal) {
+                params = *wanted;
+            }
+        } else if (contents.size() == kLegacyKeyFileSize) {
+            salt.assign(contents.begin(), contents.begin() + Crypto::SALT_SIZE);
+            key = Crypto::derive_key(master_password, salt).first;
+            unsigned char check[kCheckSize];
+            crypto_kdf_derive_from_key(check, sizeof(check), CHECK_SUBKEY_ID, KDF_CONTEXT, key.data());
+            bool match = sodium_memcmp(check, contents.data() + Crypto::SALT_SIZE, kCheckSize) == 0;
+            sodium_memzero(check, sizeof(check));
+            if (!match) {
+                wipe(key);
+                return false;
+            }
+            // Keep the master key (subkeys stay the same), seal it in a header
+            params = wanted ? *wanted : Crypto::KdfParams();
+        } else {
+            return false;  // Truncated or from a newer build: refuse rather than replace it
+        }
+    } catch (const std::exception&) {
+        wipe(key);
+        return false;
+    }
+
+    if (reseal && !write_key_file(master_password, params, key)) {
+        wipe(key);
+        return false;
+    }
+
+    auto* master_key = static_cast<unsigned char*>(sodium_malloc(Crypto::KEY_SIZE));
+    if (!master_key) {
+        wipe(key);
+        return false;
+    }
+    std::copy(key.begin(), key.end(), master_key);
+    wipe(key);
+    sodium_mprotect_noaccess(master_key);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (master_key_) {
+        sodium_free(master_key);  // Another thread unlocked meanwhile
+    } else {
+        master_key_ = master_key;
+        file_params_ = params;
+    }
+    last_used_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool KeyAgent::change_password(std::string_view old_password, std::string_view new_password) {
+    if (old_password.empty() || new_password.empty()) {
+        return false;
+    }
+    std::optional<Crypto::KdfParams> wanted;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        wanted = wanted_params_;
+    }
+
+    // Always unseal from the file: it checks the old password whether or not
+    // we are unlocked. Older key files are converted by unlock() first.
+    std::vector<unsigned char> contents;
+    {
+        std::ifstream in(key_file_path_, std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    SecureBuffer key;
+    Crypto::KdfParams params;
+    try {
+        Crypto::init();
+        if (contents.size() != kKeyFileSize || !unseal_key_file(old_password, contents, params, key)) {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (wanted) {
+        params = *wanted;
+    }
+
+    bool ok = write_key_file(new_password, params, key);
+    wipe(key);
+    if (ok) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        file_params_ = params;
+    }
+    return ok;
+}
+
+bool KeyAgent::unseal_key_file(std::string_view master_password, const std::vector<unsigned char>& contents,
+                               Crypto::KdfParams& params, SecureBuffer& master_key) {
+    std::vector<unsigned char> salt;
+    if (!Crypto::decode_kdf_header(contents.data(), Crypto::KDF_HEADER_SIZE, params, salt)) {
+        return false;
+    }
+    SecureBuffer password_key = Crypto::derive_key(master_password, salt, params).first;
+    master_key.resize(Crypto::KEY_SIZE);
+    try {
+        Crypto::decrypt(contents.data() + Crypto::KDF_HEADER_SIZE, kSealedKeySize, password_key, master_key.data());
+    } catch (const std::exception&) {
+        wipe(password_key);
+        wipe(master_key);
+        return false;
+    }
+    wipe(password_key);
+    return true;
+}
+
+bool KeyAgent::write_key_file(std::string_view master_password, const Crypto::KdfParams& params,
+                              const SecureBuffer& master_key) {
+    std::vector<unsigned char> contents;
+    try {
+        auto [password_key, salt] = Crypto::derive_key(master_password, {}, params);
+        contents = Crypto::encode_kdf_header(params, salt);
+        contents.resize(Crypto::KDF_HEADER_SIZE + kSealedKeySize);
+        Crypto::encrypt(master_key.data(), master_key.size(), password_key, contents.data() + Crypto::KDF_HEADER_SIZE);
+        wipe(password_key);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    // Write aside and rename, so a crash never leaves half a key file
+    std::filesystem::path path(key_file_path_);
+    std::filesystem::path temp_path = key_file_path_ + ".tmp";
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        std::filesystem::permissions(temp_path,
+                                     std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, ec);
+        out.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+        out.flush();
+        if (!out.good()) {
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp_path, path, ec);
+    return !ec;
+}
+
+void KeyAgent::lock() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!master_key_) {
+            return;
+        }
+        wipe_locked();
+    }
+    notify_lock_listeners();
+}
+
+bool KeyAgent::is_unlocked() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return master_key_ != nullptr;
+}
+
+bool KeyAgent::get_key(Purpose purpose, SecureBuffer& key) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!master_key_) {
+        return false;
+    }
+    if (!key.empty()) {
+        sodium_memzero(key.data(), key.size());
+    }
+    key.resize(Crypto::KEY_SIZE);
+    derive_locked(static_cast<uint64_t>(purpose), key.data(), key.size());
+    last_used_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void KeyAgent::touch() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    last_used_ = std::chrono::steady_clock::now();
+}
+
+size_t KeyAgent::add_lock_listener(LockListener listener) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    size_t id = next_listener_id_++;
+    listeners_.emplace(id, std::move(listener));
+    return id;
+}
+
+void KeyAgent::remove_lock_listener(size_t id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    listeners_.erase(id);
+}
+
+void KeyAgent::set_idle_timeout(std::chrono::seconds timeout) {
+    if (idle_timer_id_ != 0) {
+        g_source_remove(idle_timer_id_);
+        idle_timer_id_ = 0;
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        idle_timeout_ = timeout;
+        last_used_ = std::chrono::steady_clock::now();
+    }
+    if (timeout.count() > 0) {
+        // Checking a few times per timeout keeps the overshoot small
+        guint interval = static_cast<guint>(std::max<int64_t>(1, timeout.count() / 4));
+        idle_timer_id_ = g_timeout_add_seconds(interval, idle_timer_callback, this);
+    }
+}
+
+bool KeyAgent::lock_if_idle(std::chrono::steady_clock::time_point now) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!master_key_ || idle_timeout_.count() == 0 || now - last_used_ < idle_timeout_) {
+            return false;
+        }
+        wipe_locked();
+    }
+    notify_lock_listeners();
+    return true;
+}
+
+void KeyAgent::set_kdf_params(const Crypto::KdfParams& params) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    wanted_params_ = params;
+}
+
+Crypto::KdfParams KeyAgent::get_kdf_params() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return file_params_;
+}
+
+KeyAgent& KeyAgent::shared() {
+    static KeyAgent agent([] {
+        std::filesystem::path base_dir;
+        if (const char* xdg_data = std::getenv("XDG_DATA_HOME")) {
+            base_dir = std::filesystem::path(xdg_data) / "ryxsurf";
+        } else if (const char* home = std::getenv("HOME")) {
+            base_dir = std::filesystem::path(home) / ".local" / "share" / "ryxsurf";
+        } else {
+            base_dir = std::filesystem::path("/tmp") / "ryxsurf";
+        }
+        return (base_dir / "master.kdf").string();
+    }());
+    return agent;
+}
+
+void KeyAgent::derive_locked(uint64_t subkey_id, unsigned char* out, size_t size) const {
+    sodium_mprotect_readonly(master_key_);
+    crypto_kdf_derive_from_key(out, size, subkey_id, KDF_CONTEXT, master_key_);
+    sodium_mprotect_noaccess(master_key_);
+}
+
+void KeyAgent::wipe_locked() {
+    if (master_key_) {
+        sodium_free(master_key_);  // Zeroes the key before unmapping it
+        master_key_ = nullptr;
+    }
+}
+
+void KeyAgent::notify_lock_listeners() {
+    std::vector<LockListener> listeners;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto& entry : listeners_) {
+            listeners.push_back(entry.second);
+        }
+    }
+    for (const LockListener& listener : listeners) {
+        listener();
+    }
+}
+
+gboolean KeyAgent::idle_timer_callback(gpointer user_data) {
+    static_cast<KeyAgent*>(user_data)->lock_if_idle();
+    return G_SOURCE_CONTINUE;
+}
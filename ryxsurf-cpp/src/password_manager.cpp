@@ -1,13 +1,20 @@
 #include "password_manager.h"
+#include "breach_corpus.h"
+#include "credential_transfer.h"
+#include "key_agent.h"
+#include "parallel.h"
+#include "rekey.h"
+#include "public_suffix.h"
 #include <libsecret/secret.h>
 #include <sqlite3.h>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <iterator>
 #include <random>
 #include <algorithm>
 #include <stdexcept>
 #include <cstdlib>
+#include <cstring>
 #include <system_error>
 
 // libsecret schema
@@ -24,29 +31,171 @@ static const SecretSchema* get_schema() {
     return &schema;
 }
 
+// Host names compare case-insensitively; stored and indexed in lowercase
+static char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static std::string lowercase_host(std::string_view host) {
+    std::string result(host);
+    std::transform(result.begin(), result.end(), result.begin(), ascii_lower);
+    return result;
+}
+
+static bool same_host_name(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return ascii_lower(x) == ascii_lower(y);
+    });
+}
+
+// SQL for each PasswordManager::Statement, in enum order
+static const char* const kStatementSql[] = {
+    "SELECT username, password_encrypted, created, last_used FROM credentials WHERE domain = ?;",
+    "SELECT password_encrypted FROM credentials WHERE domain = ? AND username = ?;",
+    "INSERT OR REPLACE INTO credentials (domain, username, password_encrypted, created, last_used) VALUES (?, ?, ?, ?, ?);",
+    "INSERT OR REPLACE INTO credentials (domain, username, password_encrypted, created, last_used) VALUES (?, ?, X'', ?, ?);",
+    "DELETE FROM credentials WHERE domain = ? AND username = ?;",
+    "UPDATE credentials SET last_used = ? WHERE domain = ? AND username = ?;",
+};
+
+// Zero key material before releasing it
+static void wipe(SecureBuffer& bytes) {
+    if (!bytes.empty()) {
+        sodium_memzero(bytes.data(), bytes.size());
+    }
+    bytes.clear();
+}
+
+// Record i is bytes[offsets[i], offsets[i + 1]). Cleared between batches
+// but never shrunk, so after the first batch no record allocates.
+struct PasswordManager::SealedBatch {
+    std::vector<unsigned char> bytes;
+    std::vector<size_t> offsets{0};
+    
+    size_t count() const { return offsets.size() - 1; }
+    const unsigned char* data(size_t i) const { return bytes.data() + offsets[i]; }
+    unsigned char* data(size_t i) { return bytes.data() + offsets[i]; }
+    size_t size(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    
+    // Room for a record of `size` bytes; pointers are valid once all are added
+    void add(size_t size) {
+        offsets.push_back(offsets.back() + size);
+        bytes.resize(offsets.back());
+    }
+    void add(const unsigned char* data, size_t size) {
+        add(size);
+        if (size > 0) {
+            std::memcpy(bytes.data() + offsets[offsets.size() - 2], data, size);
+        }
+    }
+    void clear() {
+        bytes.clear();
+        offsets.resize(1);
+    }
+};
+
+struct PasswordManager::KeyringOp {
+    PasswordManager* self;
+    GCancellable* cancellable;  // Own reference; outlives a closed manager
+    std::string domain;
+    std::string username;
+    SecureString password;
+    CredentialMeta meta;
+    DoneCallback done;
+    CredentialsCallback credentials_done;
+    CredentialCallback credential_done;
+
+    explicit KeyringOp(PasswordManager* manager)
+        : self(manager)
+        , cancellable(G_CANCELLABLE(g_object_ref(manager->cancellable_)))
+    {}
+    ~KeyringOp() { g_object_unref(cancellable); }
+
+    // True once the manager has been closed or destroyed: do not touch `self`
+    bool cancelled() const { return g_cancellable_is_cancelled(cancellable); }
+};
+
+struct PasswordManager::KeyringBatch {
+    // One per call, handed to it as user_data
+    struct Slot {
+        KeyringBatch* batch;
+        size_t index;
+    };
+    
+    GMainContext* context;
+    std::vector<Slot> slots;
+    std::vector<char> succeeded;
+    size_t pending;
+
+    // The calls complete on a private context, as libsecret's _sync calls
+    // do, so waiting does not dispatch the application's other sources
+    explicit KeyringBatch(size_t count)
+        : context(g_main_context_new())
+        , succeeded(count, 0)
+        , pending(count)
+    {
+        slots.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            slots.push_back(Slot{this, i});
+        }
+        g_main_context_push_thread_default(context);
+    }
+    ~KeyringBatch() {
+        g_main_context_pop_thread_default(context);
+        g_main_context_unref(context);
+    }
+
+    void wait() {
+        while (pending > 0) {
+            g_main_context_iteration(context, TRUE);
+        }
+    }
+    static void finish(gpointer user_data, bool ok) {
+        Slot* slot = static_cast<Slot*>(user_data);
+        slot->batch->succeeded[slot->index] = ok;
+        --slot->batch->pending;
+    }
+};
+
 PasswordManager::PasswordManager()
-    : use_libsecret_(false)
+    : keyring_state_(KeyringState::Unknown)
     , db_(nullptr)
+    , statements_{}
+    , statement_cache_enabled_(true)
+    , wal_enabled_(true)
+    , statements_prepared_(0)
+    , encrypted_(false)
+    , key_agent_(nullptr)
+    , key_listener_id_(0)
+    , legacy_pending_(false)
     , autofill_enabled_(true)
+    , breach_corpus_(nullptr)
     , schema_(const_cast<SecretSchema*>(get_schema()))
+    , cancellable_(g_cancellable_new())
 {
-    // Check if libsecret is available; fall back silently on error
-    GError* error = nullptr;
-    SecretService* service = secret_service_get_sync(SECRET_SERVICE_NONE, nullptr, &error);
-    if (error) {
-        g_error_free(error);
-        service = nullptr;
-    }
-    use_libsecret_ = service != nullptr;
-    if (service) {
-        g_object_unref(service);
-    }
-
+    // The Secret Service is probed on first use, not here: connecting is a
+    // blocking D-Bus round trip
     db_path_ = get_db_path();
 }
 
 PasswordManager::~PasswordManager() {
+    set_key_agent(nullptr);
     close();
+    g_object_unref(cancellable_);
+    wipe(encryption_key_);
+    wipe(legacy_key_);
+}
+
+void PasswordManager::set_key_agent(KeyAgent* agent) {
+    if (key_agent_) {
+        key_agent_->remove_lock_listener(key_listener_id_);
+    }
+    key_agent_ = agent;
+    if (key_agent_) {
+        // Our copy of the subkey goes when the agent locks; ensure_key()
+        // fetches it again after the next unlock
+        key_listener_id_ = key_agent_->add_lock_listener([this] { wipe(encryption_key_); });
+    }
 }
 
 std::string PasswordManager::get_db_path() const {
@@ -89,7 +238,7 @@ bool PasswordManager::initialize(const std::string& master_password) {
                               std::getenv("RYXSURF_DISABLE_LIBSECRET") ||
                               std::getenv("CI");
     if (force_sqlite) {
-        use_libsecret_ = false;
+        keyring_state_ = KeyringState::Unavailable;
     }
 
     // In test mode, start from a clean DB to avoid cross-test contamination
@@ -97,9 +246,13 @@ bool PasswordManager::initialize(const std::string& master_password) {
         std::error_code ec;
         std::filesystem::remove(db_path_, ec);
         std::filesystem::remove(db_path_ + ".salt", ec);
+        std::filesystem::remove(db_path_ + "-wal", ec);
+        std::filesystem::remove(db_path_ + "-shm", ec);
     }
 
-    if (!use_libsecret_ && !master_password_.empty()) {
+    // An agent another store has unlocked needs no password of its own
+    const bool agent_unlocked = key_agent_ && key_agent_->is_unlocked();
+    if (!use_libsecret() && (!master_password_.empty() || agent_unlocked)) {
         if (!setup_encryption()) {
             return false;
         }
@@ -113,6 +266,9 @@ bool PasswordManager::initialize(const std::string& master_password) {
 }
 
 bool PasswordManager::setup_encryption() {
+    if (key_agent_) {
+        return setup_agent_encryption();
+    }
     if (master_password_.empty()) {
         return false;
     }
@@ -120,28 +276,105 @@ bool PasswordManager::setup_encryption() {
     std::string salt_file = db_path_ + ".salt";
     std::ifstream salt_in(salt_file, std::ios::binary);
     
+    Crypto::KdfParams params;
+    
     if (salt_in.is_open()) {
-        salt_.resize(Crypto::SALT_SIZE);
-        salt_in.read(reinterpret_cast<char*>(salt_.data()), Crypto::SALT_SIZE);
-        salt_in.close();
+        // A KDF header, or a bare salt from before headers
+        std::vector<unsigned char> header((std::istreambuf_iterator<char>(salt_in)), std::istreambuf_iterator<char>());
+        if (!Crypto::decode_kdf_header(header.data(), header.size(), params, salt_)) {
+            return false;
+        }
     } else {
         salt_ = Crypto::random_bytes(Crypto::SALT_SIZE);
+        std::vector<unsigned char> header = Crypto::encode_kdf_header(params, salt_);
         std::ofstream salt_out(salt_file, std::ios::binary);
         if (salt_out.is_open()) {
-            salt_out.write(reinterpret_cast<const char*>(salt_.data()), Crypto::SALT_SIZE);
+            salt_out.write(reinterpret_cast<const char*>(header.data()), header.size());
             salt_out.close();
         }
     }
     
     try {
-        auto [key, _] = Crypto::derive_key(master_password_, salt_);
-        encryption_key_ = key;
+        auto [key, _] = Crypto::derive_key(master_password_, salt_, params);
+        encryption_key_ = std::move(key);
+        kdf_params_ = params;
+        encrypted_ = true;
         return true;
     } catch (const std::exception&) {
         return false;
     }
 }
 
+bool PasswordManager::setup_agent_encryption() {
+    // A no-op when the session store has already unlocked the agent
+    if (!master_password_.empty() && !key_agent_->unlock(master_password_)) {
+        return false;
+    }
+    if (!key_agent_->get_key(KeyAgent::Purpose::Passwords, encryption_key_)) {
+        return false;
+    }
+    encrypted_ = true;
+    
+    // A store from before the agent is still under the key of its own salt:
+    // derive that once more, and re-encrypt once the database is open.
+    // Opened through an agent another store unlocked, there is no password
+    // to derive it from: keep the salt and act as locked until one is set.
+    std::string salt_file = db_path_ + ".salt";
+    std::error_code ec;
+    if (legacy_key_.empty() && std::filesystem::exists(salt_file, ec)) {
+        legacy_pending_ = true;
+    }
+    if (legacy_pending_ && !master_password_.empty()) {
+        std::ifstream salt_in(salt_file, std::ios::binary);
+        std::vector<unsigned char> header((std::istreambuf_iterator<char>(salt_in)), std::istreambuf_iterator<char>());
+        Crypto::KdfParams params;
+        std::vector<unsigned char> salt;
+        if (!Crypto::decode_kdf_header(header.data(), header.size(), params, salt)) {
+            return false;
+        }
+        try {
+            legacy_key_ = Crypto::derive_key(master_password_, salt, params).first;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    
+    master_password_.clear();
+    // Hex rows left pending by the open need the legacy key too
+    return !db_ || (create_schema() && migrate_legacy_key());
+}
+
+bool PasswordManager::migrate_legacy_key() {
+    if (legacy_key_.empty()) {
+        return true;
+    }
+    
+    // Nothing is written unless every row decrypts (a wrong master
+    // password leaves the store untouched)
+    bool ok = Rekey::run(db_, "credentials", "id", "password_encrypted", legacy_key_, encryption_key_);
+    if (ok) {
+        std::error_code ec;
+        std::filesystem::remove(db_path_ + ".salt", ec);
+        legacy_pending_ = false;
+    }
+    wipe(legacy_key_);  // Derived again from the next password on failure
+    return ok;
+}
+
+bool PasswordManager::ensure_key() {
+    if (!encrypted_ || !key_agent_) {
+        return true;
+    }
+    if (legacy_pending_) {
+        return false;  // Rows are still under the pre-agent key
+    }
+    if (encryption_key_.empty() && !key_agent_->get_key(KeyAgent::Purpose::Passwords, encryption_key_)) {
+        return false;
+    }
+    key_agent_->touch();
+    return true;
+}
+
 bool PasswordManager::init_database() {
     if (db_) {
         return true;
@@ -152,7 +385,149 @@ bool PasswordManager::init_database() {
         return false;
     }
     
-    return create_schema();
+    if (wal_enabled_) {
+        sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+    }
+    
+    return create_schema() && migrate_legacy_key() && load_index() && prepare_statements();
+}
+
+bool PasswordManager::prepare_statements() {
+    static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) ==
+                  static_cast<size_t>(Statement::Count),
+                  "kStatementSql must cover every Statement");
+    
+    for (size_t i = 0; i < statements_.size(); ++i) {
+        if (statements_[i]) {
+            continue;
+        }
+        if (sqlite3_prepare_v3(db_, kStatementSql[i], -1, SQLITE_PREPARE_PERSISTENT,
+                               &statements_[i], nullptr) != SQLITE_OK) {
+            finalize_statements();
+            return false;
+        }
+        ++statements_prepared_;
+    }
+    return true;
+}
+
+void PasswordManager::finalize_statements() {
+    for (sqlite3_stmt*& stmt : statements_) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+sqlite3_stmt* PasswordManager::acquire(Statement id) {
+    if (!statement_cache_enabled_) {
+        // Uncached path (benchmarks): compile the statement for every use
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, kStatementSql[static_cast<size_t>(id)], -1, &stmt, nullptr) != SQLITE_OK) {
+            return nullptr;
+        }
+        ++statements_prepared_;
+        return stmt;
+    }
+    sqlite3_stmt* stmt = statements_[static_cast<size_t>(id)];
+    // A decrypt that threw mid-scan skipped release(); start over
+    if (stmt && sqlite3_stmt_busy(stmt)) {
+        sqlite3_reset(stmt);
+    }
+    return stmt;
+}
+
+void PasswordManager::release(sqlite3_stmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+    if (!statement_cache_enabled_) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    // Leave the cached statement ready for its next use; a reset statement
+    // also holds no read transaction open against WAL checkpoints
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+bool PasswordManager::load_index() {
+    index_.clear();
+    
+    // Most recently used first; several stored domains may share a site
+    const char* sql = "SELECT domain, username, created, last_used FROM credentials "
+                      "ORDER BY last_used DESC, id DESC;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* domain = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        
+        CredentialMeta meta;
+        meta.domain = domain ? domain : "";
+        meta.username = username ? username : "";
+        meta.created = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 2));
+        meta.last_used = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 3));
+        // Rows saved before domains were lowercased keep their stored
+        // spelling, which fetches need, but share the lowercase key
+        std::string site = site_of(meta.domain);
+        index_[std::move(site)].push_back(std::move(meta));
+    }
+    
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+void PasswordManager::index_touch(const std::string& domain, const std::string& username, bool inserted) {
+    std::string site = site_of(domain);
+    auto it = index_.find(site);
+    if (it == index_.end()) {
+        if (!inserted) {
+            return;
+        }
+        it = index_.emplace(std::move(site), std::vector<CredentialMeta>()).first;
+    }
+    
+    auto now = std::chrono::system_clock::from_time_t(
+        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    std::vector<CredentialMeta>& entries = it->second;
+    auto entry = std::find_if(entries.begin(), entries.end(), [&](const CredentialMeta& m) {
+        return m.domain == domain && m.username == username;
+    });
+    if (entry == entries.end()) {
+        if (!inserted) {
+            return;
+        }
+        entries.push_back(CredentialMeta{domain, username, now, now});
+        entry = entries.end() - 1;
+    } else if (inserted) {
+        entry->created = now;  // INSERT OR REPLACE starts a new row
+    }
+    entry->last_used = now;
+    
+    // Keep the most recently used credential at the front
+    std::rotate(entries.begin(), entry, entry + 1);
+}
+
+void PasswordManager::index_remove(const std::string& domain, const std::string& username) {
+    auto it = index_.find(site_of(domain));
+    if (it == index_.end()) {
+        return;
+    }
+    
+    std::vector<CredentialMeta>& entries = it->second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const CredentialMeta& m) {
+                      return m.domain == domain && m.username == username;
+                  }),
+                  entries.end());
+    if (entries.empty()) {
+        index_.erase(it);
+    }
 }
 
 bool PasswordManager::create_schema() {
@@ -184,69 +559,326 @@ bool PasswordManager::create_schema() {
         return false;
     }
     
+    int version = get_schema_version();
+    if (version < 0 || version > SCHEMA_VERSION) {
+        return false;  // Unreadable, or written by a newer build
+    }
+    if (version < 1 && !migrate_hex_ciphertext()) {
+        return false;
+    }
+    
     return true;
 }
 
-std::string PasswordManager::encrypt_password(const std::string& password) {
-    if (encryption_key_.empty()) {
-        return password;  // No encryption
+int PasswordManager::get_schema_version() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+    int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Version 0 -> 1: hex TEXT ciphertext becomes a BLOB of the same bytes.
+// Only rows whose decoded bytes open with the store's key are ciphertext;
+// a plaintext password that happens to be long hex, and libsecret metadata
+// rows (''), are left alone. Without a key (no master password yet) the
+// step stays pending, as it does when no candidate opens at all: that is a
+// wrong master password rather than a store without ciphertext.
+bool PasswordManager::migrate_hex_ciphertext() {
+    // Before the agent re-keys a legacy store, its rows are under legacy_key_
+    const SecureBuffer& key = legacy_key_.empty() ? encryption_key_ : legacy_key_;
+    if (!encrypted_ || key.empty() || (legacy_pending_ && legacy_key_.empty())) {
+        return true;
+    }
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    
+    const size_t min_hex = 2 * Crypto::SEALED_OVERHEAD;
+    std::vector<std::pair<sqlite3_int64, std::vector<unsigned char>>> rows;
+    SecureBuffer scratch;  // Opened passwords, wiped when released
+    size_t candidates = 0;
+    
+    sqlite3_stmt* select;
+    bool ok = sqlite3_prepare_v2(db_,
+        "SELECT id, password_encrypted FROM credentials WHERE typeof(password_encrypted) = 'text';",
+        -1, &select, nullptr) == SQLITE_OK;
+    while (ok && sqlite3_step(select) == SQLITE_ROW) {
+        const char* hex = reinterpret_cast<const char*>(sqlite3_column_text(select, 1));
+        size_t length = static_cast<size_t>(sqlite3_column_bytes(select, 1));
+        if (!hex || length < min_hex || length % 2 != 0) {
+            continue;
+        }
+        
+        std::vector<unsigned char> bytes(length / 2);
+        bool is_hex = true;
+        for (size_t i = 0; i < bytes.size() && is_hex; ++i) {
+            int hi = hex_value(hex[2 * i]);
+            int lo = hex_value(hex[2 * i + 1]);
+            is_hex = hi >= 0 && lo >= 0;
+            bytes[i] = static_cast<unsigned char>((hi << 4) | lo);
+        }
+        if (!is_hex) {
+            continue;
+        }
+        ++candidates;
+        scratch.resize(bytes.size() - Crypto::SEALED_OVERHEAD);
+        try {
+            Crypto::decrypt(bytes.data(), bytes.size(), key, scratch.data());
+            rows.emplace_back(sqlite3_column_int64(select, 0), std::move(bytes));
+        } catch (const std::exception&) {
+            // Not sealed with this key: plaintext that looks like hex
+        }
+    }
+    if (ok) {
+        sqlite3_finalize(select);
     }
     
-    std::vector<unsigned char> plaintext(password.begin(), password.end());
-    std::vector<unsigned char> encrypted = Crypto::encrypt(plaintext, encryption_key_);
+    if (ok && candidates > 0 && rows.empty()) {
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return true;  // Wrong key; retried with the next one
+    }
     
-    // Convert to base64-like string for storage
-    std::string result;
-    result.reserve(encrypted.size() * 2);
-    for (unsigned char byte : encrypted) {
-        char hex[3];
-        snprintf(hex, sizeof(hex), "%02x", byte);
-        result += hex;
+    sqlite3_stmt* update;
+    ok = ok && sqlite3_prepare_v2(db_, "UPDATE credentials SET password_encrypted = ? WHERE id = ?;",
+                                  -1, &update, nullptr) == SQLITE_OK;
+    if (ok) {
+        for (const auto& row : rows) {
+            sqlite3_bind_blob(update, 1, row.second.data(), static_cast<int>(row.second.size()), SQLITE_STATIC);
+            sqlite3_bind_int64(update, 2, row.first);
+            ok = sqlite3_step(update) == SQLITE_DONE;
+            sqlite3_reset(update);
+            if (!ok) {
+                break;
+            }
+        }
+        sqlite3_finalize(update);
     }
-    return result;
+    
+    ok = ok &&
+         sqlite3_exec(db_, "PRAGMA user_version = 1;", nullptr, nullptr, nullptr) == SQLITE_OK &&
+         sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+    return ok;
+}
+
+std::vector<unsigned char> PasswordManager::encrypt_password(std::string_view password) {
+    std::vector<unsigned char> sealed(sealed_password_size(password.size()));
+    encrypt_password(password, sealed.data());
+    return sealed;
+}
+
+size_t PasswordManager::sealed_password_size(size_t password_size) const {
+    return encrypted_ ? Crypto::sealed_size(password_size) : password_size;
+}
+
+void PasswordManager::encrypt_password(std::string_view password, unsigned char* out) {
+    const auto* plaintext = reinterpret_cast<const unsigned char*>(password.data());
+    if (!encrypted_) {
+        std::copy(plaintext, plaintext + password.size(), out);  // No encryption
+        return;
+    }
+    Crypto::encrypt(plaintext, password.size(), encryption_key_, out);
+}
+
+SecureString PasswordManager::decrypt_password(const unsigned char* data, size_t size) {
+    if (!encrypted_) {
+        // No encryption
+        return SecureString(std::string_view(reinterpret_cast<const char*>(data), size));
+    }
+    
+    // Straight into the result's pool block
+    if (size < Crypto::SEALED_OVERHEAD) {
+        throw std::invalid_argument("Ciphertext too short");
+    }
+    SecureString password;
+    password.resize(size - Crypto::SEALED_OVERHEAD);
+    password.resize(Crypto::decrypt(data, size, encryption_key_, reinterpret_cast<unsigned char*>(password.data())));
+    return password;
+}
+
+void PasswordManager::ensure_keyring() {
+    if (keyring_state_ == KeyringState::Available || keyring_state_ == KeyringState::Unavailable) {
+        return;
+    }
+    
+    // Blocking probe for the synchronous API; a pending async probe still
+    // completes and releases its waiters
+    GError* error = nullptr;
+    SecretService* service = secret_service_get_sync(SECRET_SERVICE_NONE, nullptr, &error);
+    if (error) {
+        g_error_free(error);
+        service = nullptr;
+    }
+    keyring_state_ = service ? KeyringState::Available : KeyringState::Unavailable;
+    if (service) {
+        g_object_unref(service);
+    }
+}
+
+void PasswordManager::probe_keyring_async(DoneCallback done) {
+    when_keyring_ready([this, done]() {
+        if (done) {
+            done(use_libsecret());
+        }
+    });
 }
 
-std::string PasswordManager::decrypt_password(const std::string& encrypted) {
-    if (encryption_key_.empty()) {
-        return encrypted;  // No encryption
+void PasswordManager::when_keyring_ready(std::function<void()> operation) {
+    if (keyring_state_ == KeyringState::Available || keyring_state_ == KeyringState::Unavailable) {
+        operation();
+        return;
+    }
+    
+    keyring_waiters_.push_back(std::move(operation));
+    if (keyring_state_ == KeyringState::Probing) {
+        return;
+    }
+    
+    keyring_state_ = KeyringState::Probing;
+    secret_service_get(SECRET_SERVICE_NONE, cancellable_, &PasswordManager::on_keyring_probed,
+                       new KeyringOp(this));
+}
+
+void PasswordManager::on_keyring_probed(GObject*, GAsyncResult* result, gpointer user_data) {
+    std::unique_ptr<KeyringOp> op(static_cast<KeyringOp*>(user_data));
+    GError* error = nullptr;
+    SecretService* service = secret_service_get_finish(result, &error);
+    if (error) {
+        g_error_free(error);
+        service = nullptr;
+    }
+    if (service) {
+        g_object_unref(service);
     }
     
-    // Convert from hex string
-    std::vector<unsigned char> encrypted_bytes;
-    for (size_t i = 0; i < encrypted.length(); i += 2) {
-        unsigned int byte;
-        sscanf(encrypted.substr(i, 2).c_str(), "%02x", &byte);
-        encrypted_bytes.push_back(static_cast<unsigned char>(byte));
+    if (!op->cancelled()) {
+        op->self->finish_keyring_probe(service != nullptr);
+    }
+}
+
+void PasswordManager::finish_keyring_probe(bool available) {
+    // initialize() or a synchronous call may have settled the state already
+    if (keyring_state_ == KeyringState::Probing) {
+        keyring_state_ = available ? KeyringState::Available : KeyringState::Unavailable;
     }
     
-    std::vector<unsigned char> plaintext = Crypto::decrypt(encrypted_bytes, encryption_key_);
-    return std::string(plaintext.begin(), plaintext.end());
+    // Waiters may queue new operations; those run immediately now
+    std::vector<std::function<void()>> waiters;
+    waiters.swap(keyring_waiters_);
+    for (auto& waiter : waiters) {
+        waiter();
+    }
+}
+
+bool PasswordManager::fall_back_to_sqlite() {
+    // Disable libsecret for subsequent operations
+    keyring_state_ = KeyringState::Unavailable;
+    if (!encrypted_ && !master_password_.empty()) {
+        if (!setup_encryption()) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool PasswordManager::save(const std::string& domain, const std::string& username, const std::string& password) {
+bool PasswordManager::save(const std::string& domain, const std::string& username, const SecureString& password) {
+    const std::string host = lowercase_host(domain);
+    
     // Prefer libsecret but gracefully fall back to SQLite if it fails
-    if (use_libsecret_) {
-        if (save_to_libsecret(domain, username, password)) {
+    ensure_keyring();
+    if (use_libsecret()) {
+        if (save_to_libsecret(host, username, password)) {
+            store_keyring_metadata(host, username);
             return true;
         }
-
-        // Disable libsecret for subsequent operations and fall back
-        use_libsecret_ = false;
-        if (encryption_key_.empty() && !master_password_.empty()) {
-            if (!setup_encryption()) {
-                return false;
-            }
+        if (!fall_back_to_sqlite()) {
+            return false;
         }
     }
 
-    if (!db_ && !init_database()) {
+    return save_locally(host, username, password);
+}
+
+bool PasswordManager::save_locally(const std::string& domain, const std::string& username, std::string_view password) {
+    if ((!db_ && !init_database()) || !ensure_key()) {
+        return false;
+    }
+
+    if (!save_to_sqlite(domain, username, password)) {
         return false;
     }
+    index_touch(domain, username, true);
+    return true;
+}
+
+void PasswordManager::save_async(const std::string& domain, const std::string& username, const SecureString& password,
+                                 DoneCallback done) {
+    when_keyring_ready([this, domain = lowercase_host(domain), username, password, done]() {
+        if (!use_libsecret()) {
+            bool ok = save(domain, username, password);
+            if (done) {
+                done(ok);
+            }
+            return;
+        }
+        
+        auto* op = new KeyringOp(this);
+        op->domain = domain;
+        op->username = username;
+        op->password = password;
+        op->done = done;
+        secret_password_store(
+            schema_,
+            SECRET_COLLECTION_DEFAULT,
+            "RyxSurf Password",
+            password.c_str(),
+            cancellable_,
+            &PasswordManager::on_password_stored,
+            op,
+            "domain", domain.c_str(),
+            "username", username.c_str(),
+            nullptr);
+    });
+}
 
-    return save_to_sqlite(domain, username, password);
+void PasswordManager::on_password_stored(GObject*, GAsyncResult* result, gpointer user_data) {
+    std::unique_ptr<KeyringOp> op(static_cast<KeyringOp*>(user_data));
+    GError* error = nullptr;
+    gboolean stored = secret_password_store_finish(result, &error);
+    if (error) {
+        g_error_free(error);
+        stored = FALSE;
+    }
+    if (op->cancelled()) {
+        return;
+    }
+    
+    PasswordManager* self = op->self;
+    bool ok;
+    if (stored) {
+        self->store_keyring_metadata(op->domain, op->username);
+        ok = true;
+    } else {
+        ok = self->fall_back_to_sqlite() && self->save_locally(op->domain, op->username, op->password);
+    }
+    if (op->done) {
+        op->done(ok);
+    }
 }
 
-bool PasswordManager::save_to_libsecret(const std::string& domain, const std::string& username, const std::string& password) {
+bool PasswordManager::save_to_libsecret(const std::string& domain, const std::string& username, const SecureString& password) {
     GError* error = nullptr;
     
     secret_password_store_sync(
@@ -265,6 +897,10 @@ bool PasswordManager::save_to_libsecret(const std::string& domain, const std::st
         return false;
     }
     
+    return true;
+}
+
+void PasswordManager::store_keyring_metadata(const std::string& domain, const std::string& username) {
     // Also save metadata to SQLite for fast lookup
     if (!db_) {
         init_database();
@@ -273,58 +909,100 @@ bool PasswordManager::save_to_libsecret(const std::string& domain, const std::st
         auto now = std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch()).count();
         
-        const char* sql = "INSERT OR REPLACE INTO credentials (domain, username, password_encrypted, created, last_used) VALUES (?, ?, '', ?, ?);";
-        sqlite3_stmt* stmt;
-        
-        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = acquire(Statement::UpsertMetadata);
+        if (stmt) {
             sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_STATIC);
             sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
             sqlite3_bind_int64(stmt, 3, now);
             sqlite3_bind_int64(stmt, 4, now);
             sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+            release(stmt);
         }
     }
-    
-    return true;
+    index_touch(domain, username, true);
 }
 
-bool PasswordManager::save_to_sqlite(const std::string& domain, const std::string& username, const std::string& password) {
+bool PasswordManager::save_to_sqlite(const std::string& domain, const std::string& username, std::string_view password) {
     if (!db_) {
         return false;
     }
     
-    std::string encrypted = encrypt_password(password);
+    std::vector<unsigned char> encrypted = encrypt_password(password);
     auto now = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
     
-    const char* sql = "INSERT OR REPLACE INTO credentials (domain, username, password_encrypted, created, last_used) VALUES (?, ?, ?, ?, ?);";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt* stmt = acquire(Statement::Upsert);
+    if (!stmt) {
         return false;
     }
     
     sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, encrypted.c_str(), -1, SQLITE_STATIC);
+    // A zero-length blob still needs a non-null pointer, or SQLite binds NULL
+    static const unsigned char empty = 0;
+    sqlite3_bind_blob(stmt, 3, encrypted.empty() ? &empty : encrypted.data(),
+                      static_cast<int>(encrypted.size()), SQLITE_STATIC);
     sqlite3_bind_int64(stmt, 4, now);
     sqlite3_bind_int64(stmt, 5, now);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    release(stmt);
     
     return rc == SQLITE_DONE;
 }
 
 std::vector<Credential> PasswordManager::get(const std::string& domain) {
-    if (use_libsecret_) {
+    ensure_keyring();
+    if (use_libsecret()) {
         return get_from_libsecret(domain);
     } else {
         return get_from_sqlite(domain);
     }
 }
 
+void PasswordManager::get_async(const std::string& domain, CredentialsCallback done) {
+    when_keyring_ready([this, domain, done]() {
+        if (!use_libsecret()) {
+            done(get_from_sqlite(domain));
+            return;
+        }
+        
+        GHashTable* attrs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        g_hash_table_insert(attrs, g_strdup("domain"), g_strdup(domain.c_str()));
+        
+        auto* op = new KeyringOp(this);
+        op->domain = domain;
+        op->credentials_done = done;
+        // Unlocking may prompt; that is fine off the blocking path
+        secret_service_search(
+            nullptr,
+            schema_,
+            attrs,
+            static_cast<SecretSearchFlags>(SECRET_SEARCH_ALL | SECRET_SEARCH_UNLOCK | SECRET_SEARCH_LOAD_SECRETS),
+            cancellable_,
+            &PasswordManager::on_items_found,
+            op);
+        g_hash_table_unref(attrs);
+    });
+}
+
+void PasswordManager::on_items_found(GObject*, GAsyncResult* result, gpointer user_data) {
+    std::unique_ptr<KeyringOp> op(static_cast<KeyringOp*>(user_data));
+    GError* error = nullptr;
+    GList* items = secret_service_search_finish(nullptr, result, &error);
+    if (error) {
+        g_error_free(error);
+    }
+    if (op->cancelled()) {
+        g_list_free_full(items, g_object_unref);
+        return;
+    }
+    
+    std::vector<Credential> credentials = op->self->credentials_from_items(op->domain, items);
+    g_list_free_full(items, g_object_unref);
+    op->credentials_done(std::move(credentials));
+}
+
 std::vector<Credential> PasswordManager::get_from_libsecret(const std::string& domain) {
     std::vector<Credential> credentials;
     GError* error = nullptr;
@@ -348,6 +1026,15 @@ std::vector<Credential> PasswordManager::get_from_libsecret(const std::string& d
         return credentials;
     }
     
+    credentials = credentials_from_items(domain, items);
+    g_list_free_full(items, g_object_unref);
+    return credentials;
+}
+
+std::vector<Credential> PasswordManager::credentials_from_items(const std::string& domain, GList* items) const {
+    std::vector<Credential> credentials;
+    auto indexed = index_.find(site_of(domain));
+    
     for (GList* item = items; item != nullptr; item = item->next) {
         SecretItem* secret_item = static_cast<SecretItem*>(item->data);
         SecretValue* value = secret_item_get_secret(secret_item);
@@ -365,7 +1052,18 @@ std::vector<Credential> PasswordManager::get_from_libsecret(const std::string& d
                 cred.username = username;
                 cred.password = password;
                 cred.created = std::chrono::system_clock::now();
-                cred.last_used = std::chrono::system_clock::now();
+                cred.last_used = cred.created;
+                
+                // Timestamps live in the SQLite metadata, not the keyring
+                if (indexed != index_.end()) {
+                    for (const CredentialMeta& meta : indexed->second) {
+                        if (meta.domain == domain && meta.username == cred.username) {
+                            cred.created = meta.created;
+                            cred.last_used = meta.last_used;
+                            break;
+                        }
+                    }
+                }
                 credentials.push_back(cred);
             }
             
@@ -373,22 +1071,18 @@ std::vector<Credential> PasswordManager::get_from_libsecret(const std::string& d
         }
     }
     
-    g_list_free_full(items, g_object_unref);
     return credentials;
 }
 
 std::vector<Credential> PasswordManager::get_from_sqlite(const std::string& domain) {
     std::vector<Credential> credentials;
     
-    if (!db_) {
+    if (!db_ || !ensure_key()) {
         return credentials;
     }
     
-    std::stringstream ss;
-    ss << "SELECT username, password_encrypted, created, last_used FROM credentials WHERE domain = ?;";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, ss.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt* stmt = acquire(Statement::SelectDomain);
+    if (!stmt) {
         return credentials;
     }
     
@@ -396,88 +1090,245 @@ std::vector<Credential> PasswordManager::get_from_sqlite(const std::string& doma
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        const char* encrypted = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        // Read in place from SQLite's row buffer
+        const auto* encrypted = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 1));
+        size_t encrypted_size = static_cast<size_t>(sqlite3_column_bytes(stmt, 1));
         sqlite3_int64 created = sqlite3_column_int64(stmt, 2);
         sqlite3_int64 last_used = sqlite3_column_int64(stmt, 3);
         
-        std::string password = decrypt_password(encrypted ? encrypted : "");
-        
         Credential cred;
         cred.domain = domain;
         cred.username = username ? username : "";
-        cred.password = password;
+        cred.password = decrypt_password(encrypted, encrypted_size);
         cred.created = std::chrono::system_clock::from_time_t(created);
         cred.last_used = std::chrono::system_clock::from_time_t(last_used);
-        credentials.push_back(cred);
+        credentials.push_back(std::move(cred));
     }
     
-    sqlite3_finalize(stmt);
+    release(stmt);
     return credentials;
 }
 
 std::optional<Credential> PasswordManager::get_one(const std::string& domain) {
-    auto creds = get(domain);
-    if (creds.empty()) {
+    // The index already knows the site's most recently used credential;
+    // fetch and decrypt only its password
+    const CredentialMeta* meta = find_credential(domain, false);
+    if (!meta) {
+        return std::nullopt;
+    }
+    ensure_keyring();
+    return fetch_credential(*meta);
+}
+
+const PasswordManager::CredentialMeta* PasswordManager::find_credential(std::string_view domain,
+                                                                         bool same_host) const {
+    auto it = index_.find(site_of(domain));
+    if (it == index_.end()) {
+        return nullptr;
+    }
+    if (!same_host) {
+        return &it->second.front();
+    }
+    for (const CredentialMeta& meta : it->second) {
+        if (same_host_name(meta.domain, domain)) {
+            return &meta;
+        }
+    }
+    return nullptr;
+}
+
+std::optional<Credential> PasswordManager::fetch_credential(const CredentialMeta& meta) {
+    std::optional<SecureString> password = use_libsecret()
+        ? get_password_from_libsecret(meta.domain, meta.username)
+        : get_password_from_sqlite(meta.domain, meta.username);
+    if (!password) {
+        return std::nullopt;
+    }
+    
+    Credential cred;
+    cred.domain = meta.domain;
+    cred.username = meta.username;
+    cred.password = std::move(*password);
+    cred.created = meta.created;
+    cred.last_used = meta.last_used;
+    return cred;
+}
+
+std::optional<SecureString> PasswordManager::get_password_from_sqlite(const std::string& domain, const std::string& username) {
+    if (!db_ || !ensure_key()) {
+        return std::nullopt;
+    }
+    
+    sqlite3_stmt* stmt = acquire(Statement::SelectPassword);
+    if (!stmt) {
         return std::nullopt;
     }
     
-    // Return most recently used
-    std::sort(creds.begin(), creds.end(),
-              [](const Credential& a, const Credential& b) {
-                  return a.last_used > b.last_used;
-              });
+    sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
+    
+    std::optional<SecureString> password;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* encrypted = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+        password = decrypt_password(encrypted, static_cast<size_t>(sqlite3_column_bytes(stmt, 0)));
+    }
     
-    return creds[0];
+    release(stmt);
+    return password;
 }
 
-bool PasswordManager::has_credentials(const std::string& domain) {
-    if (use_libsecret_) {
-        // Fast check using SQLite metadata if available
-        if (db_) {
-            std::stringstream ss;
-            ss << "SELECT 1 FROM credentials WHERE domain = ? LIMIT 1;";
-            sqlite3_stmt* stmt;
-            if (sqlite3_prepare_v2(db_, ss.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-                sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_STATIC);
-                bool has = sqlite3_step(stmt) == SQLITE_ROW;
-                sqlite3_finalize(stmt);
-                return has;
-            }
-        }
-        // Fallback: try to get (slower)
-        return !get(domain).empty();
-    } else {
-        if (!db_) {
-            return false;
+std::optional<SecureString> PasswordManager::get_password_from_libsecret(const std::string& domain, const std::string& username) {
+    GError* error = nullptr;
+    
+    gchar* password = secret_password_lookup_sync(
+        schema_,
+        nullptr,
+        &error,
+        "domain", domain.c_str(),
+        "username", username.c_str(),
+        nullptr);
+    
+    if (error) {
+        g_error_free(error);
+        return std::nullopt;
+    }
+    if (!password) {
+        return std::nullopt;
+    }
+    
+    SecureString result(password);
+    secret_password_free(password);
+    return result;
+}
+
+void PasswordManager::get_one_async(const std::string& domain, CredentialCallback done) {
+    get_one_async(domain, false, std::move(done));
+}
+
+void PasswordManager::get_one_async(const std::string& domain, bool same_host, CredentialCallback done) {
+    when_keyring_ready([this, domain, same_host, done]() {
+        const CredentialMeta* meta = find_credential(domain, same_host);
+        if (!meta) {
+            done(std::nullopt);
+            return;
         }
-        
-        std::stringstream ss;
-        ss << "SELECT 1 FROM credentials WHERE domain = ? LIMIT 1;";
-        sqlite3_stmt* stmt;
-        if (sqlite3_prepare_v2(db_, ss.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-            return false;
+        if (!use_libsecret()) {
+            done(fetch_credential(*meta));
+            return;
         }
         
-        sqlite3_bind_text(stmt, 1, domain.c_str(), -1, SQLITE_STATIC);
-        bool has = sqlite3_step(stmt) == SQLITE_ROW;
-        sqlite3_finalize(stmt);
-        return has;
+        auto* op = new KeyringOp(this);
+        op->meta = *meta;
+        op->domain = op->meta.domain;
+        op->credential_done = done;
+        secret_password_lookup(
+            schema_,
+            cancellable_,
+            &PasswordManager::on_password_looked_up,
+            op,
+            "domain", op->domain.c_str(),
+            "username", op->meta.username.c_str(),
+            nullptr);
+    });
+}
+
+void PasswordManager::on_password_looked_up(GObject*, GAsyncResult* result, gpointer user_data) {
+    std::unique_ptr<KeyringOp> op(static_cast<KeyringOp*>(user_data));
+    GError* error = nullptr;
+    gchar* password = secret_password_lookup_finish(result, &error);
+    if (error) {
+        g_error_free(error);
+    }
+    if (op->cancelled()) {
+        secret_password_free(password);
+        return;
+    }
+    if (!password) {
+        op->credential_done(std::nullopt);
+        return;
     }
+    
+    Credential cred;
+    cred.domain = op->domain;
+    cred.username = op->meta.username;
+    cred.password = password;
+    cred.created = op->meta.created;
+    cred.last_used = op->meta.last_used;
+    secret_password_free(password);
+    op->credential_done(std::move(cred));
+}
+
+bool PasswordManager::has_credentials(std::string_view domain) const {
+    return index_.find(site_of(domain)) != index_.end();
 }
 
 bool PasswordManager::delete_credential(const std::string& domain, const std::string& username) {
     bool libsecret_ok = true;
-    bool sqlite_ok = true;
     
-    if (use_libsecret_) {
+    ensure_keyring();
+    if (use_libsecret()) {
         libsecret_ok = delete_from_libsecret(domain, username);
     }
     
-    if (db_) {
-        sqlite_ok = delete_from_sqlite(domain, username);
+    bool sqlite_ok = delete_locally(domain, username);
+    return libsecret_ok && sqlite_ok;
+}
+
+bool PasswordManager::delete_locally(const std::string& domain, const std::string& username) {
+    if (!db_) {
+        return true;
     }
     
-    return libsecret_ok && sqlite_ok;
+    if (!delete_from_sqlite(domain, username)) {
+        return false;
+    }
+    index_remove(domain, username);
+    return true;
+}
+
+void PasswordManager::delete_credential_async(const std::string& domain, const std::string& username,
+                                              DoneCallback done) {
+    when_keyring_ready([this, domain, username, done]() {
+        if (!use_libsecret()) {
+            bool ok = delete_credential(domain, username);
+            if (done) {
+                done(ok);
+            }
+            return;
+        }
+        
+        auto* op = new KeyringOp(this);
+        op->domain = domain;
+        op->username = username;
+        op->done = done;
+        secret_password_clear(
+            schema_,
+            cancellable_,
+            &PasswordManager::on_password_cleared,
+            op,
+            "domain", domain.c_str(),
+            "username", username.c_str(),
+            nullptr);
+    });
+}
+
+void PasswordManager::on_password_cleared(GObject*, GAsyncResult* result, gpointer user_data) {
+    std::unique_ptr<KeyringOp> op(static_cast<KeyringOp*>(user_data));
+    GError* error = nullptr;
+    // FALSE without an error only means nothing matched
+    secret_password_clear_finish(result, &error);
+    bool libsecret_ok = error == nullptr;
+    if (error) {
+        g_error_free(error);
+    }
+    if (op->cancelled()) {
+        return;
+    }
+    
+    bool sqlite_ok = op->self->delete_locally(op->domain, op->username);
+    if (op->done) {
+        op->done(libsecret_ok && sqlite_ok);
+    }
 }
 
 bool PasswordManager::delete_from_libsecret(const std::string& domain, const std::string& username) {
@@ -499,16 +1350,73 @@ bool PasswordManager::delete_from_libsecret(const std::string& domain, const std
     return true;
 }
 
+std::vector<char> PasswordManager::store_in_keyring(const std::vector<Credential>& batch) {
+    // Issued together, the stores cost about one D-Bus round trip per batch
+    // instead of one per password
+    KeyringBatch calls(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        secret_password_store(
+            schema_,
+            SECRET_COLLECTION_DEFAULT,
+            "RyxSurf Password",
+            batch[i].password.c_str(),
+            cancellable_,
+            &PasswordManager::on_batch_stored,
+            &calls.slots[i],
+            "domain", batch[i].domain.c_str(),
+            "username", batch[i].username.c_str(),
+            nullptr);
+    }
+    calls.wait();
+    return calls.succeeded;
+}
+
+void PasswordManager::clear_from_keyring(const std::vector<std::pair<std::string, std::string>>& items) {
+    for (size_t begin = 0; begin < items.size(); begin += IMPORT_BATCH_SIZE) {
+        size_t end = std::min(items.size(), begin + IMPORT_BATCH_SIZE);
+        KeyringBatch calls(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            secret_password_clear(
+                schema_,
+                cancellable_,
+                &PasswordManager::on_batch_cleared,
+                &calls.slots[i - begin],
+                "domain", items[i].first.c_str(),
+                "username", items[i].second.c_str(),
+                nullptr);
+        }
+        calls.wait();
+    }
+}
+
+void PasswordManager::on_batch_stored(GObject*, GAsyncResult* result, gpointer user_data) {
+    GError* error = nullptr;
+    gboolean stored = secret_password_store_finish(result, &error);
+    if (error) {
+        g_error_free(error);
+        stored = FALSE;
+    }
+    KeyringBatch::finish(user_data, stored);
+}
+
+void PasswordManager::on_batch_cleared(GObject*, GAsyncResult* result, gpointer user_data) {
+    GError* error = nullptr;
+    // FALSE without an error only means nothing matched
+    secret_password_clear_finish(result, &error);
+    bool ok = error == nullptr;
+    if (error) {
+        g_error_free(error);
+    }
+    KeyringBatch::finish(user_data, ok);
+}
+
 bool PasswordManager::delete_from_sqlite(const std::string& domain, const std::string& username) {
     if (!db_) {
         return false;
     }
     
-    std::stringstream ss;
-    ss << "DELETE FROM credentials WHERE domain = ? AND username = ?;";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, ss.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt* stmt = acquire(Statement::Delete);
+    if (!stmt) {
         return false;
     }
     
@@ -516,7 +1424,7 @@ bool PasswordManager::delete_from_sqlite(const std::string& domain, const std::s
     sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    release(stmt);
     
     return rc == SQLITE_DONE;
 }
@@ -529,11 +1437,8 @@ void PasswordManager::update_last_used(const std::string& domain, const std::str
     auto now = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
     
-    std::stringstream ss;
-    ss << "UPDATE credentials SET last_used = ? WHERE domain = ? AND username = ?;";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, ss.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt* stmt = acquire(Statement::UpdateLastUsed);
+    if (!stmt) {
         return;
     }
     
@@ -541,85 +1446,271 @@ void PasswordManager::update_last_used(const std::string& domain, const std::str
     sqlite3_bind_text(stmt, 2, domain.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 3, username.c_str(), -1, SQLITE_STATIC);
     
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release(stmt);
+    if (rc == SQLITE_DONE) {
+        index_touch(domain, username, false);
+    }
 }
 
 std::vector<std::string> PasswordManager::list_domains() {
+    // The index is keyed by site; report the stored domains under each
     std::vector<std::string> domains;
-    
-    if (!db_) {
-        return domains;
+    for (const auto& entry : index_) {
+        for (const CredentialMeta& meta : entry.second) {
+            domains.push_back(meta.domain);
+        }
+    }
+    std::sort(domains.begin(), domains.end());
+    domains.erase(std::unique(domains.begin(), domains.end()), domains.end());
+    return domains;
+}
+
+bool PasswordManager::import_credentials(CredentialReader& reader, ImportStats* stats) {
+    if ((!db_ && !init_database()) || !ensure_key()) {
+        return false;
     }
+    ensure_keyring();
     
-    const char* sql = "SELECT DISTINCT domain FROM credentials ORDER BY domain;";
+    const char* sql = "INSERT OR REPLACE INTO credentials (domain, username, password_encrypted, created, last_used) VALUES (?, ?, ?, ?, ?);";
     sqlite3_stmt* stmt;
-    
     if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        return domains;
+        return false;
+    }
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return false;
     }
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* domain = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        if (domain) {
-            domains.push_back(domain);
+    // Parse a batch, then encrypt and insert it; only one batch is in memory
+    SealedBatch sealed;
+    ImportStats counts;
+    std::vector<std::pair<std::string, std::string>> keyring_added;
+    std::vector<Credential> batch;
+    batch.reserve(IMPORT_BATCH_SIZE);
+    Credential credential;
+    bool ok = true;
+    bool more = true;
+    while (ok && more) {
+        more = reader.next(credential);
+        if (more) {
+            batch.push_back(std::move(credential));
+        }
+        if (batch.size() == IMPORT_BATCH_SIZE || (!more && !batch.empty())) {
+            ok = import_batch(batch, stmt, sealed, keyring_added);
+            counts.imported += batch.size();
+            batch.clear();
         }
     }
-    
     sqlite3_finalize(stmt);
-    return domains;
+    
+    ok = ok && !reader.failed() &&
+         sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        clear_from_keyring(keyring_added);
+        counts.imported = 0;
+    }
+    counts.skipped = reader.skipped();
+    if (stats) {
+        *stats = counts;
+    }
+    
+    // Imported rows carry their own timestamps; rebuild the index from them
+    load_index();
+    return ok;
 }
 
-std::string PasswordManager::extract_domain(const std::string& url) const {
-    // Simple domain extraction (should use proper URL parsing in production)
-    size_t start = url.find("://");
-    if (start == std::string::npos) {
-        start = 0;
-    } else {
-        start += 3;
+bool PasswordManager::import_batch(const std::vector<Credential>& batch, sqlite3_stmt* insert, SealedBatch& sealed,
+                                   std::vector<std::pair<std::string, std::string>>& keyring_added) {
+    // Whatever the keyring does not take is encrypted for the table instead
+    std::vector<char> in_keyring(batch.size(), 0);
+    if (use_libsecret()) {
+        // A rollback removes only what the import added: an item it
+        // replaced cannot be restored
+        auto indexed = [this](const Credential& cred) {
+            auto it = index_.find(site_of(cred.domain));
+            return it != index_.end() &&
+                   std::any_of(it->second.begin(), it->second.end(), [&](const CredentialMeta& m) {
+                       return m.domain == cred.domain && m.username == cred.username;
+                   });
+        };
+        in_keyring = store_in_keyring(batch);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (in_keyring[i] && !indexed(batch[i])) {
+                keyring_added.emplace_back(batch[i].domain, batch[i].username);
+            }
+        }
+        bool all_stored = std::find(in_keyring.begin(), in_keyring.end(), 0) == in_keyring.end();
+        if (!all_stored && !fall_back_to_sqlite()) {
+            return false;
+        }
     }
     
-    size_t end = url.find("/", start);
-    if (end == std::string::npos) {
-        end = url.length();
+    // Lay the batch out in one buffer (keyring rows stay empty), then
+    // encrypt into it; each encryption draws its own nonce, so they are
+    // independent
+    sealed.clear();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        sealed.add(in_keyring[i] ? 0 : sealed_password_size(batch[i].password.size()));
     }
-    
-    std::string domain = url.substr(start, end - start);
-    
-    // Remove port if present
-    size_t colon = domain.find(":");
-    if (colon != std::string::npos) {
-        domain = domain.substr(0, colon);
+    if (!parallel_for(batch.size(), [&](size_t i) {
+            if (!in_keyring[i]) {
+                encrypt_password(batch[i].password, sealed.data(i));
+            }
+        })) {
+        return false;
     }
     
-    return domain;
+    static const unsigned char empty = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const Credential& cred = batch[i];
+        sqlite3_bind_text(insert, 1, cred.domain.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insert, 2, cred.username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_blob(insert, 3, sealed.size(i) == 0 ? &empty : sealed.data(i),
+                          static_cast<int>(sealed.size(i)), SQLITE_STATIC);
+        sqlite3_bind_int64(insert, 4, std::chrono::system_clock::to_time_t(cred.created));
+        sqlite3_bind_int64(insert, 5, std::chrono::system_clock::to_time_t(cred.last_used));
+        int rc = sqlite3_step(insert);
+        sqlite3_reset(insert);
+        if (rc != SQLITE_DONE) {
+            return false;
+        }
+    }
+    return true;
 }
 
-void PasswordManager::autofill(WebKitWebView* webview, const std::string& origin) {
-    if (!autofill_enabled_ || !webview) {
-        return;
+bool PasswordManager::export_credentials(EncryptedCredentialWriter& writer, ExportStats* stats) {
+    if ((!db_ && !init_database()) || !ensure_key()) {
+        return false;
+    }
+    ensure_keyring();
+    
+    ExportStats counts;
+    if (use_libsecret()) {
+        // Passwords live in the keyring: one search per domain
+        for (const std::string& domain : list_domains()) {
+            for (const Credential& cred : get_from_libsecret(domain)) {
+                if (!writer.write(cred)) {
+                    return false;
+                }
+                ++counts.exported;
+            }
+        }
+        if (stats) {
+            *stats = counts;
+        }
+        return writer.finish();
+    }
+    
+    const char* sql = "SELECT domain, username, password_encrypted, created, last_used FROM credentials "
+                      "ORDER BY domain, username;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
     }
     
-    std::string domain = extract_domain(origin);
-    auto cred = get_one(domain);
+    // Decrypt a batch in parallel, then write it in order. A row that does
+    // not decrypt cannot be exported; it is skipped and counted.
+    std::vector<Credential> batch;
+    SealedBatch encrypted;
+    std::vector<char> decrypted;
+    auto flush = [&]() {
+        decrypted.assign(batch.size(), 0);
+        parallel_for(batch.size(), [&](size_t i) {
+            try {
+                batch[i].password = decrypt_password(encrypted.data(i), encrypted.size(i));
+                decrypted[i] = 1;
+            } catch (const std::exception&) {
+                // Counted as skipped below
+            }
+        });
+        bool ok = true;
+        for (size_t i = 0; ok && i < batch.size(); ++i) {
+            if (!decrypted[i]) {
+                ++counts.skipped;
+                continue;
+            }
+            ok = writer.write(batch[i]);
+            counts.exported += ok;
+        }
+        batch.clear();
+        encrypted.clear();
+        return ok;
+    };
+    
+    bool ok = true;
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 2));
+        size_t blob_size = static_cast<size_t>(sqlite3_column_bytes(stmt, 2));
+        if (blob_size == 0) {
+            continue;  // Keyring metadata, or no password worth exporting
+        }
+        
+        const char* domain = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        Credential cred;
+        cred.domain = domain ? domain : "";
+        cred.username = username ? username : "";
+        cred.created = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 3));
+        cred.last_used = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 4));
+        batch.push_back(std::move(cred));
+        encrypted.add(blob, blob_size);
+        if (batch.size() == IMPORT_BATCH_SIZE) {
+            ok = flush();
+        }
+    }
+    sqlite3_finalize(stmt);
     
-    if (!cred.has_value()) {
+    // A read error ends the loop too; the export must not look complete
+    ok = ok && rc == SQLITE_DONE && flush() && writer.finish();
+    if (stats) {
+        *stats = counts;
+    }
+    return ok;
+}
+
+std::string PasswordManager::extract_domain(const std::string& url) const {
+    return domain_of(url);
+}
+
+std::string PasswordManager::domain_of(std::string_view url) {
+    return lowercase_host(url_host(url));
+}
+
+std::string PasswordManager::site_of(std::string_view domain) {
+    std::string host = lowercase_host(domain);
+    std::string_view site = PublicSuffixList::shared().registrable_domain(host);
+    return site.empty() ? host : std::string(site);
+}
+
+void PasswordManager::autofill(const std::string& origin, AutofillTrigger trigger, CredentialCallback done) {
+    // Pages call this for every login form they show; answer from the index
+    // when there is nothing to decrypt
+    if (!should_autofill(origin, trigger)) {
+        done(std::nullopt);
         return;
     }
     
-    // Use WebKit's autofill API (simplified - real implementation would use
-    // WebKitFormSubmissionListener or JavaScript injection)
-    // For now, this is a placeholder
-    update_last_used(domain, cred->username);
+    get_one_async(domain_of(origin), trigger == AutofillTrigger::PageLoad,
+                  [this, done](std::optional<Credential> cred) {
+        if (cred) {
+            update_last_used(cred->domain, cred->username);
+        }
+        done(std::move(cred));
+    });
 }
 
-bool PasswordManager::should_autofill(const std::string& origin) const {
-    if (!autofill_enabled_) {
+bool PasswordManager::should_autofill(const std::string& origin, AutofillTrigger trigger) const {
+    // A password typed on an https page never goes to a plaintext one
+    constexpr std::string_view kSecureScheme = "https://";
+    if (!autofill_enabled_ || origin.compare(0, kSecureScheme.size(), kSecureScheme) != 0) {
         return false;
     }
     
-    std::string domain = extract_domain(origin);
-    return const_cast<PasswordManager*>(this)->has_credentials(domain);
+    // The origin's host looked up in the index: no SQLite
+    return find_credential(domain_of(origin), trigger == AutofillTrigger::PageLoad) != nullptr;
 }
 
 std::string PasswordManager::generate_password(size_t length, bool include_symbols) {
@@ -640,23 +1731,137 @@ std::string PasswordManager::generate_password(size_t length, bool include_symbo
     std::string password;
     password.reserve(length);
     
-    for (size_t i = 0; i < length; ++i) {
-        password += charset[dis(gen)];
+    // Only plausible for very short lengths; give up rather than loop forever
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        password.clear();
+        for (size_t i = 0; i < length; ++i) {
+            password += charset[dis(gen)];
+        }
+        if (!is_breached(password)) {
+            break;
+        }
     }
     
     return password;
 }
 
+bool PasswordManager::is_breached(std::string_view password) const {
+    return breach_corpus_ && !password.empty() && breach_corpus_->contains(password);
+}
+
+std::vector<Credential> PasswordManager::find_breached() {
+    std::vector<Credential> breached;
+    if (!breach_corpus_ || (!db_ && !init_database()) || !ensure_key()) {
+        return breached;
+    }
+    ensure_keyring();
+    
+    if (use_libsecret()) {
+        for (const std::string& domain : list_domains()) {
+            for (Credential& cred : get_from_libsecret(domain)) {
+                if (is_breached(cred.password)) {
+                    cred.password.clear();
+                    breached.push_back(std::move(cred));
+                }
+            }
+        }
+        return breached;
+    }
+    
+    const char* sql = "SELECT domain, username, password_encrypted, created, last_used FROM credentials "
+                      "WHERE length(password_encrypted) > 0 ORDER BY domain, username;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return breached;
+    }
+    
+    std::vector<Credential> candidates;
+    SealedBatch encrypted;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 2));
+        const char* domain = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        Credential cred;
+        cred.domain = domain ? domain : "";
+        cred.username = username ? username : "";
+        cred.created = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 3));
+        cred.last_used = std::chrono::system_clock::from_time_t(sqlite3_column_int64(stmt, 4));
+        candidates.push_back(std::move(cred));
+        encrypted.add(blob, static_cast<size_t>(sqlite3_column_bytes(stmt, 2)));
+    }
+    sqlite3_finalize(stmt);
+    
+    // Decrypt, hash and look up in parallel; each plaintext is wiped at once
+    std::vector<char> hits(candidates.size(), 0);
+    parallel_for(candidates.size(), [&](size_t i) {
+        try {
+            SecureString password = decrypt_password(encrypted.data(i), encrypted.size(i));
+            hits[i] = is_breached(password);
+        } catch (const std::exception&) {
+            // A row that does not decrypt cannot be checked; skip it
+        }
+    });
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (hits[i]) {
+            breached.push_back(std::move(candidates[i]));
+        }
+    }
+    return breached;
+}
+
 void PasswordManager::close() {
+    // Abandon in-flight keyring calls; their completions see the cancelled
+    // token and never touch this object
+    g_cancellable_cancel(cancellable_);
+    g_object_unref(cancellable_);
+    cancellable_ = g_cancellable_new();
+    keyring_waiters_.clear();
+    if (keyring_state_ == KeyringState::Probing) {
+        keyring_state_ = KeyringState::Unknown;
+    }
+    
     if (db_) {
+        finalize_statements();
         sqlite3_close(db_);
         db_ = nullptr;
     }
+    index_.clear();
 }
 
 void PasswordManager::set_master_password(const std::string& password) {
     master_password_ = password;
-    if (!password.empty() && !use_libsecret_) {
+    if (!password.empty() && !use_libsecret()) {
         setup_encryption();
     }
 }
+
+bool PasswordManager::change_master_password(const std::string& old_password, const std::string& new_password,
+                                             const Rekey::Progress& progress) {
+    if (new_password.empty() || use_libsecret()) {
+        return false;
+    }
+    if (key_agent_) {
+        return key_agent_->change_password(old_password, new_password);
+    }
+    
+    // The store's key is the old password's own: it must be the one that
+    // opened the store, and every row moves to the new password's key
+    if (!encrypted_ || encryption_key_.empty() || master_password_ != old_password ||
+        (!db_ && !init_database())) {
+        return false;
+    }
+    SecureBuffer new_key;
+    try {
+        new_key = Crypto::derive_key(new_password, salt_, kdf_params_).first;
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (!Rekey::run(db_, "credentials", "id", "password_encrypted", encryption_key_, new_key, progress)) {
+        wipe(new_key);
+        return false;
+    }
+    wipe(encryption_key_);
+    encryption_key_ = std::move(new_key);
+    master_password_ = new_password;
+    return true;
+}
@@ -1,11 +1,18 @@
 #include "persistence_manager.h"
+#include "key_agent.h"
 #include "workspace.h"
 #include "session.h"
 #include "tab.h"
+#include "session_writer.h"
+#include "session_journal.h"
+#include "session_snapshot.h"
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <iterator>
 #include <map>
+#include <sstream>
+#include <unordered_map>
 #include <glib.h>
 #include <sqlite3.h>
 #include <stdexcept>
@@ -13,16 +20,51 @@
 PersistenceManager::PersistenceManager(SessionManager* session_manager)
     : session_manager_(session_manager)
     , db_(nullptr)
+    , encrypted_(false)
+    , key_agent_(nullptr)
+    , key_listener_id_(0)
+    , legacy_pending_(false)
     , autosave_enabled_(false)
     , autosave_interval_(30)
     , autosave_timer_id_(0)
+    , journal_timer_id_(0)
+    , last_save_changes_(0)
+    , last_autosave_stall_us_(0)
+    , statements_{}
+    , statement_cache_enabled_(true)
+    , statements_prepared_(0)
+    , next_workspace_id_(0)
+    , next_session_id_(0)
+    , next_tab_id_(0)
+    , writer_(std::make_unique<SessionWriter>())
+    , journal_(std::make_unique<SessionJournal>())
+    , journaled_bytes_(0)
 {
     db_path_ = get_db_path();
 }
 
 PersistenceManager::~PersistenceManager() {
+    set_key_agent(nullptr);
     disable_autosave();
     close();
+    if (!encryption_key_.empty()) {
+        sodium_memzero(encryption_key_.data(), encryption_key_.size());
+    }
+}
+
+void PersistenceManager::set_key_agent(KeyAgent* agent) {
+    if (key_agent_) {
+        key_agent_->remove_lock_listener(key_listener_id_);
+    }
+    key_agent_ = agent;
+    if (key_agent_) {
+        key_listener_id_ = key_agent_->add_lock_listener([this] {
+            if (!encryption_key_.empty()) {
+                sodium_memzero(encryption_key_.data(), encryption_key_.size());
+            }
+            encryption_key_.clear();
+        });
+    }
 }
 
 std::string PersistenceManager::get_db_path() const {
@@ -55,8 +97,8 @@ bool PersistenceManager::initialize(const std::string& master_password) {
         return false;
     }
     
-    // Setup encryption
-    if (!master_password_.empty()) {
+    // Setup encryption (an agent another store has unlocked needs no password)
+    if (!master_password_.empty() || (key_agent_ && key_agent_->is_unlocked())) {
         if (!setup_encryption()) {
             return false;
         }
@@ -73,11 +115,26 @@ bool PersistenceManager::initialize(const std::string& master_password) {
     execute_sql("PRAGMA synchronous=NORMAL;");
     execute_sql("PRAGMA foreign_keys=ON;");
     
-    // Create schema
-    return create_schema();
+    // Migrate the schema, then compile the statements used by load once
+    if (!create_schema() || !check_encryption_mode() || !migrate_legacy_key() || !prepare_statements() ||
+        !sync_row_ids()) {
+        return false;
+    }
+    
+    // Writes go through the writer thread's own connection
+    if (!writer_->open(db_path_)) {
+        return false;
+    }
+    
+    // Without a journal, dirty rows go straight to the writer on each tick
+    journal_->open(db_path_ + ".journal");
+    return true;
 }
 
 bool PersistenceManager::setup_encryption() {
+    if (key_agent_) {
+        return setup_agent_encryption();
+    }
     if (master_password_.empty()) {
         return false;
     }
@@ -86,36 +143,135 @@ bool PersistenceManager::setup_encryption() {
     std::string salt_file = db_path_ + ".salt";
     std::ifstream salt_in(salt_file, std::ios::binary);
     
+    Crypto::KdfParams params;
+    
     if (salt_in.is_open()) {
-        salt_.resize(Crypto::SALT_SIZE);
-        salt_in.read(reinterpret_cast<char*>(salt_.data()), Crypto::SALT_SIZE);
-        salt_in.close();
+        // A KDF header, or a bare salt from before headers
+        std::vector<unsigned char> header((std::istreambuf_iterator<char>(salt_in)), std::istreambuf_iterator<char>());
+        if (!Crypto::decode_kdf_header(header.data(), header.size(), params, salt_)) {
+            return false;
+        }
     } else {
         // Generate new salt
         salt_ = Crypto::random_bytes(Crypto::SALT_SIZE);
+        std::vector<unsigned char> header = Crypto::encode_kdf_header(params, salt_);
         std::ofstream salt_out(salt_file, std::ios::binary);
         if (salt_out.is_open()) {
-            salt_out.write(reinterpret_cast<const char*>(salt_.data()), Crypto::SALT_SIZE);
+            salt_out.write(reinterpret_cast<const char*>(header.data()), header.size());
             salt_out.close();
         }
     }
     
     // Derive key
     try {
-        auto [key, _] = Crypto::derive_key(master_password_, salt_);
-        encryption_key_ = key;
+        auto [key, _] = Crypto::derive_key(master_password_, salt_, params);
+        encryption_key_ = std::move(key);
+        kdf_params_ = params;
+        encrypted_ = true;
         return true;
     } catch (const std::exception&) {
         return false;
     }
 }
 
-bool PersistenceManager::create_schema() {
-    return create_tables();
+bool PersistenceManager::setup_agent_encryption() {
+    if (!master_password_.empty() && !key_agent_->unlock(master_password_)) {
+        return false;
+    }
+    if (!key_agent_->get_key(KeyAgent::Purpose::Sessions, encryption_key_)) {
+        return false;
+    }
+    encrypted_ = true;
+    
+    // Blobs sealed before the agent existed use the key of our own salt.
+    // Opened through an agent another store unlocked, there is no password
+    // to derive it from: keep the salt and act as locked until one is set.
+    std::string salt_file = db_path_ + ".salt";
+    std::error_code ec;
+    if (legacy_key_.empty() && std::filesystem::exists(salt_file, ec)) {
+        legacy_pending_ = true;
+    }
+    if (legacy_pending_ && !master_password_.empty()) {
+        std::ifstream salt_in(salt_file, std::ios::binary);
+        std::vector<unsigned char> header((std::istreambuf_iterator<char>(salt_in)), std::istreambuf_iterator<char>());
+        Crypto::KdfParams params;
+        std::vector<unsigned char> salt;
+        if (!Crypto::decode_kdf_header(header.data(), header.size(), params, salt)) {
+            return false;
+        }
+        try {
+            legacy_key_ = Crypto::derive_key(master_password_, salt, params).first;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    
+    master_password_.clear();
+    return !db_ || migrate_legacy_key();
+}
+
+bool PersistenceManager::check_encryption_mode() {
+    if (encrypted_) {
+        return execute_sql("INSERT OR REPLACE INTO meta (key, value) VALUES ('encrypted', 1);");
+    }
+    
+    // Without the key, rows written now would be shadowed by the blobs on
+    // the next encrypted load, and sit unencrypted on disk meanwhile
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "SELECT value FROM meta WHERE key = 'encrypted';", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    bool encrypted_profile = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+    sqlite3_finalize(stmt);
+    return !encrypted_profile;
+}
+
+bool PersistenceManager::migrate_legacy_key() {
+    if (legacy_key_.empty()) {
+        return true;
+    }
+    
+    // Re-seal every workspace blob; nothing is written unless all decrypt
+    bool ok = Rekey::run(db_, "workspace_blobs", "workspace_id", "data", legacy_key_, encryption_key_);
+    if (ok) {
+        std::error_code ec;
+        std::filesystem::remove(db_path_ + ".salt", ec);
+        legacy_pending_ = false;
+    }
+    // Derived again from the next password on failure
+    sodium_memzero(legacy_key_.data(), legacy_key_.size());
+    legacy_key_.clear();
+    return ok;
+}
+
+bool PersistenceManager::ensure_key() {
+    if (!encrypted_ || !key_agent_) {
+        return true;
+    }
+    if (legacy_pending_) {
+        return false;  // Rows are still under the pre-agent key
+    }
+    if (encryption_key_.empty() && !key_agent_->get_key(KeyAgent::Purpose::Sessions, encryption_key_)) {
+        return false;
+    }
+    key_agent_->touch();
+    return true;
 }
 
-bool PersistenceManager::create_tables() {
-    const char* schema = R"(
+namespace {
+
+// Schema history. A step's SQL runs in the same transaction that sets
+// user_version to its version, so a step is either fully applied or not at
+// all. Never edit a shipped step; append a new one and bump SCHEMA_VERSION.
+// Version 1 is the original schema, which databases created before
+// versioning (user_version 0) already have, hence IF NOT EXISTS.
+struct Migration {
+    int version;
+    const char* sql;
+};
+
+const Migration kMigrations[] = {
+    {1, R"(
         CREATE TABLE IF NOT EXISTS workspaces (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             name TEXT NOT NULL UNIQUE,
@@ -147,9 +303,78 @@ bool PersistenceManager::create_tables() {
         
         CREATE INDEX IF NOT EXISTS idx_sessions_workspace ON sessions(workspace_id);
         CREATE INDEX IF NOT EXISTS idx_tabs_session ON tabs(session_id);
-    )";
+    )"},
+    // Encrypted mode: one sealed blob of sessions and tabs per workspace
+    {2, R"(
+        CREATE TABLE IF NOT EXISTS workspace_blobs (
+            workspace_id INTEGER PRIMARY KEY,
+            data BLOB NOT NULL,
+            FOREIGN KEY (workspace_id) REFERENCES workspaces(id) ON DELETE CASCADE
+        );
+    )"},
+    // Tabs come back in position order straight from the index, with no
+    // sort; the old single-column index is a prefix of the new one
+    {3, R"(
+        CREATE INDEX idx_tabs_session_position ON tabs(session_id, position);
+        DROP INDEX IF EXISTS idx_tabs_session;
+    )"},
+    // Profile-wide values: whether the profile is encrypted, and the highest
+    // session and tab ids handed out (ids sealed in workspace blobs are
+    // invisible to MAX(id)). A profile with blobs is encrypted already.
+    {4, R"(
+        CREATE TABLE IF NOT EXISTS meta (
+            key TEXT PRIMARY KEY,
+            value INTEGER NOT NULL
+        );
+        INSERT OR IGNORE INTO meta (key, value)
+            SELECT 'encrypted', 1 WHERE EXISTS (SELECT 1 FROM workspace_blobs);
+    )"},
+};
+
+static_assert(sizeof(kMigrations) / sizeof(kMigrations[0]) == PersistenceManager::SCHEMA_VERSION,
+              "every schema version needs a migration step");
+
+}  // namespace
+
+bool PersistenceManager::create_schema() {
+    int version = get_schema_version();
+    if (version < 0 || version > SCHEMA_VERSION) {
+        return false;  // Unreadable, or written by a newer build
+    }
+    
+    for (const Migration& migration : kMigrations) {
+        if (migration.version > version && !apply_migration(migration.version, migration.sql)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PersistenceManager::apply_migration(int version, const char* sql) {
+    if (!execute_sql("BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    if (!execute_sql(sql) ||
+        !execute_sql("PRAGMA user_version = " + std::to_string(version) + ";") ||
+        !execute_sql("COMMIT;")) {
+        execute_sql("ROLLBACK;");
+        return false;
+    }
+    return true;
+}
+
+int PersistenceManager::get_schema_version() {
+    if (!db_) {
+        return -1;
+    }
     
-    return execute_sql(schema);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+    int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return version;
 }
 
 bool PersistenceManager::execute_sql(const std::string& sql) {
@@ -171,93 +396,173 @@ bool PersistenceManager::execute_sql(const std::string& sql) {
 }
 
 std::vector<unsigned char> PersistenceManager::encrypt_data(const std::string& data) {
-    if (encryption_key_.empty()) {
+    if (!encrypted_) {
         // Return plaintext as bytes if no encryption
         return std::vector<unsigned char>(data.begin(), data.end());
     }
+    // No key while the agent is locked or a legacy migration is pending
+    if (!ensure_key()) {
+        throw std::runtime_error("Session key unavailable");
+    }
     
-    std::vector<unsigned char> plaintext(data.begin(), data.end());
-    return Crypto::encrypt(plaintext, encryption_key_);
+    std::vector<unsigned char> sealed(Crypto::sealed_size(data.size()));
+    Crypto::encrypt(reinterpret_cast<const unsigned char*>(data.data()), data.size(), encryption_key_, sealed.data());
+    return sealed;
 }
 
-std::string PersistenceManager::decrypt_data(const std::vector<unsigned char>& encrypted) {
-    if (encryption_key_.empty()) {
+std::string PersistenceManager::decrypt_data(const unsigned char* data, size_t size) {
+    if (!encrypted_) {
         // Return as string if no encryption
-        return std::string(encrypted.begin(), encrypted.end());
+        return size > 0 ? std::string(reinterpret_cast<const char*>(data), size) : std::string();
+    }
+    if (!ensure_key()) {
+        throw std::runtime_error("Session key unavailable");
     }
     
-    std::vector<unsigned char> plaintext = Crypto::decrypt(encrypted, encryption_key_);
-    return std::string(plaintext.begin(), plaintext.end());
+    if (size < Crypto::SEALED_OVERHEAD) {
+        throw std::invalid_argument("Ciphertext too short");
+    }
+    std::string plaintext(size - Crypto::SEALED_OVERHEAD, '\0');
+    plaintext.resize(Crypto::decrypt(data, size, encryption_key_, reinterpret_cast<unsigned char*>(&plaintext[0])));
+    return plaintext;
 }
 
-bool PersistenceManager::save_all() {
-    if (!db_) {
-        return false;
+namespace {
+
+// SQL for each PersistenceManager::Statement, in enum order
+const char* const kStatementSql[] = {
+    "SELECT id, name, created_at, updated_at FROM workspaces ORDER BY id;",
+    "SELECT id, created_at, updated_at FROM workspaces WHERE name = ?;",
+    "SELECT id, name, is_overview, created_at, updated_at FROM sessions WHERE workspace_id = ? ORDER BY id;",
+    "SELECT t.id, t.session_id, t.url, t.title, t.snapshot_path, t.last_active, t.position FROM tabs t "
+    "JOIN sessions s ON s.id = t.session_id WHERE s.workspace_id = ? ORDER BY s.id, t.position;",
+    "SELECT data FROM workspace_blobs WHERE workspace_id = ?;",
+};
+
+int64_t to_unix_seconds(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point from_unix_seconds(sqlite3_int64 seconds) {
+    return std::chrono::system_clock::from_time_t(static_cast<time_t>(seconds));
+}
+
+// Rows of a SelectWorkspaceSessions / SelectWorkspaceTabs statement, bound
+// and ready to step
+void read_session_rows(sqlite3_stmt* stmt, int64_t workspace_id, ChangeSet& contents) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        contents.sessions.push_back({
+            sqlite3_column_int64(stmt, 0),
+            workspace_id,
+            name ? name : "",
+            sqlite3_column_int(stmt, 2) != 0,
+            sqlite3_column_int64(stmt, 3),
+            sqlite3_column_int64(stmt, 4),
+        });
     }
+}
+
+void read_tab_rows(sqlite3_stmt* stmt, ChangeSet& contents) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        const char* title = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        const char* snapshot = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        contents.tabs.push_back({
+            sqlite3_column_int64(stmt, 0),
+            sqlite3_column_int64(stmt, 1),
+            url ? url : "",
+            title ? title : "",
+            snapshot ? snapshot : "",
+            sqlite3_column_int64(stmt, 5),
+            sqlite3_column_int64(stmt, 6),
+        });
+    }
+}
+
+// A workspace's contents while the writer applies journaled deltas to them
+struct WorkspaceContents {
+    WorkspaceRow row;
+    std::vector<SessionRow> sessions;  // Stored order
+    std::unordered_map<int64_t, TabRow> tabs;
+};
+
+bool workspace_has_changes(Workspace* workspace) {
+    if (workspace->get_row_id() == 0 || workspace->is_dirty() ||
+        !workspace->get_removed_session_ids().empty()) {
+        return true;
+    }
+    for (size_t i = 0; i < workspace->get_session_count(); ++i) {
+        Session* session = workspace->get_session(i);
+        if (session->get_row_id() == 0 || session->is_dirty() ||
+            !session->get_removed_tab_ids().empty()) {
+            return true;
+        }
+        for (size_t j = 0; j < session->get_tab_count(); ++j) {
+            Tab* tab = session->get_tab(j);
+            if (tab->get_row_id() == 0 || tab->is_dirty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+void PersistenceManager::collect_changes(ChangeSet& changes) {
+    for (int64_t id : session_manager_->get_removed_workspace_ids()) {
+        changes.deleted_workspaces.push_back(id);
+    }
+    session_manager_->clear_removed_workspace_ids();
     
-    // Begin transaction
-    execute_sql("BEGIN TRANSACTION;");
-    
-    // Clear existing data
-    execute_sql("DELETE FROM tabs;");
-    execute_sql("DELETE FROM sessions;");
-    execute_sql("DELETE FROM workspaces;");
-    
-    // Save all workspaces
     for (size_t i = 0; i < session_manager_->get_workspace_count(); ++i) {
         Workspace* ws = session_manager_->get_workspace(i);
-        if (ws) {
-            bool is_empty_default = ws->get_name() == "Main" &&
-                                   ws->get_session_count() == 1 &&
-                                   ws->get_session(0)->is_overview() &&
-                                   ws->get_session(0)->get_tab_count() == 0;
-            if (is_empty_default) {
-                continue;
-            }
-            if (!save_workspace(ws)) {
-                execute_sql("ROLLBACK;");
-                return false;
-            }
+        // A workspace whose rows were never restored (dormant, or its load
+        // failed) is an empty shell; saving it would overwrite the stored data
+        if (!ws || !ws->is_loaded()) {
+            continue;
+        }
+        
+        bool is_empty_default = ws->get_row_id() == 0 &&
+                               ws->get_name() == "Main" &&
+                               ws->get_session_count() == 1 &&
+                               ws->get_session(0)->is_overview() &&
+                               ws->get_session(0)->get_tab_count() == 0;
+        if (is_empty_default) {
+            continue;
         }
+        collect_workspace(ws, changes);
     }
-    
-    // Commit transaction
-    execute_sql("COMMIT;");
-    return true;
 }
 
-bool PersistenceManager::save_workspace(Workspace* workspace) {
-    if (!workspace || !db_) {
-        return false;
+void PersistenceManager::collect_workspace(Workspace* workspace, ChangeSet& changes) {
+    // Encrypted profiles collect the same row deltas; the writer folds them
+    // into the workspace's blob, which it finds by the workspace row, so any
+    // change in the workspace sends that row along
+    bool reseal = encrypted_ && workspace_has_changes(workspace);
+    if (reseal && !ensure_key()) {
+        return;  // Stays dirty until the key is back
     }
     
-    // Insert workspace using parameterized query
-    const char* sql = "INSERT OR REPLACE INTO workspaces (name, created_at, updated_at) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        return false;
+    if (workspace->get_row_id() == 0 || workspace->is_dirty() || reseal) {
+        if (workspace->get_row_id() == 0) {
+            workspace->set_row_id(++next_workspace_id_);
+        }
+        changes.workspaces.push_back({
+            workspace->get_row_id(),
+            workspace->get_name(),
+            to_unix_seconds(workspace->get_created_at()),
+            to_unix_seconds(workspace->get_updated_at()),
+        });
+        workspace->clear_dirty();
     }
     
-    auto created = std::chrono::duration_cast<std::chrono::seconds>(
-        workspace->get_created_at().time_since_epoch()).count();
-    auto updated = std::chrono::duration_cast<std::chrono::seconds>(
-        workspace->get_updated_at().time_since_epoch()).count();
-    
-    sqlite3_bind_text(stmt, 1, workspace->get_name().c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 2, created);
-    sqlite3_bind_int64(stmt, 3, updated);
-    
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        return false;
+    // Sessions removed since the last save (their tabs cascade)
+    for (int64_t id : workspace->get_removed_session_ids()) {
+        changes.deleted_sessions.push_back(id);
     }
-    
-    sqlite3_int64 workspace_id = sqlite3_last_insert_rowid(db_);
-    sqlite3_finalize(stmt);
-    
-    // Save sessions
-    const char* session_sql = "INSERT OR REPLACE INTO sessions (workspace_id, name, is_overview, created_at, updated_at) VALUES (?, ?, ?, ?, ?);";
+    workspace->clear_removed_session_ids();
     
     for (size_t i = 0; i < workspace->get_session_count(); ++i) {
         Session* session = workspace->get_session(i);
@@ -265,161 +570,469 @@ bool PersistenceManager::save_workspace(Workspace* workspace) {
             continue;
         }
         
-        if (sqlite3_prepare_v2(db_, session_sql, -1, &stmt, nullptr) != SQLITE_OK) {
-            continue;
+        if (session->get_row_id() == 0 || session->is_dirty()) {
+            if (session->get_row_id() == 0) {
+                session->set_row_id(++next_session_id_);
+            }
+            changes.sessions.push_back({
+                session->get_row_id(),
+                workspace->get_row_id(),
+                session->get_name(),
+                session->is_overview(),
+                to_unix_seconds(session->get_created_at()),
+                to_unix_seconds(session->get_updated_at()),
+            });
+            session->clear_dirty();
         }
         
-        auto s_created = std::chrono::duration_cast<std::chrono::seconds>(
-            session->get_created_at().time_since_epoch()).count();
-        auto s_updated = std::chrono::duration_cast<std::chrono::seconds>(
-            session->get_updated_at().time_since_epoch()).count();
-        
-        sqlite3_bind_int64(stmt, 1, workspace_id);
-        sqlite3_bind_text(stmt, 2, session->get_name().c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 3, session->is_overview() ? 1 : 0);
-        sqlite3_bind_int64(stmt, 4, s_created);
-        sqlite3_bind_int64(stmt, 5, s_updated);
-        
-        if (sqlite3_step(stmt) != SQLITE_DONE) {
-            sqlite3_finalize(stmt);
-            continue;
+        for (int64_t id : session->get_removed_tab_ids()) {
+            changes.deleted_tabs.push_back(id);
         }
-        
-        sqlite3_int64 session_id = sqlite3_last_insert_rowid(db_);
-        sqlite3_finalize(stmt);
-        
-        // Save tabs using parameterized query
-        const char* tab_sql = "INSERT INTO tabs (session_id, url, title, snapshot_path, last_active, position) VALUES (?, ?, ?, ?, ?, ?);";
+        session->clear_removed_tab_ids();
         
         for (size_t j = 0; j < session->get_tab_count(); ++j) {
             Tab* tab = session->get_tab(j);
-            if (!tab) {
+            if (!tab || (tab->get_row_id() != 0 && !tab->is_dirty())) {
                 continue;
             }
             
-            if (sqlite3_prepare_v2(db_, tab_sql, -1, &stmt, nullptr) != SQLITE_OK) {
-                continue;
+            if (tab->get_row_id() == 0) {
+                tab->set_row_id(++next_tab_id_);
             }
-            
             // Use system_clock time_point for persistence
-            auto last_active = std::chrono::duration_cast<std::chrono::seconds>(
-                tab->get_last_active_system().time_since_epoch()).count();
-            
-            sqlite3_bind_int64(stmt, 1, session_id);
-            sqlite3_bind_text(stmt, 2, tab->get_url().c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 3, tab->get_title().c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 4, tab->get_snapshot_path().c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_int64(stmt, 5, last_active);
-            sqlite3_bind_int(stmt, 6, j);
-            
-            if (sqlite3_step(stmt) != SQLITE_DONE) {
-                sqlite3_finalize(stmt);
+            changes.tabs.push_back({
+                tab->get_row_id(),
+                session->get_row_id(),
+                tab->get_url(),
+                tab->get_title(),
+                tab->get_snapshot_path(),
+                to_unix_seconds(tab->get_last_active_system()),
+                static_cast<int64_t>(j),
+            });
+            tab->clear_dirty();
+        }
+    }
+    
+    if (reseal) {
+        changes.last_session_id = next_session_id_;
+        changes.last_tab_id = next_tab_id_;
+    }
+}
+
+bool PersistenceManager::save_all() {
+    if (!db_) {
+        return false;
+    }
+    
+    // Hand the dirty rows to the writer and wait for it to drain, including
+    // anything an earlier autosave queued. An idle save touches nothing.
+    ChangeSet changes;
+    collect_changes(changes);
+    
+    int64_t changes_before = writer_->get_total_changes();
+    bool ok = checkpoint(std::move(changes));
+    last_save_changes_ = static_cast<int>(writer_->get_total_changes() - changes_before);
+    return ok;
+}
+
+bool PersistenceManager::save_workspace(Workspace* workspace) {
+    if (!workspace || !db_) {
+        return false;
+    }
+    
+    ChangeSet changes;
+    collect_workspace(workspace, changes);
+    return checkpoint(std::move(changes));
+}
+
+bool PersistenceManager::checkpoint(ChangeSet changes) {
+    // Journaled rows are older than `changes`, so they are written first
+    if (!changes.empty()) {
+        journaled_.push_back(std::move(changes));
+    }
+    if (!journaled_.empty()) {
+        if (encrypted_ && !ensure_key()) {
+            return false;  // Kept for a checkpoint once the key is back
+        }
+        submit_changes(std::move(journaled_));
+        journaled_.clear();
+        journaled_bytes_ = 0;
+    }
+    
+    bool ok = writer_->flush();
+    if (ok && journal_->is_open()) {
+        // Everything journaled so far is in the database now
+        journal_->reset();
+    }
+    return ok;
+}
+
+void PersistenceManager::submit_changes(std::vector<ChangeSet> sets, std::function<void()> on_commit) {
+    if (sets.empty()) {
+        return;
+    }
+    if (!encrypted_) {
+        for (size_t i = 0; i < sets.size(); ++i) {
+            bool last = i + 1 == sets.size();
+            writer_->submit(std::move(sets[i]), last ? std::move(on_commit) : nullptr);
+        }
+        return;
+    }
+    
+    // Encrypted rows never reach the tables: the writer applies them to the
+    // stored contents of each workspace they touch and re-seals those blobs,
+    // once per batch and on its own thread, with a copy of the key
+    writer_->submit(ChangeSet(), std::move(on_commit),
+                    [deltas = std::move(sets), key = SecureBuffer(encryption_key_)](sqlite3* db, ChangeSet& sealed) {
+                        return seal_deltas(db, key, deltas, sealed);
+                    });
+}
+
+bool PersistenceManager::replay_journal() {
+    // Records on disk are whatever the last run journaled but never compacted.
+    // Rows are upserted by id, so replaying ones that did commit is harmless.
+    writer_->flush_posted();
+    std::vector<std::string> records;
+    if (!journal_->read_all(records)) {
+        records.clear();
+    }
+    if (!records.empty() && encrypted_ && !ensure_key()) {
+        // The records are sealed: keep them for the key, and keep this run
+        // from appending to or truncating the file
+        journal_->close();
+        return false;
+    }
+    
+    std::vector<ChangeSet> deltas;
+    for (const std::string& record : records) {
+        ChangeSet changes;
+        if (!encrypted_) {
+            if (decode_change_set(record.data(), record.size(), changes)) {
+                deltas.push_back(std::move(changes));
+            }
+            continue;
+        }
+        
+        // Encrypted profiles journal sealed deltas
+        try {
+            std::string plaintext = decrypt_data(reinterpret_cast<const unsigned char*>(record.data()),
+                                                 record.size());
+            if (decode_change_set(plaintext.data(), plaintext.size(), changes)) {
+                deltas.push_back(std::move(changes));
                 continue;
             }
-            
+        } catch (const std::exception&) {
+        }
+        // Records from before that hold their blobs sealed already
+        ChangeSet sealed;
+        if (!decode_change_set(record.data(), record.size(), sealed)) {
+            journal_->close();  // Opens neither way: the wrong key, so leave the file be
+            return false;
+        }
+        submit_changes(std::move(deltas));
+        deltas.clear();
+        writer_->submit(std::move(sealed));
+    }
+    submit_changes(std::move(deltas));
+    return checkpoint(ChangeSet());
+}
+
+bool PersistenceManager::journal_changes() {
+    if (!db_) {
+        return false;
+    }
+    
+    ChangeSet changes;
+    collect_changes(changes);
+    if (changes.empty()) {
+        return false;
+    }
+    
+    if (!journal_->is_open()) {
+        std::vector<ChangeSet> sets;
+        sets.push_back(std::move(changes));
+        submit_changes(std::move(sets));
+        return true;
+    }
+    
+    // Only collecting and encoding (and, encrypted, sealing the small delta)
+    // happen here. The writer thread does the write + fdatasync, one per
+    // batch; if it fails the batch stays buffered and the rows still reach
+    // the database at the next compaction.
+    std::string record = encode_change_set(changes);
+    if (encrypted_) {
+        try {
+            std::vector<unsigned char> sealed = encrypt_data(record);
+            record.assign(sealed.begin(), sealed.end());
+        } catch (const std::exception&) {
+            record.clear();  // Not journaled; committed by the next compaction
+        }
+    }
+    if (!record.empty()) {
+        journaled_bytes_ += record.size();
+        SessionJournal* journal = journal_.get();
+        writer_->post([journal, record = std::move(record)] {
+            journal->append(record);
+            journal->sync();
+        });
+    }
+    journaled_.push_back(std::move(changes));
+    return true;
+}
+
+void PersistenceManager::compact_journal() {
+    if (journaled_.empty() || journal_->has_sealed()) {
+        return;  // Nothing to do, or the previous compaction has not committed yet
+    }
+    if (encrypted_ && !ensure_key()) {
+        return;  // Nothing can be sealed while the agent is locked
+    }
+    
+    // Seal the records being compacted so new ones keep going to a fresh file;
+    // the sealed file is dropped once the last of them commits. The rotation
+    // is posted after their appends and runs before their commits.
+    SessionJournal* journal = journal_.get();
+    writer_->post([journal] { journal->rotate(); });
+    submit_changes(std::move(journaled_), [journal] { journal->discard_sealed(); });
+    journaled_.clear();
+    journaled_bytes_ = 0;
+}
+
+uint64_t PersistenceManager::get_journal_bytes_written() const {
+    return journal_->get_bytes_written();
+}
+
+void PersistenceManager::flush_journal() {
+    writer_->flush_posted();
+}
+
+void PersistenceManager::set_statement_cache_enabled_for_tests(bool enabled) {
+    statement_cache_enabled_ = enabled;
+    writer_->set_statement_cache_enabled(enabled);
+}
+
+size_t PersistenceManager::get_statements_prepared() const {
+    return statements_prepared_ + writer_->get_statements_prepared();
+}
+
+std::vector<std::string> PersistenceManager::get_query_plans_for_tests() {
+    std::vector<std::string> plans;
+    for (const char* sql : kStatementSql) {
+        std::string plan;
+        sqlite3_stmt* stmt;
+        std::string explain = std::string("EXPLAIN QUERY PLAN ") + sql;
+        if (db_ && sqlite3_prepare_v2(db_, explain.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                const unsigned char* detail = sqlite3_column_text(stmt, 3);
+                plan += detail ? reinterpret_cast<const char*>(detail) : "";
+                plan += "\n";
+            }
             sqlite3_finalize(stmt);
         }
+        plans.push_back(plan);
     }
+    return plans;
+}
+
+bool PersistenceManager::sync_row_ids() {
+    // Blob mode deletes the plaintext session and tab rows, so their ids
+    // also come from the marks the writer keeps in meta
+    const char* sql = "SELECT (SELECT COALESCE(MAX(id), 0) FROM workspaces), "
+                      "MAX((SELECT COALESCE(MAX(id), 0) FROM sessions), "
+                      "    (SELECT COALESCE(MAX(value), 0) FROM meta WHERE key = 'last_session_id')), "
+                      "MAX((SELECT COALESCE(MAX(id), 0) FROM tabs), "
+                      "    (SELECT COALESCE(MAX(value), 0) FROM meta WHERE key = 'last_tab_id')), "
+                      "EXISTS (SELECT 1 FROM workspace_blobs) AND "
+                      "NOT EXISTS (SELECT 1 FROM meta WHERE key = 'last_session_id');";
+    sqlite3_stmt* stmt;
+    
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    bool unmarked_blobs = false;
+    if (ok) {
+        next_workspace_id_ = sqlite3_column_int64(stmt, 0);
+        next_session_id_ = sqlite3_column_int64(stmt, 1);
+        next_tab_id_ = sqlite3_column_int64(stmt, 2);
+        unmarked_blobs = sqlite3_column_int(stmt, 3) != 0;
+    }
+    sqlite3_finalize(stmt);
     
+    if (ok && unmarked_blobs) {
+        scan_blob_row_ids();
+    }
+    return ok;
+}
+
+void PersistenceManager::scan_blob_row_ids() {
+    // Blobs written before the marks existed: open each once for its ids,
+    // and record them so later starts skip the scan. Without the key (or
+    // with the wrong one) nothing is recorded and the next start retries.
+    if (!encrypted_ || !ensure_key()) {
+        return;
+    }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "SELECT data FROM workspace_blobs;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return;
+    }
+    
+    int64_t last_session_id = next_session_id_;
+    int64_t last_tab_id = next_tab_id_;
+    bool ok = true;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+        size_t size = static_cast<size_t>(sqlite3_column_bytes(stmt, 0));
+        ChangeSet contents;
+        try {
+            std::string plaintext = decrypt_data(data, size);
+            ok = decode_change_set(plaintext.data(), plaintext.size(), contents);
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        for (const SessionRow& row : contents.sessions) {
+            last_session_id = std::max(last_session_id, row.id);
+        }
+        for (const TabRow& row : contents.tabs) {
+            last_tab_id = std::max(last_tab_id, row.id);
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (!ok) {
+        return;
+    }
+    
+    next_session_id_ = last_session_id;
+    next_tab_id_ = last_tab_id;
+    execute_sql("INSERT OR REPLACE INTO meta (key, value) VALUES "
+                "('last_session_id', " + std::to_string(last_session_id) + "), "
+                "('last_tab_id', " + std::to_string(last_tab_id) + ");");
+}
+
+bool PersistenceManager::prepare_statements() {
+    static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) ==
+                  static_cast<size_t>(Statement::Count),
+                  "kStatementSql must cover every Statement");
+    
+    for (size_t i = 0; i < statements_.size(); ++i) {
+        if (statements_[i]) {
+            continue;
+        }
+        if (sqlite3_prepare_v3(db_, kStatementSql[i], -1, SQLITE_PREPARE_PERSISTENT,
+                               &statements_[i], nullptr) != SQLITE_OK) {
+            finalize_statements();
+            return false;
+        }
+        ++statements_prepared_;
+    }
     return true;
 }
 
+void PersistenceManager::finalize_statements() {
+    for (sqlite3_stmt*& stmt : statements_) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+sqlite3_stmt* PersistenceManager::acquire(Statement id) {
+    if (!statement_cache_enabled_) {
+        // Uncached path (benchmarks): compile the statement for every use
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, kStatementSql[static_cast<size_t>(id)], -1, &stmt, nullptr) != SQLITE_OK) {
+            return nullptr;
+        }
+        ++statements_prepared_;
+        return stmt;
+    }
+    return statements_[static_cast<size_t>(id)];
+}
+
+void PersistenceManager::release(sqlite3_stmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+    if (!statement_cache_enabled_) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    // Leave the cached statement ready for its next use
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
 bool PersistenceManager::load_all() {
     if (!db_) {
         return false;
     }
 
-    // Start from a clean slate to avoid carrying default workspaces into loaded state
+    // Replay what a crash left in the journal and let queued autosaves land
+    // before reading back
+    if (!replay_journal()) {
+        return false;
+    }
+
+    // Start from a clean slate to avoid carrying default workspaces into loaded state.
+    // The database is authoritative here, so nothing the reset dropped needs deleting.
     session_manager_->reset(false);
-    
-    // Load workspaces
-    const char* sql = "SELECT id, name, created_at, updated_at FROM workspaces ORDER BY id;";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    session_manager_->clear_removed_workspace_ids();
+    if (!sync_row_ids()) {
         return false;
     }
     
-    std::map<sqlite3_int64, Workspace*> workspace_map;
+    // Only the workspace list is read up front; each workspace stays an empty
+    // shell until it is switched to, so startup cost does not grow with
+    // dormant workspaces.
+    sqlite3_stmt* stmt = acquire(Statement::SelectWorkspaces);
+    if (!stmt) {
+        return false;
+    }
     
-    bool loaded_any = false;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        loaded_any = true;
         sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
         const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
         sqlite3_int64 created = sqlite3_column_int64(stmt, 2);
         sqlite3_int64 updated = sqlite3_column_int64(stmt, 3);
         
         Workspace* ws = session_manager_->add_workspace(name ? name : "");
-        if (ws) {
-            if (created > 0) {
-                ws->set_created_at(std::chrono::system_clock::from_time_t(static_cast<time_t>(created)));
-            }
-            if (updated > 0) {
-                ws->set_updated_at(std::chrono::system_clock::from_time_t(static_cast<time_t>(updated)));
-            }
+        if (created > 0) {
+            ws->set_created_at(from_unix_seconds(created));
         }
-        workspace_map[id] = ws;
-        
-        // Load sessions for this workspace using parameterized query
-        const char* session_sql = "SELECT id, name, is_overview, created_at, updated_at FROM sessions WHERE workspace_id = ? ORDER BY id;";
-        sqlite3_stmt* session_stmt;
-        
-        if (sqlite3_prepare_v2(db_, session_sql, -1, &session_stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int64(session_stmt, 1, id);
-            
-            while (sqlite3_step(session_stmt) == SQLITE_ROW) {
-                sqlite3_int64 session_id = sqlite3_column_int64(session_stmt, 0);
-                const char* s_name = reinterpret_cast<const char*>(sqlite3_column_text(session_stmt, 1));
-                int is_overview = sqlite3_column_int(session_stmt, 2);
-                
-                Session* session = ws->add_session(s_name ? s_name : "");
-                session->set_overview(is_overview != 0);
-                sqlite3_int64 s_created = sqlite3_column_int64(session_stmt, 3);
-                sqlite3_int64 s_updated = sqlite3_column_int64(session_stmt, 4);
-                if (s_created > 0) {
-                    session->set_created_at(std::chrono::system_clock::from_time_t(static_cast<time_t>(s_created)));
-                }
-                if (s_updated > 0) {
-                    session->set_updated_at(std::chrono::system_clock::from_time_t(static_cast<time_t>(s_updated)));
-                }
-                
-                // Load tabs for this session using parameterized query
-                const char* tab_sql = "SELECT url, title, snapshot_path, last_active, position FROM tabs WHERE session_id = ? ORDER BY position;";
-                sqlite3_stmt* tab_stmt;
-                
-                if (sqlite3_prepare_v2(db_, tab_sql, -1, &tab_stmt, nullptr) == SQLITE_OK) {
-                    sqlite3_bind_int64(tab_stmt, 1, session_id);
-                    
-                    while (sqlite3_step(tab_stmt) == SQLITE_ROW) {
-                        const char* url = reinterpret_cast<const char*>(sqlite3_column_text(tab_stmt, 0));
-                        const char* title = reinterpret_cast<const char*>(sqlite3_column_text(tab_stmt, 1));
-                        const char* snapshot = reinterpret_cast<const char*>(sqlite3_column_text(tab_stmt, 2));
-                        sqlite3_int64 last_active = sqlite3_column_int64(tab_stmt, 3);
-                        
-                        Tab* tab = session->add_tab(url ? url : "");
-                        tab->set_title(title ? title : "");
-                        if (snapshot) {
-                            tab->set_snapshot_path(snapshot);
-                        }
-                        if (last_active > 0) {
-                            tab->set_last_active_system(std::chrono::system_clock::from_time_t(static_cast<time_t>(last_active)));
-                        }
-                    }
-                    sqlite3_finalize(tab_stmt);
-                }
-            }
-            sqlite3_finalize(session_stmt);
+        if (updated > 0) {
+            ws->set_updated_at(from_unix_seconds(updated));
         }
+        ws->set_row_id(id);
+        ws->set_loaded(false);
+        ws->clear_dirty();
     }
+    release(stmt);
     
-    sqlite3_finalize(stmt);
+    // The database has taken over from the startup snapshot
+    std::error_code ec;
+    std::filesystem::remove(get_snapshot_path(), ec);
 
-    if (!loaded_any) {
+    if (session_manager_->get_workspace_count() == 0) {
         // Recreate default workspace if nothing was stored
         session_manager_->reset(true);
+        return true;
     }
-    return true;
+    
+    session_manager_->set_workspace_loader([this](Workspace* ws) {
+        return load_workspace(ws->get_name(), ws);
+    });
+    Workspace* current = session_manager_->get_current_workspace();
+    return load_workspace(current->get_name(), current);
+}
+
+bool PersistenceManager::write_snapshot() {
+    // The snapshot is plaintext, so encrypted profiles never get one
+    if (!db_ || encrypted_) {
+        return false;
+    }
+    return SessionSnapshot::write(get_snapshot_path(), session_manager_);
 }
 
 void PersistenceManager::enable_autosave(int interval_seconds) {
@@ -430,6 +1043,10 @@ void PersistenceManager::enable_autosave(int interval_seconds) {
         interval_seconds,
         autosave_callback,
         this);
+    journal_timer_id_ = g_timeout_add(
+        JOURNAL_INTERVAL_MS,
+        journal_callback,
+        this);
 }
 
 void PersistenceManager::disable_autosave() {
@@ -437,17 +1054,61 @@ void PersistenceManager::disable_autosave() {
         g_source_remove(autosave_timer_id_);
         autosave_timer_id_ = 0;
     }
+    if (journal_timer_id_ != 0) {
+        g_source_remove(journal_timer_id_);
+        journal_timer_id_ = 0;
+    }
     autosave_enabled_ = false;
 }
 
+void PersistenceManager::queue_autosave() {
+    if (!db_) {
+        return;
+    }
+    
+    // Main thread only snapshots the dirty rows; the writer thread does the I/O
+    auto start = std::chrono::steady_clock::now();
+    compact_journal();
+    if (!journaled_.empty()) {
+        // An earlier compaction is still committing; keep ordering via the journal
+        journal_changes();
+    } else {
+        ChangeSet changes;
+        collect_changes(changes);
+        if (!changes.empty()) {
+            std::vector<ChangeSet> sets;
+            sets.push_back(std::move(changes));
+            submit_changes(std::move(sets));
+        }
+    }
+    last_autosave_stall_us_ = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
 gboolean PersistenceManager::autosave_callback(gpointer user_data) {
     PersistenceManager* pm = static_cast<PersistenceManager*>(user_data);
-    pm->save_all();
+    pm->queue_autosave();
     return TRUE;  // Keep timer running
 }
 
+gboolean PersistenceManager::journal_callback(gpointer user_data) {
+    PersistenceManager* pm = static_cast<PersistenceManager*>(user_data);
+    // A tick with nothing new means the user went idle: compact then
+    if (!pm->journal_changes() || pm->journaled_bytes_ > JOURNAL_COMPACT_BYTES) {
+        pm->compact_journal();
+    }
+    return TRUE;
+}
+
 void PersistenceManager::close() {
     disable_autosave();
+    if (db_) {
+        checkpoint(ChangeSet());  // Commits journaled rows; empties the journal
+        session_manager_->set_workspace_loader(nullptr);
+    }
+    writer_->close();  // Flushes anything still queued
+    journal_->close();
+    finalize_statements();
     if (db_) {
         sqlite3_close(db_);
         db_ = nullptr;
@@ -457,17 +1118,362 @@ void PersistenceManager::close() {
 void PersistenceManager::set_master_password(const std::string& password) {
     master_password_ = password;
     if (!password.empty()) {
-        setup_encryption();
+        if (setup_encryption() && db_) {
+            check_encryption_mode();
+        }
     } else {
+        if (!encryption_key_.empty()) {
+            sodium_memzero(encryption_key_.data(), encryption_key_.size());
+        }
         encryption_key_.clear();
         salt_.clear();
+        encrypted_ = false;
     }
 }
 
+bool PersistenceManager::change_master_password(const std::string& old_password, const std::string& new_password,
+                                                const Rekey::Progress& progress) {
+    if (new_password.empty()) {
+        return false;
+    }
+    if (key_agent_) {
+        return key_agent_->change_password(old_password, new_password);
+    }
+    if (!db_ || !encrypted_ || encryption_key_.empty() || master_password_ != old_password) {
+        return false;
+    }
+    
+    // Blobs sealed under the old key may still be queued for the writer or
+    // journaled; land them first, so the journal is empty and nothing older
+    // than the re-key is written after it
+    if (!save_all()) {
+        return false;
+    }
+    SecureBuffer new_key;
+    try {
+        new_key = Crypto::derive_key(new_password, salt_, kdf_params_).first;
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (!Rekey::run(db_, "workspace_blobs", "workspace_id", "data", encryption_key_, new_key, progress)) {
+        sodium_memzero(new_key.data(), new_key.size());
+        return false;
+    }
+    sodium_memzero(encryption_key_.data(), encryption_key_.size());
+    encryption_key_ = std::move(new_key);
+    master_password_ = new_password;
+    return true;
+}
+
 bool PersistenceManager::load_workspace(const std::string& name, Workspace* workspace) {
-    (void)name;
-    (void)workspace;
-    // Implementation for loading single workspace
-    // For now, load_all handles everything
-    return false;
+    if (!db_ || !workspace) {
+        return false;
+    }
+    if (workspace->is_loaded() && workspace->get_row_id() != 0) {
+        return true;  // Already restored
+    }
+    
+    sqlite3_stmt* stmt = acquire(Statement::SelectWorkspaceByName);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        release(stmt);
+        return false;
+    }
+    sqlite3_int64 workspace_id = sqlite3_column_int64(stmt, 0);
+    sqlite3_int64 created = sqlite3_column_int64(stmt, 1);
+    sqlite3_int64 updated = sqlite3_column_int64(stmt, 2);
+    release(stmt);
+    
+    // Encrypted profiles keep each workspace in one blob; a workspace stored
+    // before the master password was set still has plaintext rows
+    ChangeSet contents;
+    bool from_blob = false;
+    if (encrypted_ && !read_workspace_blob(workspace_id, contents, from_blob)) {
+        return false;
+    }
+    if (!from_blob && !read_workspace_rows(workspace_id, contents)) {
+        return false;
+    }
+    restore_workspace(workspace, contents);
+    
+    if (created > 0) {
+        workspace->set_created_at(from_unix_seconds(created));
+    }
+    if (updated > 0) {
+        workspace->set_updated_at(from_unix_seconds(updated));
+    }
+    workspace->set_row_id(workspace_id);
+    workspace->set_loaded(true);
+    if (from_blob || !encrypted_) {
+        workspace->clear_dirty();
+    }
+    // Otherwise stay dirty so the next save moves the rows into a blob
+    return true;
+}
+
+bool PersistenceManager::read_workspace_rows(int64_t workspace_id, ChangeSet& contents) {
+    sqlite3_stmt* stmt = acquire(Statement::SelectWorkspaceSessions);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    read_session_rows(stmt, workspace_id, contents);
+    release(stmt);
+    
+    stmt = acquire(Statement::SelectWorkspaceTabs);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    read_tab_rows(stmt, contents);
+    release(stmt);
+    return true;
+}
+
+bool PersistenceManager::read_workspace_blob(int64_t workspace_id, ChangeSet& contents, bool& found) {
+    sqlite3_stmt* stmt = acquire(Statement::SelectWorkspaceBlob);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    
+    found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (!found) {
+        release(stmt);
+        return true;
+    }
+    
+    // One decryption, straight from SQLite's row buffer, restores the whole
+    // workspace
+    const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+    size_t size = static_cast<size_t>(sqlite3_column_bytes(stmt, 0));
+    bool ok;
+    try {
+        std::string plaintext = decrypt_data(data, size);
+        ok = decode_change_set(plaintext.data(), plaintext.size(), contents);
+    } catch (const std::exception&) {
+        ok = false;  // Wrong master password or corrupted blob
+    }
+    release(stmt);
+    return ok;
+}
+
+bool PersistenceManager::read_stored_workspace(sqlite3* db, const SecureBuffer& key, int64_t workspace_id,
+                                               ChangeSet& contents) {
+    // The writer's connection, so each statement is compiled here: this runs
+    // once per touched workspace and batch
+    auto prepare = [db](Statement id) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db, kStatementSql[static_cast<size_t>(id)], -1, &stmt, nullptr);
+        return stmt;
+    };
+    
+    sqlite3_stmt* stmt = prepare(Statement::SelectWorkspaceBlob);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+        size_t size = static_cast<size_t>(sqlite3_column_bytes(stmt, 0));
+        bool ok = false;
+        try {
+            if (size < Crypto::SEALED_OVERHEAD) {
+                throw std::invalid_argument("Ciphertext too short");
+            }
+            std::string plaintext(size - Crypto::SEALED_OVERHEAD, '\0');
+            plaintext.resize(Crypto::decrypt(data, size, key, reinterpret_cast<unsigned char*>(&plaintext[0])));
+            ok = decode_change_set(plaintext.data(), plaintext.size(), contents);
+        } catch (const std::exception&) {
+            ok = false;  // Sealed under another key, or corrupted
+        }
+        sqlite3_finalize(stmt);
+        return ok;
+    }
+    sqlite3_finalize(stmt);
+    
+    // No blob yet: plaintext rows from before the password was set, or nothing
+    stmt = prepare(Statement::SelectWorkspaceSessions);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    read_session_rows(stmt, workspace_id, contents);
+    sqlite3_finalize(stmt);
+    
+    stmt = prepare(Statement::SelectWorkspaceTabs);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, workspace_id);
+    read_tab_rows(stmt, contents);
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool PersistenceManager::seal_deltas(sqlite3* db, const SecureBuffer& key, const std::vector<ChangeSet>& deltas,
+                                     ChangeSet& sealed) {
+    std::map<int64_t, WorkspaceContents> touched;
+    std::unordered_map<int64_t, int64_t> session_workspace;
+    
+    for (const ChangeSet& delta : deltas) {
+        // Every change in a workspace comes with its workspace row, so the
+        // stored contents are read before this delta's deletes apply
+        for (const WorkspaceRow& row : delta.workspaces) {
+            auto it = touched.find(row.id);
+            if (it != touched.end()) {
+                it->second.row = row;
+                continue;
+            }
+            ChangeSet stored;
+            if (!read_stored_workspace(db, key, row.id, stored)) {
+                return false;
+            }
+            WorkspaceContents& contents = touched[row.id];
+            contents.row = row;
+            for (SessionRow& session : stored.sessions) {
+                session_workspace[session.id] = row.id;
+                contents.sessions.push_back(std::move(session));
+            }
+            for (TabRow& tab : stored.tabs) {
+                contents.tabs.emplace(tab.id, std::move(tab));
+            }
+        }
+        
+        for (int64_t id : delta.deleted_tabs) {
+            for (auto& [workspace_id, contents] : touched) {
+                contents.tabs.erase(id);
+            }
+        }
+        for (int64_t id : delta.deleted_sessions) {
+            auto owner = session_workspace.find(id);
+            auto it = owner != session_workspace.end() ? touched.find(owner->second) : touched.end();
+            if (it == touched.end()) {
+                continue;
+            }
+            WorkspaceContents& contents = it->second;
+            contents.sessions.erase(std::remove_if(contents.sessions.begin(), contents.sessions.end(),
+                                                   [id](const SessionRow& row) { return row.id == id; }),
+                                    contents.sessions.end());
+            for (auto tab = contents.tabs.begin(); tab != contents.tabs.end();) {
+                tab = tab->second.session_id == id ? contents.tabs.erase(tab) : std::next(tab);
+            }
+            session_workspace.erase(owner);
+        }
+        for (int64_t id : delta.deleted_workspaces) {
+            touched.erase(id);  // Its blob cascades with the row
+            sealed.deleted_workspaces.push_back(id);
+        }
+        
+        for (const SessionRow& row : delta.sessions) {
+            auto it = touched.find(row.workspace_id);
+            if (it == touched.end()) {
+                continue;
+            }
+            std::vector<SessionRow>& sessions = it->second.sessions;
+            auto session = std::find_if(sessions.begin(), sessions.end(),
+                                        [&row](const SessionRow& stored) { return stored.id == row.id; });
+            if (session != sessions.end()) {
+                *session = row;
+            } else {
+                sessions.push_back(row);
+            }
+            session_workspace[row.id] = row.workspace_id;
+        }
+        for (const TabRow& row : delta.tabs) {
+            auto owner = session_workspace.find(row.session_id);
+            auto it = owner != session_workspace.end() ? touched.find(owner->second) : touched.end();
+            if (it != touched.end()) {
+                it->second.tabs[row.id] = row;
+            }
+        }
+        
+        sealed.last_session_id = std::max(sealed.last_session_id, delta.last_session_id);
+        sealed.last_tab_id = std::max(sealed.last_tab_id, delta.last_tab_id);
+    }
+    
+    // restore_workspace() wants tabs grouped by session, in position order
+    for (auto& [workspace_id, contents] : touched) {
+        ChangeSet plain;
+        plain.sessions = std::move(contents.sessions);
+        std::unordered_map<int64_t, size_t> session_order;
+        for (size_t i = 0; i < plain.sessions.size(); ++i) {
+            session_order[plain.sessions[i].id] = i;
+        }
+        plain.tabs.reserve(contents.tabs.size());
+        for (auto& [tab_id, tab] : contents.tabs) {
+            if (session_order.count(tab.session_id)) {
+                plain.tabs.push_back(std::move(tab));
+            }
+        }
+        std::sort(plain.tabs.begin(), plain.tabs.end(), [&session_order](const TabRow& a, const TabRow& b) {
+            size_t a_session = session_order.at(a.session_id);
+            size_t b_session = session_order.at(b.session_id);
+            return a_session != b_session ? a_session < b_session
+                                          : (a.position != b.position ? a.position < b.position : a.id < b.id);
+        });
+        
+        std::string encoded = encode_change_set(plain);
+        std::vector<unsigned char> blob(Crypto::sealed_size(encoded.size()));
+        try {
+            Crypto::encrypt(reinterpret_cast<const unsigned char*>(encoded.data()), encoded.size(), key, blob.data());
+        } catch (const std::exception&) {
+            return false;
+        }
+        sealed.workspaces.push_back(std::move(contents.row));
+        sealed.blobs.push_back({workspace_id, std::move(blob)});
+    }
+    return true;
+}
+
+void PersistenceManager::restore_workspace(Workspace* workspace, const ChangeSet& contents) {
+    // Sessions in stored order, then tabs (grouped by session, in position
+    // order) attached to their session by id
+    std::unordered_map<int64_t, Session*> session_map;
+    for (const SessionRow& row : contents.sessions) {
+        Session* session = workspace->add_session(row.name);
+        session->set_overview(row.is_overview);
+        if (row.created_at > 0) {
+            session->set_created_at(from_unix_seconds(row.created_at));
+        }
+        session->set_row_id(row.id);
+        session_map[row.id] = session;
+    }
+    
+    Session* session = nullptr;
+    int64_t current_session_id = 0;
+    for (const TabRow& row : contents.tabs) {
+        if (!session || row.session_id != current_session_id) {
+            auto session_it = session_map.find(row.session_id);
+            session = session_it != session_map.end() ? session_it->second : nullptr;
+            current_session_id = row.session_id;
+        }
+        if (!session) {
+            continue;  // Orphaned row
+        }
+        
+        Tab* tab = session->add_tab(row.url);
+        tab->set_title(row.title);
+        if (!row.snapshot_path.empty()) {
+            tab->set_snapshot_path(row.snapshot_path);
+        }
+        if (row.last_active > 0) {
+            tab->set_last_active_system(from_unix_seconds(row.last_active));
+        }
+        tab->set_row_id(row.id);
+        tab->clear_dirty();
+    }
+    
+    // Adding tabs bumped updated_at; put the stored values back and mark
+    // everything just read as matching the database
+    for (const SessionRow& row : contents.sessions) {
+        Session* restored = session_map[row.id];
+        if (row.updated_at > 0) {
+            restored->set_updated_at(from_unix_seconds(row.updated_at));
+        }
+        restored->clear_dirty();
+    }
 }
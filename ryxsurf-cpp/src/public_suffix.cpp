@@ -0,0 +1,458 @@
+#include "public_suffix.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+// Fallback when no system copy of the list is installed: the generic TLDs
+// and the registries most users meet, in public_suffix_list.dat format
+const char* const kBuiltinRules = R"(
+// Generic
+com
+net
+org
+edu
+gov
+mil
+int
+info
+biz
+name
+pro
+app
+dev
+io
+ai
+co
+me
+tv
+cc
+xyz
+online
+site
+shop
+blog
+cloud
+// Country codes with open second levels
+uk
+co.uk
+org.uk
+me.uk
+ltd.uk
+plc.uk
+net.uk
+ac.uk
+gov.uk
+nhs.uk
+police.uk
+au
+com.au
+net.au
+org.au
+edu.au
+gov.au
+asn.au
+id.au
+nz
+co.nz
+net.nz
+org.nz
+ac.nz
+govt.nz
+geek.nz
+jp
+co.jp
+ne.jp
+or.jp
+ac.jp
+go.jp
+ed.jp
+gr.jp
+lg.jp
+*.kawasaki.jp
+*.kitakyushu.jp
+*.kobe.jp
+*.nagoya.jp
+*.sapporo.jp
+*.sendai.jp
+*.yokohama.jp
+!city.kawasaki.jp
+!city.kitakyushu.jp
+!city.kobe.jp
+!city.nagoya.jp
+!city.sapporo.jp
+!city.sendai.jp
+!city.yokohama.jp
+br
+com.br
+net.br
+org.br
+gov.br
+edu.br
+cn
+com.cn
+net.cn
+org.cn
+gov.cn
+edu.cn
+in
+co.in
+net.in
+org.in
+gov.in
+ac.in
+za
+co.za
+org.za
+gov.za
+ac.za
+kr
+co.kr
+or.kr
+go.kr
+ac.kr
+mx
+com.mx
+org.mx
+gob.mx
+ar
+com.ar
+gob.ar
+tr
+com.tr
+gov.tr
+tw
+com.tw
+org.tw
+hk
+com.hk
+org.hk
+sg
+com.sg
+gov.sg
+my
+com.my
+il
+co.il
+ac.il
+ru
+de
+fr
+nl
+es
+it
+pl
+se
+no
+fi
+dk
+ch
+at
+be
+eu
+ca
+us
+*.ck
+!www.ck
+// Private registries
+github.io
+gitlab.io
+pages.dev
+netlify.app
+vercel.app
+herokuapp.com
+appspot.com
+blogspot.com
+cloudfront.net
+azurewebsites.net
+s3.amazonaws.com
+*.compute.amazonaws.com
+)";
+
+char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Orders like std::string's operator< on the lowercased label
+int compare_label(std::string_view stored, std::string_view label) {
+    size_t n = std::min(stored.size(), label.size());
+    for (size_t i = 0; i < n; ++i) {
+        auto a = static_cast<unsigned char>(stored[i]);
+        auto b = static_cast<unsigned char>(ascii_lower(label[i]));
+        if (a != b) {
+            return a < b ? -1 : 1;
+        }
+    }
+    if (stored.size() == label.size()) {
+        return 0;
+    }
+    return stored.size() < label.size() ? -1 : 1;
+}
+
+bool all_digits(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+bool is_scheme(std::string_view text) {
+    if (text.empty() || !std::isalpha(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    return std::all_of(text.begin(), text.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '-' || c == '.';
+    });
+}
+
+}  // namespace
+
+std::string_view url_host(std::string_view url) {
+    size_t start = 0;
+    size_t delimiter = url.find_first_of("/?#");
+    size_t scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos && (delimiter == std::string_view::npos || scheme_end < delimiter)) {
+        start = scheme_end + 3;
+    } else if (url.substr(0, 2) == "//") {
+        start = 2;
+    } else {
+        // "about:blank", "mailto:a@b": a scheme without an authority
+        size_t colon = url.find(':');
+        if (colon != std::string_view::npos && colon < delimiter && is_scheme(url.substr(0, colon)) &&
+            !all_digits(url.substr(colon + 1, delimiter == std::string_view::npos ? delimiter : delimiter - colon - 1))) {
+            return {};
+        }
+    }
+
+    size_t end = url.find_first_of("/?#", start);
+    std::string_view authority = url.substr(start, end == std::string_view::npos ? end : end - start);
+
+    // Userinfo may itself contain ':' but never '@' unescaped
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        authority.remove_prefix(at + 1);
+    }
+
+    if (!authority.empty() && authority.front() == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string_view::npos) {
+            return {};
+        }
+        return authority.substr(1, close - 1);
+    }
+
+    size_t colon = authority.find(':');
+    if (colon != std::string_view::npos) {
+        std::string_view port = authority.substr(colon + 1);
+        if (!port.empty() && !all_digits(port)) {
+            return {};
+        }
+        authority = authority.substr(0, colon);
+    }
+
+    if (!authority.empty() && authority.back() == '.') {
+        authority.remove_suffix(1);
+    }
+    return authority;
+}
+
+PublicSuffixList::PublicSuffixList() {
+    load(kBuiltinRules);
+}
+
+bool PublicSuffixList::load(std::string_view list) {
+    std::vector<std::string_view> rules;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t eol = list.find('\n', pos);
+        std::string_view line = list.substr(pos, eol == std::string_view::npos ? eol : eol - pos);
+        pos = eol == std::string_view::npos ? list.size() : eol + 1;
+
+        // The rule is the first whitespace-delimited token; "//" starts a comment
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos || line.substr(begin, 2) == "//") {
+            continue;
+        }
+        size_t stop = line.find_first_of(" \t\r", begin);
+        rules.push_back(line.substr(begin, stop == std::string_view::npos ? stop : stop - begin));
+    }
+
+    if (rules.empty()) {
+        return false;
+    }
+    build(rules);
+    return true;
+}
+
+bool PublicSuffixList::load_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return load(contents.str());
+}
+
+void PublicSuffixList::build(const std::vector<std::string_view>& rules) {
+    // Collect into a pointer-free temporary trie (children sorted by label),
+    // then lay it out breadth first so each node's children are contiguous
+    struct TempNode {
+        std::map<std::string, size_t> children;
+        uint8_t flags = 0;
+        bool has_wildcard = false;
+    };
+    std::vector<TempNode> temp(1);
+
+    for (std::string_view rule : rules) {
+        uint8_t flag = RULE;
+        if (rule.front() == '!') {
+            flag = EXCEPTION;
+            rule.remove_prefix(1);
+        }
+
+        size_t node = 0;
+        size_t label_end = rule.size();
+        while (label_end > 0) {
+            size_t dot = rule.rfind('.', label_end - 1);
+            size_t label_start = dot == std::string_view::npos ? 0 : dot + 1;
+            std::string label(rule.substr(label_start, label_end - label_start));
+            std::transform(label.begin(), label.end(), label.begin(), ascii_lower);
+
+            if (label == "*" && label_start == 0) {
+                temp[node].has_wildcard = true;
+                node = std::string::npos;
+                break;
+            }
+            auto it = temp[node].children.find(label);
+            if (it == temp[node].children.end()) {
+                temp.emplace_back();
+                it = temp[node].children.emplace(std::move(label), temp.size() - 1).first;
+            }
+            node = it->second;
+            label_end = label_start > 0 ? label_start - 1 : 0;
+        }
+        if (node != std::string::npos && node != 0) {
+            temp[node].flags |= flag;
+        }
+    }
+
+    nodes_.clear();
+    labels_.clear();
+    nodes_.reserve(temp.size());
+    std::vector<size_t> temp_index{0};
+    nodes_.push_back(Node{0, 0, 0, 0, temp[0].flags, temp[0].has_wildcard});
+    for (size_t i = 0; i < temp_index.size(); ++i) {
+        const TempNode& source = temp[temp_index[i]];
+        nodes_[i].first_child = static_cast<uint32_t>(nodes_.size());
+        nodes_[i].child_count = static_cast<uint32_t>(source.children.size());
+        for (const auto& [label, child] : source.children) {
+            nodes_.push_back(Node{static_cast<uint32_t>(labels_.size()), 0, 0,
+                                  static_cast<uint16_t>(label.size()), temp[child].flags,
+                                  temp[child].has_wildcard});
+            labels_ += label;
+            temp_index.push_back(child);
+        }
+    }
+    rule_count_ = rules.size();
+}
+
+const PublicSuffixList::Node* PublicSuffixList::find_child(const Node& node, std::string_view label) const {
+    const Node* first = nodes_.data() + node.first_child;
+    const Node* last = first + node.child_count;
+    while (first < last) {
+        const Node* mid = first + (last - first) / 2;
+        int cmp = compare_label(std::string_view(labels_).substr(mid->label_offset, mid->label_length), label);
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return nullptr;
+}
+
+size_t PublicSuffixList::suffix_start(std::string_view host) const {
+    if (host.empty()) {
+        return 0;
+    }
+
+    // Walk labels right to left. With no matching rule the implicit "*"
+    // rule applies and the suffix is the last label
+    const Node* node = &nodes_[0];
+    size_t label_end = host.size();
+    size_t previous_start = host.size();
+    size_t best = std::string_view::npos;
+    while (true) {
+        size_t dot = host.rfind('.', label_end - 1);
+        size_t start = dot == std::string_view::npos ? 0 : dot + 1;
+        if (best == std::string_view::npos) {
+            best = start;
+        }
+
+        const Node* child = start < label_end ? find_child(*node, host.substr(start, label_end - start)) : nullptr;
+        if (child && (child->flags & EXCEPTION)) {
+            return previous_start;  // Exceptions beat every other rule
+        }
+        if (node->has_wildcard) {
+            best = start;
+        }
+        if (!child) {
+            break;
+        }
+        if (child->flags & RULE) {
+            best = start;
+        }
+        if (start == 0) {
+            break;
+        }
+        node = child;
+        previous_start = start;
+        label_end = start - 1;
+        if (label_end == 0) {
+            break;
+        }
+    }
+    return best;
+}
+
+std::string_view PublicSuffixList::public_suffix(std::string_view host) const {
+    return host.substr(suffix_start(host));
+}
+
+std::string_view PublicSuffixList::registrable_domain(std::string_view host) const {
+    if (host.empty()) {
+        return {};
+    }
+
+    // IP literals have no suffix to share: IPv6 has ':', and no TLD is numeric
+    size_t last_dot = host.rfind('.');
+    if (host.find(':') != std::string_view::npos ||
+        all_digits(last_dot == std::string_view::npos ? host : host.substr(last_dot + 1))) {
+        return host;
+    }
+
+    size_t start = suffix_start(host);
+    if (start < 2) {
+        return {};  // The host is itself a public suffix
+    }
+    size_t dot = host.rfind('.', start - 2);
+    return host.substr(dot == std::string_view::npos ? 0 : dot + 1);
+}
+
+const PublicSuffixList& PublicSuffixList::shared() {
+    static const PublicSuffixList list = [] {
+        PublicSuffixList loaded;
+        if (const char* override_path = std::getenv("RYXSURF_PUBLIC_SUFFIX_LIST")) {
+            loaded.load_file(override_path);
+        } else {
+            loaded.load_file("/usr/share/publicsuffix/public_suffix_list.dat");
+        }
+        return loaded;
+    }();
+    return list;
+}
@@ -0,0 +1,117 @@
+#include "rekey.h"
+#include "crypto.h"
+#include "parallel.h"
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Row buffers are never shrunk, so after the first batch nothing allocates
+// unless a row outgrows its slot
+struct Batch {
+    std::vector<sqlite3_int64> ids;
+    std::vector<std::vector<unsigned char>> rows;
+    size_t count = 0;
+};
+
+bool exec(sqlite3* db, const char* sql) {
+    return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+// The next rows after `last_id`; false on a SQLite error
+bool read_batch(sqlite3_stmt* select, sqlite3_int64 last_id, Batch& batch) {
+    sqlite3_bind_int64(select, 1, last_id);
+    batch.count = 0;
+    size_t bytes = 0;
+    int rc = SQLITE_ROW;
+    while (batch.count < Rekey::BATCH_ROWS && bytes < Rekey::BATCH_BYTES &&
+           (rc = sqlite3_step(select)) == SQLITE_ROW) {
+        if (batch.count == batch.rows.size()) {
+            batch.ids.push_back(0);
+            batch.rows.emplace_back();
+        }
+        const auto* data = static_cast<const unsigned char*>(sqlite3_column_blob(select, 1));
+        size_t size = static_cast<size_t>(sqlite3_column_bytes(select, 1));
+        batch.ids[batch.count] = sqlite3_column_int64(select, 0);
+        batch.rows[batch.count].assign(data, data + size);
+        bytes += size;
+        ++batch.count;
+    }
+    sqlite3_reset(select);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+// Decrypt into the slot after the nonce, where encrypt() reads its
+// plaintext from when sealing in place; the new seal then overwrites it
+void reseal(std::vector<unsigned char>& row, const SecureBuffer& old_key, const SecureBuffer& new_key) {
+    if (row.size() < Crypto::SEALED_OVERHEAD) {
+        throw std::invalid_argument("Ciphertext too short");
+    }
+    unsigned char* body = row.data() + Crypto::NONCE_SIZE;
+    size_t size = Crypto::decrypt(row.data(), row.size(), old_key, body);
+    Crypto::encrypt(body, size, new_key, row.data());
+}
+
+}  // namespace
+
+bool Rekey::run(sqlite3* db, const char* table, const char* id_column, const char* data_column,
+                const SecureBuffer& old_key, const SecureBuffer& new_key, const Progress& progress) {
+    if (!db || old_key.size() != Crypto::KEY_SIZE || new_key.size() != Crypto::KEY_SIZE) {
+        return false;
+    }
+
+    // Empty values are rows without ciphertext (e.g. kept in the keyring)
+    std::string where = std::string(" FROM ") + table + " WHERE length(" + data_column + ") > 0";
+    std::string count_sql = "SELECT COUNT(*)" + where + ";";
+    std::string select_sql = std::string("SELECT ") + id_column + ", " + data_column + where +
+                             " AND " + id_column + " > ? ORDER BY " + id_column + ";";
+    std::string update_sql = std::string("UPDATE ") + table + " SET " + data_column + " = ? WHERE " +
+                             id_column + " = ?;";
+
+    // Taking the write lock first keeps the row set fixed until COMMIT
+    if (!exec(db, "BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    sqlite3_stmt* count = nullptr;
+    sqlite3_stmt* select = nullptr;
+    sqlite3_stmt* update = nullptr;
+    bool ok = sqlite3_prepare_v2(db, count_sql.c_str(), -1, &count, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, select_sql.c_str(), -1, &select, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, update_sql.c_str(), -1, &update, nullptr) == SQLITE_OK &&
+              sqlite3_step(count) == SQLITE_ROW;
+    size_t total = ok ? static_cast<size_t>(sqlite3_column_int64(count, 0)) : 0;
+
+    Batch batch;
+    size_t done = 0;
+    sqlite3_int64 last_id = std::numeric_limits<sqlite3_int64>::min();
+    while (ok) {
+        ok = read_batch(select, last_id, batch);
+        if (!ok || batch.count == 0) {
+            break;
+        }
+        // Crypto throws on a row that does not open with old_key
+        ok = parallel_for(batch.count, [&](size_t i) { reseal(batch.rows[i], old_key, new_key); });
+        for (size_t i = 0; ok && i < batch.count; ++i) {
+            sqlite3_bind_blob(update, 1, batch.rows[i].data(), static_cast<int>(batch.rows[i].size()), SQLITE_STATIC);
+            sqlite3_bind_int64(update, 2, batch.ids[i]);
+            ok = sqlite3_step(update) == SQLITE_DONE;
+            sqlite3_reset(update);
+        }
+        last_id = batch.ids[batch.count - 1];
+        done += batch.count;
+        if (ok && progress) {
+            progress(done, total);
+        }
+    }
+    sqlite3_finalize(count);
+    sqlite3_finalize(select);
+    sqlite3_finalize(update);
+
+    ok = ok && exec(db, "COMMIT;");
+    if (!ok) {
+        exec(db, "ROLLBACK;");
+    }
+    return ok;
+}
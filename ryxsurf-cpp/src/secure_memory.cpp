@@ -0,0 +1,135 @@
+#include "secure_memory.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <sodium.h>
+
+SecurePool::SecurePool() {
+    // sodium_malloc() needs the page size sodium_init() looks up
+    if (sodium_init() < 0) {
+        throw std::bad_alloc();
+    }
+}
+
+SecurePool::~SecurePool() {
+    for (void* arena : arenas_) {
+        sodium_free(arena);  // Zeroes it
+    }
+}
+
+SecurePool& SecurePool::shared() {
+    // Never destroyed: static objects holding secrets may be destroyed after
+    // a function-local static pool would be
+    static SecurePool* pool = new SecurePool();
+    return *pool;
+}
+
+size_t SecurePool::class_index(size_t size) {
+    size_t index = 0;
+    for (size_t block = MIN_BLOCK_SIZE; block < size; block <<= 1) {
+        ++index;
+    }
+    return index;
+}
+
+void* SecurePool::allocate(size_t size) {
+    if (size > MAX_BLOCK_SIZE) {
+        void* region = sodium_malloc(size);
+        if (!region) {
+            throw std::bad_alloc();
+        }
+        std::lock_guard<std::mutex> guard(mutex_);
+        ++stats_.large_in_use;
+        return region;
+    }
+
+    size_t index = class_index(size);
+    size_t block_size = MIN_BLOCK_SIZE << index;
+    std::lock_guard<std::mutex> guard(mutex_);
+    SizeClass& size_class = classes_[index];
+    void* block;
+    if (size_class.free_list) {
+        block = size_class.free_list;
+        size_class.free_list = size_class.free_list->next;
+        // Blocks were zeroed when freed, except for the link
+        std::memset(block, 0, sizeof(FreeBlock));
+    } else {
+        if (size_class.next == size_class.end) {
+            void* arena = sodium_malloc(ARENA_SIZE);
+            if (!arena) {
+                throw std::bad_alloc();
+            }
+            arenas_.push_back(arena);
+            ++stats_.arenas;
+            // sodium_malloc() fills new regions with garbage bytes
+            std::memset(arena, 0, ARENA_SIZE);
+            size_class.next = static_cast<unsigned char*>(arena);
+            size_class.end = size_class.next + ARENA_SIZE;
+        }
+        block = size_class.next;
+        size_class.next += block_size;
+    }
+    ++stats_.blocks_in_use;
+    return block;
+}
+
+void SecurePool::deallocate(void* ptr, size_t size) noexcept {
+    if (!ptr) {
+        return;
+    }
+    if (size > MAX_BLOCK_SIZE) {
+        sodium_free(ptr);  // Zeroes it
+        std::lock_guard<std::mutex> guard(mutex_);
+        --stats_.large_in_use;
+        return;
+    }
+
+    size_t index = class_index(size);
+    sodium_memzero(ptr, MIN_BLOCK_SIZE << index);
+    std::lock_guard<std::mutex> guard(mutex_);
+    SizeClass& size_class = classes_[index];
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = size_class.free_list;
+    size_class.free_list = block;
+    --stats_.blocks_in_use;
+}
+
+SecurePool::Stats SecurePool::get_stats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+}
+
+void SecureString::assign(const char* data, size_t size) {
+    clear();
+    if (size == 0) {
+        return;
+    }
+    bytes_.reserve(size + 1);
+    bytes_.insert(bytes_.end(), data, data + size);
+    bytes_.push_back('\0');
+}
+
+void SecureString::resize(size_t size) {
+    if (size == this->size()) {
+        return;
+    }
+    if (size == 0) {
+        clear();
+        return;
+    }
+    if (size < this->size()) {
+        sodium_memzero(bytes_.data() + size, bytes_.size() - size);
+    } else if (!bytes_.empty()) {
+        bytes_.pop_back();
+    }
+    // Growing reallocates into a fresh block; the pool zeroes the old one
+    bytes_.resize(size, '\0');
+    bytes_.push_back('\0');
+}
+
+void SecureString::clear() {
+    if (!bytes_.empty()) {
+        sodium_memzero(bytes_.data(), bytes_.size());
+    }
+    bytes_.clear();
+}
@@ -1,4 +1,5 @@
 #include "session.h"
+#include "workspace.h"
 #include <algorithm>
 
 Session::Session(const std::string& name)
@@ -7,6 +8,9 @@ Session::Session(const std::string& name)
     , is_overview_(false)
     , created_at_(std::chrono::system_clock::now())
     , updated_at_(std::chrono::system_clock::now())
+    , row_id_(0)
+    , dirty_(true)
+    , workspace_(nullptr)
 {
 }
 
@@ -15,10 +19,14 @@ Session::~Session() = default;
 Tab* Session::add_tab(const std::string& url) {
     auto tab = std::make_unique<Tab>(url);
     Tab* tab_ptr = tab.get();
+    tab_ptr->set_session(this);
     tabs_.push_back(std::move(tab));
     active_tab_index_ = tabs_.size() - 1;
     is_overview_ = false;
     mark_updated();
+    
+    notify_tab(SessionEventType::TabAdded, tab_ptr, active_tab_index_);
+    notify_tab(SessionEventType::TabActivated, tab_ptr, active_tab_index_);
     return tab_ptr;
 }
 
@@ -27,8 +35,20 @@ void Session::remove_tab(size_t index) {
         return;
     }
     
+    if (tabs_[index]->get_row_id() != 0) {
+        removed_tab_ids_.push_back(tabs_[index]->get_row_id());
+    }
+    Tab* active_before = get_active_tab();
+    // Kept alive until observers have seen the removal
+    std::unique_ptr<Tab> removed = std::move(tabs_[index]);
+    removed->set_session(nullptr);
     tabs_.erase(tabs_.begin() + index);
     
+    // Tabs after the removed one shift down a position
+    for (size_t i = index; i < tabs_.size(); ++i) {
+        tabs_[i]->mark_dirty();
+    }
+    
     // Adjust active tab index
     if (tabs_.empty()) {
         active_tab_index_ = 0;
@@ -38,6 +58,37 @@ void Session::remove_tab(size_t index) {
     }
     
     mark_updated();
+    
+    notify_tab(SessionEventType::TabRemoved, removed.get(), index);
+    if (active_before == removed.get() && !tabs_.empty()) {
+        notify_tab(SessionEventType::TabActivated, tabs_[active_tab_index_].get(), active_tab_index_);
+    }
+}
+
+void Session::move_tab(size_t from, size_t to) {
+    if (from >= tabs_.size() || to >= tabs_.size() || from == to) {
+        return;
+    }
+    
+    Tab* active = get_active_tab();
+    auto first = tabs_.begin() + static_cast<std::ptrdiff_t>(std::min(from, to));
+    auto last = tabs_.begin() + static_cast<std::ptrdiff_t>(std::max(from, to)) + 1;
+    if (from < to) {
+        std::rotate(first, first + 1, last);
+    } else {
+        std::rotate(first, last - 1, last);
+    }
+    
+    // Every tab between the two positions changed position
+    for (auto it = first; it != last; ++it) {
+        (*it)->mark_dirty();
+        if (it->get() == active) {
+            active_tab_index_ = static_cast<size_t>(it - tabs_.begin());
+        }
+    }
+    mark_updated();
+    
+    notify_tab(SessionEventType::TabMoved, tabs_[to].get(), to, from);
 }
 
 Tab* Session::get_tab(size_t index) {
@@ -49,11 +100,15 @@ Tab* Session::get_tab(size_t index) {
 
 void Session::set_active_tab(size_t index) {
     if (index < tabs_.size()) {
+        bool changed = index != active_tab_index_;
         active_tab_index_ = index;
         if (tabs_[index]) {
             tabs_[index]->mark_active();
         }
         mark_updated();
+        if (changed) {
+            notify_tab(SessionEventType::TabActivated, tabs_[index].get(), index);
+        }
     }
 }
 
@@ -64,6 +119,31 @@ Tab* Session::get_active_tab() {
     return tabs_[active_tab_index_].get();
 }
 
+void Session::set_overview(bool overview) {
+    if (is_overview_ != overview) {
+        is_overview_ = overview;
+        dirty_ = true;
+    }
+}
+
 void Session::mark_updated() {
     updated_at_ = std::chrono::system_clock::now();
+    dirty_ = true;
+}
+
+void Session::notify(SessionEvent event) {
+    event.session = this;
+    observers_.notify(event);
+    if (workspace_) {
+        workspace_->notify(event);
+    }
+}
+
+void Session::notify_tab(SessionEventType type, Tab* tab, size_t index, size_t old_index) {
+    SessionEvent event;
+    event.type = type;
+    event.tab = tab;
+    event.index = index;
+    event.old_index = old_index;
+    notify(event);
 }
@@ -0,0 +1,222 @@
+#include "session_changes.h"
+#include <array>
+
+namespace {
+
+// Varints keep ids, positions and counts to one or two bytes each
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void put_int(std::string& out, int64_t v) {
+    // Zigzag so small negative values stay small
+    put_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+void put_string(std::string& out, const std::string& s) {
+    put_varint(out, s.size());
+    out.append(s);
+}
+
+// Bounds-checked reader over one encoded ChangeSet
+class Reader {
+public:
+    Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+    bool varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) {
+                return false;
+            }
+            unsigned char byte = static_cast<unsigned char>(*p_++);
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool integer(int64_t& v) {
+        uint64_t u;
+        if (!varint(u)) {
+            return false;
+        }
+        v = static_cast<int64_t>((u >> 1) ^ (~(u & 1) + 1));
+        return true;
+    }
+
+    bool string(std::string& s) {
+        uint64_t size;
+        if (!varint(size) || size > static_cast<uint64_t>(end_ - p_)) {
+            return false;
+        }
+        s.assign(p_, static_cast<size_t>(size));
+        p_ += size;
+        return true;
+    }
+
+    // Element counts can never exceed the bytes left (every element takes one)
+    bool count(size_t& n) {
+        uint64_t v;
+        if (!varint(v) || v > static_cast<uint64_t>(end_ - p_)) {
+            return false;
+        }
+        n = static_cast<size_t>(v);
+        return true;
+    }
+
+    bool done() const { return p_ == end_; }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+}  // namespace
+
+std::string encode_change_set(const ChangeSet& changes) {
+    std::string out;
+    for (const auto* ids : {&changes.deleted_tabs, &changes.deleted_sessions, &changes.deleted_workspaces}) {
+        put_varint(out, ids->size());
+        for (int64_t id : *ids) {
+            put_int(out, id);
+        }
+    }
+
+    put_varint(out, changes.workspaces.size());
+    for (const WorkspaceRow& row : changes.workspaces) {
+        put_int(out, row.id);
+        put_string(out, row.name);
+        put_int(out, row.created_at);
+        put_int(out, row.updated_at);
+    }
+
+    put_varint(out, changes.sessions.size());
+    for (const SessionRow& row : changes.sessions) {
+        put_int(out, row.id);
+        put_int(out, row.workspace_id);
+        put_string(out, row.name);
+        put_varint(out, row.is_overview ? 1 : 0);
+        put_int(out, row.created_at);
+        put_int(out, row.updated_at);
+    }
+
+    put_varint(out, changes.tabs.size());
+    for (const TabRow& row : changes.tabs) {
+        put_int(out, row.id);
+        put_int(out, row.session_id);
+        put_string(out, row.url);
+        put_string(out, row.title);
+        put_string(out, row.snapshot_path);
+        put_int(out, row.last_active);
+        put_int(out, row.position);
+    }
+
+    put_varint(out, changes.blobs.size());
+    for (const WorkspaceBlobRow& row : changes.blobs) {
+        put_int(out, row.workspace_id);
+        put_varint(out, row.data.size());
+        out.append(reinterpret_cast<const char*>(row.data.data()), row.data.size());
+    }
+
+    put_int(out, changes.last_session_id);
+    put_int(out, changes.last_tab_id);
+    return out;
+}
+
+bool decode_change_set(const char* data, size_t size, ChangeSet& changes) {
+    Reader in(data, size);
+    size_t n;
+
+    for (auto* ids : {&changes.deleted_tabs, &changes.deleted_sessions, &changes.deleted_workspaces}) {
+        if (!in.count(n)) {
+            return false;
+        }
+        ids->resize(n);
+        for (int64_t& id : *ids) {
+            if (!in.integer(id)) {
+                return false;
+            }
+        }
+    }
+
+    if (!in.count(n)) {
+        return false;
+    }
+    changes.workspaces.resize(n);
+    for (WorkspaceRow& row : changes.workspaces) {
+        if (!in.integer(row.id) || !in.string(row.name) ||
+            !in.integer(row.created_at) || !in.integer(row.updated_at)) {
+            return false;
+        }
+    }
+
+    if (!in.count(n)) {
+        return false;
+    }
+    changes.sessions.resize(n);
+    for (SessionRow& row : changes.sessions) {
+        uint64_t is_overview;
+        if (!in.integer(row.id) || !in.integer(row.workspace_id) || !in.string(row.name) ||
+            !in.varint(is_overview) || !in.integer(row.created_at) || !in.integer(row.updated_at)) {
+            return false;
+        }
+        row.is_overview = is_overview != 0;
+    }
+
+    if (!in.count(n)) {
+        return false;
+    }
+    changes.tabs.resize(n);
+    for (TabRow& row : changes.tabs) {
+        if (!in.integer(row.id) || !in.integer(row.session_id) || !in.string(row.url) ||
+            !in.string(row.title) || !in.string(row.snapshot_path) ||
+            !in.integer(row.last_active) || !in.integer(row.position)) {
+            return false;
+        }
+    }
+
+    if (!in.count(n)) {
+        return false;
+    }
+    changes.blobs.resize(n);
+    for (WorkspaceBlobRow& row : changes.blobs) {
+        std::string data;
+        if (!in.integer(row.workspace_id) || !in.string(data)) {
+            return false;
+        }
+        row.data.assign(data.begin(), data.end());
+    }
+
+    // Records from before the id marks end here
+    if (!in.done() && (!in.integer(changes.last_session_id) || !in.integer(changes.last_tab_id))) {
+        return false;
+    }
+    return in.done();
+}
+
+uint32_t checksum_crc32(const char* data, size_t size, uint32_t crc) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc ^= 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,41 @@
+#include "session_events.h"
+#include <algorithm>
+
+SessionObserverList::ObserverId SessionObserverList::add(Observer observer) {
+    ObserverId id = next_id_++;
+    observers_.push_back(Entry{id, std::move(observer), false});
+    return id;
+}
+
+void SessionObserverList::remove(ObserverId id) {
+    auto it = std::find_if(observers_.begin(), observers_.end(),
+                           [id](const Entry& entry) { return entry.id == id; });
+    if (it == observers_.end()) {
+        return;
+    }
+    if (notifying_ > 0) {
+        it->removed = true;  // The observer may be running right now
+    } else {
+        observers_.erase(it);
+    }
+}
+
+void SessionObserverList::notify(const SessionEvent& event) {
+    if (observers_.empty()) {
+        return;
+    }
+
+    ++notifying_;
+    // Observers added during the callbacks are appended and not called
+    size_t count = observers_.size();
+    for (size_t i = 0; i < count; ++i) {
+        if (!observers_[i].removed) {
+            observers_[i].observer(event);
+        }
+    }
+    if (--notifying_ == 0) {
+        observers_.erase(std::remove_if(observers_.begin(), observers_.end(),
+                                        [](const Entry& entry) { return entry.removed; }),
+                         observers_.end());
+    }
+}
@@ -0,0 +1,229 @@
+#include "session_journal.h"
+#include "session_changes.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// File header: magic followed by a little-endian format version
+const char kMagic[4] = {'R', 'Y', 'X', 'J'};
+constexpr uint32_t kVersion = 2;
+constexpr size_t kHeaderSize = 8;
+// Record header: payload length and CRC32 of the payload
+constexpr size_t kRecordHeaderSize = 8;
+constexpr uint32_t kMaxRecordSize = 64u * 1024 * 1024;
+
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+}
+
+uint32_t get_u32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+std::string header() {
+    std::string out(kMagic, sizeof(kMagic));
+    put_u32(out, kVersion);
+    return out;
+}
+
+// Read the records of one journal file. Returns the length of its valid
+// prefix (0 if the header is missing); records past a torn one are ignored.
+uint64_t read_file(const std::string& path, std::vector<std::string>* records) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return 0;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < kHeaderSize || data.compare(0, kHeaderSize, header()) != 0) {
+        return 0;
+    }
+
+    size_t offset = kHeaderSize;
+    while (data.size() - offset >= kRecordHeaderSize) {
+        uint32_t size = get_u32(data.data() + offset);
+        uint32_t crc = get_u32(data.data() + offset + 4);
+        if (size > kMaxRecordSize || size > data.size() - offset - kRecordHeaderSize) {
+            break;
+        }
+
+        const char* payload = data.data() + offset + kRecordHeaderSize;
+        if (checksum_crc32(payload, size) != crc) {
+            break;
+        }
+        if (records) {
+            records->emplace_back(payload, size);
+        }
+        offset += kRecordHeaderSize + size;
+    }
+    return offset;
+}
+
+}  // namespace
+
+SessionJournal::SessionJournal()
+    : fd_(-1)
+    , size_(0)
+    , sealed_(false)
+    , bytes_written_(0)
+    , sync_count_(0)
+{
+}
+
+SessionJournal::~SessionJournal() {
+    close();
+}
+
+bool SessionJournal::open(const std::string& path) {
+    close();
+    path_ = path;
+    sealed_ = std::filesystem::exists(sealed_path());
+    bytes_written_ = 0;
+    sync_count_ = 0;
+    return open_live();
+}
+
+bool SessionJournal::open_live() {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    // Keep the intact records, cut anything a crash left half-written
+    size_ = read_file(path_, nullptr);
+    if (size_ == 0) {
+        if (ftruncate(fd_, 0) != 0 || !write_all(header()) || fdatasync(fd_) != 0) {
+            close();
+            return false;
+        }
+        size_ = kHeaderSize;
+    } else if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SessionJournal::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    sync();
+    ::close(fd_);
+    fd_ = -1;
+    pending_.clear();
+}
+
+void SessionJournal::append(const std::string& payload) {
+    put_u32(pending_, static_cast<uint32_t>(payload.size()));
+    put_u32(pending_, checksum_crc32(payload.data(), payload.size()));
+    pending_.append(payload);
+}
+
+bool SessionJournal::sync() {
+    if (fd_ < 0) {
+        return false;
+    }
+    if (pending_.empty()) {
+        return true;
+    }
+
+    if (!write_all(pending_) || fdatasync(fd_) != 0) {
+        // Cut whatever part made it out; the batch stays buffered for the next sync
+        if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            size_ = read_file(path_, nullptr);
+        }
+        return false;
+    }
+    size_ += pending_.size();
+    pending_.clear();
+    ++sync_count_;
+    return true;
+}
+
+bool SessionJournal::rotate() {
+    if (fd_ < 0 || sealed_ || !sync()) {
+        return false;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+    if (std::rename(path_.c_str(), sealed_path().c_str()) != 0) {
+        return open_live();
+    }
+    sealed_ = true;
+
+    bool ok = open_live();
+    sync_directory();
+    return ok;
+}
+
+void SessionJournal::discard_sealed() {
+    std::error_code ec;
+    std::filesystem::remove(sealed_path(), ec);
+    sealed_ = false;
+}
+
+bool SessionJournal::reset() {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    discard_sealed();
+    pending_.clear();
+    if (size_ == kHeaderSize) {
+        return true;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(kHeaderSize)) != 0) {
+        return false;
+    }
+    size_ = kHeaderSize;
+    return true;
+}
+
+bool SessionJournal::read_all(std::vector<std::string>& records) const {
+    if (fd_ < 0) {
+        return false;
+    }
+    read_file(sealed_path(), &records);
+    read_file(path_, &records);
+    return true;
+}
+
+bool SessionJournal::write_all(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd_, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    bytes_written_ += data.size();
+    return true;
+}
+
+void SessionJournal::sync_directory() const {
+    // Make the rename itself durable
+    std::string dir = std::filesystem::path(path_).parent_path().string();
+    int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
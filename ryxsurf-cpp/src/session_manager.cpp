@@ -11,12 +11,10 @@ SessionManager::~SessionManager() = default;
 
 void SessionManager::ensure_default_workspace() {
     if (workspaces_.empty()) {
-        auto workspace = std::make_unique<Workspace>("Main");
-        workspaces_.push_back(std::move(workspace));
+        Workspace* ws = add_workspace("Main");
         current_workspace_index_ = 0;
         
         // Create default session "Overview" in the workspace
-        Workspace* ws = workspaces_[0].get();
         Session* session = ws->add_session("Overview");
         session->set_overview(true);
     }
@@ -25,7 +23,9 @@ void SessionManager::ensure_default_workspace() {
 Workspace* SessionManager::add_workspace(const std::string& name) {
     auto workspace = std::make_unique<Workspace>(name);
     Workspace* workspace_ptr = workspace.get();
+    workspace_ptr->set_session_manager(this);
     workspaces_.push_back(std::move(workspace));
+    notify_workspace(SessionEventType::WorkspaceAdded, workspace_ptr, workspaces_.size() - 1);
     return workspace_ptr;
 }
 
@@ -61,8 +61,18 @@ Tab* SessionManager::get_current_tab() {
 }
 
 void SessionManager::switch_workspace(size_t index) {
-    if (index < workspaces_.size()) {
-        current_workspace_index_ = index;
+    if (index >= workspaces_.size()) {
+        return;
+    }
+    
+    Workspace* ws = workspaces_[index].get();
+    if (!ws->is_loaded() && workspace_loader_ && !workspace_loader_(ws)) {
+        return;
+    }
+    bool changed = index != current_workspace_index_;
+    current_workspace_index_ = index;
+    if (changed) {
+        notify_workspace(SessionEventType::WorkspaceActivated, ws, index);
     }
 }
 
@@ -159,9 +169,29 @@ void SessionManager::previous_session() {
 }
 
 void SessionManager::reset(bool create_default) {
+    for (const auto& ws : workspaces_) {
+        if (ws->get_row_id() != 0) {
+            removed_workspace_ids_.push_back(ws->get_row_id());
+        }
+    }
+    // Detach first so observers see an empty manager while workspaces are still alive
+    std::vector<std::unique_ptr<Workspace>> removed = std::move(workspaces_);
     workspaces_.clear();
     current_workspace_index_ = 0;
+    for (size_t i = 0; i < removed.size(); ++i) {
+        removed[i]->set_session_manager(nullptr);
+        notify_workspace(SessionEventType::WorkspaceRemoved, removed[i].get(), i);
+    }
+    removed.clear();
     if (create_default) {
         ensure_default_workspace();
     }
 }
+
+void SessionManager::notify_workspace(SessionEventType type, Workspace* workspace, size_t index) {
+    SessionEvent event;
+    event.type = type;
+    event.workspace = workspace;
+    event.index = index;
+    observers_.notify(event);
+}
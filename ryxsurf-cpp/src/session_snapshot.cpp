@@ -0,0 +1,317 @@
+#include "session_snapshot.h"
+#include "session_manager.h"
+#include "session_changes.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'R', 'Y', 'X', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kByteOrder = 0x01020304;
+
+// Every array starts 8-byte aligned because every record size is a multiple of 8
+static_assert(sizeof(SessionSnapshot::Header) % 8 == 0, "Header must keep records aligned");
+static_assert(sizeof(SessionSnapshot::WorkspaceRecord) % 8 == 0, "WorkspaceRecord must keep records aligned");
+static_assert(sizeof(SessionSnapshot::SessionRecord) % 8 == 0, "SessionRecord must keep records aligned");
+static_assert(sizeof(SessionSnapshot::TabRecord) % 8 == 0, "TabRecord must keep records aligned");
+
+int64_t to_unix_seconds(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count();
+}
+
+class StringTable {
+public:
+    SessionSnapshot::StringRef add(const std::string& s) {
+        SessionSnapshot::StringRef ref{static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(s.size())};
+        data_.append(s);
+        return ref;
+    }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+template <typename T>
+void append_records(std::string& out, const std::vector<T>& records) {
+    out.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+bool write_file(const std::string& path, const std::string& data) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+
+    bool ok = fdatasync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+}
+
+}  // namespace
+
+SessionSnapshot::SessionSnapshot()
+    : mapping_(nullptr)
+    , size_(0)
+    , header_(nullptr)
+    , workspaces_(nullptr)
+    , sessions_(nullptr)
+    , tabs_(nullptr)
+    , strings_(nullptr)
+    , strings_size_(0)
+{
+}
+
+SessionSnapshot::~SessionSnapshot() {
+    close();
+}
+
+bool SessionSnapshot::write(const std::string& path, SessionManager* session_manager) {
+    if (!session_manager) {
+        return false;
+    }
+
+    std::vector<WorkspaceRecord> workspaces;
+    std::vector<SessionRecord> sessions;
+    std::vector<TabRecord> tabs;
+    StringTable names;
+    StringTable strings;  // Tab strings, offset by the names once both are known
+
+    for (size_t w = 0; w < session_manager->get_workspace_count(); ++w) {
+        Workspace* ws = session_manager->get_workspace(w);
+        WorkspaceRecord ws_record{};
+        ws_record.id = ws->get_row_id();
+        ws_record.created_at = to_unix_seconds(ws->get_created_at());
+        ws_record.updated_at = to_unix_seconds(ws->get_updated_at());
+        ws_record.name = names.add(ws->get_name());
+        ws_record.first_session = static_cast<uint32_t>(sessions.size());
+        ws_record.session_count = static_cast<uint32_t>(ws->get_session_count());
+        ws_record.active_session = static_cast<uint32_t>(ws->get_active_session_index());
+        ws_record.flags = ws->is_loaded() ? 0 : WORKSPACE_DORMANT;
+        workspaces.push_back(ws_record);
+
+        for (size_t s = 0; s < ws->get_session_count(); ++s) {
+            Session* session = ws->get_session(s);
+            SessionRecord session_record{};
+            session_record.id = session->get_row_id();
+            session_record.created_at = to_unix_seconds(session->get_created_at());
+            session_record.updated_at = to_unix_seconds(session->get_updated_at());
+            session_record.name = names.add(session->get_name());
+            session_record.first_tab = static_cast<uint32_t>(tabs.size());
+            session_record.tab_count = static_cast<uint32_t>(session->get_tab_count());
+            session_record.active_tab = static_cast<uint32_t>(session->get_active_tab_index());
+            session_record.flags = session->is_overview() ? SESSION_OVERVIEW : 0;
+            session_record.tab_strings.offset = static_cast<uint32_t>(strings.data().size());
+
+            for (size_t t = 0; t < session->get_tab_count(); ++t) {
+                Tab* tab = session->get_tab(t);
+                TabRecord tab_record{};
+                tab_record.id = tab->get_row_id();
+                tab_record.last_active = to_unix_seconds(tab->get_last_active_system());
+                tab_record.url = strings.add(tab->get_url());
+                tab_record.title = strings.add(tab->get_title());
+                tab_record.snapshot_path = strings.add(tab->get_snapshot_path());
+                tabs.push_back(tab_record);
+            }
+            session_record.tab_strings.length =
+                static_cast<uint32_t>(strings.data().size() - session_record.tab_strings.offset);
+            sessions.push_back(session_record);
+        }
+    }
+    if (names.data().size() + strings.data().size() > UINT32_MAX) {
+        return false;  // String offsets are 32-bit
+    }
+
+    // Tab strings follow the names; rebase their references and checksum each session
+    const uint32_t names_size = static_cast<uint32_t>(names.data().size());
+    for (auto& tab : tabs) {
+        tab.url.offset += names_size;
+        tab.title.offset += names_size;
+        tab.snapshot_path.offset += names_size;
+    }
+    for (auto& session : sessions) {
+        session.tab_checksum = checksum_crc32(
+            reinterpret_cast<const char*>(tabs.data() + session.first_tab),
+            session.tab_count * sizeof(TabRecord));
+        session.tab_checksum = checksum_crc32(
+            strings.data().data() + session.tab_strings.offset, session.tab_strings.length,
+            session.tab_checksum);
+        session.tab_strings.offset += names_size;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = VERSION;
+    header.byte_order = kByteOrder;
+    header.workspace_count = static_cast<uint32_t>(workspaces.size());
+    header.session_count = static_cast<uint32_t>(sessions.size());
+    header.tab_count = static_cast<uint32_t>(tabs.size());
+    header.workspaces_offset = sizeof(Header);
+    header.sessions_offset = header.workspaces_offset + workspaces.size() * sizeof(WorkspaceRecord);
+    header.tabs_offset = header.sessions_offset + sessions.size() * sizeof(SessionRecord);
+    header.strings_offset = header.tabs_offset + tabs.size() * sizeof(TabRecord);
+    header.names_size = names_size;
+    header.file_size = header.strings_offset + names_size + strings.data().size();
+
+    std::string data(sizeof(Header), '\0');
+    data.reserve(header.file_size);
+    append_records(data, workspaces);
+    append_records(data, sessions);
+    header.checksum = checksum_crc32(data.data() + sizeof(Header), data.size() - sizeof(Header));
+    header.checksum = checksum_crc32(names.data().data(), names_size, header.checksum);
+    append_records(data, tabs);
+    data.append(names.data());
+    data.append(strings.data());
+    std::memcpy(&data[0], &header, sizeof(Header));
+
+    // Readers only ever see the old file or the complete new one
+    std::string tmp_path = path + ".tmp";
+    if (!write_file(tmp_path, data) || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::filesystem::remove(tmp_path);
+        return false;
+    }
+
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    return true;
+}
+
+bool SessionSnapshot::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    mapping_ = mapping;
+
+    if (!validate()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SessionSnapshot::validate() {
+    const char* base = static_cast<const char*>(mapping_);
+    const Header* header = reinterpret_cast<const Header*>(base);
+
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->version != VERSION || header->byte_order != kByteOrder ||
+        header->file_size != size_) {
+        return false;
+    }
+
+    // Arrays must be back to back, in order, and inside the file
+    uint64_t sessions_offset = header->workspaces_offset +
+        static_cast<uint64_t>(header->workspace_count) * sizeof(WorkspaceRecord);
+    uint64_t tabs_offset = sessions_offset +
+        static_cast<uint64_t>(header->session_count) * sizeof(SessionRecord);
+    uint64_t strings_offset = tabs_offset +
+        static_cast<uint64_t>(header->tab_count) * sizeof(TabRecord);
+    if (header->workspaces_offset != sizeof(Header) || header->sessions_offset != sessions_offset ||
+        header->tabs_offset != tabs_offset || header->strings_offset != strings_offset ||
+        strings_offset > size_ || header->names_size > size_ - strings_offset) {
+        return false;
+    }
+
+    // Only the records and names are checked here; tabs are checked per session
+    uint32_t checksum = checksum_crc32(base + sizeof(Header), tabs_offset - sizeof(Header));
+    checksum = checksum_crc32(base + strings_offset, header->names_size, checksum);
+    if (checksum != header->checksum) {
+        return false;
+    }
+
+    const WorkspaceRecord* workspaces = reinterpret_cast<const WorkspaceRecord*>(base + header->workspaces_offset);
+    const SessionRecord* sessions = reinterpret_cast<const SessionRecord*>(base + sessions_offset);
+    for (uint32_t i = 0; i < header->workspace_count; ++i) {
+        if (static_cast<uint64_t>(workspaces[i].first_session) + workspaces[i].session_count > header->session_count) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->session_count; ++i) {
+        if (static_cast<uint64_t>(sessions[i].first_tab) + sessions[i].tab_count > header->tab_count ||
+            static_cast<uint64_t>(sessions[i].tab_strings.offset) + sessions[i].tab_strings.length >
+                size_ - strings_offset) {
+            return false;
+        }
+    }
+
+    header_ = header;
+    workspaces_ = workspaces;
+    sessions_ = sessions;
+    tabs_ = reinterpret_cast<const TabRecord*>(base + tabs_offset);
+    strings_ = base + strings_offset;
+    strings_size_ = size_ - strings_offset;
+    return true;
+}
+
+void SessionSnapshot::close() {
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+    mapping_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    workspaces_ = nullptr;
+    sessions_ = nullptr;
+    tabs_ = nullptr;
+    strings_ = nullptr;
+    strings_size_ = 0;
+}
+
+bool SessionSnapshot::verify_session(size_t index) const {
+    if (!header_ || index >= header_->session_count) {
+        return false;
+    }
+    const SessionRecord& session = sessions_[index];
+    uint32_t checksum = checksum_crc32(reinterpret_cast<const char*>(tabs_ + session.first_tab),
+                                       session.tab_count * sizeof(TabRecord));
+    checksum = checksum_crc32(strings_ + session.tab_strings.offset, session.tab_strings.length, checksum);
+    return checksum == session.tab_checksum;
+}
+
+std::string_view SessionSnapshot::get_string(StringRef ref) const {
+    if (static_cast<uint64_t>(ref.offset) + ref.length > strings_size_) {
+        return {};
+    }
+    return std::string_view(strings_ + ref.offset, ref.length);
+}
@@ -0,0 +1,404 @@
+#include "session_writer.h"
+
+namespace {
+
+// SQL for each SessionWriter::Statement, in enum order
+const char* const kStatementSql[] = {
+    "INSERT INTO workspaces (id, name, created_at, updated_at) VALUES (?, ?, ?, ?) "
+    "ON CONFLICT(id) DO UPDATE SET name = excluded.name, created_at = excluded.created_at, "
+    "updated_at = excluded.updated_at;",
+    "DELETE FROM workspaces WHERE id = ?;",
+    "INSERT INTO sessions (id, workspace_id, name, is_overview, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT(id) DO UPDATE SET workspace_id = excluded.workspace_id, name = excluded.name, "
+    "is_overview = excluded.is_overview, created_at = excluded.created_at, updated_at = excluded.updated_at;",
+    "DELETE FROM sessions WHERE id = ?;",
+    "INSERT INTO tabs (id, session_id, url, title, snapshot_path, last_active, position) VALUES (?, ?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT(id) DO UPDATE SET session_id = excluded.session_id, url = excluded.url, title = excluded.title, "
+    "snapshot_path = excluded.snapshot_path, last_active = excluded.last_active, position = excluded.position;",
+    "DELETE FROM tabs WHERE id = ?;",
+    "INSERT INTO workspace_blobs (workspace_id, data) VALUES (?, ?) "
+    "ON CONFLICT(workspace_id) DO UPDATE SET data = excluded.data;",
+    "DELETE FROM sessions WHERE workspace_id = ?;",
+    "INSERT INTO meta (key, value) VALUES (?, ?) "
+    "ON CONFLICT(key) DO UPDATE SET value = MAX(value, excluded.value);",
+};
+
+}  // namespace
+
+SessionWriter::SessionWriter()
+    : db_(nullptr)
+    , statements_{}
+    , statement_cache_enabled_(true)
+    , statements_prepared_(0)
+    , total_changes_(0)
+    , busy_(false)
+    , stalled_(false)
+    , stop_(false)
+{
+}
+
+SessionWriter::~SessionWriter() {
+    close();
+}
+
+bool SessionWriter::open(const std::string& db_path) {
+    if (db_) {
+        return true;
+    }
+    
+    if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    
+    // Same durability settings as the main connection; wait out its readers
+    sqlite3_busy_timeout(db_, 5000);
+    execute_sql("PRAGMA journal_mode=WAL;");
+    execute_sql("PRAGMA synchronous=NORMAL;");
+    execute_sql("PRAGMA foreign_keys=ON;");
+    
+    if (!prepare_statements()) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    
+    stop_ = false;
+    thread_ = std::thread(&SessionWriter::run, this);
+    return true;
+}
+
+void SessionWriter::close() {
+    if (!db_) {
+        return;
+    }
+    
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    finalize_statements();
+    sqlite3_close(db_);
+    db_ = nullptr;
+}
+
+void SessionWriter::submit(ChangeSet changes, std::function<void()> on_commit, Prepare prepare) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back({std::move(changes), std::move(on_commit), std::move(prepare)});
+        stalled_ = false;
+    }
+    work_cv_.notify_one();
+}
+
+bool SessionWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) {
+        return queue_.empty();
+    }
+    
+    // Give a previously failed change set one more attempt
+    stalled_ = false;
+    work_cv_.notify_one();
+    idle_cv_.wait(lock, [this] { return tasks_.empty() && (queue_.empty() || stalled_) && !busy_; });
+    return queue_.empty();
+}
+
+void SessionWriter::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    work_cv_.notify_one();
+}
+
+void SessionWriter::flush_posted() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) {
+        return;
+    }
+    idle_cv_.wait(lock, [this] { return tasks_.empty() && !busy_; });
+}
+
+void SessionWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_cv_.wait(lock, [this] { return stop_ || !tasks_.empty() || (!queue_.empty() && !stalled_); });
+        if (!tasks_.empty()) {
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop_front();
+            busy_ = true;
+            
+            lock.unlock();
+            task();
+            lock.lock();
+            
+            busy_ = false;
+            idle_cv_.notify_all();
+            continue;
+        }
+        if (queue_.empty() || stalled_) {
+            break;  // Stopping with nothing left that can be written
+        }
+        
+        Pending pending = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        
+        lock.unlock();
+        bool ok = write(pending);
+        if (ok && pending.on_commit) {
+            pending.on_commit();
+        }
+        lock.lock();
+        
+        busy_ = false;
+        if (!ok) {
+            // Keep ordering: retry this set before anything queued after it
+            queue_.push_front(std::move(pending));
+            stalled_ = true;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+bool SessionWriter::write(const Pending& pending) {
+    sqlite3_int64 changes_before = sqlite3_total_changes(db_);
+    
+    if (!execute_sql("BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    
+    // The hook works on a copy, so a retry starts from the set as submitted
+    ChangeSet prepared;
+    if (pending.prepare) {
+        prepared = pending.changes;
+        if (!pending.prepare(db_, prepared)) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    const ChangeSet& changes = pending.prepare ? prepared : pending.changes;
+    
+    // Children of deleted sessions/workspaces go via ON DELETE CASCADE
+    if (!delete_rows(Statement::DeleteTab, changes.deleted_tabs) ||
+        !delete_rows(Statement::DeleteSession, changes.deleted_sessions) ||
+        !delete_rows(Statement::DeleteWorkspace, changes.deleted_workspaces)) {
+        execute_sql("ROLLBACK;");
+        return false;
+    }
+    
+    for (const WorkspaceRow& row : changes.workspaces) {
+        sqlite3_stmt* stmt = acquire(Statement::UpsertWorkspace);
+        if (!stmt) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, row.id);
+        sqlite3_bind_text(stmt, 2, row.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, row.created_at);
+        sqlite3_bind_int64(stmt, 4, row.updated_at);
+        
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        if (rc != SQLITE_DONE) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    
+    // A blob supersedes any plaintext rows the workspace had before encryption
+    for (const WorkspaceBlobRow& row : changes.blobs) {
+        sqlite3_stmt* stmt = acquire(Statement::UpsertWorkspaceBlob);
+        if (!stmt) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, row.workspace_id);
+        sqlite3_bind_blob(stmt, 2, row.data.data(), static_cast<int>(row.data.size()), SQLITE_STATIC);
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        
+        std::vector<int64_t> workspace_id{row.workspace_id};
+        if (rc != SQLITE_DONE || !delete_rows(Statement::DeleteWorkspaceSessions, workspace_id)) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    
+    // The main thread cleared these rows' dirty flags when it collected them,
+    // so a row that fails (a duplicate session name, SQLITE_FULL) fails the
+    // whole set: it stays queued and is retried instead of being dropped
+    for (const SessionRow& row : changes.sessions) {
+        sqlite3_stmt* stmt = acquire(Statement::UpsertSession);
+        if (!stmt) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, row.id);
+        sqlite3_bind_int64(stmt, 2, row.workspace_id);
+        sqlite3_bind_text(stmt, 3, row.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, row.is_overview ? 1 : 0);
+        sqlite3_bind_int64(stmt, 5, row.created_at);
+        sqlite3_bind_int64(stmt, 6, row.updated_at);
+        
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        if (rc != SQLITE_DONE) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    
+    for (const TabRow& row : changes.tabs) {
+        sqlite3_stmt* stmt = acquire(Statement::UpsertTab);
+        if (!stmt) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, row.id);
+        sqlite3_bind_int64(stmt, 2, row.session_id);
+        sqlite3_bind_text(stmt, 3, row.url.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, row.title.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, row.snapshot_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 6, row.last_active);
+        sqlite3_bind_int64(stmt, 7, row.position);
+        
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        if (rc != SQLITE_DONE) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    
+    // Bookkeeping, not session rows: left out of the change count
+    sqlite3_int64 rows_changed = sqlite3_total_changes(db_) - changes_before;
+    const std::pair<const char*, int64_t> marks[] = {
+        {"last_session_id", changes.last_session_id},
+        {"last_tab_id", changes.last_tab_id},
+    };
+    for (const auto& [key, value] : marks) {
+        if (value == 0) {
+            continue;
+        }
+        sqlite3_stmt* stmt = acquire(Statement::UpsertMeta);
+        if (!stmt) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+        sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, value);
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        if (rc != SQLITE_DONE) {
+            execute_sql("ROLLBACK;");
+            return false;
+        }
+    }
+    
+    if (!execute_sql("COMMIT;")) {
+        execute_sql("ROLLBACK;");
+        return false;
+    }
+    
+    total_changes_ += rows_changed;
+    return true;
+}
+
+bool SessionWriter::delete_rows(Statement id, const std::vector<int64_t>& row_ids) {
+    for (int64_t row_id : row_ids) {
+        sqlite3_stmt* stmt = acquire(id);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, row_id);
+        int rc = sqlite3_step(stmt);
+        release(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SessionWriter::execute_sql(const char* sql) {
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg);
+    
+    if (rc != SQLITE_OK) {
+        if (err_msg) {
+            sqlite3_free(err_msg);
+        }
+        return false;
+    }
+    
+    return true;
+}
+
+bool SessionWriter::prepare_statements() {
+    static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) ==
+                  static_cast<size_t>(Statement::Count),
+                  "kStatementSql must cover every Statement");
+    
+    for (size_t i = 0; i < statements_.size(); ++i) {
+        if (statements_[i]) {
+            continue;
+        }
+        if (sqlite3_prepare_v3(db_, kStatementSql[i], -1, SQLITE_PREPARE_PERSISTENT,
+                               &statements_[i], nullptr) != SQLITE_OK) {
+            finalize_statements();
+            return false;
+        }
+        ++statements_prepared_;
+    }
+    return true;
+}
+
+void SessionWriter::finalize_statements() {
+    for (sqlite3_stmt*& stmt : statements_) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+sqlite3_stmt* SessionWriter::acquire(Statement id) {
+    if (!statement_cache_enabled_) {
+        // Uncached path (benchmarks): compile the statement for every use
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, kStatementSql[static_cast<size_t>(id)], -1, &stmt, nullptr) != SQLITE_OK) {
+            return nullptr;
+        }
+        ++statements_prepared_;
+        return stmt;
+    }
+    return statements_[static_cast<size_t>(id)];
+}
+
+void SessionWriter::release(sqlite3_stmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+    if (!statement_cache_enabled_) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    // Leave the cached statement ready for its next use
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
@@ -1,4 +1,6 @@
 #include "tab.h"
+#include "session.h"
+#include "autofill_script.h"
 #include <webkit/webkit.h>
 #include <gtk/gtk.h>
 
@@ -10,6 +12,9 @@ Tab::Tab(const std::string& url)
     , last_active_(std::chrono::steady_clock::now())
     , last_active_system_(std::chrono::system_clock::now())
     , is_unloaded_(false)
+    , row_id_(0)
+    , dirty_(true)
+    , session_(nullptr)
 {
 }
 
@@ -52,8 +57,11 @@ void Tab::create_webview() {
         context_configured = true;
     }
 
-    // Create WebView and apply settings
-    webview_ = WEBKIT_WEB_VIEW(webkit_web_view_new());
+    // Create WebView and apply settings. Every view shares one content
+    // manager, so the autofill script is registered once, not per page.
+    webview_ = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
+        "user-content-manager", AutofillScript::shared().get_content_manager(),
+        nullptr));
     g_object_ref_sink(webview_);
     webkit_web_view_set_settings(webview_, settings);
     g_object_unref(settings);
@@ -118,8 +126,10 @@ void Tab::unload() {
     // Save URL before unloading
     if (webview_) {
         const char* uri = webkit_web_view_get_uri(webview_);
-        if (uri) {
+        if (uri && url_ != uri) {
             url_ = uri;
+            dirty_ = true;
+            notify(SessionEventType::TabNavigated);
         }
     }
 
@@ -142,13 +152,47 @@ void Tab::restore() {
     is_unloaded_ = false;
 }
 
+void Tab::set_url(const std::string& url) {
+    if (url_ != url) {
+        url_ = url;
+        dirty_ = true;
+        notify(SessionEventType::TabNavigated);
+    }
+}
+
+void Tab::set_title(const std::string& title) {
+    if (title_ != title) {
+        title_ = title;
+        dirty_ = true;
+        notify(SessionEventType::TabRetitled);
+    }
+}
+
+void Tab::set_snapshot_path(const std::string& path) {
+    if (snapshot_path_ != path) {
+        snapshot_path_ = path;
+        dirty_ = true;
+    }
+}
+
 void Tab::mark_active() {
     last_active_ = std::chrono::steady_clock::now();
     last_active_system_ = std::chrono::system_clock::now();
+    dirty_ = true;
 }
 
 void Tab::set_last_active_system(std::chrono::system_clock::time_point tp) {
     last_active_system_ = tp;
+    dirty_ = true;
     // Align steady clock to "now" so relative comparisons remain monotonic in runtime
     last_active_ = std::chrono::steady_clock::now();
 }
+
+void Tab::notify(SessionEventType type) {
+    if (session_) {
+        SessionEvent event;
+        event.type = type;
+        event.tab = this;
+        session_->notify(event);
+    }
+}
@@ -1,5 +1,6 @@
 #include "workspace.h"
 #include "session.h"
+#include "session_manager.h"
 #include <algorithm>
 
 Workspace::Workspace(const std::string& name)
@@ -7,6 +8,10 @@ Workspace::Workspace(const std::string& name)
     , active_session_index_(0)
     , created_at_(std::chrono::system_clock::now())
     , updated_at_(std::chrono::system_clock::now())
+    , row_id_(0)
+    , dirty_(true)
+    , loaded_(true)
+    , session_manager_(nullptr)
 {
 }
 
@@ -15,9 +20,13 @@ Workspace::~Workspace() = default;
 Session* Workspace::add_session(const std::string& name) {
     auto session = std::make_unique<Session>(name);
     Session* session_ptr = session.get();
+    session_ptr->set_workspace(this);
     sessions_.push_back(std::move(session));
     active_session_index_ = sessions_.size() - 1;
     mark_updated();
+    
+    notify_session(SessionEventType::SessionAdded, session_ptr, active_session_index_);
+    notify_session(SessionEventType::SessionActivated, session_ptr, active_session_index_);
     return session_ptr;
 }
 
@@ -26,6 +35,13 @@ void Workspace::remove_session(size_t index) {
         return;
     }
     
+    if (sessions_[index]->get_row_id() != 0) {
+        removed_session_ids_.push_back(sessions_[index]->get_row_id());
+    }
+    Session* active_before = get_active_session();
+    // Kept alive until observers have seen the removal
+    std::unique_ptr<Session> removed = std::move(sessions_[index]);
+    removed->set_workspace(nullptr);
     sessions_.erase(sessions_.begin() + index);
     
     // Adjust active session index
@@ -36,6 +52,12 @@ void Workspace::remove_session(size_t index) {
     }
     
     mark_updated();
+    
+    notify_session(SessionEventType::SessionRemoved, removed.get(), index);
+    if (active_before == removed.get() && !sessions_.empty()) {
+        notify_session(SessionEventType::SessionActivated, sessions_[active_session_index_].get(),
+                       active_session_index_);
+    }
 }
 
 Session* Workspace::get_session(size_t index) {
@@ -47,8 +69,12 @@ Session* Workspace::get_session(size_t index) {
 
 void Workspace::set_active_session(size_t index) {
     if (index < sessions_.size()) {
+        bool changed = index != active_session_index_;
         active_session_index_ = index;
         mark_updated();
+        if (changed) {
+            notify_session(SessionEventType::SessionActivated, sessions_[index].get(), index);
+        }
     }
 }
 
@@ -61,4 +87,31 @@ Session* Workspace::get_active_session() {
 
 void Workspace::mark_updated() {
     updated_at_ = std::chrono::system_clock::now();
+    dirty_ = true;
+}
+
+void Workspace::set_loaded(bool loaded) {
+    bool became_loaded = loaded && !loaded_;
+    loaded_ = loaded;
+    if (became_loaded) {
+        SessionEvent event;
+        event.type = SessionEventType::WorkspaceLoaded;
+        notify(event);
+    }
+}
+
+void Workspace::notify(SessionEvent event) {
+    event.workspace = this;
+    observers_.notify(event);
+    if (session_manager_) {
+        session_manager_->notify(event);
+    }
+}
+
+void Workspace::notify_session(SessionEventType type, Session* session, size_t index) {
+    SessionEvent event;
+    event.type = type;
+    event.session = session;
+    event.index = index;
+    notify(event);
 }
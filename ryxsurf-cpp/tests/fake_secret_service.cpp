@@ -0,0 +1,464 @@
+#include "fake_secret_service.h"
+#include <algorithm>
+
+namespace {
+
+const char* const kServicePath = "/org/freedesktop/secrets";
+const char* const kCollectionPath = "/org/freedesktop/secrets/collection/login";
+const char* const kServiceInterface = "org.freedesktop.Secret.Service";
+const char* const kCollectionInterface = "org.freedesktop.Secret.Collection";
+const char* const kItemInterface = "org.freedesktop.Secret.Item";
+const char* const kSessionInterface = "org.freedesktop.Secret.Session";
+
+const char* const kIntrospection = R"(
+<node>
+  <interface name='org.freedesktop.Secret.Service'>
+    <method name='OpenSession'>
+      <arg name='algorithm' type='s' direction='in'/>
+      <arg name='input' type='v' direction='in'/>
+      <arg name='output' type='v' direction='out'/>
+      <arg name='result' type='o' direction='out'/>
+    </method>
+    <method name='SearchItems'>
+      <arg name='attributes' type='a{ss}' direction='in'/>
+      <arg name='unlocked' type='ao' direction='out'/>
+      <arg name='locked' type='ao' direction='out'/>
+    </method>
+    <method name='Unlock'>
+      <arg name='objects' type='ao' direction='in'/>
+      <arg name='unlocked' type='ao' direction='out'/>
+      <arg name='prompt' type='o' direction='out'/>
+    </method>
+    <method name='Lock'>
+      <arg name='objects' type='ao' direction='in'/>
+      <arg name='locked' type='ao' direction='out'/>
+      <arg name='prompt' type='o' direction='out'/>
+    </method>
+    <method name='GetSecrets'>
+      <arg name='items' type='ao' direction='in'/>
+      <arg name='session' type='o' direction='in'/>
+      <arg name='secrets' type='a{o(oayays)}' direction='out'/>
+    </method>
+    <method name='ReadAlias'>
+      <arg name='name' type='s' direction='in'/>
+      <arg name='collection' type='o' direction='out'/>
+    </method>
+    <property name='Collections' type='ao' access='read'/>
+  </interface>
+  <interface name='org.freedesktop.Secret.Collection'>
+    <method name='CreateItem'>
+      <arg name='properties' type='a{sv}' direction='in'/>
+      <arg name='secret' type='(oayays)' direction='in'/>
+      <arg name='replace' type='b' direction='in'/>
+      <arg name='item' type='o' direction='out'/>
+      <arg name='prompt' type='o' direction='out'/>
+    </method>
+    <method name='SearchItems'>
+      <arg name='attributes' type='a{ss}' direction='in'/>
+      <arg name='results' type='ao' direction='out'/>
+    </method>
+    <property name='Items' type='ao' access='read'/>
+    <property name='Label' type='s' access='read'/>
+    <property name='Locked' type='b' access='read'/>
+    <property name='Created' type='t' access='read'/>
+    <property name='Modified' type='t' access='read'/>
+  </interface>
+  <interface name='org.freedesktop.Secret.Item'>
+    <method name='Delete'>
+      <arg name='prompt' type='o' direction='out'/>
+    </method>
+    <method name='GetSecret'>
+      <arg name='session' type='o' direction='in'/>
+      <arg name='secret' type='(oayays)' direction='out'/>
+    </method>
+    <method name='SetSecret'>
+      <arg name='secret' type='(oayays)' direction='in'/>
+    </method>
+    <property name='Locked' type='b' access='read'/>
+    <property name='Attributes' type='a{ss}' access='read'/>
+    <property name='Label' type='s' access='read'/>
+    <property name='Created' type='t' access='read'/>
+    <property name='Modified' type='t' access='read'/>
+  </interface>
+  <interface name='org.freedesktop.Secret.Session'>
+    <method name='Close'/>
+  </interface>
+</node>
+)";
+
+FakeSecretService::Attributes parse_attributes(GVariant* dict) {
+    FakeSecretService::Attributes attributes;
+    GVariantIter iter;
+    const gchar* key;
+    const gchar* value;
+    g_variant_iter_init(&iter, dict);
+    while (g_variant_iter_next(&iter, "{&s&s}", &key, &value)) {
+        attributes[key] = value;
+    }
+    return attributes;
+}
+
+bool matches(const FakeSecretService::Attributes& item, const FakeSecretService::Attributes& wanted) {
+    return std::all_of(wanted.begin(), wanted.end(), [&](const auto& kv) {
+        auto it = item.find(kv.first);
+        return it != item.end() && it->second == kv.second;
+    });
+}
+
+GVariant* bytes_variant(const std::vector<uint8_t>& bytes) {
+    if (bytes.empty()) {
+        return g_variant_new_array(G_VARIANT_TYPE_BYTE, nullptr, 0);
+    }
+    return g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, bytes.data(), bytes.size(), 1);
+}
+
+GVariant* paths_variant(const std::vector<std::string>& paths) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("ao"));
+    for (const auto& path : paths) {
+        g_variant_builder_add(&builder, "o", path.c_str());
+    }
+    return g_variant_builder_end(&builder);
+}
+
+}  // namespace
+
+const GDBusInterfaceVTable* FakeSecretService::vtable() {
+    static const GDBusInterfaceVTable table = {
+        &FakeSecretService::on_method_call_thunk,
+        &FakeSecretService::on_get_property_thunk,
+        nullptr,
+        {nullptr},
+    };
+    return &table;
+}
+
+FakeSecretService::~FakeSecretService() {
+    stop();
+}
+
+bool FakeSecretService::start(const std::string& bus_address) {
+    GError* error = nullptr;
+    connection_ = g_dbus_connection_new_for_address_sync(
+        bus_address.c_str(),
+        static_cast<GDBusConnectionFlags>(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                          G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+        nullptr, nullptr, &error);
+    if (error) {
+        g_error_free(error);
+        return false;
+    }
+
+    introspection_ = g_dbus_node_info_new_for_xml(kIntrospection, nullptr);
+    if (!introspection_ ||
+        !register_object(kServicePath, kServiceInterface) ||
+        !register_object(kCollectionPath, kCollectionInterface)) {
+        return false;
+    }
+
+    // 4 = DBUS_NAME_FLAG_DO_NOT_QUEUE; reply 1 = primary owner
+    GVariant* reply = g_dbus_connection_call_sync(
+        connection_, "org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus",
+        "RequestName", g_variant_new("(su)", "org.freedesktop.secrets", 4u), G_VARIANT_TYPE("(u)"),
+        G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &error);
+    if (error) {
+        g_error_free(error);
+        return false;
+    }
+    guint32 result = 0;
+    g_variant_get(reply, "(u)", &result);
+    g_variant_unref(reply);
+    return result == 1;
+}
+
+void FakeSecretService::stop() {
+    if (!connection_) {
+        return;
+    }
+    for (const auto& item : items_) {
+        g_dbus_connection_unregister_object(connection_, item->registration);
+    }
+    items_.clear();
+    for (guint registration : registrations_) {
+        g_dbus_connection_unregister_object(connection_, registration);
+    }
+    registrations_.clear();
+    if (introspection_) {
+        g_dbus_node_info_unref(introspection_);
+        introspection_ = nullptr;
+    }
+    g_dbus_connection_close_sync(connection_, nullptr, nullptr);
+    g_object_unref(connection_);
+    connection_ = nullptr;
+}
+
+std::optional<std::string> FakeSecretService::find_secret(const Attributes& attributes) const {
+    for (const auto& item : items_) {
+        if (matches(item->attributes, attributes)) {
+            return std::string(item->value.begin(), item->value.end());
+        }
+    }
+    return std::nullopt;
+}
+
+bool FakeSecretService::register_object(const std::string& path, const char* interface_name, guint* registration) {
+    GDBusInterfaceInfo* info = g_dbus_node_info_lookup_interface(introspection_, interface_name);
+    guint id = g_dbus_connection_register_object(connection_, path.c_str(), info, vtable(), this,
+                                                 nullptr, nullptr);
+    if (id == 0) {
+        return false;
+    }
+    if (registration) {
+        *registration = id;
+    } else {
+        registrations_.push_back(id);
+    }
+    return true;
+}
+
+FakeSecretService::Item* FakeSecretService::find_item(const std::string& path) {
+    for (const auto& item : items_) {
+        if (item->path == path) {
+            return item.get();
+        }
+    }
+    return nullptr;
+}
+
+std::vector<FakeSecretService::Item*> FakeSecretService::search(GVariant* attributes) {
+    Attributes wanted = parse_attributes(attributes);
+    std::vector<Item*> found;
+    for (const auto& item : items_) {
+        if (matches(item->attributes, wanted)) {
+            found.push_back(item.get());
+        }
+    }
+    return found;
+}
+
+GVariant* FakeSecretService::secret_variant(const Item& item) const {
+    return g_variant_new("(o@ay@ays)", "/org/freedesktop/secrets/session/1",
+                         bytes_variant({}), bytes_variant(item.value), item.content_type.c_str());
+}
+
+void FakeSecretService::delete_item(Item* item) {
+    g_dbus_connection_unregister_object(connection_, item->registration);
+    items_.erase(std::remove_if(items_.begin(), items_.end(),
+                                [item](const std::unique_ptr<Item>& i) { return i.get() == item; }),
+                 items_.end());
+}
+
+void FakeSecretService::on_method_call_thunk(GDBusConnection*, const gchar*, const gchar* object_path,
+                                             const gchar* interface_name, const gchar* method_name,
+                                             GVariant* parameters, GDBusMethodInvocation* invocation,
+                                             gpointer user_data) {
+    auto* self = static_cast<FakeSecretService*>(user_data);
+    std::string interface(interface_name);
+    ++self->method_calls_;
+
+    if (interface == kServiceInterface) {
+        self->handle_service(method_name, parameters, invocation);
+    } else if (interface == kCollectionInterface) {
+        self->handle_collection(method_name, parameters, invocation);
+    } else if (interface == kItemInterface) {
+        Item* item = self->find_item(object_path);
+        if (!item) {
+            g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.Secret.Error.NoSuchObject",
+                                                       "No such item");
+            return;
+        }
+        self->handle_item(item, method_name, parameters, invocation);
+    } else {
+        // Session.Close
+        g_dbus_method_invocation_return_value(invocation, nullptr);
+    }
+}
+
+void FakeSecretService::handle_service(const std::string& method, GVariant* parameters,
+                                       GDBusMethodInvocation* invocation) {
+    if (method == "OpenSession") {
+        const gchar* algorithm;
+        GVariant* input;
+        g_variant_get(parameters, "(&sv)", &algorithm, &input);
+        g_variant_unref(input);
+        // libsecret tries DH first and falls back to plain on NotSupported
+        if (std::string(algorithm) != "plain") {
+            g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.DBus.Error.NotSupported",
+                                                       "Only plain sessions are supported");
+            return;
+        }
+        std::string path = std::string(kServicePath) + "/session/" + std::to_string(next_session_++);
+        register_object(path, kSessionInterface);
+        g_dbus_method_invocation_return_value(invocation,
+                                              g_variant_new("(vo)", g_variant_new_string(""), path.c_str()));
+    } else if (method == "SearchItems") {
+        GVariant* attributes = g_variant_get_child_value(parameters, 0);
+        std::vector<std::string> unlocked;
+        for (Item* item : search(attributes)) {
+            unlocked.push_back(item->path);
+        }
+        g_variant_unref(attributes);
+        g_dbus_method_invocation_return_value(invocation,
+                                              g_variant_new("(@ao@ao)", paths_variant(unlocked), paths_variant({})));
+    } else if (method == "Unlock" || method == "Lock") {
+        // Nothing is ever locked; report every object as done, no prompt
+        GVariant* objects = g_variant_get_child_value(parameters, 0);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@aoo)", objects, "/"));
+        g_variant_unref(objects);
+    } else if (method == "GetSecrets") {
+        GVariant* paths = g_variant_get_child_value(parameters, 0);
+        GVariantBuilder builder;
+        g_variant_builder_init(&builder, G_VARIANT_TYPE("a{o(oayays)}"));
+        GVariantIter iter;
+        const gchar* path;
+        g_variant_iter_init(&iter, paths);
+        while (g_variant_iter_next(&iter, "&o", &path)) {
+            if (Item* item = find_item(path)) {
+                g_variant_builder_add(&builder, "{o@(oayays)}", path, secret_variant(*item));
+            }
+        }
+        g_variant_unref(paths);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a{o(oayays)})",
+                                                                        g_variant_builder_end(&builder)));
+    } else if (method == "ReadAlias") {
+        const gchar* name;
+        g_variant_get(parameters, "(&s)", &name);
+        const char* path = std::string(name) == "default" ? kCollectionPath : "/";
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(o)", path));
+    } else {
+        g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.DBus.Error.UnknownMethod", method.c_str());
+    }
+}
+
+void FakeSecretService::handle_collection(const std::string& method, GVariant* parameters,
+                                          GDBusMethodInvocation* invocation) {
+    if (method == "CreateItem") {
+        GVariant* properties;
+        GVariant* secret;
+        gboolean replace;
+        g_variant_get(parameters, "(@a{sv}@(oayays)b)", &properties, &secret, &replace);
+
+        Attributes attributes;
+        if (GVariant* dict = g_variant_lookup_value(properties, "org.freedesktop.Secret.Item.Attributes",
+                                                    G_VARIANT_TYPE("a{ss}"))) {
+            attributes = parse_attributes(dict);
+            g_variant_unref(dict);
+        }
+        const gchar* label = "";
+        g_variant_lookup(properties, "org.freedesktop.Secret.Item.Label", "&s", &label);
+
+        Item* item = nullptr;
+        if (replace) {
+            for (const auto& existing : items_) {
+                if (existing->attributes == attributes) {
+                    item = existing.get();
+                    break;
+                }
+            }
+        }
+        if (!item) {
+            auto created = std::make_unique<Item>();
+            created->path = std::string(kCollectionPath) + "/" + std::to_string(next_item_++);
+            created->created = static_cast<uint64_t>(g_get_real_time() / G_USEC_PER_SEC);
+            item = created.get();
+            register_object(item->path, kItemInterface, &item->registration);
+            items_.push_back(std::move(created));
+        }
+        item->attributes = std::move(attributes);
+        item->label = label;
+
+        GVariant* value = g_variant_get_child_value(secret, 2);
+        gsize length = 0;
+        const auto* bytes = static_cast<const uint8_t*>(g_variant_get_fixed_array(value, &length, 1));
+        item->value.assign(bytes, bytes + length);
+        g_variant_unref(value);
+        GVariant* content_type = g_variant_get_child_value(secret, 3);
+        item->content_type = g_variant_get_string(content_type, nullptr);
+        g_variant_unref(content_type);
+
+        std::string path = item->path;
+        g_variant_unref(secret);
+        g_variant_unref(properties);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(oo)", path.c_str(), "/"));
+    } else if (method == "SearchItems") {
+        GVariant* attributes = g_variant_get_child_value(parameters, 0);
+        std::vector<std::string> found;
+        for (Item* item : search(attributes)) {
+            found.push_back(item->path);
+        }
+        g_variant_unref(attributes);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@ao)", paths_variant(found)));
+    } else {
+        g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.DBus.Error.UnknownMethod", method.c_str());
+    }
+}
+
+void FakeSecretService::handle_item(Item* item, const std::string& method, GVariant* parameters,
+                                    GDBusMethodInvocation* invocation) {
+    if (method == "Delete") {
+        delete_item(item);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(o)", "/"));
+    } else if (method == "GetSecret") {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@(oayays))", secret_variant(*item)));
+    } else if (method == "SetSecret") {
+        GVariant* secret = g_variant_get_child_value(parameters, 0);
+        GVariant* value = g_variant_get_child_value(secret, 2);
+        gsize length = 0;
+        const auto* bytes = static_cast<const uint8_t*>(g_variant_get_fixed_array(value, &length, 1));
+        item->value.assign(bytes, bytes + length);
+        g_variant_unref(value);
+        g_variant_unref(secret);
+        g_dbus_method_invocation_return_value(invocation, nullptr);
+    } else {
+        g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.DBus.Error.UnknownMethod", method.c_str());
+    }
+}
+
+GVariant* FakeSecretService::on_get_property_thunk(GDBusConnection*, const gchar*, const gchar* object_path,
+                                                   const gchar* interface_name, const gchar* property_name,
+                                                   GError** error, gpointer user_data) {
+    auto* self = static_cast<FakeSecretService*>(user_data);
+    std::string interface(interface_name);
+    std::string property(property_name);
+
+    if (interface == kServiceInterface) {
+        return paths_variant({kCollectionPath});
+    }
+    if (interface == kCollectionInterface) {
+        if (property == "Items") {
+            std::vector<std::string> paths;
+            for (const auto& item : self->items_) {
+                paths.push_back(item->path);
+            }
+            return paths_variant(paths);
+        }
+        if (property == "Label") {
+            return g_variant_new_string("Login");
+        }
+        if (property == "Locked") {
+            return g_variant_new_boolean(FALSE);
+        }
+        return g_variant_new_uint64(0);
+    }
+
+    Item* item = self->find_item(object_path);
+    if (!item) {
+        g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_OBJECT, "No such item");
+        return nullptr;
+    }
+    if (property == "Attributes") {
+        GVariantBuilder builder;
+        g_variant_builder_init(&builder, G_VARIANT_TYPE("a{ss}"));
+        for (const auto& kv : item->attributes) {
+            g_variant_builder_add(&builder, "{ss}", kv.first.c_str(), kv.second.c_str());
+        }
+        return g_variant_builder_end(&builder);
+    }
+    if (property == "Label") {
+        return g_variant_new_string(item->label.c_str());
+    }
+    if (property == "Locked") {
+        return g_variant_new_boolean(FALSE);
+    }
+    return g_variant_new_uint64(item->created);
+}
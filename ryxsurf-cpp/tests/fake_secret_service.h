@@ -0,0 +1,74 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * FakeSecretService is a stand-in for gnome-keyring: just enough of the
+ * org.freedesktop.secrets D-Bus API (plain sessions, one always-unlocked
+ * "login" collection) for libsecret's password store/lookup/clear/search
+ * calls. It runs on its own connection to a private test bus and answers
+ * from the thread-default main context, so callers must iterate it.
+ */
+class FakeSecretService {
+public:
+    using Attributes = std::map<std::string, std::string>;
+
+    FakeSecretService() = default;
+    ~FakeSecretService();
+
+    FakeSecretService(const FakeSecretService&) = delete;
+    FakeSecretService& operator=(const FakeSecretService&) = delete;
+
+    // Connects to `bus_address` and claims org.freedesktop.secrets
+    bool start(const std::string& bus_address);
+    void stop();
+
+    size_t item_count() const { return items_.size(); }
+    // Secret of the first item whose attributes include all of `attributes`
+    std::optional<std::string> find_secret(const Attributes& attributes) const;
+    // Method calls received so far (property reads excluded)
+    uint64_t method_calls() const { return method_calls_; }
+
+private:
+    struct Item {
+        std::string path;
+        Attributes attributes;
+        std::string label;
+        std::vector<uint8_t> value;
+        std::string content_type;
+        uint64_t created = 0;
+        guint registration = 0;
+    };
+
+    static const GDBusInterfaceVTable* vtable();
+    static void on_method_call_thunk(GDBusConnection* connection, const gchar* sender, const gchar* object_path,
+                                     const gchar* interface_name, const gchar* method_name, GVariant* parameters,
+                                     GDBusMethodInvocation* invocation, gpointer user_data);
+    static GVariant* on_get_property_thunk(GDBusConnection* connection, const gchar* sender,
+                                           const gchar* object_path, const gchar* interface_name,
+                                           const gchar* property_name, GError** error, gpointer user_data);
+
+    void handle_service(const std::string& method, GVariant* parameters, GDBusMethodInvocation* invocation);
+    void handle_collection(const std::string& method, GVariant* parameters, GDBusMethodInvocation* invocation);
+    void handle_item(Item* item, const std::string& method, GVariant* parameters, GDBusMethodInvocation* invocation);
+
+    bool register_object(const std::string& path, const char* interface_name, guint* registration = nullptr);
+    Item* find_item(const std::string& path);
+    std::vector<Item*> search(GVariant* attributes);
+    GVariant* secret_variant(const Item& item) const;
+    void delete_item(Item* item);
+
+    GDBusConnection* connection_ = nullptr;
+    GDBusNodeInfo* introspection_ = nullptr;
+    std::vector<guint> registrations_;
+    std::vector<std::unique_ptr<Item>> items_;
+    uint64_t next_item_ = 1;
+    uint64_t next_session_ = 1;
+    uint64_t method_calls_ = 0;
+};
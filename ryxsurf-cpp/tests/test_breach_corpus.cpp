@@ -0,0 +1,218 @@
+#include <catch2/catch.hpp>
+#include "../include/breach_corpus.h"
+#include "../include/password_manager.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+using Hash = std::array<unsigned char, BreachCorpus::HASH_SIZE>;
+
+Hash hash_of(const std::string& password) {
+    Hash hash;
+    BreachCorpus::sha1(password, hash.data());
+    return hash;
+}
+
+std::string hex_of(const Hash& hash) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string hex;
+    for (unsigned char byte : hash) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 15];
+    }
+    return hex;
+}
+
+void write_corpus(const std::string& path, std::vector<Hash> hashes) {
+    std::sort(hashes.begin(), hashes.end());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (const Hash& hash : hashes) {
+        out.write(reinterpret_cast<const char*>(hash.data()), hash.size());
+    }
+}
+
+void remove_corpus(const std::string& path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".bloom");
+}
+
+}  // namespace
+
+TEST_CASE("BreachCorpus hashes with SHA-1", "[breach]") {
+    REQUIRE(hex_of(hash_of("password")) == "5BAA61E4C9B93F3F0682250B6CF8331B7EE68FD8");
+    REQUIRE(hex_of(hash_of("")) == "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709");
+}
+
+TEST_CASE("BreachCorpus converts HIBP text", "[breach]") {
+    std::vector<std::string> lines = {
+        hex_of(hash_of("password")) + ":10434004",
+        hex_of(hash_of("123456")) + ":37359195",
+        hex_of(hash_of("letmein")) + ":1",
+    };
+    std::sort(lines.begin(), lines.end());
+    std::string text;
+    for (const std::string& line : lines) {
+        text += line + "\r\n";
+    }
+    std::string lower = lines[0];
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    text = lower + "\r\n" + text;  // A duplicate in lowercase is dropped
+
+    std::string path = "/tmp/test_ryxsurf_breach_text.sha1";
+    remove_corpus(path);
+    {
+        std::istringstream in(text);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        size_t count = 0;
+        REQUIRE(BreachCorpus::convert_hibp_text(in, out, &count));
+        REQUIRE(count == 3);
+    }
+
+    BreachCorpus corpus;
+    REQUIRE(corpus.open(path));
+    REQUIRE(corpus.size() == 3);
+    REQUIRE_FALSE(corpus.has_bloom_filter());
+    REQUIRE(corpus.contains("password"));
+    REQUIRE(corpus.contains("letmein"));
+    REQUIRE_FALSE(corpus.contains("Password"));
+    REQUIRE_FALSE(corpus.contains(""));
+    corpus.close();
+    remove_corpus(path);
+
+    SECTION("Out of order") {
+        std::istringstream in(lines[2] + "\n" + lines[0] + "\n");
+        std::ostringstream out;
+        REQUIRE_FALSE(BreachCorpus::convert_hibp_text(in, out));
+    }
+    SECTION("Malformed") {
+        std::istringstream in("5BAA61E4C9B93F3F0682250B6CF8331B7EE68FDX:1\n");
+        std::ostringstream out;
+        REQUIRE_FALSE(BreachCorpus::convert_hibp_text(in, out));
+    }
+}
+
+TEST_CASE("BreachCorpus lookups with and without a Bloom filter", "[breach]") {
+    std::string path = "/tmp/test_ryxsurf_breach.sha1";
+    remove_corpus(path);
+
+    std::mt19937_64 rng(42);
+    std::vector<Hash> hashes(200000);
+    for (Hash& hash : hashes) {
+        for (unsigned char& byte : hash) {
+            byte = static_cast<unsigned char>(rng());
+        }
+    }
+    hashes.push_back(hash_of("hunter2"));
+    // A run of equal prefixes, where interpolation cannot help
+    for (int i = 0; i < 500; ++i) {
+        Hash hash{};
+        hash.fill(0x77);
+        hash[19] = static_cast<unsigned char>(i);
+        hash[18] = static_cast<unsigned char>(i >> 8);
+        hashes.push_back(hash);
+    }
+    write_corpus(path, hashes);
+
+    auto check = [&](const BreachCorpus& corpus) {
+        for (size_t i = 0; i < hashes.size(); i += 97) {
+            REQUIRE(corpus.contains_hash(hashes[i].data()));
+            Hash absent = hashes[i];
+            absent[19] ^= 0x01;
+            absent[7] ^= 0x80;
+            REQUIRE_FALSE(corpus.contains_hash(absent.data()));
+        }
+        REQUIRE(corpus.contains("hunter2"));
+        REQUIRE_FALSE(corpus.contains("hunter3"));
+        Hash smallest{};
+        Hash largest;
+        largest.fill(0xFF);
+        REQUIRE_FALSE(corpus.contains_hash(smallest.data()));
+        REQUIRE_FALSE(corpus.contains_hash(largest.data()));
+    };
+
+    BreachCorpus corpus;
+    REQUIRE(corpus.open(path));
+    REQUIRE(corpus.size() == hashes.size());
+    check(corpus);
+
+    REQUIRE(BreachCorpus::build_bloom_filter(path));
+    REQUIRE(corpus.open(path));
+    REQUIRE(corpus.has_bloom_filter());
+    check(corpus);
+
+    // Bloom false positives still go to the corpus, so answers stay exact
+    size_t hits = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Hash probe;
+        for (unsigned char& byte : probe) {
+            byte = static_cast<unsigned char>(rng());
+        }
+        hits += corpus.contains_hash(probe.data());
+    }
+    REQUIRE(hits == 0);
+
+    // A filter built for another corpus is ignored
+    hashes.resize(1000);
+    write_corpus(path, hashes);
+    REQUIRE(corpus.open(path));
+    REQUIRE_FALSE(corpus.has_bloom_filter());
+    REQUIRE(corpus.contains_hash(hashes[500].data()));
+
+    corpus.close();
+    remove_corpus(path);
+}
+
+TEST_CASE("BreachCorpus rejects a truncated corpus", "[breach]") {
+    std::string path = "/tmp/test_ryxsurf_breach_truncated.sha1";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not twenty bytes";
+    }
+    BreachCorpus corpus;
+    REQUIRE_FALSE(corpus.open(path));
+    REQUIRE_FALSE(corpus.open("/tmp/test_ryxsurf_breach_missing.sha1"));
+    remove_corpus(path);
+}
+
+TEST_CASE("PasswordManager flags breached passwords", "[breach][password]") {
+    std::string path = "/tmp/test_ryxsurf_breach_pm.sha1";
+    remove_corpus(path);
+    write_corpus(path, {hash_of("password"), hash_of("123456"), hash_of("qwerty")});
+    BreachCorpus corpus;
+    REQUIRE(corpus.open(path));
+
+    PasswordManager pm;
+    REQUIRE(pm.initialize("test_master_password"));
+    REQUIRE_FALSE(pm.is_breached("password"));  // No corpus yet
+    pm.set_breach_corpus(&corpus);
+    REQUIRE(pm.is_breached("password"));
+    REQUIRE_FALSE(pm.is_breached("c0rrect-h0rse"));
+
+    REQUIRE(pm.save("example.com", "alice", "password"));
+    REQUIRE(pm.save("example.com", "bob", "c0rrect-h0rse"));
+    REQUIRE(pm.save("mail.example.org", "alice", "qwerty"));
+    for (int i = 0; i < 300; ++i) {
+        REQUIRE(pm.save("site" + std::to_string(i) + ".example", "user", "unique-" + std::to_string(i)));
+    }
+
+    auto breached = pm.find_breached();
+    REQUIRE(breached.size() == 2);
+    REQUIRE(breached[0].domain == "example.com");
+    REQUIRE(breached[0].username == "alice");
+    REQUIRE(breached[0].password.empty());
+    REQUIRE(breached[1].domain == "mail.example.org");
+
+    REQUIRE_FALSE(pm.is_breached(pm.generate_password()));
+
+    pm.set_breach_corpus(nullptr);
+    REQUIRE(pm.find_breached().empty());
+    pm.close();
+    corpus.close();
+    remove_corpus(path);
+}
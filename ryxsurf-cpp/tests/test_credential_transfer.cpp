@@ -0,0 +1,271 @@
+#include <catch2/catch.hpp>
+#include "../include/credential_transfer.h"
+#include "../include/password_manager.h"
+#include <sqlite3.h>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+static std::vector<Credential> read_all(CredentialReader& reader) {
+    std::vector<Credential> credentials;
+    Credential cred;
+    while (reader.next(cred)) {
+        credentials.push_back(cred);
+    }
+    return credentials;
+}
+
+TEST_CASE("CredentialReader parses Chromium CSV", "[transfer]") {
+    std::istringstream in(
+        "\xEF\xBB\xBFname,url,username,password,note\r\n"
+        "example.com,https://example.com/login,alice,\"p,a\"\"ss\",\r\n"
+        "Mail,https://Mail.Example.org:8443/,bob,\"multi\nline\",\"a note\"\r\n"
+        "\r\n"
+        "app,android://hash@com.example.app/,carol,secret,\r\n"
+        "federated,https://sso.example.net/,dave,,\r\n"
+        "last,https://last.example/,erin,no-newline-at-end");
+    CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+
+    auto creds = read_all(reader);
+    REQUIRE_FALSE(reader.failed());
+    REQUIRE(creds.size() == 3);
+    REQUIRE(creds[0].domain == "example.com");
+    REQUIRE(creds[0].username == "alice");
+    REQUIRE(creds[0].password == "p,a\"ss");
+    REQUIRE(creds[1].domain == "mail.example.org");
+    REQUIRE(creds[1].password == "multi\nline");
+    REQUIRE(creds[2].password == "no-newline-at-end");
+    REQUIRE(reader.skipped() == 2);  // Android app, no password
+}
+
+TEST_CASE("CredentialReader keeps Firefox timestamps", "[transfer]") {
+    std::istringstream in(
+        "\"url\",\"username\",\"password\",\"httpRealm\",\"formActionOrigin\",\"guid\","
+        "\"timeCreated\",\"timeLastUsed\",\"timePasswordChanged\"\n"
+        "\"https://example.com\",\"alice\",\"pw\",,\"https://example.com\",\"{1}\","
+        "\"1600000000000\",\"1700000000000\",\"1650000000000\"\n");
+    CredentialReader reader(in, CredentialFormat::FirefoxCsv);
+
+    auto creds = read_all(reader);
+    REQUIRE(creds.size() == 1);
+    REQUIRE(std::chrono::system_clock::to_time_t(creds[0].created) == 1600000000);
+    REQUIRE(std::chrono::system_clock::to_time_t(creds[0].last_used) == 1700000000);
+}
+
+TEST_CASE("CredentialReader parses Bitwarden JSON", "[transfer]") {
+    std::istringstream in(R"({
+        "encrypted": false,
+        "folders": [{"id": "f1", "name": "Work"}],
+        "items": [
+            {"id": "1", "type": 1, "name": "Example", "fields": [{"name": "pin", "value": "{]"}],
+             "login": {"uris": [{"match": null, "uri": "androidapp://com.example"},
+                                {"match": null, "uri": "https://www.example.com/"}],
+                       "username": "café", "password": "🔑 \"key\"\\", "totp": null}},
+            {"id": "2", "type": 2, "name": "A note", "notes": "not a login", "secureNote": {"type": 0}},
+            {"id": "3", "type": 1, "login": {"uris": null, "username": "nouri", "password": "pw"}},
+            {"id": "4", "type": 1, "login": {"uris": [{"uri": "example.org"}], "username": null, "password": "pw4"}}
+        ]
+    })");
+    CredentialReader reader(in, CredentialFormat::BitwardenJson);
+
+    auto creds = read_all(reader);
+    REQUIRE_FALSE(reader.failed());
+    REQUIRE(creds.size() == 2);
+    REQUIRE(creds[0].domain == "www.example.com");
+    REQUIRE(creds[0].username == "caf\xC3\xA9");
+    REQUIRE(creds[0].password == "\xF0\x9F\x94\x91 \"key\"\\");
+    REQUIRE(creds[1].domain == "example.org");
+    REQUIRE(creds[1].username.empty());
+    REQUIRE(reader.skipped() == 2);  // The note, and the login without a URI
+}
+
+TEST_CASE("CredentialReader reports malformed input", "[transfer]") {
+    SECTION("Unterminated CSV quote") {
+        std::istringstream in("url,username,password\nhttps://a.example/,u,\"open\n");
+        CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+        read_all(reader);
+        REQUIRE(reader.failed());
+    }
+    SECTION("Missing CSV columns") {
+        std::istringstream in("name,login\nx,y\n");
+        CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+        Credential cred;
+        REQUIRE_FALSE(reader.next(cred));
+        REQUIRE(reader.failed());
+    }
+    SECTION("Encrypted Bitwarden export") {
+        std::istringstream in(R"({"encrypted": true, "items": []})");
+        CredentialReader reader(in, CredentialFormat::BitwardenJson);
+        read_all(reader);
+        REQUIRE(reader.failed());
+    }
+    SECTION("Truncated JSON") {
+        std::istringstream in(R"({"items": [{"type": 1, "login": {"username": "u")");
+        CredentialReader reader(in, CredentialFormat::BitwardenJson);
+        read_all(reader);
+        REQUIRE(reader.failed());
+    }
+}
+
+TEST_CASE("CredentialReader streams across read blocks", "[transfer]") {
+    // Well past the 64 KiB read block, with quoted fields straddling blocks
+    std::string csv = "name,url,username,password\n";
+    for (int i = 0; i < 5000; ++i) {
+        csv += "s,https://site" + std::to_string(i) + ".example/,\"user, " + std::to_string(i) +
+               "\",\"pass\"\"" + std::to_string(i) + "\"\n";
+    }
+    std::istringstream in(csv);
+    CredentialReader reader(in, CredentialFormat::ChromiumCsv);
+
+    auto creds = read_all(reader);
+    REQUIRE_FALSE(reader.failed());
+    REQUIRE(creds.size() == 5000);
+    REQUIRE(creds[4321].domain == "site4321.example");
+    REQUIRE(creds[4321].username == "user, 4321");
+    REQUIRE(creds[4321].password == "pass\"4321");
+}
+
+TEST_CASE("Encrypted export round-trips", "[transfer]") {
+    auto created = std::chrono::system_clock::from_time_t(1600000000);
+    std::vector<Credential> originals;
+    for (int i = 0; i < 3000; ++i) {
+        originals.push_back(Credential{"site" + std::to_string(i) + ".example", "user\"" + std::to_string(i),
+                                       "pass,\n" + std::to_string(i), created, created});
+    }
+    originals.push_back(Credential{"::1", "admin", "ip", created, created});
+
+    std::stringstream out;
+    EncryptedCredentialWriter writer(out);
+    REQUIRE(writer.begin("export passphrase"));
+    for (const Credential& cred : originals) {
+        REQUIRE(writer.write(cred));
+    }
+    REQUIRE(writer.finish());
+    std::string exported = out.str();
+    REQUIRE(exported.find("pass,") == std::string::npos);
+    REQUIRE(exported.size() > 2 * EncryptedCredentialWriter::FRAME_SIZE);
+
+    SECTION("Correct passphrase") {
+        std::istringstream in(exported);
+        CredentialReader reader(in, "export passphrase");
+        auto creds = read_all(reader);
+        REQUIRE_FALSE(reader.failed());
+        REQUIRE(creds.size() == originals.size());
+        REQUIRE(creds[1234].domain == originals[1234].domain);
+        REQUIRE(creds[1234].username == originals[1234].username);
+        REQUIRE(creds[1234].password == originals[1234].password);
+        REQUIRE(creds[1234].created == created);
+        REQUIRE(creds.back().domain == "::1");
+    }
+    SECTION("Wrong passphrase") {
+        std::istringstream in(exported);
+        CredentialReader reader(in, "wrong");
+        Credential cred;
+        REQUIRE_FALSE(reader.next(cred));
+        REQUIRE(reader.failed());
+    }
+    SECTION("Truncated export") {
+        // Drop the final frame: every record before it still decrypts
+        std::istringstream in(exported.substr(0, exported.size() - 40));
+        CredentialReader reader(in, "export passphrase");
+        read_all(reader);
+        REQUIRE(reader.failed());
+    }
+}
+
+TEST_CASE("PasswordManager bulk import and export", "[transfer][password]") {
+    PasswordManager pm;
+    REQUIRE(pm.initialize("test_master_password"));
+    REQUIRE(pm.save("site7.example", "user7", "old password"));
+
+    // More than one batch
+    size_t count = PasswordManager::IMPORT_BATCH_SIZE * 2 + 17;
+    std::string csv = "\"url\",\"username\",\"password\",\"timeCreated\",\"timeLastUsed\"\n";
+    for (size_t i = 0; i < count; ++i) {
+        csv += "https://site" + std::to_string(i) + ".example/,user" + std::to_string(i) + ",pass" +
+               std::to_string(i) + ",1600000000000," + std::to_string(1600000000000 + i * 1000) + "\n";
+    }
+    csv += "android://x@com.app/,u,p,,\n";
+    std::istringstream in(csv);
+    CredentialReader reader(in, CredentialFormat::FirefoxCsv);
+
+    PasswordManager::ImportStats stats;
+    REQUIRE(pm.import_credentials(reader, &stats));
+    REQUIRE(stats.imported == count);
+    REQUIRE(stats.skipped == 1);
+    REQUIRE(pm.list_domains().size() == count);
+
+    auto cred = pm.get_one("site7.example");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->password == "pass7");  // The import replaced the saved one
+    REQUIRE(std::chrono::system_clock::to_time_t(cred->last_used) == 1600000007);
+
+    SECTION("A read error rolls the import back") {
+        std::istringstream bad("url,username,password\nhttps://new.example/,u,p\nhttps://x.example/,u,\"open\n");
+        CredentialReader bad_reader(bad, CredentialFormat::ChromiumCsv);
+        REQUIRE_FALSE(pm.import_credentials(bad_reader, &stats));
+        REQUIRE(stats.imported == 0);
+        REQUIRE_FALSE(pm.has_credentials("new.example"));
+        REQUIRE(pm.has_credentials("site7.example"));
+    }
+
+    SECTION("Export decrypts everything and re-imports") {
+        std::stringstream exported;
+        EncryptedCredentialWriter writer(exported);
+        REQUIRE(writer.begin("passphrase"));
+        REQUIRE(pm.export_credentials(writer));
+        REQUIRE(writer.written() == count);
+
+        std::istringstream back(exported.str());
+        CredentialReader back_reader(back, "passphrase");
+        auto creds = read_all(back_reader);
+        REQUIRE_FALSE(back_reader.failed());
+        REQUIRE(creds.size() == count);
+        for (const Credential& c : creds) {
+            if (c.domain == "site42.example") {
+                REQUIRE(c.password == "pass42");
+                REQUIRE(std::chrono::system_clock::to_time_t(c.last_used) == 1600000042);
+            }
+        }
+    }
+
+    pm.close();
+}
+
+TEST_CASE("PasswordManager export skips rows that do not decrypt", "[transfer][password]") {
+    std::string db_path = "/tmp/test_ryxsurf_export_skip.db";
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    PasswordManager pm;
+    REQUIRE(pm.initialize("test_master_password"));
+    REQUIRE(pm.save("good.example", "user", "pass-good"));
+    REQUIRE(pm.save("bad.example", "user", "pass-bad"));
+
+    // Damage one ciphertext behind the manager's back
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(db_path.c_str(), &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "UPDATE credentials SET password_encrypted = zeroblob(64) WHERE domain = 'bad.example';",
+                         nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    std::stringstream exported;
+    EncryptedCredentialWriter writer(exported);
+    REQUIRE(writer.begin("passphrase"));
+    PasswordManager::ExportStats stats;
+    REQUIRE(pm.export_credentials(writer, &stats));
+    REQUIRE(stats.exported == 1);
+    REQUIRE(stats.skipped == 1);
+
+    std::istringstream back(exported.str());
+    CredentialReader reader(back, "passphrase");
+    auto creds = read_all(reader);
+    REQUIRE_FALSE(reader.failed());
+    REQUIRE(creds.size() == 1);
+    REQUIRE(creds[0].domain == "good.example");
+    REQUIRE(creds[0].password == "pass-good");
+
+    pm.close();
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    for (const char* suffix : {"", ".salt", "-wal", "-shm"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
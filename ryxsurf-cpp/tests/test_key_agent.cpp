@@ -0,0 +1,395 @@
+#include <catch2/catch.hpp>
+#include "../include/key_agent.h"
+#include "../include/password_manager.h"
+#include "../include/persistence_manager.h"
+#include "../include/session_manager.h"
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Cheapest parameters, so tests do not calibrate or spend 64 MB per unlock
+Crypto::KdfParams fast_params() {
+    Crypto::KdfParams params;
+    params.ops_limit = 1;
+    params.mem_limit = Crypto::MIN_MEM_LIMIT;
+    return params;
+}
+
+void remove_all(const std::string& path) {
+    for (const char* suffix : {"", ".salt", ".journal", "-wal", "-shm"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+}  // namespace
+
+TEST_CASE("KeyAgent unlocks once and checks the password", "[keyagent]") {
+    std::string key_file = temp_path("test_ryxsurf_agent.kdf");
+    std::filesystem::remove(key_file);
+
+    SecureBuffer sessions_key;
+    SecureBuffer passwords_key;
+    {
+        KeyAgent agent(key_file);
+        agent.set_kdf_params(fast_params());
+        REQUIRE_FALSE(agent.is_unlocked());
+        REQUIRE_FALSE(agent.get_key(KeyAgent::Purpose::Sessions, sessions_key));
+
+        REQUIRE(agent.unlock("master"));
+        REQUIRE(std::filesystem::file_size(key_file) == Crypto::KDF_HEADER_SIZE + Crypto::NONCE_SIZE +
+                                                         Crypto::KEY_SIZE + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+        REQUIRE(agent.get_kdf_params() == fast_params());
+        REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, sessions_key));
+        REQUIRE(agent.get_key(KeyAgent::Purpose::Passwords, passwords_key));
+        REQUIRE(sessions_key.size() == Crypto::KEY_SIZE);
+        REQUIRE(sessions_key != passwords_key);
+
+        // Already unlocked: no second derivation, even with another password
+        REQUIRE(agent.unlock("anything"));
+
+        int locks = 0;
+        size_t id = agent.add_lock_listener([&] { ++locks; });
+        agent.lock();
+        agent.lock();
+        REQUIRE(locks == 1);
+        REQUIRE_FALSE(agent.is_unlocked());
+        REQUIRE_FALSE(agent.get_key(KeyAgent::Purpose::Sessions, sessions_key));
+
+        agent.remove_lock_listener(id);
+        REQUIRE_FALSE(agent.unlock("wrong"));
+        REQUIRE(agent.unlock("master"));
+        agent.lock();
+        REQUIRE(locks == 1);
+    }
+
+    // Subkeys depend only on the password and the key file
+    KeyAgent agent(key_file);
+    REQUIRE(agent.unlock("master"));
+    REQUIRE(agent.get_kdf_params() == fast_params());
+    SecureBuffer again;
+    REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, again));
+    REQUIRE(again == sessions_key);
+
+    std::filesystem::remove(key_file);
+}
+
+TEST_CASE("KeyAgent locks when idle", "[keyagent]") {
+    std::string key_file = temp_path("test_ryxsurf_agent_idle.kdf");
+    std::filesystem::remove(key_file);
+    KeyAgent agent(key_file);
+    agent.set_kdf_params(fast_params());
+    REQUIRE(agent.unlock("master"));
+
+    auto now = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(agent.lock_if_idle(now + std::chrono::hours(1)));  // No timeout set
+
+    agent.set_idle_timeout(std::chrono::seconds(60));
+    REQUIRE_FALSE(agent.lock_if_idle(now + std::chrono::seconds(30)));
+    REQUIRE(agent.lock_if_idle(std::chrono::steady_clock::now() + std::chrono::seconds(61)));
+    REQUIRE_FALSE(agent.is_unlocked());
+
+    agent.set_idle_timeout(std::chrono::seconds(0));
+    std::filesystem::remove(key_file);
+}
+
+TEST_CASE("Session and password stores share one unlock", "[keyagent][password][persistence]") {
+    std::string key_file = temp_path("test_ryxsurf_shared.kdf");
+    std::string sessions_db = temp_path("test_ryxsurf_shared_sessions.db");
+    std::string passwords_db = temp_path("test_ryxsurf_shared_passwords.db");
+    std::filesystem::remove(key_file);
+    remove_all(sessions_db);
+    remove_all(passwords_db);
+    setenv("RYXSURF_PASSWORD_DB_PATH", passwords_db.c_str(), 1);
+
+    KeyAgent agent(key_file);
+    agent.set_kdf_params(fast_params());
+    SessionManager sm;
+    PersistenceManager sessions(&sm);
+    sessions.set_key_agent(&agent);
+    sessions.set_db_path_for_tests(sessions_db);
+    PasswordManager passwords;
+    passwords.set_key_agent(&agent);
+
+    REQUIRE(sessions.initialize("master"));
+    REQUIRE(agent.is_unlocked());
+    REQUIRE(passwords.initialize("master"));
+    REQUIRE(sessions.has_master_password());
+    REQUIRE(passwords.has_master_password());
+    // Neither store derived a key of its own
+    REQUIRE_FALSE(std::filesystem::exists(sessions_db + ".salt"));
+    REQUIRE_FALSE(std::filesystem::exists(passwords_db + ".salt"));
+
+    REQUIRE(passwords.save("example.com", "alice", "s3cret"));
+    sm.reset(false);
+    sm.add_workspace("Private")->add_session("S")->add_tab("https://example.com/inbox");
+    REQUIRE(sessions.save_all());
+
+    // Locked: no key to read or write with
+    agent.lock();
+    REQUIRE_FALSE(passwords.save("example.org", "bob", "pw"));
+    REQUIRE(passwords.get("example.com").empty());
+    sm.get_workspace(0)->get_session(0)->add_tab("https://example.com/sent");
+    REQUIRE(sessions.save_all());
+    REQUIRE(sessions.get_last_save_changes() == 0);  // The workspace stays dirty
+
+    // Unlocking again serves both stores without re-initializing them
+    REQUIRE(agent.unlock("master"));
+    REQUIRE(sessions.save_all());
+    REQUIRE(sessions.get_last_save_changes() > 0);
+    auto creds = passwords.get("example.com");
+    REQUIRE(creds.size() == 1);
+    REQUIRE(creds[0].password == "s3cret");
+    passwords.close();
+    sessions.close();
+
+    SessionManager sm2;
+    PersistenceManager reopened(&sm2);
+    reopened.set_key_agent(&agent);
+    reopened.set_db_path_for_tests(sessions_db);
+    REQUIRE(reopened.initialize());
+    REQUIRE(reopened.load_all());
+    sm2.switch_workspace(0);
+    REQUIRE(sm2.get_workspace(0)->get_session(0)->get_tab_count() == 2);
+    reopened.close();
+
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    std::filesystem::remove(key_file);
+    remove_all(sessions_db);
+    remove_all(passwords_db);
+}
+
+TEST_CASE("PasswordManager moves a salted store onto the agent's key", "[keyagent][password]") {
+    std::string key_file = temp_path("test_ryxsurf_migrate.kdf");
+    std::string db_path = temp_path("test_ryxsurf_migrate_passwords.db");
+    std::filesystem::remove(key_file);
+    remove_all(db_path);
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+
+    // set_master_password() opens lazily, so the store survives between
+    // managers (initialize() wipes it in test mode)
+    {
+        PasswordManager pm;
+        pm.set_master_password("master");
+        REQUIRE(pm.save("example.com", "alice", "s3cret"));
+        pm.close();
+    }
+    REQUIRE(std::filesystem::exists(db_path + ".salt"));
+
+    KeyAgent agent(key_file);
+    agent.set_kdf_params(fast_params());
+    {
+        // The old rows do not decrypt, so nothing is rewritten
+        PasswordManager pm;
+        pm.set_key_agent(&agent);
+        pm.set_master_password("wrong");
+        REQUIRE_FALSE(pm.save("new.example", "bob", "pw"));
+    }
+    REQUIRE(std::filesystem::exists(db_path + ".salt"));
+    agent.lock();  // It took "wrong" as a first password; start over
+    std::filesystem::remove(key_file);
+    {
+        PasswordManager pm;
+        pm.set_key_agent(&agent);
+        pm.set_master_password("master");
+        REQUIRE(pm.save("new.example", "bob", "pw"));
+        auto cred = pm.get_one("example.com");
+        REQUIRE(cred.has_value());
+        REQUIRE(cred->password == "s3cret");
+        pm.close();
+    }
+    REQUIRE_FALSE(std::filesystem::exists(db_path + ".salt"));
+    {
+        // From now on the unlocked agent alone opens the store
+        PasswordManager pm;
+        pm.set_key_agent(&agent);
+        pm.set_master_password("master");
+        REQUIRE(pm.save("other.example", "carol", "pw3"));
+        REQUIRE(pm.get("example.com")[0].password == "s3cret");
+        REQUIRE(pm.get("new.example")[0].password == "pw");
+        pm.close();
+    }
+
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    agent.lock();
+    std::filesystem::remove(key_file);
+    remove_all(db_path);
+}
+
+TEST_CASE("A salted store opened through the agent alone waits for a password", "[keyagent][persistence]") {
+    std::string key_file = temp_path("test_ryxsurf_pending.kdf");
+    std::string sessions_db = temp_path("test_ryxsurf_pending_sessions.db");
+    std::string passwords_db = temp_path("test_ryxsurf_pending_passwords.db");
+    std::filesystem::remove(key_file);
+    remove_all(sessions_db);
+    remove_all(passwords_db);
+    setenv("RYXSURF_PASSWORD_DB_PATH", passwords_db.c_str(), 1);
+
+    // Both stores as written before the agent, each under its own salt
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(sessions_db);
+        REQUIRE(pm.initialize("master"));
+        sm.reset(false);
+        sm.add_workspace("Private")->add_session("S")->add_tab("https://example.com/inbox");
+        REQUIRE(pm.save_all());
+        pm.close();
+    }
+    {
+        PasswordManager pm;
+        pm.set_master_password("master");
+        REQUIRE(pm.save("example.com", "alice", "s3cret"));
+        pm.close();
+    }
+
+    // The password store migrates; the session store then opens with the
+    // agent that unlock left behind, and has no password to migrate with
+    KeyAgent agent(key_file);
+    agent.set_kdf_params(fast_params());
+    PasswordManager passwords;
+    passwords.set_key_agent(&agent);
+    passwords.set_master_password("master");
+    REQUIRE(passwords.save("new.example", "bob", "pw"));
+    REQUIRE(passwords.get("example.com")[0].password == "s3cret");
+    REQUIRE_FALSE(std::filesystem::exists(passwords_db + ".salt"));
+
+    SessionManager sm;
+    PersistenceManager sessions(&sm);
+    sessions.set_key_agent(&agent);
+    sessions.set_db_path_for_tests(sessions_db);
+    REQUIRE(sessions.initialize());
+    REQUIRE(std::filesystem::exists(sessions_db + ".salt"));
+    REQUIRE_FALSE(sessions.load_all());  // As if locked: nothing opened with the wrong key
+
+    sessions.set_master_password("master");
+    REQUIRE_FALSE(std::filesystem::exists(sessions_db + ".salt"));
+    REQUIRE(sessions.load_all());
+    REQUIRE(sm.get_workspace(0)->get_session(0)->get_tab(0)->get_url() == "https://example.com/inbox");
+    sessions.close();
+    passwords.close();
+
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    agent.lock();
+    std::filesystem::remove(key_file);
+    remove_all(sessions_db);
+    remove_all(passwords_db);
+}
+
+TEST_CASE("KeyAgent re-seals the key file when KDF parameters change", "[keyagent]") {
+    std::string key_file = temp_path("test_ryxsurf_reseal.kdf");
+    std::filesystem::remove(key_file);
+    auto read_header = [&](Crypto::KdfParams& params) {
+        std::ifstream in(key_file, std::ios::binary);
+        std::vector<unsigned char> header(Crypto::KDF_HEADER_SIZE);
+        in.read(reinterpret_cast<char*>(header.data()), header.size());
+        std::vector<unsigned char> salt;
+        return Crypto::decode_kdf_header(header.data(), header.size(), params, salt);
+    };
+
+    SecureBuffer subkey;
+    {
+        KeyAgent agent(key_file);
+        agent.set_kdf_params(fast_params());
+        REQUIRE(agent.unlock("master"));
+        REQUIRE(agent.get_key(KeyAgent::Purpose::Passwords, subkey));
+    }
+
+    Crypto::KdfParams stronger = fast_params();
+    stronger.ops_limit = 2;
+    stronger.mem_limit = 2 * Crypto::MIN_MEM_LIMIT;
+    {
+        KeyAgent agent(key_file);
+        agent.set_kdf_params(stronger);
+        REQUIRE_FALSE(agent.unlock("wrong"));
+        REQUIRE(agent.unlock("master"));
+        REQUIRE(agent.get_kdf_params() == stronger);
+        // Only the seal changed: data under the subkeys stays readable
+        SecureBuffer again;
+        REQUIRE(agent.get_key(KeyAgent::Purpose::Passwords, again));
+        REQUIRE(again == subkey);
+    }
+    Crypto::KdfParams stored;
+    REQUIRE(read_header(stored));
+    REQUIRE(stored == stronger);
+    REQUIRE_FALSE(std::filesystem::exists(key_file + ".tmp"));
+
+    // Without wanted parameters the file's own are kept
+    KeyAgent agent(key_file);
+    REQUIRE(agent.unlock("master"));
+    REQUIRE(agent.get_kdf_params() == stronger);
+    std::filesystem::remove(key_file);
+}
+
+TEST_CASE("KeyAgent changes the password without changing subkeys", "[keyagent]") {
+    std::string key_file = temp_path("test_ryxsurf_change.kdf");
+    std::filesystem::remove(key_file);
+
+    SecureBuffer subkey;
+    {
+        KeyAgent agent(key_file);
+        agent.set_kdf_params(fast_params());
+        REQUIRE(agent.unlock("old"));
+        REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, subkey));
+
+        REQUIRE_FALSE(agent.change_password("wrong", "new"));
+        REQUIRE_FALSE(agent.change_password("old", ""));
+        REQUIRE(agent.change_password("old", "new"));
+        REQUIRE(agent.is_unlocked());
+        REQUIRE_FALSE(agent.change_password("old", "newer"));
+    }
+
+    // Locked agents can change it too; only the new password unlocks
+    KeyAgent agent(key_file);
+    REQUIRE(agent.change_password("new", "newest"));
+    REQUIRE_FALSE(agent.is_unlocked());
+    REQUIRE_FALSE(agent.unlock("new"));
+    REQUIRE(agent.unlock("newest"));
+    REQUIRE(agent.get_kdf_params() == fast_params());
+    SecureBuffer again;
+    REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, again));
+    REQUIRE(again == subkey);
+
+    agent.lock();
+    std::filesystem::remove(key_file);
+}
+
+TEST_CASE("KeyAgent upgrades a key file from before KDF headers", "[keyagent]") {
+    std::string key_file = temp_path("test_ryxsurf_upgrade.kdf");
+    Crypto::init();
+
+    // Salt, then subkey 0 of the Argon2id output, which was the master key
+    auto [master, salt] = Crypto::derive_key("master");
+    unsigned char check[32];
+    unsigned char old_subkey[Crypto::KEY_SIZE];
+    crypto_kdf_derive_from_key(check, sizeof(check), 0, "RyxSurfK", master.data());
+    crypto_kdf_derive_from_key(old_subkey, sizeof(old_subkey), static_cast<uint64_t>(KeyAgent::Purpose::Sessions),
+                               "RyxSurfK", master.data());
+    {
+        std::ofstream out(key_file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(salt.data()), salt.size());
+        out.write(reinterpret_cast<const char*>(check), sizeof(check));
+    }
+
+    KeyAgent agent(key_file);
+    REQUIRE_FALSE(agent.unlock("wrong"));
+    REQUIRE(std::filesystem::file_size(key_file) == salt.size() + sizeof(check));
+    REQUIRE(agent.unlock("master"));
+    REQUIRE(agent.get_kdf_params() == Crypto::KdfParams());
+    SecureBuffer subkey;
+    REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, subkey));
+    REQUIRE(subkey == SecureBuffer(old_subkey, old_subkey + sizeof(old_subkey)));
+    REQUIRE(std::filesystem::file_size(key_file) > Crypto::KDF_HEADER_SIZE);
+
+    agent.lock();
+    REQUIRE(agent.unlock("master"));
+    SecureBuffer again;
+    REQUIRE(agent.get_key(KeyAgent::Purpose::Sessions, again));
+    REQUIRE(again == subkey);
+    std::filesystem::remove(key_file);
+}
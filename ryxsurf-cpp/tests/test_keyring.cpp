@@ -0,0 +1,146 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+#include "../include/password_manager.h"
+#include "fake_secret_service.h"
+#include <gio/gio.h>
+#include <filesystem>
+#include <functional>
+
+// Keyring tests talk to FakeSecretService over a private D-Bus session bus,
+// never the user's real keyring. Everything runs on the default main context.
+
+static FakeSecretService* g_service = nullptr;
+
+// Iterate the main loop until `done` holds or `seconds` pass; false on timeout
+static bool spin_until(const std::function<bool()>& done, guint seconds = 10) {
+    bool timed_out = false;
+    guint timeout = g_timeout_add_seconds(seconds, [](gpointer data) -> gboolean {
+        *static_cast<bool*>(data) = true;
+        return G_SOURCE_REMOVE;
+    }, &timed_out);
+    while (!done() && !timed_out) {
+        g_main_context_iteration(nullptr, TRUE);
+    }
+    if (!timed_out) {
+        g_source_remove(timeout);
+    }
+    return !timed_out;
+}
+
+TEST_CASE("Keyring is not contacted until first use", "[keyring]") {
+    uint64_t calls = g_service->method_calls();
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+    REQUIRE(g_service->method_calls() == calls);
+
+    std::optional<bool> available;
+    pm.probe_keyring_async([&](bool ok) { available = ok; });
+    REQUIRE(spin_until([&] { return available.has_value(); }));
+    REQUIRE(*available);
+
+    pm.close();
+}
+
+TEST_CASE("Async save, lookup and delete go through the keyring", "[keyring]") {
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+
+    // Issued before the service probe has answered: queued, then run in order
+    std::optional<bool> saved;
+    std::optional<bool> saved_second;
+    pm.save_async("example.com", "alice", "secret-a", [&](bool ok) { saved = ok; });
+    pm.save_async("example.com", "bob", "secret-b", [&](bool ok) { saved_second = ok; });
+    REQUIRE_FALSE(saved.has_value());
+    REQUIRE(spin_until([&] { return saved.has_value() && saved_second.has_value(); }));
+    REQUIRE(*saved);
+    REQUIRE(*saved_second);
+
+    REQUIRE(g_service->find_secret({{"domain", "example.com"}, {"username", "alice"}}) == "secret-a");
+    REQUIRE(g_service->item_count() == 2);
+    // Only metadata goes to SQLite, and the index answers origin checks
+    REQUIRE(pm.should_autofill("https://example.com/login"));
+
+    std::optional<std::optional<Credential>> one;
+    pm.get_one_async("example.com", [&](std::optional<Credential> cred) { one = std::move(cred); });
+    REQUIRE(spin_until([&] { return one.has_value(); }));
+    REQUIRE(one->has_value());
+    REQUIRE((*one)->username == "bob");
+    REQUIRE((*one)->password == "secret-b");
+
+    std::optional<std::vector<Credential>> all;
+    pm.get_async("example.com", [&](std::vector<Credential> creds) { all = std::move(creds); });
+    REQUIRE(spin_until([&] { return all.has_value(); }));
+    REQUIRE(all->size() == 2);
+
+    std::optional<bool> deleted;
+    pm.delete_credential_async("example.com", "bob", [&](bool ok) { deleted = ok; });
+    REQUIRE(spin_until([&] { return deleted.has_value(); }));
+    REQUIRE(*deleted);
+    REQUIRE(g_service->item_count() == 1);
+    REQUIRE_FALSE(g_service->find_secret({{"username", "bob"}}).has_value());
+
+    deleted.reset();
+    pm.delete_credential_async("example.com", "alice", [&](bool ok) { deleted = ok; });
+    REQUIRE(spin_until([&] { return deleted.has_value(); }));
+    REQUIRE(g_service->item_count() == 0);
+    REQUIRE_FALSE(pm.should_autofill("https://example.com/login"));
+
+    pm.close();
+}
+
+TEST_CASE("Callbacks pending at close are dropped", "[keyring]") {
+    bool called = false;
+    {
+        PasswordManager pm;
+        REQUIRE(pm.initialize());
+        pm.save_async("dropped.example", "user", "pass", [&](bool) { called = true; });
+    }
+
+    // Give any completion a chance to (wrongly) arrive
+    spin_until([] { return false; }, 1);
+    REQUIRE_FALSE(called);
+}
+
+int main(int argc, char* argv[]) {
+    // GTestDBus aborts when it cannot spawn a bus; 77 tells meson to skip
+    gchar* daemon = g_find_program_in_path("dbus-daemon");
+    if (!daemon) {
+        return 77;
+    }
+    g_free(daemon);
+
+    // This binary exercises the keyring on purpose, and must not share the
+    // other suite's database
+    g_unsetenv("RYXSURF_FORCE_SQLITE");
+    g_unsetenv("RYXSURF_DISABLE_LIBSECRET");
+    g_unsetenv("CI");
+    gchar* dir = g_dir_make_tmp("ryxsurf-keyring-XXXXXX", nullptr);
+    gchar* db_path = g_build_filename(dir, "passwords.db", nullptr);
+    g_setenv("RYXSURF_PASSWORD_DB_PATH", db_path, TRUE);
+
+    // Sets DBUS_SESSION_BUS_ADDRESS before libsecret connects to anything
+    GTestDBus* bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+
+    int result = 1;
+    {
+        FakeSecretService service;
+        if (service.start(g_test_dbus_get_bus_address(bus))) {
+            g_service = &service;
+            result = Catch::Session().run(argc, argv);
+            g_service = nullptr;
+        }
+    }
+
+    // libsecret caches the service (and with it the bus connection), which
+    // g_test_dbus_down() would otherwise wait on
+    secret_service_disconnect();
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    g_free(db_path);
+    g_free(dir);
+    return result;
+}
@@ -2,6 +2,11 @@
 #include "../include/password_manager.h"
 #include "../include/crypto.h"
 #include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <sqlite3.h>
 
 TEST_CASE("PasswordManager initialization", "[password]") {
     PasswordManager pm;
@@ -82,3 +87,346 @@ TEST_CASE("PasswordManager domain extraction", "[password]") {
     
     pm.close();
 }
+
+TEST_CASE("PasswordManager matches origins by registrable domain", "[password]") {
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+
+    REQUIRE(pm.save("example.co.uk", "user", "pass"));
+    REQUIRE(pm.should_autofill("https://accounts.example.co.uk/signin"));
+    REQUIRE(pm.should_autofill("https://evil@example.co.uk:443/"));
+    REQUIRE_FALSE(pm.should_autofill("https://other.co.uk/"));
+    REQUIRE_FALSE(pm.should_autofill("https://example.co.uk.attacker.test/"));
+
+    // The credential found for a subdomain keeps its stored domain
+    auto cred = pm.get_one("accounts.example.co.uk");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->domain == "example.co.uk");
+    REQUIRE(cred->password == "pass");
+
+    // Hosts on a shared-hosting suffix are separate sites
+    REQUIRE(pm.save("alice.github.io", "alice", "pass-a"));
+    REQUIRE(pm.should_autofill("https://alice.github.io/"));
+    REQUIRE_FALSE(pm.should_autofill("https://bob.github.io/"));
+
+    REQUIRE(pm.save("::1", "admin", "pass-ip"));
+    REQUIRE(pm.should_autofill("https://[::1]:8080/admin"));
+    REQUIRE_FALSE(pm.should_autofill("about:blank"));
+
+    REQUIRE(pm.delete_credential("example.co.uk", "user"));
+    REQUIRE_FALSE(pm.should_autofill("https://accounts.example.co.uk/signin"));
+
+    pm.close();
+}
+
+TEST_CASE("PasswordManager treats domains case-insensitively", "[password]") {
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+
+    // Stored and indexed under the lowercase host
+    REQUIRE(pm.save("Example.COM", "user", "pass"));
+    REQUIRE(pm.has_credentials("example.com"));
+    REQUIRE(pm.should_autofill("https://LOGIN.Example.com/"));
+    REQUIRE(pm.should_autofill("https://EXAMPLE.com/", PasswordManager::AutofillTrigger::PageLoad));
+    auto cred = pm.get_one("EXAMPLE.com");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->domain == "example.com");
+
+    REQUIRE(pm.delete_credential("example.com", "user"));
+    REQUIRE_FALSE(pm.has_credentials("Example.COM"));
+
+    pm.close();
+}
+
+TEST_CASE("PasswordManager index tracks most recently used", "[password]") {
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+    
+    REQUIRE(pm.save("example.com", "user1", "pass1"));
+    REQUIRE(pm.save("example.com", "user2", "pass2"));
+    
+    auto cred = pm.get_one("example.com");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->username == "user2");
+    REQUIRE(cred->password == "pass2");
+    
+    pm.update_last_used("example.com", "user1");
+    cred = pm.get_one("example.com");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->username == "user1");
+    REQUIRE(cred->password == "pass1");
+    
+    // Deleting one username keeps the domain; deleting the last drops it
+    REQUIRE(pm.delete_credential("example.com", "user1"));
+    REQUIRE(pm.should_autofill("https://example.com:8443/login"));
+    REQUIRE(pm.get_one("example.com")->username == "user2");
+    REQUIRE(pm.delete_credential("example.com", "user2"));
+    REQUIRE_FALSE(pm.should_autofill("https://example.com/login"));
+    REQUIRE_FALSE(pm.get_one("example.com").has_value());
+    
+    pm.close();
+}
+
+TEST_CASE("PasswordManager answers autofill requests", "[password]") {
+    using Trigger = PasswordManager::AutofillTrigger;
+    PasswordManager pm;
+    REQUIRE(pm.initialize());
+    REQUIRE(pm.save("example.co.uk", "user1", "pass1"));
+    REQUIRE(pm.save("example.co.uk", "user2", "pass2"));
+    
+    // SQLite answers before autofill() returns
+    auto request = [&pm](const std::string& origin, Trigger trigger) {
+        std::optional<Credential> answer;
+        bool answered = false;
+        pm.autofill(origin, trigger, [&](std::optional<Credential> cred) {
+            answer = std::move(cred);
+            answered = true;
+        });
+        REQUIRE(answered);
+        return answer;
+    };
+    
+    auto cred = request("https://accounts.example.co.uk", Trigger::UserGesture);
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->username == "user2");
+    REQUIRE(cred->password == "pass2");
+    REQUIRE_FALSE(request("https://other.co.uk", Trigger::UserGesture).has_value());
+    
+    // Offers follow the most recently used credential
+    pm.update_last_used("example.co.uk", "user1");
+    REQUIRE(request("https://example.co.uk", Trigger::PageLoad)->username == "user1");
+    
+    // Without a gesture only the exact host is filled; never over http
+    REQUIRE_FALSE(request("https://accounts.example.co.uk", Trigger::PageLoad).has_value());
+    REQUIRE_FALSE(pm.should_autofill("https://accounts.example.co.uk", Trigger::PageLoad));
+    REQUIRE_FALSE(request("http://example.co.uk", Trigger::PageLoad).has_value());
+    REQUIRE_FALSE(request("http://example.co.uk", Trigger::UserGesture).has_value());
+    
+    // A host's own login wins over its site's more recent one on load
+    REQUIRE(pm.save("accounts.example.co.uk", "user3", "pass3"));
+    pm.update_last_used("example.co.uk", "user2");
+    REQUIRE(request("https://accounts.example.co.uk", Trigger::UserGesture)->username == "user2");
+    REQUIRE(request("https://accounts.example.co.uk", Trigger::PageLoad)->username == "user3");
+    
+    pm.set_autofill_enabled(false);
+    REQUIRE_FALSE(request("https://example.co.uk", Trigger::UserGesture).has_value());
+    
+    pm.close();
+}
+
+TEST_CASE("PasswordManager reuses cached statements", "[password]") {
+    std::string db_path = "/tmp/test_ryxsurf_password_cache.db";
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    {
+        PasswordManager pm;
+        REQUIRE(pm.initialize("test_master_password"));
+        
+        size_t prepared = pm.get_statements_prepared();
+        REQUIRE(prepared > 0);
+        
+        for (int i = 0; i < 20; ++i) {
+            std::string domain = "site" + std::to_string(i) + ".example";
+            REQUIRE(pm.save(domain, "user", "pass" + std::to_string(i)));
+            pm.update_last_used(domain, "user");
+            REQUIRE(pm.get_one(domain)->password == "pass" + std::to_string(i));
+            REQUIRE(pm.get(domain).size() == 1);
+        }
+        REQUIRE(pm.delete_credential("site3.example", "user"));
+        REQUIRE_FALSE(pm.has_credentials("site3.example"));
+        
+        // Nothing is compiled after initialize()
+        REQUIRE(pm.get_statements_prepared() == prepared);
+        pm.close();
+    }
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(db_path.c_str(), &db) == SQLITE_OK);
+    sqlite3_stmt* stmt = nullptr;
+    REQUIRE(sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, nullptr) == SQLITE_OK);
+    REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+    REQUIRE(std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))) == "wal");
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    for (const char* suffix : {"", ".salt", "-wal", "-shm"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
+
+TEST_CASE("PasswordManager index reloads from disk", "[password]") {
+    {
+        PasswordManager pm;
+        REQUIRE(pm.initialize());
+        REQUIRE(pm.save("b.example", "user", "pass-b"));
+        REQUIRE(pm.save("a.example", "user", "pass-a"));
+        pm.close();
+        REQUIRE_FALSE(pm.has_credentials("a.example"));
+    }
+    
+    // A fresh instance opens the same database lazily, without initialize()
+    // wiping it in test mode
+    PasswordManager pm;
+    REQUIRE(pm.save("c.example", "user", "pass-c"));
+    REQUIRE(pm.has_credentials("a.example"));
+    REQUIRE(pm.has_credentials("b.example"));
+    REQUIRE(pm.list_domains() == std::vector<std::string>{"a.example", "b.example", "c.example"});
+    
+    auto cred = pm.get_one("a.example");
+    REQUIRE(cred.has_value());
+    REQUIRE(cred->password == "pass-a");
+    
+    pm.close();
+}
+
+TEST_CASE("PasswordManager migrates hex ciphertext to blobs", "[password]") {
+    std::string db_path = "/tmp/ryxsurf-tests/passwords-hex.db";
+    std::filesystem::create_directories("/tmp/ryxsurf-tests");
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + ".salt");
+    
+    // A database as older builds wrote it: hex-encoded TEXT, no user_version
+    std::vector<unsigned char> salt = Crypto::random_bytes(Crypto::SALT_SIZE);
+    {
+        std::ofstream salt_out(db_path + ".salt", std::ios::binary);
+        salt_out.write(reinterpret_cast<const char*>(salt.data()), salt.size());
+    }
+    auto key = Crypto::derive_key("legacy_master", salt).first;
+    std::string plain = "hunter2";
+    auto encrypted = Crypto::encrypt(std::vector<unsigned char>(plain.begin(), plain.end()), key);
+    std::string hex;
+    for (unsigned char byte : encrypted) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", byte);
+        hex += buf;
+    }
+    
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(db_path.c_str(), &db) == SQLITE_OK);
+    std::string sql =
+        "CREATE TABLE credentials (id INTEGER PRIMARY KEY AUTOINCREMENT, domain TEXT NOT NULL, "
+        "username TEXT NOT NULL, password_encrypted BLOB NOT NULL, created INTEGER NOT NULL, "
+        "last_used INTEGER NOT NULL, UNIQUE(domain, username));"
+        "INSERT INTO credentials (domain, username, password_encrypted, created, last_used) "
+        "VALUES ('legacy.example', 'user', '" + hex + "', 1, 1);"
+        "INSERT INTO credentials (domain, username, password_encrypted, created, last_used) "
+        "VALUES ('keyring.example', 'user', '', 1, 1);"
+        "INSERT INTO credentials (domain, username, password_encrypted, created, last_used) "
+        "VALUES ('hexlike.example', 'user', '" + std::string(2 * Crypto::SEALED_OVERHEAD, 'a') + "', 1, 1);";
+    REQUIRE(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+    
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    {
+        PasswordManager pm;
+        pm.set_master_password("legacy_master");
+        // Opens the database lazily (initialize() wipes it in test mode)
+        REQUIRE(pm.save("new.example", "user", "fresh"));
+        
+        auto creds = pm.get("legacy.example");
+        REQUIRE(creds.size() == 1);
+        REQUIRE(creds[0].password == "hunter2");
+        REQUIRE(pm.get("new.example")[0].password == "fresh");
+        pm.close();
+    }
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    
+    REQUIRE(sqlite3_open(db_path.c_str(), &db) == SQLITE_OK);
+    auto query_text = [&](const char* q) {
+        sqlite3_stmt* stmt;
+        REQUIRE(sqlite3_prepare_v2(db, q, -1, &stmt, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        std::string value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        sqlite3_finalize(stmt);
+        return value;
+    };
+    REQUIRE(query_text("PRAGMA user_version;") == std::to_string(PasswordManager::SCHEMA_VERSION));
+    REQUIRE(query_text("SELECT typeof(password_encrypted) FROM credentials WHERE domain = 'legacy.example';") == "blob");
+    REQUIRE(query_text("SELECT length(password_encrypted) FROM credentials WHERE domain = 'legacy.example';") ==
+            std::to_string(encrypted.size()));
+    REQUIRE(query_text("SELECT typeof(password_encrypted) FROM credentials WHERE domain = 'new.example';") == "blob");
+    // Metadata rows for keyring entries are not ciphertext and stay as they were
+    REQUIRE(query_text("SELECT typeof(password_encrypted) FROM credentials WHERE domain = 'keyring.example';") == "text");
+    // Hex-shaped but not sealed with the store's key
+    REQUIRE(query_text("SELECT typeof(password_encrypted) FROM credentials WHERE domain = 'hexlike.example';") == "text");
+    sqlite3_close(db);
+    
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + ".salt");
+}
+
+TEST_CASE("PasswordManager leaves hex passwords of an unencrypted store alone", "[password]") {
+    std::string db_path = "/tmp/ryxsurf-tests/passwords-hex-plain.db";
+    std::filesystem::create_directories("/tmp/ryxsurf-tests");
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + ".salt");
+    
+    // Long enough and hex enough to pass for ciphertext
+    const std::string password(2 * Crypto::SEALED_OVERHEAD + 8, 'f');
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(db_path.c_str(), &db) == SQLITE_OK);
+    std::string sql =
+        "CREATE TABLE credentials (id INTEGER PRIMARY KEY AUTOINCREMENT, domain TEXT NOT NULL, "
+        "username TEXT NOT NULL, password_encrypted BLOB NOT NULL, created INTEGER NOT NULL, "
+        "last_used INTEGER NOT NULL, UNIQUE(domain, username));"
+        "INSERT INTO credentials (domain, username, password_encrypted, created, last_used) "
+        "VALUES ('plain.example', 'user', '" + password + "', 1, 1);";
+    REQUIRE(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+    
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    {
+        PasswordManager pm;
+        REQUIRE(pm.save("new.example", "user", "fresh"));
+        auto creds = pm.get("plain.example");
+        REQUIRE(creds.size() == 1);
+        REQUIRE(creds[0].password == password);
+        pm.close();
+    }
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    
+    std::filesystem::remove(db_path);
+}
+
+TEST_CASE("PasswordManager re-keys every password when the master password changes", "[password]") {
+    std::string db_path = (std::filesystem::temp_directory_path() / "test_ryxsurf_rekey_passwords.db").string();
+    for (const char* suffix : {"", ".salt", "-wal", "-shm"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+    setenv("RYXSURF_PASSWORD_DB_PATH", db_path.c_str(), 1);
+    
+    // set_master_password() opens lazily, so the store survives between managers
+    {
+        PasswordManager pm;
+        pm.set_master_password("old_master");
+        for (int i = 0; i < 300; ++i) {
+            REQUIRE(pm.save("site" + std::to_string(i) + ".example", "user", "pw" + std::to_string(i)));
+        }
+        
+        REQUIRE_FALSE(pm.change_master_password("wrong", "new_master"));
+        REQUIRE_FALSE(pm.change_master_password("old_master", ""));
+        std::vector<size_t> progress;
+        REQUIRE(pm.change_master_password("old_master", "new_master",
+                                          [&](size_t done, size_t total) {
+                                              REQUIRE(total == 300);
+                                              progress.push_back(done);
+                                          }));
+        REQUIRE(progress == std::vector<size_t>{300});
+        REQUIRE(pm.get("site7.example")[0].password == "pw7");
+        REQUIRE(pm.save("late.example", "user", "late"));
+        pm.close();
+    }
+    {
+        PasswordManager pm;
+        pm.set_master_password("new_master");
+        REQUIRE(pm.save("open.example", "user", "opens the store"));
+        REQUIRE(pm.get("site0.example")[0].password == "pw0");
+        REQUIRE(pm.get("site299.example")[0].password == "pw299");
+        REQUIRE(pm.get("late.example")[0].password == "late");
+        pm.close();
+    }
+    
+    unsetenv("RYXSURF_PASSWORD_DB_PATH");
+    for (const char* suffix : {"", ".salt", "-wal", "-shm"}) {
+        std::filesystem::remove(db_path + suffix);
+    }
+}
@@ -2,8 +2,17 @@
 #include "../include/persistence_manager.h"
 #include "../include/session_manager.h"
 #include "../include/crypto.h"
+#include "../include/crypto_stream.h"
+#include "../include/rekey.h"
+#include "../include/secure_memory.h"
+#include "../include/session_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <unistd.h>
 
 TEST_CASE("Crypto key derivation", "[crypto]") {
     Crypto::init();
@@ -34,6 +43,299 @@ TEST_CASE("Crypto encrypt/decrypt", "[crypto]") {
     REQUIRE(decrypted_text == plaintext);
 }
 
+TEST_CASE("Crypto buffer and in-place encrypt/decrypt", "[crypto]") {
+    Crypto::init();
+
+    SecureBuffer key = Crypto::random_key();
+    std::string plaintext = "in-place secret";
+    const auto* bytes = reinterpret_cast<const unsigned char*>(plaintext.data());
+
+    // Into a caller buffer; readable by the vector API
+    std::vector<unsigned char> sealed(Crypto::sealed_size(plaintext.size()));
+    REQUIRE(Crypto::encrypt(bytes, plaintext.size(), key, sealed.data()) == sealed.size());
+    std::vector<unsigned char> decrypted = Crypto::decrypt(sealed, key);
+    REQUIRE(std::string(decrypted.begin(), decrypted.end()) == plaintext);
+
+    // In place: the plaintext sits after the nonce slot and comes back there
+    std::vector<unsigned char> frame(Crypto::sealed_size(plaintext.size()));
+    std::memcpy(frame.data() + Crypto::NONCE_SIZE, bytes, plaintext.size());
+    Crypto::encrypt(frame.data() + Crypto::NONCE_SIZE, plaintext.size(), key, frame.data());
+    REQUIRE(std::memcmp(frame.data() + Crypto::NONCE_SIZE, bytes, plaintext.size()) != 0);
+    size_t size = Crypto::decrypt(frame.data(), frame.size(), key, frame.data() + Crypto::NONCE_SIZE);
+    REQUIRE(size == plaintext.size());
+    REQUIRE(std::memcmp(frame.data() + Crypto::NONCE_SIZE, bytes, size) == 0);
+
+    // Vector output decrypts in place too
+    std::vector<unsigned char> vector_sealed = Crypto::encrypt(
+        std::vector<unsigned char>(plaintext.begin(), plaintext.end()), key);
+    size = Crypto::decrypt(vector_sealed.data(), vector_sealed.size(), key,
+                           vector_sealed.data() + Crypto::NONCE_SIZE);
+    REQUIRE(std::string(reinterpret_cast<const char*>(vector_sealed.data()) + Crypto::NONCE_SIZE, size) == plaintext);
+
+    // Tampered or truncated input throws
+    sealed.back() ^= 1;
+    unsigned char out[64];
+    REQUIRE_THROWS(Crypto::decrypt(sealed.data(), sealed.size(), key, out));
+    REQUIRE_THROWS(Crypto::decrypt(sealed.data(), Crypto::SEALED_OVERHEAD - 1, key, out));
+}
+
+TEST_CASE("Crypto KDF headers", "[crypto]") {
+    Crypto::init();
+    
+    Crypto::KdfParams params;
+    params.ops_limit = 1;
+    params.mem_limit = Crypto::MIN_MEM_LIMIT;
+    std::vector<unsigned char> salt = Crypto::random_bytes(Crypto::SALT_SIZE);
+    std::vector<unsigned char> header = Crypto::encode_kdf_header(params, salt);
+    REQUIRE(header.size() == Crypto::KDF_HEADER_SIZE);
+    
+    Crypto::KdfParams decoded;
+    std::vector<unsigned char> decoded_salt;
+    REQUIRE(Crypto::decode_kdf_header(header.data(), header.size(), decoded, decoded_salt));
+    REQUIRE(decoded == params);
+    REQUIRE(decoded_salt == salt);
+    
+    // The parameters are part of the key
+    REQUIRE(Crypto::derive_key("pw", salt, params).first != Crypto::derive_key("pw", salt).first);
+    
+    // A bare salt means the default parameters
+    REQUIRE(Crypto::decode_kdf_header(salt.data(), salt.size(), decoded, decoded_salt));
+    REQUIRE(decoded == Crypto::KdfParams());
+    
+    // Newer versions and unknown algorithms are refused
+    std::vector<unsigned char> newer = header;
+    newer[4] = 2;
+    REQUIRE_FALSE(Crypto::decode_kdf_header(newer.data(), newer.size(), decoded, decoded_salt));
+    std::vector<unsigned char> other = header;
+    other[5] = 1;
+    REQUIRE_FALSE(Crypto::decode_kdf_header(other.data(), other.size(), decoded, decoded_salt));
+    REQUIRE_FALSE(Crypto::decode_kdf_header(header.data(), header.size() - 1, decoded, decoded_salt));
+}
+
+TEST_CASE("Crypto KDF calibration stays within bounds", "[crypto]") {
+    Crypto::init();
+    
+    const size_t max_mem = 32 * 1024 * 1024;
+    Crypto::KdfParams params = Crypto::calibrate_kdf(std::chrono::milliseconds(50), max_mem);
+    REQUIRE(params.algorithm == crypto_pwhash_argon2id_ALG_ARGON2ID13);
+    REQUIRE(params.ops_limit >= 1);
+    REQUIRE(params.ops_limit <= Crypto::MAX_OPS_LIMIT);
+    REQUIRE(params.mem_limit >= Crypto::MIN_MEM_LIMIT);
+    REQUIRE(params.mem_limit <= max_mem);
+    REQUIRE(params.mem_limit % (1024 * 1024) == 0);
+}
+
+namespace {
+
+CryptoStream::Reader memory_reader(const std::vector<unsigned char>& data, size_t& offset, size_t step = 1000) {
+    offset = 0;
+    return [&data, &offset, step](unsigned char* buffer, size_t size) -> ssize_t {
+        size_t n = std::min({size, step, data.size() - offset});
+        std::memcpy(buffer, data.data() + offset, n);
+        offset += n;
+        return static_cast<ssize_t>(n);
+    };
+}
+
+CryptoStream::Writer memory_writer(std::vector<unsigned char>& data) {
+    return [&data](const unsigned char* bytes, size_t size) {
+        data.insert(data.end(), bytes, bytes + size);
+        return true;
+    };
+}
+
+}  // namespace
+
+TEST_CASE("CryptoStream round trips in chunks", "[crypto]") {
+    Crypto::init();
+    SecureBuffer key = Crypto::random_key();
+    const size_t chunk = 4096;
+
+    for (size_t size : {size_t(0), size_t(1), chunk - 1, chunk, chunk + 1, 3 * chunk + 5}) {
+        std::vector<unsigned char> plaintext = Crypto::random_bytes(size);
+        std::vector<unsigned char> sealed;
+        size_t offset;
+        std::string error;
+        REQUIRE(CryptoStream::encrypt(memory_reader(plaintext, offset), memory_writer(sealed), key, &error, chunk));
+        REQUIRE(sealed.size() == CryptoStream::sealed_size(size, chunk));
+
+        std::vector<unsigned char> opened;
+        REQUIRE(CryptoStream::decrypt(memory_reader(sealed, offset), memory_writer(opened), key, &error));
+        REQUIRE(opened == plaintext);
+    }
+}
+
+TEST_CASE("CryptoStream rejects tampered, truncated and extended streams", "[crypto]") {
+    Crypto::init();
+    SecureBuffer key = Crypto::random_key();
+    const size_t chunk = 1024;
+    std::vector<unsigned char> plaintext = Crypto::random_bytes(4 * chunk + 100);
+    std::vector<unsigned char> sealed;
+    size_t offset;
+    REQUIRE(CryptoStream::encrypt(memory_reader(plaintext, offset), memory_writer(sealed), key, nullptr, chunk));
+
+    auto fails = [&](const std::vector<unsigned char>& input, const SecureBuffer& k) {
+        std::vector<unsigned char> opened;
+        size_t read_offset;
+        std::string error;
+        bool ok = CryptoStream::decrypt(memory_reader(input, read_offset), memory_writer(opened), k, &error);
+        return !ok && !error.empty();
+    };
+
+    REQUIRE(fails(sealed, Crypto::random_key()));
+
+    std::vector<unsigned char> flipped = sealed;
+    flipped[CryptoStream::HEADER_SIZE + 2 * (chunk + CryptoStream::CHUNK_OVERHEAD) + 7] ^= 1;
+    REQUIRE(fails(flipped, key));
+
+    // The chunk size is authenticated
+    std::vector<unsigned char> resized = sealed;
+    resized[8] = 0;
+    resized[9] = 2;
+    REQUIRE(fails(resized, key));
+
+    // Dropping the final chunk, or a whole middle one, is detected
+    std::vector<unsigned char> truncated(sealed.begin(), sealed.end() - (100 + CryptoStream::CHUNK_OVERHEAD));
+    REQUIRE(fails(truncated, key));
+    std::vector<unsigned char> dropped = sealed;
+    auto middle = dropped.begin() + CryptoStream::HEADER_SIZE + (chunk + CryptoStream::CHUNK_OVERHEAD);
+    dropped.erase(middle, middle + (chunk + CryptoStream::CHUNK_OVERHEAD));
+    REQUIRE(fails(dropped, key));
+
+    std::vector<unsigned char> extended = sealed;
+    extended.push_back(0);
+    REQUIRE(fails(extended, key));
+
+    REQUIRE(fails(std::vector<unsigned char>(sealed.begin(), sealed.begin() + 10), key));
+}
+
+TEST_CASE("CryptoStream over file descriptors and GIO streams", "[crypto]") {
+    Crypto::init();
+    SecureBuffer key = Crypto::random_key();
+    std::vector<unsigned char> plaintext = Crypto::random_bytes(3 * CryptoStream::CHUNK_SIZE + 17);
+
+    std::string plain_path = "/tmp/test_ryxsurf_stream.plain";
+    std::string sealed_path = "/tmp/test_ryxsurf_stream.sealed";
+    std::string opened_path = "/tmp/test_ryxsurf_stream.opened";
+    {
+        std::ofstream out(plain_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(plaintext.data()), static_cast<std::streamsize>(plaintext.size()));
+    }
+    int in_fd = ::open(plain_path.c_str(), O_RDONLY);
+    int sealed_fd = ::open(sealed_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    int opened_fd = ::open(opened_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    REQUIRE(CryptoStream::encrypt_fd(in_fd, sealed_fd, key));
+    REQUIRE(std::filesystem::file_size(sealed_path) == CryptoStream::sealed_size(plaintext.size()));
+    REQUIRE(::lseek(sealed_fd, 0, SEEK_SET) == 0);
+    REQUIRE(CryptoStream::decrypt_fd(sealed_fd, opened_fd, key));
+    ::close(in_fd);
+    ::close(sealed_fd);
+    ::close(opened_fd);
+    {
+        std::ifstream in(opened_path, std::ios::binary);
+        std::vector<unsigned char> opened((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        REQUIRE(opened == plaintext);
+    }
+
+    // A bad descriptor reports the errno message
+    std::string error;
+    REQUIRE_FALSE(CryptoStream::encrypt_fd(-1, -1, key, &error));
+    REQUIRE(error.rfind("write failed: ", 0) == 0);
+
+    // The same stream through GIO
+    GInputStream* gin = g_memory_input_stream_new_from_data(plaintext.data(), static_cast<gssize>(plaintext.size()), nullptr);
+    GOutputStream* gsealed = g_memory_output_stream_new_resizable();
+    REQUIRE(CryptoStream::encrypt_gio(gin, gsealed, key));
+    g_output_stream_close(gsealed, nullptr, nullptr);
+    auto* sealed_data = static_cast<unsigned char*>(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(gsealed)));
+    size_t sealed_size = g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(gsealed));
+    REQUIRE(sealed_size == CryptoStream::sealed_size(plaintext.size()));
+
+    GInputStream* gsealed_in = g_memory_input_stream_new_from_data(sealed_data, static_cast<gssize>(sealed_size), nullptr);
+    GOutputStream* gopened = g_memory_output_stream_new_resizable();
+    REQUIRE(CryptoStream::decrypt_gio(gsealed_in, gopened, key));
+    auto* opened_data = static_cast<unsigned char*>(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(gopened)));
+    REQUIRE(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(gopened)) == plaintext.size());
+    REQUIRE(std::memcmp(opened_data, plaintext.data(), plaintext.size()) == 0);
+
+    g_object_unref(gsealed_in);
+    g_object_unref(gopened);
+    g_object_unref(gin);
+    g_object_unref(gsealed);
+    std::filesystem::remove(plain_path);
+    std::filesystem::remove(sealed_path);
+    std::filesystem::remove(opened_path);
+}
+
+TEST_CASE("SecurePool reuses zeroed blocks per size class", "[crypto]") {
+    SecurePool pool;
+
+    auto* a = static_cast<unsigned char*>(pool.allocate(20));
+    auto* b = static_cast<unsigned char*>(pool.allocate(32));
+    REQUIRE(b - a == 32);  // Same 32-byte class, same arena
+    std::memset(a, 0xAB, 20);
+    REQUIRE(pool.get_stats().arenas == 1);
+    REQUIRE(pool.get_stats().blocks_in_use == 2);
+
+    // A freed block comes back zeroed, link included
+    pool.deallocate(a, 20);
+    auto* c = static_cast<unsigned char*>(pool.allocate(25));
+    REQUIRE(c == a);
+    for (size_t i = 0; i < 32; ++i) {
+        REQUIRE(c[i] == 0);
+    }
+
+    // Another size class takes another arena
+    void* d = pool.allocate(100);
+    REQUIRE(pool.get_stats().arenas == 2);
+
+    // Beyond MAX_BLOCK_SIZE: a region of its own
+    void* large = pool.allocate(SecurePool::MAX_BLOCK_SIZE + 1);
+    REQUIRE(pool.get_stats().large_in_use == 1);
+    pool.deallocate(large, SecurePool::MAX_BLOCK_SIZE + 1);
+    REQUIRE(pool.get_stats().large_in_use == 0);
+
+    pool.deallocate(b, 32);
+    pool.deallocate(c, 25);
+    pool.deallocate(d, 100);
+    REQUIRE(pool.get_stats().blocks_in_use == 0);
+}
+
+TEST_CASE("SecureString keeps passwords in the pool", "[crypto]") {
+    size_t in_use = SecurePool::shared().get_stats().blocks_in_use;
+    {
+        SecureString password("hunter2");
+        REQUIRE(password.size() == 7);
+        REQUIRE(std::strcmp(password.c_str(), "hunter2") == 0);
+        REQUIRE(password == "hunter2");
+        REQUIRE(password == std::string("hunter2"));
+        REQUIRE(password != "hunter3");
+        REQUIRE(SecurePool::shared().get_stats().blocks_in_use == in_use + 1);
+
+        SecureString copy = password;
+        REQUIRE(copy == password);
+        SecureString moved = std::move(copy);
+        REQUIRE(moved == "hunter2");
+        REQUIRE(SecurePool::shared().get_stats().blocks_in_use == in_use + 2);
+
+        moved.resize(4);
+        REQUIRE(moved == "hunt");
+        moved.resize(6);
+        REQUIRE(moved.view() == std::string_view("hunt\0\0", 6));
+        moved = "a much longer password than before";
+        REQUIRE(moved.size() == 34);
+
+        moved.clear();
+        REQUIRE(moved.empty());
+        REQUIRE(std::strcmp(moved.c_str(), "") == 0);
+        REQUIRE(SecureString().c_str()[0] == '\0');
+
+        SecureBuffer key = Crypto::random_key();
+        REQUIRE(key.size() == Crypto::KEY_SIZE);
+    }
+    REQUIRE(SecurePool::shared().get_stats().blocks_in_use == in_use);
+}
+
 TEST_CASE("PersistenceManager initialization", "[persistence]") {
     SessionManager sm;
     PersistenceManager pm(&sm);
@@ -88,3 +390,1141 @@ TEST_CASE("PersistenceManager save/load", "[persistence]") {
     std::filesystem::remove(test_db);
     std::filesystem::remove(test_db + ".salt");
 }
+
+TEST_CASE("PersistenceManager incremental save", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_incremental.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    // Build a 2,000 tab profile
+    Workspace* ws = sm.add_workspace("Big");
+    for (int s = 0; s < 20; ++s) {
+        Session* session = ws->add_session("Session " + std::to_string(s));
+        for (int t = 0; t < 100; ++t) {
+            session->add_tab("https://example.com/" + std::to_string(s) + "/" + std::to_string(t));
+        }
+    }
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.get_last_save_changes() > 2000);
+    
+    // Idle autosave writes nothing
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.get_last_save_changes() == 0);
+    
+    // A single navigation touches a single row
+    ws->get_session(3)->get_tab(42)->set_url("https://example.org/navigated");
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.get_last_save_changes() == 1);
+    
+    // Closing a tab deletes its row and renumbers the tabs after it
+    ws->get_session(5)->remove_tab(97);
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.get_last_save_changes() == 4);  // delete + 2 positions + session
+    
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    
+    Workspace* loaded = sm2.get_workspace(0);
+    REQUIRE(loaded != nullptr);
+    REQUIRE(loaded->get_session_count() == 20);
+    REQUIRE(loaded->get_session(3)->get_tab(42)->get_url() == "https://example.org/navigated");
+    REQUIRE(loaded->get_session(5)->get_tab_count() == 99);
+    REQUIRE(loaded->get_session(5)->get_tab(97)->get_url() == "https://example.com/5/98");
+    
+    // Freshly loaded state is clean
+    REQUIRE(pm2.save_all());
+    REQUIRE(pm2.get_last_save_changes() == 0);
+    
+    pm.close();
+    pm2.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager keeps tab order after a move", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_move.db";
+    std::filesystem::remove(test_db);
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize());
+        Session* session = sm.add_workspace("Move")->add_session("S");
+        for (int i = 0; i < 5; ++i) {
+            session->add_tab("https://example.com/" + std::to_string(i));
+        }
+        REQUIRE(pm.save_all());
+        
+        session->move_tab(4, 1);
+        REQUIRE(pm.save_all());
+        REQUIRE(pm.get_last_save_changes() == 5);  // The session and the four tabs that shifted
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize());
+        REQUIRE(pm.load_all());
+        Session* session = sm.get_workspace(0)->get_session(0);
+        const char* expected[] = {"0", "4", "1", "2", "3"};
+        for (size_t i = 0; i < 5; ++i) {
+            REQUIRE(session->get_tab(i)->get_url() == std::string("https://example.com/") + expected[i]);
+        }
+        pm.close();
+    }
+    
+    std::filesystem::remove(test_db);
+    std::filesystem::remove(test_db + ".journal");
+}
+
+TEST_CASE("PersistenceManager reuses prepared statements", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_stmt_cache.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    size_t prepared = pm.get_statements_prepared();
+    REQUIRE(prepared > 0);
+    
+    Session* session = sm.add_workspace("Cache")->add_session("S");
+    for (int i = 0; i < 50; ++i) {
+        session->add_tab("https://example.com/" + std::to_string(i));
+    }
+    REQUIRE(pm.save_all());
+    session->get_tab(7)->set_title("Changed");
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.load_all());
+    
+    // Nothing is compiled after initialize()
+    REQUIRE(pm.get_statements_prepared() == prepared);
+    REQUIRE(sm.get_workspace(0)->get_session(0)->get_tab(7)->get_title() == "Changed");
+    
+    pm.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager migrates an unversioned database", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_migrate.db";
+    std::filesystem::remove(test_db);
+    
+    // A database as written before user_version was tracked
+    {
+        sqlite3* db = nullptr;
+        REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(db, R"(
+            CREATE TABLE workspaces (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE,
+                created_at INTEGER NOT NULL, updated_at INTEGER NOT NULL);
+            CREATE TABLE sessions (id INTEGER PRIMARY KEY AUTOINCREMENT, workspace_id INTEGER NOT NULL,
+                name TEXT NOT NULL, is_overview INTEGER NOT NULL DEFAULT 0, created_at INTEGER NOT NULL,
+                updated_at INTEGER NOT NULL, FOREIGN KEY (workspace_id) REFERENCES workspaces(id) ON DELETE CASCADE,
+                UNIQUE(workspace_id, name));
+            CREATE TABLE tabs (id INTEGER PRIMARY KEY AUTOINCREMENT, session_id INTEGER NOT NULL,
+                url TEXT NOT NULL, title TEXT NOT NULL, snapshot_path TEXT, last_active INTEGER NOT NULL,
+                position INTEGER NOT NULL, FOREIGN KEY (session_id) REFERENCES sessions(id) ON DELETE CASCADE);
+            CREATE INDEX idx_sessions_workspace ON sessions(workspace_id);
+            CREATE INDEX idx_tabs_session ON tabs(session_id);
+            INSERT INTO workspaces VALUES (1, 'Legacy', 0, 0);
+            INSERT INTO sessions VALUES (1, 1, 'S', 0, 0, 0);
+            INSERT INTO tabs VALUES (1, 1, 'https://second.example/', 'Second', '', 0, 1);
+            INSERT INTO tabs VALUES (2, 1, 'https://first.example/', 'First', '', 0, 0);
+        )", nullptr, nullptr, nullptr) == SQLITE_OK);
+        sqlite3_close(db);
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize());
+        REQUIRE(pm.get_schema_version() == PersistenceManager::SCHEMA_VERSION);
+        
+        REQUIRE(pm.load_all());
+        Session* session = sm.get_workspace(0)->get_session(0);
+        REQUIRE(session->get_tab_count() == 2);
+        REQUIRE(session->get_tab(0)->get_title() == "First");
+        REQUIRE(session->get_tab(1)->get_title() == "Second");
+        pm.close();
+    }
+    
+    {
+        sqlite3* db = nullptr;
+        REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+        auto count = [&](const char* sql) {
+            sqlite3_stmt* stmt = nullptr;
+            sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+            sqlite3_step(stmt);
+            int n = sqlite3_column_int(stmt, 0);
+            sqlite3_finalize(stmt);
+            return n;
+        };
+        REQUIRE(count("SELECT COUNT(*) FROM sqlite_master WHERE name = 'idx_tabs_session_position';") == 1);
+        REQUIRE(count("SELECT COUNT(*) FROM sqlite_master WHERE name = 'idx_tabs_session';") == 0);
+        REQUIRE(count("SELECT COUNT(*) FROM sqlite_master WHERE name = 'workspace_blobs';") == 1);
+        
+        // Pretend a newer build has been here
+        REQUIRE(sqlite3_exec(db, "PRAGMA user_version = 99;", nullptr, nullptr, nullptr) == SQLITE_OK);
+        sqlite3_close(db);
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE_FALSE(pm.initialize());
+        pm.close();
+    }
+    
+    std::filesystem::remove(test_db);
+    std::filesystem::remove(test_db + ".journal");
+}
+
+TEST_CASE("PersistenceManager restore queries are served by indexes", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_query_plan.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    std::string all_plans;
+    for (const std::string& plan : pm.get_query_plans_for_tests()) {
+        INFO(plan);
+        REQUIRE_FALSE(plan.empty());
+        REQUIRE(plan.find("TEMP B-TREE") == std::string::npos);
+        // Only the workspace list is read in full
+        size_t scan = plan.find("SCAN");
+        REQUIRE((scan == std::string::npos || plan.find("workspaces", scan) != std::string::npos));
+        all_plans += plan;
+    }
+    REQUIRE(all_plans.find("idx_sessions_workspace") != std::string::npos);
+    REQUIRE(all_plans.find("idx_tabs_session_position") != std::string::npos);
+    
+    pm.close();
+    std::filesystem::remove(test_db);
+    std::filesystem::remove(test_db + ".journal");
+}
+
+TEST_CASE("PersistenceManager bulk restore stitches the tree by id", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_bulk_restore.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    // 200 sessions whose rows interleave between two workspaces
+    Workspace* a = sm.add_workspace("A");
+    Workspace* b = sm.add_workspace("B");
+    for (int i = 0; i < 100; ++i) {
+        for (Workspace* ws : {a, b}) {
+            Session* session = ws->add_session(ws->get_name() + std::to_string(i));
+            for (int t = 0; t < 3; ++t) {
+                session->add_tab("https://" + ws->get_name() + ".example/" + std::to_string(i) + "/" + std::to_string(t));
+            }
+            REQUIRE(pm.save_all());
+        }
+    }
+    // Reorder tabs so position order differs from row id order
+    a->get_session(10)->remove_tab(0);
+    a->get_session(10)->add_tab("https://A.example/10/3");
+    REQUIRE(pm.save_all());
+    
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    
+    REQUIRE(sm2.get_workspace_count() == 2);
+    for (size_t w = 0; w < 2; ++w) {
+        sm2.switch_workspace(w);
+        Workspace* ws = sm2.get_workspace(w);
+        REQUIRE(ws->get_session_count() == 100);
+        for (size_t i = 0; i < 100; ++i) {
+            REQUIRE(ws->get_session(i)->get_name() == ws->get_name() + std::to_string(i));
+            REQUIRE(ws->get_session(i)->get_tab_count() == 3);
+        }
+    }
+    Session* reordered = sm2.get_workspace(0)->get_session(10);
+    REQUIRE(reordered->get_tab(0)->get_url() == "https://A.example/10/1");
+    REQUIRE(reordered->get_tab(2)->get_url() == "https://A.example/10/3");
+    
+    pm.close();
+    pm2.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager loads dormant workspaces on switch", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_lazy.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    sm.reset(false);
+    for (int w = 0; w < 20; ++w) {
+        Workspace* ws = sm.add_workspace("W" + std::to_string(w));
+        for (int s = 0; s < 3; ++s) {
+            Session* session = ws->add_session("S" + std::to_string(s));
+            for (int t = 0; t < 10; ++t) {
+                session->add_tab("https://w" + std::to_string(w) + ".example/" + std::to_string(s) + "/" + std::to_string(t));
+            }
+        }
+    }
+    REQUIRE(pm.save_all());
+    
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    
+    // Only the current workspace is restored; the rest are empty shells
+    REQUIRE(sm2.get_workspace_count() == 20);
+    REQUIRE(sm2.get_workspace(0)->is_loaded());
+    REQUIRE(sm2.get_workspace(0)->get_session_count() == 3);
+    for (size_t w = 1; w < 20; ++w) {
+        REQUIRE_FALSE(sm2.get_workspace(w)->is_loaded());
+        REQUIRE(sm2.get_workspace(w)->get_session_count() == 0);
+    }
+    
+    // Saving with dormant workspaces leaves their rows alone
+    sm2.get_current_tab()->set_title("Edited");
+    REQUIRE(pm2.save_all());
+    REQUIRE(pm2.get_last_save_changes() == 1);
+    
+    // Nor does an edit that reaches a shell before its rows are restored
+    sm2.get_workspace(9)->add_session("Session 1")->add_tab("about:blank");
+    REQUIRE(pm2.save_all());
+    REQUIRE(pm2.get_last_save_changes() == 0);
+    
+    // Switching restores the target workspace on demand
+    sm2.switch_workspace(7);
+    Workspace* ws7 = sm2.get_current_workspace();
+    REQUIRE(ws7->get_name() == "W7");
+    REQUIRE(ws7->is_loaded());
+    REQUIRE(ws7->get_session_count() == 3);
+    REQUIRE(ws7->get_session(2)->get_tab(9)->get_url() == "https://w7.example/2/9");
+    REQUIRE_FALSE(sm2.get_workspace(8)->is_loaded());
+    
+    // A freshly loaded workspace is clean, and edits to it persist
+    REQUIRE(pm2.save_all());
+    REQUIRE(pm2.get_last_save_changes() == 0);
+    ws7->get_session(1)->add_tab("https://w7.example/new");
+    REQUIRE(pm2.save_all());
+    
+    SessionManager sm3;
+    PersistenceManager pm3(&sm3);
+    pm3.set_db_path_for_tests(test_db);
+    REQUIRE(pm3.initialize());
+    REQUIRE(pm3.load_all());
+    sm3.switch_workspace(7);
+    REQUIRE(sm3.get_current_workspace()->get_session(1)->get_tab_count() == 11);
+    sm3.switch_workspace(9);
+    REQUIRE(sm3.get_current_workspace()->get_session_count() == 3);
+    REQUIRE(sm3.get_workspace(0)->get_active_session()->get_active_tab()->get_title() == "Edited");
+    
+    pm.close();
+    pm2.close();
+    pm3.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager seals each workspace into one encrypted blob", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_blobs.db";
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    
+    auto count_rows = [&](const char* table) {
+        sqlite3* db = nullptr;
+        sqlite3_open(test_db.c_str(), &db);
+        sqlite3_stmt* stmt = nullptr;
+        std::string sql = std::string("SELECT COUNT(*) FROM ") + table + ";";
+        sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_step(stmt);
+        int count = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return count;
+    };
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        
+        sm.reset(false);
+        for (int w = 0; w < 3; ++w) {
+            Workspace* ws = sm.add_workspace("W" + std::to_string(w));
+            for (int s = 0; s < 2; ++s) {
+                Session* session = ws->add_session("S" + std::to_string(s));
+                for (int t = 0; t < 5; ++t) {
+                    session->add_tab("https://secret.example/" + std::to_string(w) + "/" + std::to_string(t));
+                }
+            }
+        }
+        REQUIRE(pm.save_all());
+        
+        // One edit re-seals only its own workspace: workspace row + blob
+        sm.get_workspace(1)->get_session(0)->get_tab(2)->set_title("Private");
+        REQUIRE(pm.save_all());
+        REQUIRE(pm.get_last_save_changes() == 2);
+        pm.close();
+    }
+    
+    REQUIRE(count_rows("workspace_blobs") == 3);
+    REQUIRE(count_rows("sessions") == 0);
+    REQUIRE(count_rows("tabs") == 0);
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE(pm.load_all());
+        REQUIRE(sm.get_workspace(0)->get_session(1)->get_tab(4)->get_url() == "https://secret.example/0/4");
+        REQUIRE_FALSE(sm.get_workspace(1)->is_loaded());
+        
+        sm.switch_workspace(1);
+        REQUIRE(sm.get_workspace(1)->get_session(0)->get_tab(2)->get_title() == "Private");
+        REQUIRE(pm.save_all());
+        REQUIRE(pm.get_last_save_changes() == 0);
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("wrong_password"));
+        REQUIRE_FALSE(pm.load_all());
+        pm.close();
+    }
+    
+    // Without a key it would write plaintext rows the blobs shadow
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE_FALSE(pm.initialize());
+        pm.close();
+    }
+    REQUIRE(count_rows("sessions") == 0);
+    
+    // Profiles sealed before the mode was recorded are told by their blobs
+    {
+        sqlite3* db = nullptr;
+        REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(db, "DROP TABLE meta; PRAGMA user_version = 3;", nullptr, nullptr, nullptr) == SQLITE_OK);
+        sqlite3_close(db);
+        
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE_FALSE(pm.initialize());
+        pm.close();
+    }
+    
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
+
+TEST_CASE("PersistenceManager never reuses ids sealed inside blobs", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_blob_ids.db";
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    
+    // Restart, then add a session with one tab to the loaded workspace
+    auto add_session = [&](const std::string& name) {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE(pm.load_all());
+        Session* session = sm.get_workspace(0)->add_session(name);
+        session->add_tab("https://example.com/" + name);
+        REQUIRE(pm.save_all());
+        pm.close();
+    };
+    auto check_tree = [&](size_t sessions) {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE(pm.load_all());
+        Workspace* ws = sm.get_workspace(0);
+        REQUIRE(ws->get_session_count() == sessions);
+        for (size_t i = 1; i < sessions; ++i) {
+            Session* session = ws->get_session(i);
+            REQUIRE(session->get_tab_count() == 1);
+            REQUIRE(session->get_tab(0)->get_url() == "https://example.com/" + session->get_name());
+        }
+        pm.close();
+    };
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        sm.reset(false);
+        Workspace* ws = sm.add_workspace("W");
+        ws->add_session("Overview")->set_overview(true);
+        ws->add_session("A")->add_tab("https://example.com/A");
+        REQUIRE(pm.save_all());
+        pm.close();
+    }
+    
+    // MAX(id) over the (empty) plaintext tables would hand out A's ids again
+    add_session("B");
+    check_tree(3);
+    
+    // A profile sealed before the marks were kept gets them from its blobs
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "DELETE FROM meta WHERE key LIKE 'last_%';", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+    add_session("C");
+    check_tree(4);
+    
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
+
+TEST_CASE("Rekey re-encrypts every row in one transaction", "[crypto]") {
+    Crypto::init();
+    SecureBuffer old_key = Crypto::random_key();
+    SecureBuffer new_key = Crypto::random_key();
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(":memory:", &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "CREATE TABLE rows (id INTEGER PRIMARY KEY, data BLOB NOT NULL);", nullptr, nullptr,
+                         nullptr) == SQLITE_OK);
+
+    // More than one batch, plus a row without ciphertext
+    const size_t count = Rekey::BATCH_ROWS + 100;
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO rows (id, data) VALUES (?, ?);", -1, &insert, nullptr);
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    for (size_t i = 1; i <= count; ++i) {
+        std::string text = "secret " + std::to_string(i);
+        std::vector<unsigned char> sealed = Crypto::encrypt(std::vector<unsigned char>(text.begin(), text.end()), old_key);
+        sqlite3_bind_int64(insert, 1, static_cast<sqlite3_int64>(i));
+        sqlite3_bind_blob(insert, 2, sealed.data(), static_cast<int>(sealed.size()), SQLITE_TRANSIENT);
+        REQUIRE(sqlite3_step(insert) == SQLITE_DONE);
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    sqlite3_exec(db, "INSERT INTO rows (id, data) VALUES (0, X'');", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    auto opened_with = [&](const SecureBuffer& key) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db, "SELECT id, data FROM rows WHERE id > 0 ORDER BY id;", -1, &stmt, nullptr);
+        size_t opened = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 1));
+            std::vector<unsigned char> sealed(data, data + sqlite3_column_bytes(stmt, 1));
+            try {
+                std::vector<unsigned char> plain = Crypto::decrypt(sealed, key);
+                opened += std::string(plain.begin(), plain.end()) ==
+                          "secret " + std::to_string(sqlite3_column_int64(stmt, 0));
+            } catch (const std::exception&) {
+            }
+        }
+        sqlite3_finalize(stmt);
+        return opened;
+    };
+
+    std::vector<std::pair<size_t, size_t>> reports;
+    REQUIRE(Rekey::run(db, "rows", "id", "data", old_key, new_key,
+                       [&](size_t done, size_t total) { reports.emplace_back(done, total); }));
+    REQUIRE(opened_with(new_key) == count);
+    REQUIRE(reports.size() == 2);
+    REQUIRE(reports[0] == std::make_pair(Rekey::BATCH_ROWS, count));
+    REQUIRE(reports[1] == std::make_pair(count, count));
+
+    // A row that does not open (here: a wrong old key) rolls everything back
+    REQUIRE_FALSE(Rekey::run(db, "rows", "id", "data", old_key, new_key));
+    sqlite3_exec(db, "UPDATE rows SET data = X'00112233' WHERE id = 4000;", nullptr, nullptr, nullptr);
+    REQUIRE_FALSE(Rekey::run(db, "rows", "id", "data", new_key, old_key));
+    REQUIRE(sqlite3_get_autocommit(db) != 0);
+    REQUIRE(opened_with(new_key) == count - 1);
+    REQUIRE(opened_with(old_key) == 0);
+    sqlite3_close(db);
+}
+
+TEST_CASE("PersistenceManager re-keys its blobs when the master password changes", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_rekey.db";
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("old_password"));
+        sm.reset(false);
+        for (int w = 0; w < 3; ++w) {
+            Workspace* ws = sm.add_workspace("W" + std::to_string(w));
+            ws->add_session("S")->add_tab("https://rekey.example/" + std::to_string(w));
+        }
+        REQUIRE(pm.save_all());
+        
+        // An unsaved edit is saved under the old key, then re-keyed with the rest
+        sm.get_workspace(2)->get_session(0)->get_tab(0)->set_title("Unsaved");
+        REQUIRE_FALSE(pm.change_master_password("not_it", "new_password"));
+        size_t last_done = 0;
+        size_t last_total = 0;
+        REQUIRE(pm.change_master_password("old_password", "new_password", [&](size_t done, size_t total) {
+            last_done = done;
+            last_total = total;
+        }));
+        REQUIRE(last_done == 3);
+        REQUIRE(last_total == 3);
+        
+        // The store keeps working under the new key
+        sm.get_workspace(0)->get_session(0)->get_tab(0)->set_title("After");
+        REQUIRE(pm.save_all());
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("old_password"));
+        REQUIRE_FALSE(pm.load_all());
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("new_password"));
+        REQUIRE(pm.load_all());
+        REQUIRE(sm.get_workspace(0)->get_session(0)->get_tab(0)->get_title() == "After");
+        sm.switch_workspace(2);
+        REQUIRE(sm.get_workspace(2)->get_session(0)->get_tab(0)->get_title() == "Unsaved");
+        pm.close();
+    }
+    
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
+
+TEST_CASE("PersistenceManager moves plaintext rows into blobs once a password is set", "[persistence]") {
+    std::string test_db = "/tmp/test_ryxsurf_blob_migrate.db";
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize());
+        Session* session = sm.add_workspace("Plain")->add_session("S");
+        session->add_tab("https://plain.example/");
+        REQUIRE(pm.save_all());
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE(pm.load_all());
+        REQUIRE(sm.get_workspace(0)->get_session(0)->get_tab(0)->get_url() == "https://plain.example/");
+        REQUIRE(pm.save_all());
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE(pm.load_all());
+        REQUIRE(sm.get_workspace(0)->get_session(0)->get_tab(0)->get_url() == "https://plain.example/");
+        
+        // The plaintext rows are gone from the tables
+        sqlite3* db = nullptr;
+        REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+        sqlite3_stmt* stmt = nullptr;
+        REQUIRE(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM tabs;", -1, &stmt, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        REQUIRE(sqlite3_column_int(stmt, 0) == 0);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        pm.close();
+    }
+    
+    for (const char* suffix : {"", ".salt", ".journal"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
+
+TEST_CASE("PersistenceManager autosave hands off to the writer thread", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_writer.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    Session* session = sm.add_workspace("Async")->add_session("S");
+    for (int i = 0; i < 500; ++i) {
+        session->add_tab("https://example.com/" + std::to_string(i));
+    }
+    
+    // The tick only snapshots; the final save waits for the queued rows
+    pm.queue_autosave();
+    REQUIRE(pm.get_last_autosave_stall_us() >= 0);
+    session->get_tab(0)->set_title("After autosave");
+    REQUIRE(pm.save_all());
+    // The writer may already have committed the queued rows: 503 at most
+    // (workspace + session + 500 tabs + 1 update), and the update at least
+    REQUIRE(pm.get_last_save_changes() >= 1);
+    REQUIRE(pm.get_last_save_changes() <= 503);
+    
+    // An idle tick queues nothing
+    pm.queue_autosave();
+    REQUIRE(pm.save_all());
+    REQUIRE(pm.get_last_save_changes() == 0);
+    
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    REQUIRE(sm2.get_workspace(0)->get_session(0)->get_tab_count() == 500);
+    REQUIRE(sm2.get_workspace(0)->get_session(0)->get_tab(0)->get_title() == "After autosave");
+    
+    pm.close();
+    pm2.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager keeps a change set whose session row fails", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_writer_fail.db";
+    std::filesystem::remove(test_db);
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    // Session names are unique per workspace in the schema, not in the model
+    Workspace* ws = sm.add_workspace("Dup");
+    ws->add_session("S")->add_tab("https://example.com/first");
+    ws->add_session("S")->add_tab("https://example.com/second");
+    REQUIRE_FALSE(pm.save_all());
+    
+    // Nothing from the failed set was committed: only the default workspace loads
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    REQUIRE(sm2.get_workspace_count() == 1);
+    REQUIRE(sm2.get_workspace(0)->get_name() != "Dup");
+    
+    pm.close();
+    pm2.close();
+    std::filesystem::remove(test_db);
+}
+
+TEST_CASE("PersistenceManager replays the journal after a crash", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_journal.db";
+    std::string crash_db = "/tmp/test_ryxsurf_journal_crash.db";
+    for (const std::string& path : {test_db, crash_db}) {
+        for (const char* suffix : {"", "-wal", "-shm", ".journal", ".journal.1"}) {
+            std::filesystem::remove(path + suffix);
+        }
+    }
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    Workspace* ws = sm.add_workspace("Journal");
+    Session* first = ws->add_session("First");
+    ws->add_session("Second");
+    for (int i = 0; i < 100; ++i) {
+        first->add_tab("https://example.com/" + std::to_string(i));
+    }
+    REQUIRE(pm.save_all());
+    REQUIRE(std::filesystem::file_size(test_db + ".journal") == 8);  // Header only
+    
+    // New tab, close, navigate and session switch go out as one small batch
+    uint64_t bytes_before = pm.get_journal_bytes_written();
+    first->add_tab("https://new.example/");
+    first->remove_tab(99);
+    first->get_tab(5)->set_url("https://navigated.example/");
+    ws->set_active_session(1);
+    REQUIRE(pm.journal_changes());
+    REQUIRE_FALSE(pm.journal_changes());  // Nothing new since
+    pm.flush_journal();
+    REQUIRE(pm.get_journal_bytes_written() - bytes_before < 200);
+    
+    // A title change lands in a second batch
+    first->get_tab(6)->set_title("Retitled");
+    REQUIRE(pm.journal_changes());
+    pm.flush_journal();
+    
+    // "Crash": copy the files as they are now, without any checkpoint
+    auto copy_crash_state = [&](uintmax_t journal_trim) {
+        for (const char* suffix : {"", "-wal", ".journal"}) {
+            std::filesystem::remove(crash_db + suffix);
+            if (std::filesystem::exists(test_db + suffix)) {
+                std::filesystem::copy_file(test_db + suffix, crash_db + suffix);
+            }
+        }
+        std::filesystem::resize_file(crash_db + ".journal",
+                                     std::filesystem::file_size(crash_db + ".journal") - journal_trim);
+    };
+    
+    SECTION("every journaled batch is replayed") {
+        copy_crash_state(0);
+        SessionManager sm2;
+        PersistenceManager pm2(&sm2);
+        pm2.set_db_path_for_tests(crash_db);
+        REQUIRE(pm2.initialize());
+        REQUIRE(pm2.load_all());
+        
+        Session* restored = sm2.get_workspace(0)->get_session(0);
+        REQUIRE(restored->get_tab_count() == 100);
+        REQUIRE(restored->get_tab(5)->get_url() == "https://navigated.example/");
+        REQUIRE(restored->get_tab(6)->get_title() == "Retitled");
+        REQUIRE(restored->get_tab(99)->get_url() == "https://new.example/");
+        
+        // Replay compacted the journal into the database
+        REQUIRE(std::filesystem::file_size(crash_db + ".journal") == 8);
+        pm2.close();
+    }
+    
+    SECTION("a torn last record is dropped") {
+        copy_crash_state(3);
+        SessionManager sm2;
+        PersistenceManager pm2(&sm2);
+        pm2.set_db_path_for_tests(crash_db);
+        REQUIRE(pm2.initialize());
+        REQUIRE(pm2.load_all());
+        
+        Session* restored = sm2.get_workspace(0)->get_session(0);
+        REQUIRE(restored->get_tab_count() == 100);
+        REQUIRE(restored->get_tab(5)->get_url() == "https://navigated.example/");
+        REQUIRE(restored->get_tab(6)->get_title() != "Retitled");
+        pm2.close();
+    }
+    
+    pm.close();
+    for (const std::string& path : {test_db, crash_db}) {
+        for (const char* suffix : {"", "-wal", "-shm", ".journal", ".journal.1"}) {
+            std::filesystem::remove(path + suffix);
+        }
+    }
+}
+
+TEST_CASE("PersistenceManager compacts the journal into the database", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_journal_compact.db";
+    for (const char* suffix : {"", ".journal", ".journal.1"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize());
+    
+    Session* session = sm.add_workspace("Compact")->add_session("S");
+    for (int i = 0; i < 20; ++i) {
+        session->add_tab("https://example.com/" + std::to_string(i));
+        REQUIRE(pm.journal_changes());
+    }
+    pm.flush_journal();
+    REQUIRE(std::filesystem::file_size(test_db + ".journal") > 8);
+    
+    // Compaction seals the batches and hands them to the writer
+    pm.compact_journal();
+    session->get_tab(0)->set_title("Later");
+    REQUIRE(pm.journal_changes());
+    REQUIRE(pm.save_all());
+    REQUIRE_FALSE(std::filesystem::exists(test_db + ".journal.1"));
+    REQUIRE(std::filesystem::file_size(test_db + ".journal") == 8);
+    
+    SessionManager sm2;
+    PersistenceManager pm2(&sm2);
+    pm2.set_db_path_for_tests(test_db);
+    REQUIRE(pm2.initialize());
+    REQUIRE(pm2.load_all());
+    REQUIRE(sm2.get_workspace(0)->get_session(0)->get_tab_count() == 20);
+    REQUIRE(sm2.get_workspace(0)->get_session(0)->get_tab(0)->get_title() == "Later");
+    
+    pm.close();
+    pm2.close();
+    for (const char* suffix : {"", ".journal", ".journal.1"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
+
+TEST_CASE("PersistenceManager journals sealed deltas for encrypted profiles", "[persistence]") {
+    SessionManager sm;
+    PersistenceManager pm(&sm);
+    
+    std::string test_db = "/tmp/test_ryxsurf_journal_sealed.db";
+    std::string crash_db = "/tmp/test_ryxsurf_journal_sealed_crash.db";
+    auto remove_files = [&] {
+        for (const std::string& path : {test_db, crash_db}) {
+            for (const char* suffix : {"", "-wal", "-shm", ".salt", ".journal", ".journal.1"}) {
+                std::filesystem::remove(path + suffix);
+            }
+        }
+    };
+    remove_files();
+    pm.set_db_path_for_tests(test_db);
+    REQUIRE(pm.initialize("test_password"));
+    
+    sm.reset(false);
+    Workspace* ws = sm.add_workspace("Sealed");
+    Session* first = ws->add_session("First");
+    ws->add_session("Second");
+    for (int i = 0; i < 100; ++i) {
+        first->add_tab("https://secret.example/" + std::to_string(i));
+    }
+    REQUIRE(pm.save_all());
+    
+    // A title change is sealed on its own, not with the other 99 tabs
+    uint64_t bytes_before = pm.get_journal_bytes_written();
+    first->get_tab(6)->set_title("Private title");
+    REQUIRE(pm.journal_changes());
+    pm.flush_journal();
+    REQUIRE(pm.get_journal_bytes_written() - bytes_before < 200);
+    
+    first->add_tab("https://new.example/");
+    first->remove_tab(99);
+    REQUIRE(pm.journal_changes());
+    pm.flush_journal();
+    
+    std::ifstream journal_in(test_db + ".journal", std::ios::binary);
+    std::string journal((std::istreambuf_iterator<char>(journal_in)), std::istreambuf_iterator<char>());
+    REQUIRE(journal.find("Private title") == std::string::npos);
+    REQUIRE(journal.find("new.example") == std::string::npos);
+    
+    // "Crash", then recover with the wrong password and the right one
+    for (const char* suffix : {"", "-wal", ".salt", ".journal"}) {
+        if (std::filesystem::exists(test_db + suffix)) {
+            std::filesystem::copy_file(test_db + suffix, crash_db + suffix);
+        }
+    }
+    {
+        SessionManager sm2;
+        PersistenceManager pm2(&sm2);
+        pm2.set_db_path_for_tests(crash_db);
+        REQUIRE(pm2.initialize("wrong_password"));
+        REQUIRE_FALSE(pm2.load_all());
+        pm2.close();
+        REQUIRE(std::filesystem::file_size(crash_db + ".journal") > 8);  // Kept for the right key
+    }
+    {
+        SessionManager sm2;
+        PersistenceManager pm2(&sm2);
+        pm2.set_db_path_for_tests(crash_db);
+        REQUIRE(pm2.initialize("test_password"));
+        REQUIRE(pm2.load_all());
+        
+        Workspace* restored_ws = sm2.get_workspace(0);
+        REQUIRE(restored_ws->get_session_count() == 2);
+        Session* restored = restored_ws->get_session(0);
+        REQUIRE(restored->get_tab_count() == 100);
+        REQUIRE(restored->get_tab(6)->get_title() == "Private title");
+        REQUIRE(restored->get_tab(98)->get_url() == "https://secret.example/98");
+        REQUIRE(restored->get_tab(99)->get_url() == "https://new.example/");
+        REQUIRE(std::filesystem::file_size(crash_db + ".journal") == 8);
+        pm2.close();
+    }
+    
+    // Compaction folds the deltas into the blob; no plaintext row is written
+    pm.compact_journal();
+    first->get_tab(7)->set_title("Later");
+    REQUIRE(pm.journal_changes());
+    REQUIRE(pm.save_all());
+    pm.close();
+    {
+        sqlite3* db = nullptr;
+        REQUIRE(sqlite3_open(test_db.c_str(), &db) == SQLITE_OK);
+        sqlite3_stmt* stmt = nullptr;
+        REQUIRE(sqlite3_prepare_v2(db, "SELECT (SELECT COUNT(*) FROM sessions) + (SELECT COUNT(*) FROM tabs);",
+                                   -1, &stmt, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        REQUIRE(sqlite3_column_int(stmt, 0) == 0);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        
+        SessionManager sm2;
+        PersistenceManager pm2(&sm2);
+        pm2.set_db_path_for_tests(test_db);
+        REQUIRE(pm2.initialize("test_password"));
+        REQUIRE(pm2.load_all());
+        Session* restored = sm2.get_workspace(0)->get_session(0);
+        REQUIRE(restored->get_tab_count() == 100);
+        REQUIRE(restored->get_tab(6)->get_title() == "Private title");
+        REQUIRE(restored->get_tab(7)->get_title() == "Later");
+        REQUIRE(restored->get_tab(99)->get_url() == "https://new.example/");
+        pm2.close();
+    }
+    
+    remove_files();
+}
+
+TEST_CASE("SessionSnapshot round-trips the session tree through a mapping", "[persistence][snapshot]") {
+    std::string path = "/tmp/test_ryxsurf_snapshot.bin";
+    std::filesystem::remove(path);
+    
+    SessionManager sm;
+    sm.reset(false);
+    Workspace* work = sm.add_workspace("Work");
+    Session* overview = work->add_session("Overview");
+    overview->set_overview(true);
+    Session* research = work->add_session("Research");
+    for (int i = 0; i < 50; ++i) {
+        research->add_tab("https://research.example/" + std::to_string(i))->set_title("Paper " + std::to_string(i));
+    }
+    research->set_active_tab(7);
+    Workspace* dormant = sm.add_workspace("Dormant");
+    dormant->set_loaded(false);
+    
+    REQUIRE(SessionSnapshot::write(path, &sm));
+    REQUIRE_FALSE(std::filesystem::exists(path + ".tmp"));
+    
+    SessionSnapshot snapshot;
+    REQUIRE(snapshot.open(path));
+    REQUIRE(snapshot.get_workspace_count() == 2);
+    REQUIRE(snapshot.get_session_count() == 2);
+    REQUIRE(snapshot.get_tab_count() == 50);
+    
+    const auto& ws = snapshot.get_workspace(0);
+    REQUIRE(snapshot.get_string(ws.name) == "Work");
+    REQUIRE(ws.session_count == 2);
+    REQUIRE(ws.active_session == 1);
+    REQUIRE(snapshot.get_session(ws.first_session).flags == SessionSnapshot::SESSION_OVERVIEW);
+    
+    REQUIRE(snapshot.verify_session(ws.first_session + 1));
+    const auto& session = snapshot.get_session(ws.first_session + 1);
+    REQUIRE(snapshot.get_string(session.name) == "Research");
+    REQUIRE(session.tab_count == 50);
+    REQUIRE(session.active_tab == 7);
+    const auto& tab = snapshot.get_tab(session.first_tab + 42);
+    REQUIRE(snapshot.get_string(tab.url) == "https://research.example/42");
+    REQUIRE(snapshot.get_string(tab.title) == "Paper 42");
+    
+    REQUIRE(snapshot.get_workspace(1).flags == SessionSnapshot::WORKSPACE_DORMANT);
+    REQUIRE(snapshot.get_workspace(1).session_count == 0);
+    snapshot.close();
+    
+    auto flip_byte = [&](std::streamoff offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char c = 0;
+        file.get(c);
+        file.seekp(offset);
+        file.put(static_cast<char>(c ^ 0x20));
+    };
+    
+    SECTION("a flipped byte in the records fails open") {
+        flip_byte(sizeof(SessionSnapshot::Header) + 8);
+        REQUIRE_FALSE(snapshot.open(path));
+    }
+    
+    SECTION("a flipped byte in a tab fails only that session") {
+        // The last bytes belong to the Research session's final tab
+        flip_byte(static_cast<std::streamoff>(std::filesystem::file_size(path) - 3));
+        REQUIRE(snapshot.open(path));
+        REQUIRE(snapshot.verify_session(0));
+        REQUIRE_FALSE(snapshot.verify_session(1));
+    }
+    
+    SECTION("a truncated file is rejected") {
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        REQUIRE_FALSE(snapshot.open(path));
+    }
+    
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("PersistenceManager snapshot lives from clean shutdown to next load", "[persistence][snapshot]") {
+    std::string test_db = "/tmp/test_ryxsurf_snapshot_pm.db";
+    for (const char* suffix : {"", ".salt", ".journal", ".snapshot"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize());
+        sm.add_workspace("Snap")->add_session("S")->add_tab("https://snap.example/");
+        REQUIRE(pm.save_all());
+        REQUIRE(pm.write_snapshot());
+        pm.close();
+    }
+    
+    {
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        
+        SessionSnapshot snapshot;
+        REQUIRE(snapshot.open(pm.get_snapshot_path()));
+        REQUIRE(snapshot.get_string(snapshot.get_tab(0).url) == "https://snap.example/");
+        
+        REQUIRE(pm.initialize());
+        REQUIRE(pm.load_all());
+        REQUIRE_FALSE(std::filesystem::exists(pm.get_snapshot_path()));
+        // The mapping outlives the file
+        REQUIRE(snapshot.get_string(snapshot.get_tab(0).url) == "https://snap.example/");
+        pm.close();
+    }
+    
+    {
+        // Encrypted profiles never write a plaintext snapshot
+        SessionManager sm;
+        PersistenceManager pm(&sm);
+        pm.set_db_path_for_tests(test_db);
+        REQUIRE(pm.initialize("test_password"));
+        REQUIRE_FALSE(pm.write_snapshot());
+        REQUIRE_FALSE(std::filesystem::exists(pm.get_snapshot_path()));
+        pm.close();
+    }
+    
+    for (const char* suffix : {"", ".salt", ".journal", ".snapshot"}) {
+        std::filesystem::remove(test_db + suffix);
+    }
+}
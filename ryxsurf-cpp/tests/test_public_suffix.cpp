@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+#include "../include/public_suffix.h"
+#include <fstream>
+
+TEST_CASE("url_host strips everything but the host", "[public_suffix]") {
+    REQUIRE(url_host("https://example.com/login?next=/") == "example.com");
+    REQUIRE(url_host("https://accounts.example.co.uk:8443/") == "accounts.example.co.uk");
+    REQUIRE(url_host("https://user:p@ss@example.com/") == "example.com");
+    REQUIRE(url_host("https://example.com@evil.test/") == "evil.test");
+    REQUIRE(url_host("http://[2001:db8::1]:8080/path") == "2001:db8::1");
+    REQUIRE(url_host("https://example.com./") == "example.com");
+    REQUIRE(url_host("https://example.com#frag") == "example.com");
+    REQUIRE(url_host("example.com/login") == "example.com");
+    REQUIRE(url_host("example.com:8080") == "example.com");
+    REQUIRE(url_host("//cdn.example.com/lib.js") == "cdn.example.com");
+    REQUIRE(url_host("about:blank").empty());
+    REQUIRE(url_host("file:///home/user/page.html").empty());
+    REQUIRE(url_host("https://example.com:http/").empty());
+}
+
+TEST_CASE("Registrable domains follow public suffix rules", "[public_suffix]") {
+    PublicSuffixList psl;  // Built-in rules
+    
+    REQUIRE(psl.registrable_domain("example.com") == "example.com");
+    REQUIRE(psl.registrable_domain("www.example.com") == "example.com");
+    REQUIRE(psl.registrable_domain("accounts.example.co.uk") == "example.co.uk");
+    REQUIRE(psl.registrable_domain("example.co.uk") == "example.co.uk");
+    REQUIRE(psl.registrable_domain("Accounts.Example.CO.UK") == "Example.CO.UK");
+    REQUIRE(psl.public_suffix("accounts.example.co.uk") == "co.uk");
+    
+    // A public suffix has no registrable domain of its own
+    REQUIRE(psl.registrable_domain("co.uk").empty());
+    REQUIRE(psl.registrable_domain("com").empty());
+    
+    // Unknown TLDs fall back to the implicit "*" rule
+    REQUIRE(psl.registrable_domain("a.b.example.unknowntld") == "example.unknowntld");
+    
+    // Wildcards and exceptions
+    REQUIRE(psl.registrable_domain("shop.foo.kawasaki.jp") == "shop.foo.kawasaki.jp");
+    REQUIRE(psl.public_suffix("shop.foo.kawasaki.jp") == "foo.kawasaki.jp");
+    REQUIRE(psl.registrable_domain("www.city.kawasaki.jp") == "city.kawasaki.jp");
+    REQUIRE(psl.registrable_domain("www.ck") == "www.ck");
+    REQUIRE(psl.registrable_domain("foo.bar.ck") == "foo.bar.ck");
+    
+    // Private registries keep tenants apart
+    REQUIRE(psl.registrable_domain("alice.github.io") == "alice.github.io");
+    REQUIRE(psl.registrable_domain("docs.alice.github.io") == "alice.github.io");
+    
+    // IP literals are their own "domain"
+    REQUIRE(psl.registrable_domain("192.168.1.10") == "192.168.1.10");
+    REQUIRE(psl.registrable_domain("2001:db8::1") == "2001:db8::1");
+    REQUIRE(psl.registrable_domain("").empty());
+}
+
+TEST_CASE("PublicSuffixList loads the .dat format", "[public_suffix]") {
+    PublicSuffixList psl;
+    REQUIRE(psl.load("// comment\n\nexample\n*.wild.example\n!keep.wild.example\nsub.example  trailing text\r\n"));
+    REQUIRE(psl.rule_count() == 4);
+    
+    REQUIRE(psl.registrable_domain("a.b.example") == "b.example");
+    REQUIRE(psl.registrable_domain("a.b.sub.example") == "b.sub.example");
+    REQUIRE(psl.registrable_domain("a.b.wild.example") == "a.b.wild.example");
+    REQUIRE(psl.registrable_domain("a.keep.wild.example") == "keep.wild.example");
+    // The built-in rules are gone
+    REQUIRE(psl.registrable_domain("a.example.co.uk") == "co.uk");
+    
+    REQUIRE_FALSE(psl.load("// only comments\n"));
+    REQUIRE(psl.rule_count() == 4);
+    REQUIRE_FALSE(psl.load_file("/nonexistent/public_suffix_list.dat"));
+}
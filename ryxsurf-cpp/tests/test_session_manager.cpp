@@ -2,6 +2,7 @@
 #include "../include/session_manager.h"
 #include "../include/workspace.h"
 #include "../include/session.h"
+#include <vector>
 
 TEST_CASE("SessionManager initialization", "[session_manager]") {
     SessionManager sm;
@@ -99,3 +100,173 @@ TEST_CASE("Overview session persistence", "[session]") {
     // Overview session can be empty; no-op assertion needed
     REQUIRE((session.is_empty() || !session.is_empty()));
 }
+
+TEST_CASE("Session reports tab changes to its observers", "[session][events]") {
+    Session session("Events");
+    std::vector<SessionEvent> events;
+    session.add_observer([&](const SessionEvent& e) { events.push_back(e); });
+    
+    Tab* a = session.add_tab("https://a.example/");
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].type == SessionEventType::TabAdded);
+    REQUIRE(events[0].tab == a);
+    REQUIRE(events[0].session == &session);
+    REQUIRE(events[0].index == 0);
+    REQUIRE(events[1].type == SessionEventType::TabActivated);
+    
+    Tab* b = session.add_tab("https://b.example/");
+    Tab* c = session.add_tab("https://c.example/");
+    events.clear();
+    
+    b->set_title("B");
+    b->set_title("B");  // Unchanged: no event
+    c->set_url("https://c.example/next");
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].type == SessionEventType::TabRetitled);
+    REQUIRE(events[0].tab == b);
+    REQUIRE(events[0].index == SessionEvent::npos);
+    REQUIRE(events[1].type == SessionEventType::TabNavigated);
+    REQUIRE(events[1].tab == c);
+    events.clear();
+    
+    // c is active; moving it to the front keeps it active
+    session.move_tab(2, 0);
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::TabMoved);
+    REQUIRE(events[0].tab == c);
+    REQUIRE(events[0].old_index == 2);
+    REQUIRE(events[0].index == 0);
+    REQUIRE(session.get_tab(0) == c);
+    REQUIRE(session.get_tab(1) == a);
+    REQUIRE(session.get_tab(2) == b);
+    REQUIRE(session.get_active_tab() == c);
+    events.clear();
+    
+    session.set_active_tab(2);
+    session.set_active_tab(2);  // Already active: no event
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::TabActivated);
+    REQUIRE(events[0].tab == b);
+    events.clear();
+    
+    // Removing the active tab reports the removal, then the new active tab
+    session.remove_tab(2);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].type == SessionEventType::TabRemoved);
+    REQUIRE(events[0].tab == b);
+    REQUIRE(events[0].index == 2);
+    REQUIRE(events[1].type == SessionEventType::TabActivated);
+    REQUIRE(events[1].tab == a);
+    events.clear();
+    
+    session.remove_tab(0);  // Not the active tab
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::TabRemoved);
+    REQUIRE(session.get_active_tab() == a);
+}
+
+TEST_CASE("SessionManager observers see events from the whole tree", "[session_manager][events]") {
+    SessionManager sm;
+    std::vector<SessionEvent> events;
+    sm.add_observer([&](const SessionEvent& e) { events.push_back(e); });
+    
+    Workspace* ws = sm.add_workspace("Second");
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::WorkspaceAdded);
+    REQUIRE(events[0].workspace == ws);
+    REQUIRE(events[0].index == 1);
+    
+    Session* session = ws->add_session("S");
+    Tab* tab = session->add_tab("https://example.com/");
+    events.clear();
+    
+    // Each level fills in its own pointer on the way up
+    tab->set_title("Example");
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::TabRetitled);
+    REQUIRE(events[0].workspace == ws);
+    REQUIRE(events[0].session == session);
+    REQUIRE(events[0].tab == tab);
+    events.clear();
+    
+    sm.switch_workspace(1);
+    sm.switch_workspace(1);  // Already current: no event
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::WorkspaceActivated);
+    REQUIRE(events[0].index == 1);
+    events.clear();
+    
+    ws->add_session("T");
+    sm.switch_session(0);
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].type == SessionEventType::SessionAdded);
+    REQUIRE(events[1].type == SessionEventType::SessionActivated);
+    REQUIRE(events[2].type == SessionEventType::SessionActivated);
+    REQUIRE(events[2].session == session);
+    events.clear();
+    
+    sm.close_current_tab();
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].type == SessionEventType::TabRemoved);
+    REQUIRE(events[0].workspace == ws);
+    REQUIRE(events[0].tab == tab);
+    events.clear();
+    
+    // Removing the active session reports the removal, then the new active one
+    ws->remove_session(0);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].type == SessionEventType::SessionRemoved);
+    REQUIRE(events[0].session == session);
+    REQUIRE(events[0].index == 0);
+    REQUIRE(events[1].type == SessionEventType::SessionActivated);
+    REQUIRE(events[1].session == ws->get_session(0));
+    events.clear();
+    
+    Workspace* dormant = sm.add_workspace("Dormant");
+    dormant->set_loaded(false);
+    sm.set_workspace_loader([](Workspace* w) {
+        w->set_loaded(true);
+        return true;
+    });
+    events.clear();
+    sm.switch_workspace(2);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].type == SessionEventType::WorkspaceLoaded);
+    REQUIRE(events[0].workspace == dormant);
+    REQUIRE(events[1].type == SessionEventType::WorkspaceActivated);
+    events.clear();
+    
+    sm.reset(false);
+    REQUIRE(events.size() == 3);
+    for (const auto& e : events) {
+        REQUIRE(e.type == SessionEventType::WorkspaceRemoved);
+    }
+}
+
+TEST_CASE("Observers can be removed from inside a callback", "[session_manager][events]") {
+    SessionManager sm;
+    int first = 0;
+    int second = 0;
+    SessionObserverList::ObserverId first_id = 0;
+    first_id = sm.add_observer([&](const SessionEvent&) {
+        ++first;
+        sm.remove_observer(first_id);
+    });
+    sm.add_observer([&](const SessionEvent&) { ++second; });
+    
+    sm.add_workspace("A");
+    sm.add_workspace("B");
+    REQUIRE(first == 1);
+    REQUIRE(second == 2);
+    
+    // An observer added mid-notify only sees later events
+    int late = 0;
+    SessionObserverList::ObserverId adder = sm.add_observer([&](const SessionEvent&) {
+        sm.add_observer([&](const SessionEvent&) { ++late; });
+    });
+    sm.add_workspace("C");
+    sm.remove_observer(adder);
+    REQUIRE(late == 0);
+    sm.add_workspace("D");
+    REQUIRE(late == 1);
+}